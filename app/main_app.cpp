@@ -3,17 +3,9 @@
 #include "raceup_setup.h"
 #include "FreeRTOS.h"
 #include "task.h"
-#include "queue.h"
-#include <cstring>
-
-// ------------------------------------------------------ Data Structures
-
-/// @brief Structure to hold CAN message data in the FreeRTOS Queue
-typedef struct {
-  uint16_t id;
-  uint8_t data[8];
-  uint8_t len;
-} CanRxMessage_t;
+#include "log_backend.hpp"
+#include "serial.hpp"
+#include <stdio.h>
 
 // ------------------------------------------------------ Function Prototypes
 
@@ -21,9 +13,12 @@ typedef struct {
 static void StartDefaultTask(void *arg);
 static void StartCanRxTask(void *arg);
 static void StartCanTxTask(void *arg);
+static void StartCanHpTask(void *arg);
+static void StartLogTask(void *arg);
 
-// FDCAN Rx Callback Prototypes
-static void Fdcan1RxCallback(uint16_t id, uint8_t* data, uint8_t len);
+// FDCAN Rx Notify Prototypes
+static void CanRxNotify(void* ctx);
+static void CanHpNotify(void* ctx);
 
 static void BlinkGPIO(GPIO_TypeDef* bank, uint16_t pin, uint32_t duration);
 
@@ -42,46 +37,83 @@ static StackType_t can_tx_taskStack[512];
 static StaticTask_t can_tx_taskTcb;
 
 
+static StackType_t can_hp_taskStack[256];
+static StaticTask_t can_hp_taskTcb;
+
+
+static StackType_t log_taskStack[384];
+static StaticTask_t log_taskTcb;
+
 
-// Rx Queue (Holds up to 10 incoming CAN messages)
-#define RX_QUEUE_LENGTH 10
-#define RX_QUEUE_ITEM_SIZE sizeof(CanRxMessage_t)
-static uint8_t rxQueueStorage[RX_QUEUE_LENGTH * RX_QUEUE_ITEM_SIZE];
-static StaticQueue_t rxQueueStruct;
-static QueueHandle_t rxQueueHandle;
+
+// Rx Subscribers (each holds up to 16 incoming CAN frames, one per FDCAN instance)
+#define RX_RING_LENGTH 16
+static RUP_FDCAN_FrameTypeDef fdcan1RxRing[RX_RING_LENGTH];
+static RUP_FDCAN_SubscriberTypeDef fdcan1RxSubscriber;
+static TaskHandle_t rxTaskHandle;
+
+// High Priority fast lane rings (emergency frames never share a ring with telemetry)
+#define HP_RING_LENGTH 4
+static RUP_FDCAN_FrameTypeDef fdcan1HpRing[HP_RING_LENGTH];
+static RUP_FDCAN_SubscriberTypeDef fdcan1HpSubscriber;
+static TaskHandle_t hpTaskHandle;
 
 // ------------------------------------------------------ Application Entry
 void app_start(void) {
-  // 1. Create the FreeRTOS Queue for Rx messages
-  rxQueueHandle = xQueueCreateStatic(RX_QUEUE_LENGTH, RX_QUEUE_ITEM_SIZE, rxQueueStorage, &rxQueueStruct);
-  
   config_FDCAN();
+  config_USART();
   config_GPIO();
 
+  // 1. Subscribe the Rx task to every ID that passes the filters
+  RUP_FDCAN_SubscriberInit(&fdcan1RxSubscriber, fdcan1RxRing, RX_RING_LENGTH, CanRxNotify, NULL);
+  RUP_FDCAN_Subscribe(FDCAN1, &fdcan1RxSubscriber, 0x000, 0x7FF);
+
+  // 2. Route frames matched by HP filters to the High Priority task
+  RUP_FDCAN_SubscriberInit(&fdcan1HpSubscriber, fdcan1HpRing, HP_RING_LENGTH, CanHpNotify, NULL);
+  RUP_FDCAN_SetHpSubscriber(FDCAN1, &fdcan1HpSubscriber);
+
   // 3. Create Tasks dynamically
   xTaskCreateStatic(StartDefaultTask, "default_task", 256, NULL, 3, default_taskStack, &default_taskTcb);
-  xTaskCreateStatic(StartCanRxTask, "can_rx_task", 512, NULL, 5, can_rx_taskStack, &can_rx_taskTcb);
+  rxTaskHandle = xTaskCreateStatic(StartCanRxTask, "can_rx_task", 512, NULL, 5, can_rx_taskStack, &can_rx_taskTcb);
   xTaskCreateStatic(StartCanTxTask, "can_tx_task", 512, NULL, 5, can_tx_taskStack, &can_tx_taskTcb);
+  hpTaskHandle = xTaskCreateStatic(StartCanHpTask, "can_hp_task", 256, NULL, 6, can_hp_taskStack, &can_hp_taskTcb);
+  xTaskCreateStatic(StartLogTask, "log_task", 384, NULL, 1, log_taskStack, &log_taskTcb);
 }
 
-// ------------------------------------------------------ FDCAN Rx Callbacks (ISR Context)
-static void Fdcan1RxCallback(uint16_t id, uint8_t* data, uint8_t len) {
-  // NOTE: This runs in the hardware interrupt context!
-  
-  CanRxMessage_t msg;
-  msg.id = id;
-  msg.len = len;
-  std::memcpy(msg.data, data, len); // Copy data before leaving callback
+// ------------------------------------------------------ FDCAN Rx Notify (ISR Context)
+static void CanRxNotify(void* ctx) {
+  // NOTE: This runs in the hardware interrupt context, after a frame has been queued!
+  (void)ctx;
+
+  if (rxTaskHandle == NULL) {
+    return;
+  }
 
   BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-  
-  // Safely send data to the queue from an ISR
-  xQueueSendFromISR(rxQueueHandle, &msg, &xHigherPriorityTaskWoken);
+
+  // Wake the Rx task; it drains its rings, so one notification covers any number of frames
+  vTaskNotifyGiveFromISR(rxTaskHandle, &xHigherPriorityTaskWoken);
 
   // Yield if waking the Rx task requires a context switch
   portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
+// ------------------------------------------------------ FDCAN HP Notify (ISR Context)
+static void CanHpNotify(void* ctx) {
+  // NOTE: Called from the FDCAN IT0 interrupt as soon as an HP frame is fetched
+  (void)ctx;
+
+  if (hpTaskHandle == NULL) {
+    return;
+  }
+
+  BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+  vTaskNotifyGiveFromISR(hpTaskHandle, &xHigherPriorityTaskWoken);
+
+  // The HP task outranks every other task: switch to it on interrupt exit
+  portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
 // ------------------------------------------------------ Task Implementations
 static void StartDefaultTask(void *arg) {
   // Default Task Loop
@@ -93,15 +125,18 @@ static void StartDefaultTask(void *arg) {
 
 
 static void StartCanRxTask(void *arg) {
-  CanRxMessage_t received_msg;
+  RUP_FDCAN_FrameTypeDef received_msg;
 
   for (;;) {
-    // Block indefinitely until a message arrives in the queue
-    if (xQueueReceive(rxQueueHandle, &received_msg, portMAX_DELAY) == pdTRUE) {
+    // Block indefinitely until the ISR queues a frame in one of our rings
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    while (RUP_FDCAN_SubscriberPop(&fdcan1RxSubscriber, &received_msg)) {
       // Process the received message here safely in a task context!
       
       // Example: You can now safely check received_msg.id or received_msg.data
-      // without stalling the FDCAN peripheral.
+      // without stalling the FDCAN peripheral. Frames lost because this task
+      // fell behind are counted by RUP_FDCAN_SubscriberGetDropped().
     }
   }
 }
@@ -119,6 +154,31 @@ static void StartCanTxTask(void *arg) {
 }
 
 
+static void StartCanHpTask(void *arg) {
+  RUP_FDCAN_FrameTypeDef hp_msg;
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    while (RUP_FDCAN_HpPop(FDCAN1, &hp_msg)) {
+      // Emergency stop / shutdown handling goes here. The latency of each frame
+      // from receipt to this pop is recorded, see RUP_FDCAN_GetHpStats().
+    }
+  }
+}
+
+
+static void StartLogTask(void *arg) {
+  (void)arg;
+  static ru::driver::Serial log_serial;
+  const ru::driver::SerialConfig log_config(ru::driver::SerialId::serial_debug, 115200);
+
+  // Without the port the log text stays in RAM (ru::driver::debug::log_ram_text())
+  auto inited = log_serial.init(log_config);
+  ru::driver::debug::log_drain_loop(inited ? &log_serial : nullptr, 10);
+}
+
+
 static void BlinkGPIO(GPIO_TypeDef* bank, uint16_t pin, uint32_t duration) {
   // Turn the LED ON (Assumes active-high; swap SET/RESET if active-low)
   HAL_GPIO_WritePin(bank, pin, GPIO_PIN_SET);
@@ -1,8 +1,25 @@
+import cmath
+import math
 import os
+import re
 import yaml
 from pathlib import Path
 from jinja2 import Environment, FileSystemLoader
 
+# Standard filter elements reserved in FDCAN message RAM (RUP_FDCAN_STD_FILTER_NBR)
+FDCAN_STD_FILTER_NBR = 28
+# Number of Standard (11-bit) CAN identifiers
+FDCAN_STD_ID_COUNT = 2048
+# Streams per load test profile (RUP_CANLOAD_MAX_STREAMS) and DLC mix entries (RUP_CANLOAD_MAX_DLC_MIX)
+CANLOAD_MAX_STREAMS = 16
+CANLOAD_MAX_DLC_MIX = 4
+# GPDMA1 channels available to the Serial driver (Rx ring and Tx double buffer)
+GPDMA_CHANNELS = 8
+# configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY: handlers calling FreeRTOS must not be more urgent
+FREERTOS_MAX_SYSCALL_PRIORITY = 5
+# Board driver IDs (X-macros), checked against the IDs referenced by config.yaml
+DRIVER_IDS_FILE = Path("include/custom_board/driver_ids.hpp")
+
 
 # Custom Jinja filters to extract the Bank (e.g., 'D' from 'D0') and Pin (e.g., '0' from 'D0')
 def pinbank(pin_str):
@@ -13,6 +30,852 @@ def pinno(pin_str):
     return pin_str[1:]
 
 
+def parse_id_list(items):
+    """Expand a YAML ID list (ints or "0xA-0xB" range strings) into a sorted list of unique IDs."""
+    ids = set()
+    for item in items:
+        if isinstance(item, str) and "-" in item:
+            lo, hi = (int(x, 0) for x in item.split("-", 1))
+            ids.update(range(lo, hi + 1))
+        else:
+            ids.add(int(item, 0) if isinstance(item, str) else int(item))
+    for i in ids:
+        if not 0 <= i < FDCAN_STD_ID_COUNT:
+            raise ValueError(f"CAN ID 0x{i:X} is not a standard 11-bit identifier")
+    return sorted(ids)
+
+
+def filter_accepted_ids(f):
+    """Set of standard IDs a hardware filter element stores into a FIFO."""
+    if f.get("action") == "reject":
+        return set()
+    id1, id2 = f["id1"], f["id2"]
+    if f["type"] == "range":
+        return set(range(id1, id2 + 1))
+    if f["type"] == "dual":
+        return {id1, id2}
+    if f["type"] == "mask":
+        return {i for i in range(FDCAN_STD_ID_COUNT) if (i & id2) == (id1 & id2)}
+    return set()
+
+
+def accept_plan(inst):
+    """Split the 'accept' ID set of an FDCAN instance into hardware filters and a software bitmap.
+
+    Consecutive IDs are grouped into runs; while the runs need more filter elements than are
+    left free, the two runs separated by the smallest gap are merged (densest ranges first).
+    Single IDs are packed two per DUAL element. When any merge happened the hardware filters
+    also accept the IDs in the gaps, so a bitmap with the exact accepted set is emitted and
+    checked in the Rx ISR. The bitmap gates every frame, so it also contains the IDs accepted
+    by the instance's explicit 'filters'.
+    """
+    accept = inst["accept"]
+    if any(f["type"] == "global" and f.get("action", "reject") != "reject" for f in inst.get("filters", [])):
+        raise ValueError("an 'accept' ID set requires the global filter action to be 'reject'")
+    ids = parse_id_list(accept["ids"])
+    explicit = [f for f in inst.get("filters", []) if f["type"] != "global"]
+    budget = min(accept.get("max_filters", FDCAN_STD_FILTER_NBR), FDCAN_STD_FILTER_NBR - len(explicit))
+    if budget <= 0:
+        raise ValueError("no standard filter elements left for the 'accept' ID set")
+
+    runs = []
+    for i in ids:
+        if runs and runs[-1][1] == i - 1:
+            runs[-1][1] = i
+        else:
+            runs.append([i, i])
+
+    def elements(rs):
+        singles = sum(1 for lo, hi in rs if lo == hi)
+        return (len(rs) - singles) + (singles + 1) // 2
+
+    while elements(runs) > budget:
+        k = min(range(len(runs) - 1), key=lambda j: runs[j + 1][0] - runs[j][1])
+        runs[k:k + 2] = [[runs[k][0], runs[k + 1][1]]]
+
+    filters = [{"type": "range", "id1": lo, "id2": hi} for lo, hi in runs if lo != hi]
+    singles = [lo for lo, hi in runs if lo == hi]
+    for j in range(0, len(singles), 2):
+        pair = singles[j:j + 2]
+        filters.append({"type": "dual", "id1": pair[0], "id2": pair[-1]})
+
+    covered = sum(hi - lo + 1 for lo, hi in runs)
+    bitmap = None
+    if covered != len(ids):
+        accepted = set(ids)
+        for f in explicit:
+            accepted |= filter_accepted_ids(f)
+        bitmap = [0] * (FDCAN_STD_ID_COUNT // 32)
+        for i in accepted:
+            bitmap[i >> 5] |= 1 << (i & 31)
+
+    return {
+        "action": accept.get("action", "fifo0"),
+        "ids": len(ids),
+        "filters": filters,
+        "holes": covered - len(ids),
+        "bitmap": bitmap,
+    }
+
+
+def filter_set_plan(fs):
+    """Resolve a filter set ('filters' plus optional 'accept') into a message RAM image plan."""
+    filters = fs.get("filters", [])
+    global_action = "reject"
+    for f in filters:
+        if f["type"] == "global":
+            global_action = f.get("action", "reject")
+
+    elements = [f for f in filters if f["type"] != "global"]
+    bitmap = None
+    if "accept" in fs:
+        plan = accept_plan(fs)
+        elements = elements + [dict(f, action=plan["action"]) for f in plan["filters"]]
+        bitmap = plan["bitmap"]
+
+    if len(elements) > FDCAN_STD_FILTER_NBR:
+        raise ValueError(f"filter set needs {len(elements)} elements, only {FDCAN_STD_FILTER_NBR} available")
+
+    return {"global": global_action, "filters": elements, "bitmap": bitmap}
+
+
+def filter_sets(inst):
+    """Named filter sets of an FDCAN instance, with the boot configuration as 'default'."""
+    sets = inst.get("filter_sets") or {}
+    if not sets:
+        return {}
+    resolved = {"default": filter_set_plan(inst)}
+    for name, fs in sets.items():
+        if name == "default":
+            raise ValueError("filter set name 'default' is reserved for the boot configuration")
+        resolved[name] = filter_set_plan(fs)
+    return resolved
+
+
+def load_profile(inst):
+    """Traffic profile referenced by the 'load_test' block of an FDCAN instance (None if absent).
+
+    The profile is a separate YAML file so the same traffic can be replayed on the target
+    and by the host check of the generator (scripts/check_can_loadgen.py). Each stream takes
+    an 'id', a 'period_us' (0 = saturate the bus), an optional 'burst', 'offset_us' and a
+    'dlc' that is either a single length or a list cycled frame after frame.
+    """
+    path = (inst.get("load_test") or {}).get("profile")
+    if not path:
+        return None
+    with open(path, "r") as f:
+        prof = yaml.safe_load(f)
+
+    streams = []
+    for s in prof.get("streams") or []:
+        dlc = s.get("dlc", 8)
+        dlc = dlc if isinstance(dlc, list) else [dlc]
+        stream = {
+            "id": int(s["id"]),
+            "dlc": [int(d) for d in dlc],
+            "burst": int(s.get("burst", 1)),
+            "period_us": int(s.get("period_us", 0)),
+            "offset_us": int(s.get("offset_us", 0)),
+        }
+        if not 0 <= stream["id"] < FDCAN_STD_ID_COUNT:
+            raise ValueError(f"{path}: CAN ID 0x{stream['id']:X} is not a standard 11-bit identifier")
+        if not 1 <= len(stream["dlc"]) <= CANLOAD_MAX_DLC_MIX or any(not 0 <= d <= 8 for d in stream["dlc"]):
+            raise ValueError(f"{path}: stream 0x{stream['id']:X} needs 1-{CANLOAD_MAX_DLC_MIX} DLCs in 0-8")
+        if not 1 <= stream["burst"] <= 255:
+            raise ValueError(f"{path}: stream 0x{stream['id']:X} burst must be 1-255")
+        streams.append(stream)
+
+    if not 1 <= len(streams) <= CANLOAD_MAX_STREAMS:
+        raise ValueError(f"{path}: a profile needs 1-{CANLOAD_MAX_STREAMS} streams")
+
+    return {
+        "name": prof.get("name", Path(path).stem),
+        "bitrate": int(prof["bitrate"]),
+        "duration_ms": int(prof.get("duration_ms", 10000)),
+        "loopback": bool(prof.get("loopback", True)),
+        "streams": streams,
+    }
+
+
+def declared_ids(kind):
+    """Names declared with X_<kind>(name) in the board driver ID list."""
+    return re.findall(rf"^\s*X_{kind}\((\w+)\)", DRIVER_IDS_FILE.read_text(), re.M)
+
+
+def usart_instances(usart):
+    """Validate the enabled USART/LPUART instances and resolve the table of ru::driver::Serial.
+
+    Each port binds a SerialId of driver_ids.hpp to a peripheral and two GPDMA1 channels (Rx
+    ring, Tx double buffer). The interrupt priority must allow FreeRTOS calls.
+    """
+    if not usart or not usart.get("enable"):
+        return []
+    known_ids = declared_ids("serial")
+    ports, ids, channels = [], set(), set()
+    for name, inst in usart.get("instances", {}).items():
+        if not inst.get("enable"):
+            continue
+        sid = inst["id"]
+        if sid not in known_ids:
+            raise ValueError(f"{name}: SerialId '{sid}' is not declared in {DRIVER_IDS_FILE}")
+        if sid in ids:
+            raise ValueError(f"{name}: SerialId '{sid}' is bound to more than one port")
+        ids.add(sid)
+
+        pins = inst["pins"]
+        if "rx" not in pins or "tx" not in pins:
+            raise ValueError(f"{name}: 'rx' and 'tx' pins are required")
+        if ("rts" in pins) != ("cts" in pins):
+            raise ValueError(f"{name}: RTS/CTS flow control needs both 'rts' and 'cts' pins")
+
+        dma = inst.get("dma", {})
+        for role in ("rx", "tx"):
+            ch = dma.get(role)
+            if not isinstance(ch, int) or not 0 <= ch < GPDMA_CHANNELS:
+                raise ValueError(f"{name}: dma.{role} must be a GPDMA1 channel (0-{GPDMA_CHANNELS - 1})")
+            if ch in channels:
+                raise ValueError(f"{name}: GPDMA1 channel {ch} is already in use")
+            channels.add(ch)
+
+        priority = inst.get("interrupts", {}).get("priority", FREERTOS_MAX_SYSCALL_PRIORITY + 1)
+        if not FREERTOS_MAX_SYSCALL_PRIORITY <= priority <= 15:
+            raise ValueError(f"{name}: interrupt priority must be between {FREERTOS_MAX_SYSCALL_PRIORITY} and 15")
+
+        ports.append({
+            "name": name,
+            "periph": name.upper(),
+            "id": sid,
+            "lpuart": 1 if name.lower().startswith("lpuart") else 0,
+            "rts_cts": 1 if "rts" in pins else 0,
+            "pins": pins,
+            "alternate": inst["alternate"],
+            "clock_source": inst.get("clock_source", "PCLK2").upper(),
+            "rx_channel": dma["rx"],
+            "tx_channel": dma["tx"],
+            "priority": priority,
+        })
+    return ports
+
+
+ADC_INSTANCES = ("adc1", "adc2")
+
+
+def adc_instances(modules):
+    """Validate the enabled ADC instances and resolve the table of ru::driver::AdcScan.
+
+    Each ADC binds an AdcId of driver_ids.hpp to one GPDMA1 channel (circular sample buffer),
+    which must not be used by a serial port. The interrupt priority must allow FreeRTOS calls.
+    """
+    adc = modules.get("adc") or {}
+    if not adc.get("enable"):
+        return []
+    known_ids = declared_ids("adc")
+    channels = {}
+    for u in usart_instances(modules.get("usart")):
+        channels[u["rx_channel"]] = f"{u['name']}.rx"
+        channels[u["tx_channel"]] = f"{u['name']}.tx"
+
+    adcs, ids = [], set()
+    for name, inst in adc.get("instances", {}).items():
+        if not inst.get("enable"):
+            continue
+        if name.lower() not in ADC_INSTANCES:
+            raise ValueError(f"{name}: ADC instance must be one of {', '.join(ADC_INSTANCES)}")
+        aid = inst["id"]
+        if aid not in known_ids:
+            raise ValueError(f"{name}: AdcId '{aid}' is not declared in {DRIVER_IDS_FILE}")
+        if aid in ids:
+            raise ValueError(f"{name}: AdcId '{aid}' is bound to more than one ADC")
+        ids.add(aid)
+
+        ch = inst.get("dma")
+        if not isinstance(ch, int) or not 0 <= ch < GPDMA_CHANNELS:
+            raise ValueError(f"{name}: dma must be a GPDMA1 channel (0-{GPDMA_CHANNELS - 1})")
+        if ch in channels:
+            raise ValueError(f"{name}: GPDMA1 channel {ch} is already used by {channels[ch]}")
+        channels[ch] = name
+
+        priority = inst.get("interrupts", {}).get("priority", FREERTOS_MAX_SYSCALL_PRIORITY + 1)
+        if not FREERTOS_MAX_SYSCALL_PRIORITY <= priority <= 15:
+            raise ValueError(f"{name}: interrupt priority must be between {FREERTOS_MAX_SYSCALL_PRIORITY} and 15")
+
+        adcs.append({
+            "name": name,
+            "periph": name.upper(),
+            "id": aid,
+            "dma_channel": ch,
+            "priority": priority,
+        })
+    return adcs
+
+
+# Timers usable by ru::driver::Pwm: kernel clock bus and the ADC1/ADC2 external
+# trigger (EXTSEL) of their TRGO output, from the reference manual (RM0481)
+PWM_TIMERS = {
+    "tim1": {"bus": "APB2", "advanced": 1, "adc_trigger": 9},
+    "tim2": {"bus": "APB1L", "advanced": 0, "adc_trigger": 11},
+    "tim3": {"bus": "APB1L", "advanced": 0, "adc_trigger": 4},
+    "tim4": {"bus": "APB1L", "advanced": 0, "adc_trigger": 12},
+    "tim8": {"bus": "APB2", "advanced": 1, "adc_trigger": 7},
+}
+
+
+def pwm_instances(pwm):
+    """Validate the enabled PWM timers and resolve the table of ru::driver::Pwm.
+
+    Each timer binds a PwmId of driver_ids.hpp to the compare channel of its output and to a
+    second one, the sync channel, which Pwm::adc_trigger routes to TRGO to fire the ADC. A
+    'group' timer is driven whole by ru::driver::PwmGroup instead (channel 0 in the table), and
+    may name a GPDMA2 channel, 'burst_dma', to play its waveform tables.
+    """
+    if not pwm or not pwm.get("enable"):
+        return []
+    known_ids = declared_ids("pwm")
+    timers, ids = [], set()
+    for name, inst in pwm.get("instances", {}).items():
+        if not inst.get("enable"):
+            continue
+        timer = PWM_TIMERS.get(name.lower())
+        if not timer:
+            raise ValueError(f"{name}: PWM timer must be one of {', '.join(PWM_TIMERS)}")
+        pid = inst["id"]
+        if pid not in known_ids:
+            raise ValueError(f"{name}: PwmId '{pid}' is not declared in {DRIVER_IDS_FILE}")
+        if pid in ids:
+            raise ValueError(f"{name}: PwmId '{pid}' is bound to more than one timer")
+        ids.add(pid)
+
+        group = bool(inst.get("group"))
+        burst = inst.get("burst_dma")
+        if group:
+            if "channel" in inst or "sync_channel" in inst:
+                raise ValueError(f"{name}: a group timer takes its channels from PwmGroupConfig")
+            channel, sync = 0, 0
+            if burst is not None and (not isinstance(burst, int) or not 0 <= burst < GPDMA_CHANNELS):
+                raise ValueError(f"{name}: burst_dma must be a GPDMA2 channel (0-{GPDMA_CHANNELS - 1})")
+        else:
+            if burst is not None:
+                raise ValueError(f"{name}: burst_dma needs a group timer")
+            channel = inst.get("channel")
+            sync = inst.get("sync_channel", 4 if channel != 4 else 3)
+            for key, value in (("channel", channel), ("sync_channel", sync)):
+                if not isinstance(value, int) or not 1 <= value <= 4:
+                    raise ValueError(f"{name}: {key} must be a compare channel (1-4)")
+            if sync == channel:
+                raise ValueError(f"{name}: sync_channel must differ from channel")
+
+        priority = inst.get("interrupts", {}).get("priority", FREERTOS_MAX_SYSCALL_PRIORITY + 1)
+        if not 0 <= priority <= 15:
+            raise ValueError(f"{name}: interrupt priority must be between 0 and 15")
+
+        timers.append({
+            "id": pid,
+            "periph": name.upper(),
+            "bus": timer["bus"],
+            "advanced": timer["advanced"],
+            "channel": channel,
+            "sync_channel": sync,
+            "adc_trigger": timer["adc_trigger"],
+            "burst_channel": burst,
+            "priority": priority,
+        })
+    return timers
+
+
+def pwm_bursts(modules):
+    """Resolve the GPDMA2 channels of the PWM group timers with a 'burst_dma'.
+
+    They must not be used by the I3C controllers, the other GPDMA2 users. The interrupt only
+    reports DMA errors and makes no FreeRTOS call.
+    """
+    channels = {}
+    for i in i3c_instances(modules):
+        channels[i["rx_channel"]] = f"{i['periph'].lower()}.rx"
+        channels[i["tx_channel"]] = f"{i['periph'].lower()}.tx"
+
+    bursts = []
+    for t in pwm_instances(modules.get("pwm")):
+        ch = t["burst_channel"]
+        if ch is None:
+            continue
+        name = t["periph"].lower()
+        if ch in channels:
+            raise ValueError(f"{name}: GPDMA2 channel {ch} is already used by {channels[ch]}")
+        channels[ch] = name
+        bursts.append(t)
+    return bursts
+
+
+# FMAC limits: a filter and its X1/Y buffers must fit the 256-word local memory
+FMAC_MEMORY_WORDS = 256
+FMAC_MAX_FIR_TAPS = 64
+FMAC_MAX_IIR_ORDER = 8
+FMAC_MAX_GAIN = 7
+
+
+def fir_lowpass(taps, cutoff, rate):
+    """Windowed-sinc (Hamming) low-pass FIR with unity DC gain."""
+    fc = cutoff / rate
+    mid = (taps - 1) / 2
+    b = []
+    for n in range(taps):
+        t = n - mid
+        h = 2 * fc if t == 0 else math.sin(2 * math.pi * fc * t) / (math.pi * t)
+        b.append(h * (0.54 - 0.46 * math.cos(2 * math.pi * n / (taps - 1))))
+    total = sum(b)
+    return [c / total for c in b]
+
+
+def iir_lowpass(order, cutoff, rate):
+    """Butterworth low-pass by the bilinear transform, direct form coefficients (b, a) with
+    a[0] = 1 and unity DC gain."""
+    wc = 2 * rate * math.tan(math.pi * cutoff / rate)
+    a = [1.0]
+    for k in range(order):
+        pole = wc * cmath.exp(1j * math.pi * (2 * k + order + 1) / (2 * order))
+        z = (1 + pole / (2 * rate)) / (1 - pole / (2 * rate))
+        a = [x - z * y for x, y in zip(a + [0], [0] + a)]
+    a = [x.real for x in a]
+    b = [float(math.comb(order, k)) for k in range(order + 1)]
+    gain = sum(a) / sum(b)
+    return [c * gain for c in b], a
+
+
+def fmac_quantize(name, coefficients):
+    """Q1.15 coefficients scaled by 2^-R, with the smallest output gain R that fits them."""
+    peak = max(abs(c) for c in coefficients)
+    gain = 0
+    while peak / 2 ** gain * 32768 > 32767:
+        gain += 1
+    if gain > FMAC_MAX_GAIN:
+        raise ValueError(f"{name}: coefficients above {2 ** FMAC_MAX_GAIN} do not fit the FMAC gain")
+    return [round(c / 2 ** gain * 32768) for c in coefficients], gain
+
+
+def fmac_filter(name, spec):
+    """Design one filter spec: (feedforward b, feedback a with a[0] = 1) as floats."""
+    kind = spec.get("type")
+    if kind == "fir_lowpass":
+        taps, cutoff, rate = spec.get("taps"), spec.get("cutoff_hz"), spec.get("sample_rate_hz")
+        if not isinstance(taps, int) or not 2 <= taps <= FMAC_MAX_FIR_TAPS:
+            raise ValueError(f"{name}: taps must be between 2 and {FMAC_MAX_FIR_TAPS}")
+        if not rate or not 0 < cutoff < rate / 2:
+            raise ValueError(f"{name}: cutoff_hz must be below sample_rate_hz / 2")
+        return fir_lowpass(taps, cutoff, rate), [1.0]
+    if kind == "iir_lowpass":
+        order, cutoff, rate = spec.get("order", 2), spec.get("cutoff_hz"), spec.get("sample_rate_hz")
+        if not isinstance(order, int) or not 1 <= order <= FMAC_MAX_IIR_ORDER:
+            raise ValueError(f"{name}: order must be between 1 and {FMAC_MAX_IIR_ORDER}")
+        if not rate or not 0 < cutoff < rate / 2:
+            raise ValueError(f"{name}: cutoff_hz must be below sample_rate_hz / 2")
+        return iir_lowpass(order, cutoff, rate)
+    if kind == "fir":
+        b = [float(c) for c in spec.get("b", [])]
+        if not 2 <= len(b) <= FMAC_MAX_FIR_TAPS:
+            raise ValueError(f"{name}: b must have between 2 and {FMAC_MAX_FIR_TAPS} coefficients")
+        return b, [1.0]
+    if kind == "iir":
+        b = [float(c) for c in spec.get("b", [])]
+        a = [float(c) for c in spec.get("a", [])]
+        if not 2 <= len(b) <= FMAC_MAX_IIR_ORDER + 1 or not 2 <= len(a) <= FMAC_MAX_IIR_ORDER + 1:
+            raise ValueError(f"{name}: b and a must have between 2 and {FMAC_MAX_IIR_ORDER + 1} coefficients")
+        if a[0] != 1.0:
+            raise ValueError(f"{name}: a[0] must be 1")
+        return b, a
+    raise ValueError(f"{name}: type must be one of fir_lowpass, iir_lowpass, fir, iir")
+
+
+def fmac_instance(modules):
+    """Validate the 'fmac' module and resolve the FMAC setup and filter table of ru::driver::Filter.
+
+    The two GPDMA1 channels (input and output streams) must not be used by a serial port or an
+    ADC. Each filter binds a FilterId of driver_ids.hpp to coefficients designed here from its
+    spec and quantized to the FMAC format: Q1.15, feedback negated, all scaled by 2^-R so they
+    fit, the output gain R restoring them.
+    """
+    fmac = modules.get("fmac") or {}
+    if not fmac.get("enable"):
+        return None
+    channels = {}
+    for u in usart_instances(modules.get("usart")):
+        channels[u["rx_channel"]] = f"{u['name']}.rx"
+        channels[u["tx_channel"]] = f"{u['name']}.tx"
+    for a in adc_instances(modules):
+        channels[a["dma_channel"]] = a["name"]
+
+    dma = fmac.get("dma", {})
+    for role in ("write", "read"):
+        ch = dma.get(role)
+        if not isinstance(ch, int) or not 0 <= ch < GPDMA_CHANNELS:
+            raise ValueError(f"fmac: dma.{role} must be a GPDMA1 channel (0-{GPDMA_CHANNELS - 1})")
+        if ch in channels:
+            raise ValueError(f"fmac: GPDMA1 channel {ch} is already used by {channels[ch]}")
+        channels[ch] = f"fmac.{role}"
+
+    priority = fmac.get("interrupts", {}).get("priority", FREERTOS_MAX_SYSCALL_PRIORITY + 1)
+    if not FREERTOS_MAX_SYSCALL_PRIORITY <= priority <= 15:
+        raise ValueError(f"fmac: interrupt priority must be between {FREERTOS_MAX_SYSCALL_PRIORITY} and 15")
+
+    known_ids = declared_ids("filter")
+    filters = []
+    for name, spec in (fmac.get("filters") or {}).items():
+        if name not in known_ids:
+            raise ValueError(f"{name}: FilterId '{name}' is not declared in {DRIVER_IDS_FILE}")
+        b, a = fmac_filter(name, spec)
+        coefficients, gain = fmac_quantize(name, b + [-c for c in a[1:]])
+        filters.append({
+            "id": name,
+            "feedforward": len(b),
+            "feedback": len(a) - 1,
+            "gain": gain,
+            "coefficients": coefficients,
+        })
+    return {
+        "write_channel": dma["write"],
+        "read_channel": dma["read"],
+        "priority": priority,
+        "filters": filters,
+    }
+
+
+# SPI controllers usable by ru::driver::Spi and the peripheral bus of their clock enable
+SPI_BUSES = {
+    "spi1": "APB2",
+    "spi2": "APB1L",
+    "spi3": "APB1L",
+    "spi4": "APB2",
+    "spi5": "APB3",
+    "spi6": "APB2",
+}
+
+
+def gpdma_owners(modules):
+    """Map the GPDMA1 channels taken by the serial ports, the ADCs and the FMAC to their owner."""
+    channels = {}
+    for u in usart_instances(modules.get("usart")):
+        channels[u["rx_channel"]] = f"{u['name']}.rx"
+        channels[u["tx_channel"]] = f"{u['name']}.tx"
+    for a in adc_instances(modules):
+        channels[a["dma_channel"]] = a["name"]
+    fmac = fmac_instance(modules)
+    if fmac:
+        channels[fmac["write_channel"]] = "fmac.write"
+        channels[fmac["read_channel"]] = "fmac.read"
+    return channels
+
+
+def spi_instances(modules):
+    """Validate the enabled SPI controllers and resolve the table of ru::driver::Spi.
+
+    Each controller binds a SpiId of driver_ids.hpp to two GPDMA1 channels (Rx and Tx of the
+    transfers), which must not be used by the modules above. The interrupt priority must allow
+    FreeRTOS calls.
+    """
+    spi = modules.get("spi") or {}
+    if not spi.get("enable"):
+        return []
+    known_ids = declared_ids("spi")
+    channels = gpdma_owners(modules)
+
+    buses, ids = [], set()
+    for name, inst in spi.get("instances", {}).items():
+        if not inst.get("enable"):
+            continue
+        bus = SPI_BUSES.get(name.lower())
+        if not bus:
+            raise ValueError(f"{name}: SPI instance must be one of {', '.join(SPI_BUSES)}")
+        sid = inst["id"]
+        if sid not in known_ids:
+            raise ValueError(f"{name}: SpiId '{sid}' is not declared in {DRIVER_IDS_FILE}")
+        if sid in ids:
+            raise ValueError(f"{name}: SpiId '{sid}' is bound to more than one SPI")
+        ids.add(sid)
+
+        dma = inst.get("dma", {})
+        for role in ("rx", "tx"):
+            ch = dma.get(role)
+            if not isinstance(ch, int) or not 0 <= ch < GPDMA_CHANNELS:
+                raise ValueError(f"{name}: dma.{role} must be a GPDMA1 channel (0-{GPDMA_CHANNELS - 1})")
+            if ch in channels:
+                raise ValueError(f"{name}: GPDMA1 channel {ch} is already used by {channels[ch]}")
+            channels[ch] = f"{name}.{role}"
+
+        priority = inst.get("interrupts", {}).get("priority", FREERTOS_MAX_SYSCALL_PRIORITY + 1)
+        if not FREERTOS_MAX_SYSCALL_PRIORITY <= priority <= 15:
+            raise ValueError(f"{name}: interrupt priority must be between {FREERTOS_MAX_SYSCALL_PRIORITY} and 15")
+
+        buses.append({
+            "id": sid,
+            "periph": name.upper(),
+            "bus": bus,
+            "rx_channel": dma["rx"],
+            "tx_channel": dma["tx"],
+            "priority": priority,
+        })
+    return buses
+
+
+# I2C controllers usable by ru::driver::I2c and the peripheral bus of their clock enable
+I2C_BUSES = {
+    "i2c1": "APB1L",
+    "i2c2": "APB1L",
+    "i2c3": "APB3",
+    "i2c4": "APB3",
+}
+
+
+def i2c_instances(modules):
+    """Validate the enabled I2C controllers and resolve the table of ru::driver::I2c.
+
+    Each controller binds an I2cId of driver_ids.hpp to one GPDMA1 channel, used by both
+    directions of its transfers, which must not be used by the modules above or the SPIs. The
+    interrupt priority must allow FreeRTOS calls.
+    """
+    i2c = modules.get("i2c") or {}
+    if not i2c.get("enable"):
+        return []
+    known_ids = declared_ids("i2c")
+    channels = gpdma_owners(modules)
+    for s in spi_instances(modules):
+        channels[s["rx_channel"]] = f"{s['periph'].lower()}.rx"
+        channels[s["tx_channel"]] = f"{s['periph'].lower()}.tx"
+
+    buses, ids = [], set()
+    for name, inst in i2c.get("instances", {}).items():
+        if not inst.get("enable"):
+            continue
+        bus = I2C_BUSES.get(name.lower())
+        if not bus:
+            raise ValueError(f"{name}: I2C instance must be one of {', '.join(I2C_BUSES)}")
+        iid = inst["id"]
+        if iid not in known_ids:
+            raise ValueError(f"{name}: I2cId '{iid}' is not declared in {DRIVER_IDS_FILE}")
+        if iid in ids:
+            raise ValueError(f"{name}: I2cId '{iid}' is bound to more than one I2C")
+        ids.add(iid)
+
+        ch = inst.get("dma")
+        if not isinstance(ch, int) or not 0 <= ch < GPDMA_CHANNELS:
+            raise ValueError(f"{name}: dma must be a GPDMA1 channel (0-{GPDMA_CHANNELS - 1})")
+        if ch in channels:
+            raise ValueError(f"{name}: GPDMA1 channel {ch} is already used by {channels[ch]}")
+        channels[ch] = name
+
+        priority = inst.get("interrupts", {}).get("priority", FREERTOS_MAX_SYSCALL_PRIORITY + 1)
+        if not FREERTOS_MAX_SYSCALL_PRIORITY <= priority <= 15:
+            raise ValueError(f"{name}: interrupt priority must be between {FREERTOS_MAX_SYSCALL_PRIORITY} and 15")
+
+        buses.append({
+            "id": iid,
+            "periph": name.upper(),
+            "bus": bus,
+            "channel": ch,
+            "priority": priority,
+        })
+    return buses
+
+
+# I3C controllers usable by ru::driver::I3c and the peripheral bus of their clock enable
+I3C_BUSES = {
+    "i3c1": "APB1L",
+    "i3c2": "APB3",
+}
+
+
+def i3c_instances(modules):
+    """Validate the enabled I3C controllers and resolve the table of ru::driver::I3c.
+
+    Each controller binds an I3cId of driver_ids.hpp to two GPDMA2 channels (Rx and Tx of the
+    transfers): GPDMA1 is taken by the modules above. The interrupt priority must allow FreeRTOS
+    calls.
+    """
+    i3c = modules.get("i3c") or {}
+    if not i3c.get("enable"):
+        return []
+    known_ids = declared_ids("i3c")
+    channels = {}
+
+    buses, ids = [], set()
+    for name, inst in i3c.get("instances", {}).items():
+        if not inst.get("enable"):
+            continue
+        bus = I3C_BUSES.get(name.lower())
+        if not bus:
+            raise ValueError(f"{name}: I3C instance must be one of {', '.join(I3C_BUSES)}")
+        iid = inst["id"]
+        if iid not in known_ids:
+            raise ValueError(f"{name}: I3cId '{iid}' is not declared in {DRIVER_IDS_FILE}")
+        if iid in ids:
+            raise ValueError(f"{name}: I3cId '{iid}' is bound to more than one I3C")
+        ids.add(iid)
+
+        dma = inst.get("dma", {})
+        for role in ("rx", "tx"):
+            ch = dma.get(role)
+            if not isinstance(ch, int) or not 0 <= ch < GPDMA_CHANNELS:
+                raise ValueError(f"{name}: dma.{role} must be a GPDMA2 channel (0-{GPDMA_CHANNELS - 1})")
+            if ch in channels:
+                raise ValueError(f"{name}: GPDMA2 channel {ch} is already used by {channels[ch]}")
+            channels[ch] = f"{name}.{role}"
+
+        priority = inst.get("interrupts", {}).get("priority", FREERTOS_MAX_SYSCALL_PRIORITY + 1)
+        if not FREERTOS_MAX_SYSCALL_PRIORITY <= priority <= 15:
+            raise ValueError(f"{name}: interrupt priority must be between {FREERTOS_MAX_SYSCALL_PRIORITY} and 15")
+
+        buses.append({
+            "id": iid,
+            "periph": name.upper(),
+            "bus": bus,
+            "rx_channel": dma["rx"],
+            "tx_channel": dma["tx"],
+            "priority": priority,
+        })
+    return buses
+
+
+GPIO_EDGES = {"rising": (1, 0), "falling": (0, 1), "both": (1, 1)}
+
+
+def gpio_interrupts(gpio):
+    """Validate the 'interrupt' entries of the gpio list and resolve the EXTI lines of ru::driver::Gpio.
+
+    EXTI line n serves pin n of a single port, so two interrupt pins cannot share a pin number.
+    The handlers use FreeRTOS, so the priority must allow it.
+    """
+    known_ids = declared_ids("gpio")
+    irqs, lines, ids = [], {}, set()
+    for g in gpio or []:
+        irq = g.get("interrupt")
+        if not irq:
+            continue
+        name = g["name"]
+        gid = g.get("id")
+        if gid not in known_ids:
+            raise ValueError(f"{name}: an interrupt pin needs an 'id' declared in {DRIVER_IDS_FILE}")
+        if gid in ids:
+            raise ValueError(f"{name}: GpioId '{gid}' is bound to more than one pin")
+        ids.add(gid)
+        if not g["mode"].lower().startswith("input"):
+            raise ValueError(f"{name}: interrupts need an input pin")
+
+        line = int(pinno(g["pin"]))
+        if line in lines:
+            raise ValueError(f"{name}: EXTI line {line} is already used by {lines[line]}")
+        lines[line] = name
+
+        edge = irq.get("edge", "both")
+        if edge not in GPIO_EDGES:
+            raise ValueError(f"{name}: interrupt edge must be one of {', '.join(GPIO_EDGES)}")
+        priority = irq.get("priority", FREERTOS_MAX_SYSCALL_PRIORITY + 1)
+        if not FREERTOS_MAX_SYSCALL_PRIORITY <= priority <= 15:
+            raise ValueError(f"{name}: interrupt priority must be between {FREERTOS_MAX_SYSCALL_PRIORITY} and 15")
+        debounce_us = int(irq.get("debounce_us", 0))
+        if not 0 <= debounce_us <= 1000000:
+            raise ValueError(f"{name}: debounce_us must be between 0 and 1000000")
+
+        rising, falling = GPIO_EDGES[edge]
+        irqs.append({
+            "id": gid,
+            "port": ord(pinbank(g["pin"])) - ord("A"),
+            "line": line,
+            "rising": rising,
+            "falling": falling,
+            "priority": priority,
+            "debounce_us": debounce_us,
+        })
+    return irqs
+
+
+GPIO_PIN = re.compile(r"^[A-I](1[0-5]|[0-9])$")
+GPIO_MODES = {
+    "input": (0, 0),
+    "output_pp": (1, 0),
+    "output_od": (1, 1),
+    "af_pp": (2, 0),
+    "af_od": (2, 1),
+    "analog": (3, 0),
+}
+GPIO_PULLS = {"nopull": 0, "pullup": 1, "pulldown": 2}
+GPIO_SPEEDS = {"low": 0, "medium": 1, "high": 2, "very_high": 3}
+
+
+def pin_owners(modules):
+    """Map every pin claimed in config.yaml to its owner; a pin claimed twice is an error.
+
+    Covers the pins of the enabled FDCAN and USART instances and the gpio list.
+    """
+    owners = {}
+
+    def claim(pin, owner):
+        pin = str(pin).upper()
+        if not GPIO_PIN.match(pin):
+            raise ValueError(f"{owner}: '{pin}' is not a pin (A0 to I15)")
+        if pin in owners:
+            raise ValueError(f"{owner}: pin {pin} is already used by {owners[pin]}")
+        owners[pin] = owner
+
+    for group in ("fdcan", "usart"):
+        module = modules.get(group) or {}
+        if not module.get("enable"):
+            continue
+        for name, inst in module.get("instances", {}).items():
+            if not inst.get("enable"):
+                continue
+            for role, pin in inst.get("pins", {}).items():
+                claim(pin, f"{name}.{role}")
+    for g in modules.get("gpio") or []:
+        claim(g["pin"], g["name"])
+    return owners
+
+
+def gpio_pins(modules):
+    """Validate the gpio list and resolve the GpioId -> pin table of ru::driver::Gpio.
+
+    Entries with an 'id' are bound to the GpioId of driver_ids.hpp and returned in declaration
+    order with their register field values (MODER, OTYPER, PUPDR, OSPEEDR, AFR). Pin conflicts
+    with the peripherals are checked here, so the firmware never sees them.
+    """
+    pin_owners(modules)
+    known_ids = declared_ids("gpio")
+    bound = {}
+    for g in modules.get("gpio") or []:
+        name = g["name"]
+        mode = g["mode"].lower()
+        pull = g.get("pull", "nopull").lower()
+        speed = g.get("speed", "low").lower()
+        if mode not in GPIO_MODES:
+            raise ValueError(f"{name}: mode must be one of {', '.join(GPIO_MODES)}")
+        if pull not in GPIO_PULLS:
+            raise ValueError(f"{name}: pull must be one of {', '.join(GPIO_PULLS)}")
+        if speed not in GPIO_SPEEDS:
+            raise ValueError(f"{name}: speed must be one of {', '.join(GPIO_SPEEDS)}")
+        alternate = g.get("alternate", 0)
+        if mode.startswith("af") != ("alternate" in g):
+            raise ValueError(f"{name}: 'alternate' is required by, and only valid for, af modes")
+        if not isinstance(alternate, int) or not 0 <= alternate <= 15:
+            raise ValueError(f"{name}: alternate must be between 0 and 15")
+
+        gid = g.get("id")
+        if gid is None:
+            continue
+        if gid not in known_ids:
+            raise ValueError(f"{name}: GpioId '{gid}' is not declared in {DRIVER_IDS_FILE}")
+        if gid in bound:
+            raise ValueError(f"{name}: GpioId '{gid}' is bound to more than one pin")
+        moder, otyper = GPIO_MODES[mode]
+        bound[gid] = {
+            "id": gid,
+            "port": ord(pinbank(g["pin"]).upper()) - ord("A"),
+            "pin": int(pinno(g["pin"])),
+            "moder": moder,
+            "otyper": otyper,
+            "pupdr": GPIO_PULLS[pull],
+            "ospeedr": GPIO_SPEEDS[speed],
+            "alternate": alternate,
+        }
+    return [bound[gid] for gid in known_ids if gid in bound]
+
+
 def main():
     # 1. Load the YAML configuration from the root folder
     with open("config.yaml", "r") as f:
@@ -42,6 +905,19 @@ def main():
         env = Environment(loader=FileSystemLoader(template_dir))
         env.filters["pinbank"] = pinbank
         env.filters["pinno"] = pinno
+        env.filters["accept_plan"] = accept_plan
+        env.filters["filter_sets"] = filter_sets
+        env.filters["load_profile"] = load_profile
+        env.filters["usart_instances"] = usart_instances
+        env.filters["gpio_interrupts"] = gpio_interrupts
+        env.filters["gpio_pins"] = gpio_pins
+        env.filters["adc_instances"] = adc_instances
+        env.filters["pwm_instances"] = pwm_instances
+        env.filters["pwm_bursts"] = pwm_bursts
+        env.filters["fmac_instance"] = fmac_instance
+        env.filters["spi_instances"] = spi_instances
+        env.filters["i2c_instances"] = i2c_instances
+        env.filters["i3c_instances"] = i3c_instances
 
         # Load the template
         template = env.get_template(template_name)
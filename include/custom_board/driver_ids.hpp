@@ -2,8 +2,19 @@
 
 
 // blocco logico 1
+X_adc(analog_sensors)
+X_filter(current_lp)
+X_filter(pressure_lp)
 X_gpio(debug_led)
+X_gpio(imu_cs)
+X_gpio(imu_drdy)
+X_gpio(shutdown_loop)
+X_i2c(sensor_i2c)
+X_i3c(sensor_i3c)
+X_pwm(pump_pwm)
+X_pwm(inverter_pwm)
 X_serial(serial_debug)
+X_spi(imu_spi)
 
 // blocco logico 2
 X_can(can_1)
@@ -1,16 +1,88 @@
 #pragma once
 
 #include <cstdint>
-#include <cstdio>
+
+#include "log_backend.hpp"
+
+// Interned logging: the format string lives in the .ru_log_fmt section, which
+// stays in the ELF but is never loaded (see instances/stm32/log_strings.ld),
+// and only its offset plus the raw 32-bit arguments are queued. The host
+// rebuilds the text with `python scripts/log_decode.py firmware.elf`.
+//
+// Levels below RU_LOG_LEVEL are removed by the preprocessor, arguments
+// included. Arguments are integers, pointers or floats (no doubles); %s must
+// point to a string literal, the decoder reads it from the ELF.
+
+#define RU_LOG_LEVEL_TRACE 0
+#define RU_LOG_LEVEL_DEBUG 1
+#define RU_LOG_LEVEL_INFO 2
+#define RU_LOG_LEVEL_WARN 3
+#define RU_LOG_LEVEL_ERROR 4
+#define RU_LOG_LEVEL_NONE 5
+
+#ifndef RU_LOG_LEVEL
+#ifdef NDEBUG
+#define RU_LOG_LEVEL RU_LOG_LEVEL_INFO
+#else
+#define RU_LOG_LEVEL RU_LOG_LEVEL_DEBUG
+#endif
+#endif
+
+#define RU_LOG_STRINGIFY_(x) #x
+#define RU_LOG_STRINGIFY(x) RU_LOG_STRINGIFY_(x)
+
+// Interned string: "<level>|<file>:<line>|<format>". One section per string,
+// as the strings of inline functions are COMDAT and cannot share a section
+// with the others.
+#define RU_LOG_INTERNED(level, fmt, ...)                                             \
+  RU_LOG_INTERNED_(RU_LOG_STRINGIFY(__COUNTER__), level, fmt __VA_OPT__(, ) __VA_ARGS__)
+#define RU_LOG_INTERNED_(id, level, fmt, ...)                                        \
+  do {                                                                               \
+    [[gnu::section(".ru_log_fmt." id), gnu::used]] static const char ru_log_fmt[] =  \
+        level "|" __FILE__ ":" RU_LOG_STRINGIFY(__LINE__) "|" fmt;                   \
+    ::ru::driver::debug::log_id(ru_log_fmt __VA_OPT__(, ) __VA_ARGS__);              \
+  } while (0)
+
+#if RU_LOG_LEVEL <= RU_LOG_LEVEL_TRACE
+#define RU_LOG_TRACE(fmt, ...) RU_LOG_INTERNED("T", fmt __VA_OPT__(, ) __VA_ARGS__)
+#else
+#define RU_LOG_TRACE(fmt, ...) ((void)0)
+#endif
+
+#if RU_LOG_LEVEL <= RU_LOG_LEVEL_DEBUG
+#define RU_LOG_DEBUG(fmt, ...) RU_LOG_INTERNED("D", fmt __VA_OPT__(, ) __VA_ARGS__)
+#else
+#define RU_LOG_DEBUG(fmt, ...) ((void)0)
+#endif
+
+#if RU_LOG_LEVEL <= RU_LOG_LEVEL_INFO
+#define RU_LOG_INFO(fmt, ...) RU_LOG_INTERNED("I", fmt __VA_OPT__(, ) __VA_ARGS__)
+#else
+#define RU_LOG_INFO(fmt, ...) ((void)0)
+#endif
+
+#if RU_LOG_LEVEL <= RU_LOG_LEVEL_WARN
+#define RU_LOG_WARN(fmt, ...) RU_LOG_INTERNED("W", fmt __VA_OPT__(, ) __VA_ARGS__)
+#else
+#define RU_LOG_WARN(fmt, ...) ((void)0)
+#endif
+
+#if RU_LOG_LEVEL <= RU_LOG_LEVEL_ERROR
+#define RU_LOG_ERROR(fmt, ...) RU_LOG_INTERNED("E", fmt __VA_OPT__(, ) __VA_ARGS__)
+#else
+#define RU_LOG_ERROR(fmt, ...) ((void)0)
+#endif
 
 namespace ru::driver::debug {
 
-inline void log_op(const char* driver, const char* op) {
-  std::printf("[debug][%s] %s\n", driver, op);
+// driver and op must be string literals
+inline void log_op([[maybe_unused]] const char* driver, [[maybe_unused]] const char* op) {
+  RU_LOG_DEBUG("[%s] %s", driver, op);
 }
 
-inline void log_op_id(const char* driver, const char* op, uint32_t id) {
-  std::printf("[debug][%s] %s id=%u\n", driver, op, id);
+inline void log_op_id([[maybe_unused]] const char* driver, [[maybe_unused]] const char* op,
+                      [[maybe_unused]] uint32_t id) {
+  RU_LOG_DEBUG("[%s] %s id=%u", driver, op, id);
 }
 
 } // namespace ru::driver::debug
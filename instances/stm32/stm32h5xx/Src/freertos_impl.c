@@ -8,6 +8,7 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "stm32h5xx_hal.h"
+#include "raceup_timer.h"
 
 static StackType_t uxTimerTaskStack[configTIMER_TASK_STACK_DEPTH];
 
@@ -46,7 +47,9 @@ void vApplicationGetTimerTaskMemory(StaticTask_t **ppxTimerTaskTCBBuffer,
     *pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
 }
 
-// Tick hook function for HAL tick increment
+// Tick hook function for HAL tick increment, and the wrap count of the
+// 64-bit cycle timer
 void vApplicationTickHook(void) {
     HAL_IncTick();
+    RUP_Timer_TickHook();
 }
@@ -18,6 +18,7 @@ int main(void)
   // Call the functions generated by our Python/Jinja script
   SystemClock_Config();
   config_FDCAN();
+  config_USART();
   config_GPIO();
 
   (void)ru::driver::Driver::start();
@@ -13,6 +13,8 @@
 #include <cstdlib>
 #include <cstring>
 
+#include "log_backend.hpp"
+
 extern "C" {
 
 // -----------------------------------------------------------------------------
@@ -92,9 +94,12 @@ _ssize_t _read_r(struct _reent* r, int fd, void* ptr, size_t len) {
 
 _ssize_t _write_r(struct _reent* r, int fd, const void* ptr, size_t len) {
     (void)r;
-    (void)fd;
-    (void)ptr;
-    return static_cast<_ssize_t>(len); // Pretend all bytes were written
+    if (fd == STDOUT_FILENO || fd == STDERR_FILENO) {
+        // Queued for the log drain task; a full log ring drops the text, and
+        // so does a line longer than log_max_write_size
+        ru::driver::debug::log_write(static_cast<const char*>(ptr), len);
+    }
+    return static_cast<_ssize_t>(len);
 }
 
 // -----------------------------------------------------------------------------
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <optional>
+#include <span>
 
 #include "common/common.hpp"
 
@@ -47,4 +49,212 @@ public:
   expected::expected<std::optional<uint16_t>, Error> try_read();
 };
 
+// Sampling time of a channel, in ADC clock cycles (SMPRx encoding)
+enum class AdcSampleTime : uint8_t {
+  cycles_2_5,
+  cycles_6_5,
+  cycles_12_5,
+  cycles_24_5,
+  cycles_47_5,
+  cycles_92_5,
+  cycles_247_5,
+  cycles_640_5
+};
+
+struct AdcScanChannel {
+  uint8_t channel;
+  AdcSampleTime sample_time;
+};
+
+// What starts a scan of the channel list: the ADC itself, back to back, or an
+// edge of the external trigger selected by AdcScanConfig::m_trigger_source
+enum class AdcTrigger {
+  continuous,
+  external_rising,
+  external_falling,
+  external_both
+};
+
+// Timer behind a hardware trigger, read by AdcScan::probe_trigger_latency
+struct AdcTriggerTimer {
+  const volatile uint32_t* counter;  // CNT
+  const volatile uint32_t* compare;  // CCR of the trigger event
+  const volatile uint32_t* reload;   // ARR
+  uint32_t tick_hz;                  // counter clock when the trigger was set up
+};
+
+// Hardware trigger of a scan group, e.g. Pwm::adc_trigger()
+struct AdcHardwareTrigger {
+  AdcTrigger edge;
+  uint8_t source;  // EXTSEL value
+  AdcTriggerTimer timer;
+};
+
+// Complete block of a scan group: `scans` rows of `channels` samples each, in
+// the order of the channel list. The samples stay in the DMA buffer: they are
+// valid until the block after the next one starts (see AdcScan::is_intact).
+struct AdcBlock {
+  const uint16_t* samples;
+  size_t scans;
+  size_t channels;
+  uint32_t sequence;
+
+  uint16_t sample(size_t scan, size_t channel) const { return samples[scan * channels + channel]; }
+};
+
+// Called once per block, from the DMA interrupt
+using AdcBlockCallback = void (*)(const AdcBlock& block, void* ctx);
+
+struct AdcScanStats {
+  uint32_t blocks;      // blocks completed by the DMA
+  uint32_t missed;      // blocks overwritten before AdcScan::wait_block took them
+  uint32_t dma_errors;
+};
+
+// Trigger to end of scan delay, in trigger timer ticks: the spread (jitter)
+// is max_ticks - min_ticks. Includes the conversions of the sequence and the
+// interrupt entry, so it is an upper bound of the hardware jitter.
+struct AdcLatencyStats {
+  uint32_t scans;
+  uint32_t min_ticks;
+  uint32_t max_ticks;
+  uint32_t tick_hz;
+};
+
+// Block bookkeeping of a scan group, independent of the hardware: a circular
+// buffer of two blocks, written by a producer that reports which block it
+// is filling. AdcScan feeds it from the DMA interrupt; a host test can fill
+// block_samples() with synthetic samples and call advance_to() itself.
+class AdcBlockRing {
+  uint16_t* m_buffer = nullptr;
+  size_t m_channels = 0;
+  size_t m_scans = 0;
+  AdcBlockCallback m_callback = nullptr;
+  void* m_ctx = nullptr;
+  volatile uint32_t m_completed = 0;  // blocks completed so far; block n is in half n & 1
+  volatile uint32_t m_taken = 0;      // blocks handed to take() or skipped
+  uint32_t m_missed = 0;
+
+public:
+  void reset(uint16_t* buffer, size_t channels, size_t scans, AdcBlockCallback callback,
+             void* ctx) {
+    m_buffer = buffer;
+    m_channels = channels;
+    m_scans = scans;
+    m_callback = callback;
+    m_ctx = ctx;
+    restart();
+  }
+
+  // Back to block 0, with the producer stopped
+  void restart() {
+    m_completed = 0;
+    m_taken = 0;
+    m_missed = 0;
+  }
+
+  size_t block_size() const { return m_channels * m_scans; }
+  uint16_t* block_samples(uint32_t half) const { return m_buffer + (half & 1) * block_size(); }
+
+  // Producer side: it is now filling `half`, so every block before it is
+  // complete. Returns the number of blocks completed by this call.
+  uint32_t advance_to(uint32_t half) {
+    uint32_t count = 0;
+    while ((m_completed & 1) != (half & 1)) {
+      const AdcBlock block = block_at(m_completed);
+      m_completed = m_completed + 1;
+      ++count;
+      if (m_callback) {
+        m_callback(block, m_ctx);
+      }
+    }
+    return count;
+  }
+
+  // Consumer side: the newest complete block not taken yet. Older ones are
+  // counted as missed. Not reentrant with advance_to().
+  bool take(AdcBlock& block) {
+    const uint32_t completed = m_completed;
+    if (completed == m_taken) {
+      return false;
+    }
+    m_missed += completed - m_taken - 1;
+    m_taken = completed;
+    block = block_at(completed - 1);
+    return true;
+  }
+
+  // True while the producer fills the other half, so the samples are still
+  // those of the block
+  bool is_intact(const AdcBlock& block) const { return m_completed == block.sequence + 1; }
+
+  uint32_t completed() const { return m_completed; }
+  uint32_t missed() const { return m_missed; }
+
+private:
+  AdcBlock block_at(uint32_t sequence) const {
+    return {block_samples(sequence), m_scans, m_channels, sequence};
+  }
+};
+
+// Scan group: the ADC converts the channel list on every trigger and the
+// GPDMA copies the results into a circular buffer of two blocks of
+// m_scans_per_block scans. Half and full transfer interrupts hand each block
+// over in place, to m_callback and to wait_block(): the CPU runs once per
+// block, never per conversion. One ADC converts up to max_channels channels;
+// use both ADCs for more. The ADC pins must be in analog mode (config.yaml).
+class AdcScanConfig : public Config {
+public:
+  static constexpr size_t max_channels = 16;
+
+  const AdcId m_id;
+  std::span<const AdcScanChannel> m_channels;
+  size_t m_scans_per_block;
+  AdcTrigger m_trigger;
+  uint8_t m_trigger_source;  // EXTSEL value of the external trigger (reference manual)
+  AdcResolution m_resolution;
+  uint16_t* m_buffer;        // 2 * scans_per_block * channels samples, nullptr to allocate
+  AdcBlockCallback m_callback;
+  void* m_ctx;
+  AdcTriggerTimer m_trigger_timer;  // counter nullptr when unknown
+  AdcScanConfig(AdcId id, std::span<const AdcScanChannel> channels, size_t scans_per_block,
+                AdcTrigger trigger = AdcTrigger::continuous, uint8_t trigger_source = 0,
+                AdcResolution resolution = AdcResolution::bits_12, uint16_t* buffer = nullptr,
+                AdcBlockCallback callback = nullptr, void* ctx = nullptr);
+  // Scans fired by a hardware trigger, such as a phase of a PWM period
+  AdcScanConfig(AdcId id, std::span<const AdcScanChannel> channels, size_t scans_per_block,
+                const AdcHardwareTrigger& trigger,
+                AdcResolution resolution = AdcResolution::bits_12, uint16_t* buffer = nullptr,
+                AdcBlockCallback callback = nullptr, void* ctx = nullptr);
+};
+
+class AdcScanInstanceSpecific;
+
+class AdcScan : public Driver {
+  AdcScanInstanceSpecific* p_instance_specific;
+
+public:
+  static constexpr uint32_t wait_forever = UINT32_MAX;
+
+  AdcScan();
+  static expected::expected<void, Error> start();
+  expected::expected<void, Error> init(const Config&);
+  expected::expected<void, Error> stop();
+
+  // Starts and stops the conversions; enable() restarts from block 0
+  expected::expected<void, Error> enable();
+  expected::expected<void, Error> disable();
+  // Newest complete block not returned yet, waiting up to timeout_ms for one.
+  // Blocks completed meanwhile but never returned are counted as missed.
+  expected::expected<AdcBlock, Error> wait_block(uint32_t timeout_ms = wait_forever);
+  // False once the DMA started overwriting the block: check it after
+  // processing a block taken from a task
+  bool is_intact(const AdcBlock& block) const;
+  expected::expected<AdcScanStats, Error> stats() const;
+  // Timestamps the end of the next `scans` scans against the trigger timer,
+  // one interrupt per scan while it lasts. Needs a hardware trigger.
+  expected::expected<void, Error> probe_trigger_latency(uint32_t scans);
+  expected::expected<AdcLatencyStats, Error> trigger_latency() const;
+};
+
 } // namespace ru::driver
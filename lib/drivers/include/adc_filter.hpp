@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "adc.hpp"
+
+namespace ru::driver::dsp {
+
+// Streaming filters over the ADC sample blocks. The kernels work on one
+// channel of contiguous signed 16-bit samples (see deinterleave) and keep
+// their state across calls, so a channel is filtered block after block.
+//
+// process() uses the packed 16-bit instructions of the Cortex-M33 DSP
+// extension (SMLAD, SMLALD, SSUB16, SEL), two samples per instruction;
+// process_reference() is the portable C version. Both give bit-identical
+// results: on a host without the extension the packed instructions are
+// emulated, which is how scripts/check_adc_filters.py cross-checks them.
+// report_filter_cycles() measures the cycles per sample of both on target.
+//
+// Inputs must stay within +-8191 (ADC samples of up to 12 bits, raw or
+// offset), the range where no intermediate sum can overflow.
+
+// Copies one channel of an interleaved block into `out` (block.scans samples)
+void deinterleave(const AdcBlock& block, size_t channel, int16_t* out);
+
+// Boxcar average over the last 2^log2_window samples
+class MovingAverage {
+public:
+  static constexpr uint8_t max_log2_window = 6;
+
+  explicit MovingAverage(uint8_t log2_window);
+  void reset();
+  void process(const int16_t* in, int16_t* out, size_t count);
+  void process_reference(const int16_t* in, int16_t* out, size_t count);
+
+private:
+  int16_t m_history[1u << max_log2_window];
+  uint32_t m_pos;
+  int32_t m_sum;
+  uint8_t m_log2_window;
+};
+
+// Second order IIR section, direct form 1, Q14 coefficients:
+// y[n] = (b0 x[n] + b1 x[n-1] + b2 x[n-2] - a1 y[n-1] - a2 y[n-2]) >> 14
+class Biquad {
+public:
+  Biquad(int16_t b0, int16_t b1, int16_t b2, int16_t a1, int16_t a2);
+  // Butterworth low-pass (Q = 0.707), cutoff below sample_rate_hz / 2
+  static Biquad lowpass(float cutoff_hz, float sample_rate_hz);
+  void reset();
+  void process(const int16_t* in, int16_t* out, size_t count);
+  void process_reference(const int16_t* in, int16_t* out, size_t count);
+
+private:
+  int16_t m_b[3];
+  int16_t m_a[2];     // a1 and a2, negated
+  int16_t m_x[2];     // x[n-1], x[n-2]
+  int16_t m_y[2];     // y[n-1], y[n-2]
+};
+
+// Averages every 2^log2_factor samples into one output sample
+class Decimator {
+public:
+  static constexpr uint8_t max_log2_factor = 6;
+
+  explicit Decimator(uint8_t log2_factor);
+  void reset();
+  // Returns the number of samples written to out (at most count >> log2_factor,
+  // plus one for the group left over from the previous call)
+  size_t process(const int16_t* in, int16_t* out, size_t count);
+  size_t process_reference(const int16_t* in, int16_t* out, size_t count);
+
+private:
+  int32_t m_sum;
+  uint32_t m_phase;
+  uint8_t m_log2_factor;
+};
+
+struct SampleStats {
+  int16_t min;
+  int16_t max;
+  int16_t mean;  // rounded toward zero
+  uint16_t rms;  // rounded down
+};
+
+// Minimum, maximum, mean and RMS of count (>= 1) samples
+SampleStats stats(const int16_t* in, size_t count);
+SampleStats stats_reference(const int16_t* in, size_t count);
+
+// Runs every kernel, both versions, over `samples` synthetic samples and logs
+// their cycles per sample (DWT cycle counter). Target only.
+void report_filter_cycles(size_t samples = 256);
+
+} // namespace ru::driver::dsp
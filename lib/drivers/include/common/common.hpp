@@ -18,9 +18,12 @@
 #include "forward_decl/can.hpp"
 #include "forward_decl/common.hpp"
 #include "forward_decl/ethernet.hpp"
+#include "forward_decl/filter.hpp"
 #include "forward_decl/flash_memory.hpp"
 #include "forward_decl/gpio.hpp"
 #include "forward_decl/i2c.hpp"
+#include "forward_decl/i3c.hpp"
+#include "forward_decl/imu.hpp"
 #include "forward_decl/pwm.hpp"
 #include "forward_decl/serial.hpp"
 #include "forward_decl/spi.hpp"
@@ -44,9 +47,12 @@ using ErrorCode = std::variant<
   CanError,
   CommonError,
   EthernetError,
+  FilterError,
   FlashMemoryError,
   GpioError,
   I2cError,
+  I3cError,
+  ImuError,
   PwmError,
   SerialError,
   SpiError,
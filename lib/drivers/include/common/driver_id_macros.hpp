@@ -11,6 +11,9 @@
 #ifndef X_ethernet
 #define X_ethernet(name)
 #endif
+#ifndef X_filter
+#define X_filter(name)
+#endif
 #ifndef X_flash_memory
 #define X_flash_memory(name)
 #endif
@@ -20,6 +23,9 @@
 #ifndef X_i2c
 #define X_i2c(name)
 #endif
+#ifndef X_i3c
+#define X_i3c(name)
+#endif
 #ifndef X_pwm
 #define X_pwm(name)
 #endif
@@ -1,8 +1,10 @@
 namespace ru::driver {
 
 class Adc;
+class AdcScan;
 
 enum class AdcError{
+  timeout
 };
 
 }
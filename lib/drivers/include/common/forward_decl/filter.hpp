@@ -0,0 +1,10 @@
+namespace ru::driver {
+
+class Filter;
+
+enum class FilterError {
+  timeout,
+  dma_error
+};
+
+}
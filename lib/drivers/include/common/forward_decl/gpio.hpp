@@ -1,6 +1,7 @@
 namespace ru::driver {
 
 class Gpio;
+class GpioGroup;
 
 enum class GpioError{
   wrong_direction,
@@ -3,6 +3,9 @@ namespace ru::driver {
 class I2c;
 
 enum class I2cError{
+  timeout,
+  nack,
+  bus_error
 };
 
 }
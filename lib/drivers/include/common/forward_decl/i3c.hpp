@@ -0,0 +1,12 @@
+namespace ru::driver {
+
+class I3c;
+
+enum class I3cError{
+  timeout,
+  nack,
+  bus_error,
+  no_address
+};
+
+}
@@ -0,0 +1,9 @@
+namespace ru::driver {
+
+class Imu;
+
+enum class ImuError {
+  timeout
+};
+
+}
@@ -2,7 +2,9 @@ namespace ru::driver {
 
 class Spi;
 
-enum class SpiError{
+enum class SpiError {
+  timeout,
+  dma_error
 };
 
 }
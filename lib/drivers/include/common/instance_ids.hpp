@@ -33,6 +33,15 @@ enum class EthernetId : uint16_t {
 #define X_ethernet(name)
 };
 
+enum class FilterId : uint16_t {
+  invalid = 0,
+#undef X_filter
+#define X_filter(name) name,
+#include "custom_board/driver_ids.hpp"
+#undef X_filter
+#define X_filter(name)
+};
+
 enum class FlashMemoryId : uint16_t {
   invalid = 0,
 #undef X_flash_memory
@@ -60,6 +69,15 @@ enum class I2cId : uint16_t {
 #define X_i2c(name)
 };
 
+enum class I3cId : uint16_t {
+  invalid = 0,
+#undef X_i3c
+#define X_i3c(name) name,
+#include "custom_board/driver_ids.hpp"
+#undef X_i3c
+#define X_i3c(name)
+};
+
 enum class PwmId : uint16_t {
   invalid = 0,
 #undef X_pwm
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ru::driver::math {
+
+// Batched trigonometry and vector math for the tight loops that would call
+// sinf/cosf/atan2f/sqrtf once per element. On target the batch runs on the
+// CORDIC accelerator in zero-overhead mode: the arguments of the next element
+// are written while the current one computes, and reading a result stalls
+// the bus until it is ready, so the CORDIC never idles and there is no
+// interrupt or polling. A batch that finds the CORDIC busy (another task, or
+// an interrupt preempting one) runs on the tables instead, as does every
+// batch on the host.
+//
+// The *_table versions are table-driven fixed point: quarter-wave sine,
+// arctangent and square root tables (257 points each, in flash) with linear
+// interpolation. Errors against libm are about 5e-6 for sin/cos, 2e-6 rad
+// for atan2 and 5e-7 relative for sqrt; the CORDIC (24 iterations, Q1.31)
+// converges to about 1e-6. scripts/check_cordic_math.py measures the tables against libm
+// on the host, report_math_cycles() both versions on target. sqrtf is a
+// single FPU instruction on the M33: the table square root is only the
+// fallback of the CORDIC one.
+//
+// Inputs must be finite. Angles are in radians, any range, but reduced in
+// float: a few turns out, the error grows with the angle. Results in
+// [-pi, pi]. Vector coordinates must stay below 2^124. in and out arrays may
+// be the same.
+
+// sin and cos of each angle; either output may be nullptr
+void sincos(const float* angles, float* sin, float* cos, size_t count);
+void sincos_table(const float* angles, float* sin, float* cos, size_t count);
+
+// atan2(y[i], x[i])
+void atan2(const float* y, const float* x, float* angles, size_t count);
+void atan2_table(const float* y, const float* x, float* angles, size_t count);
+
+// Magnitude and angle of the vectors (x[i], y[i]); either output may be nullptr
+void polar(const float* x, const float* y, float* magnitude, float* angle, size_t count);
+void polar_table(const float* x, const float* y, float* magnitude, float* angle, size_t count);
+
+// Square root, NaN for a negative input
+void sqrt(const float* in, float* out, size_t count);
+void sqrt_table(const float* in, float* out, size_t count);
+
+// Runs every function, CORDIC, tables and libm, over `count` synthetic inputs
+// and logs their cycles per element and worst error against libm (DWT cycle
+// counter). Target only.
+void report_math_cycles(size_t count = 256);
+
+} // namespace ru::driver::math
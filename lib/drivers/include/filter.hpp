@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "common/common.hpp"
+
+namespace ru::driver {
+
+// Filter coefficients in the FMAC format, generated from the 'fmac' module of
+// config.yaml: Q1.15, all scaled by 2^-gain so they fit, with the feedback
+// negated so that
+//   y[n] = 2^gain * (sum b[k] x[n-k] + sum a[k] y[n-1-k])
+struct FilterCoefficients {
+  const int16_t* feedforward;  // b0 .. b[p-1]
+  const int16_t* feedback;     // -a1 .. -a[q], unused by a FIR
+  uint8_t p;
+  uint8_t q;                   // 0 for a FIR
+  uint8_t gain;                // output shift R, 0 to 7
+};
+
+// Coefficients generated for a filter, nullptr if config.yaml defines none
+const FilterCoefficients* filter_coefficients(FilterId id);
+
+// The FMAC datapath in software, bit for bit: each product is truncated to 22
+// fractional bits, summed in a 26-bit accumulator that wraps, shifted left by
+// the gain and truncated to Q1.15 with saturation. Keeps the history across
+// calls, so a stream is filtered block after block. Filter runs its blocks on
+// either side and carries the history over; on the host this is the filter.
+class FilterKernel {
+public:
+  static constexpr uint8_t max_feedforward = 64;
+  static constexpr uint8_t max_feedback = 8;
+
+  explicit FilterKernel(const FilterCoefficients& coefficients);
+  const FilterCoefficients& coefficients() const { return *m_coefficients; }
+  void reset();
+  void process(const int16_t* in, int16_t* out, size_t count);
+
+  // Inputs and outputs of a block filtered elsewhere (the FMAC), to continue
+  // from there
+  void append_history(const int16_t* in, const int16_t* out, size_t count);
+  // The last p - 1 inputs and the last q outputs, oldest first: the FMAC X1
+  // and Y preloads
+  void input_history(int16_t* out) const;
+  void output_history(int16_t* out) const;
+
+private:
+  void push_input(int16_t x);
+  void push_output(int16_t y);
+
+  const FilterCoefficients* m_coefficients;
+  // Each sample stored twice, at pos and pos + length, so the window of the
+  // last `length` samples is always contiguous
+  int16_t m_x[2 * max_feedforward];
+  int16_t m_y[2 * max_feedback];
+  uint8_t m_x_pos;
+  uint8_t m_y_pos;
+};
+
+class FilterConfig : public Config {
+public:
+  const FilterId m_id;
+  explicit FilterConfig(FilterId id);
+};
+
+struct FilterStats {
+  uint32_t blocks;      // blocks run on the FMAC
+  uint32_t samples;
+  uint32_t cpu_cycles;  // spent by the CPU on them, while the DWT cycle counter runs
+  uint32_t dma_errors;
+};
+
+class FilterInstanceSpecific;
+
+// One filter of config.yaml on the FMAC. process() loads the coefficients and
+// the history of the stream into the FMAC memory, then streams the block in
+// and out by DMA while the calling task sleeps: the CPU only sets up the block
+// and takes one interrupt. Any number of filters share the FMAC, one block at
+// a time.
+class Filter : public Driver {
+  FilterInstanceSpecific* p_instance_specific;
+
+public:
+  static constexpr uint32_t wait_forever = UINT32_MAX;
+
+  Filter();
+  static expected::expected<void, Error> start();
+  expected::expected<void, Error> init(const Config&);
+  expected::expected<void, Error> stop();
+
+  // Filters count samples on the FMAC. Fails with CommonError::busy while
+  // another filter's block runs: process_software() can take it instead.
+  expected::expected<void, Error> process(const int16_t* in, int16_t* out, size_t count,
+                                          uint32_t timeout_ms = wait_forever);
+  // Same result on the CPU, continuing the same stream
+  expected::expected<void, Error> process_software(const int16_t* in, int16_t* out, size_t count);
+  expected::expected<void, Error> reset();
+  expected::expected<FilterStats, Error> stats() const;
+};
+
+// Filters `samples` synthetic samples with the filter on the FMAC and in
+// software, checks they match and logs the CPU cycles per 1000 samples of
+// both and the cycles saved (DWT cycle counter). Target only.
+void report_fmac_cycles(FilterId id, size_t samples = 1000);
+
+} // namespace ru::driver
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <span>
 
 #include "common/capability.hpp"
 #include "common/common.hpp"
@@ -32,6 +34,25 @@ enum class GpioSpeed {
   very_high,  // 6.6ns | 50Mhz
 };
 
+enum class GpioEdge : uint8_t {
+  rising,
+  falling,
+};
+
+struct GpioEvent {
+  uint32_t timestamp;  // DWT cycle counter (SystemCoreClock) at the EXTI handler entry
+  GpioEdge edge;
+};
+
+struct GpioEventStats {
+  uint32_t events;   // recorded
+  uint32_t bounces;  // rejected by the debounce window
+  uint32_t dropped;  // lost to a full event ring
+};
+
+// Called from the EXTI handler after an edge is recorded (e.g. to notify a task)
+using GpioEventCallback = void (*)(void* ctx);
+
 class GpioConfig: public Config {
 public:
   const GpioId m_id;
@@ -70,8 +91,57 @@ public:
   expected::expected<void, Error> set_level(const bool active);
   expected::expected<void, Error> toggle();
 
+  static constexpr size_t event_ring_size = 32;
+
+  // Edge interrupts as set by the pin's 'interrupt' entry in config.yaml:
+  // every edge is timestamped and debounced in the handler, then queued in a
+  // per-pin ring of event_ring_size events
+  expected::expected<void, Error> enable_interrupt(GpioEventCallback callback = nullptr,
+                                                   void* ctx = nullptr);
+  expected::expected<void, Error> disable_interrupt();
+  // Oldest recorded edge, false when there is none
+  expected::expected<bool, Error> pop_event(GpioEvent& event);
+  // Same, from an interrupt handler, the callback of the pin included
+  expected::expected<bool, Error> pop_event_from_isr(GpioEvent& event);
+  expected::expected<GpioEventStats, Error> event_stats() const;
+
   expected::expected<void, Error> init(struct capability::Token1<Can>, const GpioConfigFriend&);
   void reverse_protected_example(struct capability::Token1<Can>);
 };
 
+// Pins updated together (parallel bus, mux select lines, bargraph): bit i of
+// a value is m_ids[i]. Writes take one BSRR store per port and reads one IDR
+// load per port, so the pins of a port never show intermediate states; pins
+// on different ports change one port after the other.
+class GpioGroupConfig: public Config {
+public:
+  std::span<const GpioId> m_ids;  // read by init() only
+  GpioFunction m_function;
+  bool m_active_high;
+  GpioSpeed m_gpio_speed;
+  GpioGroupConfig(std::span<const GpioId> ids, GpioFunction=GpioFunction::output_pushpull_pulldown,
+                  bool active_high=true, GpioSpeed=GpioSpeed::low);
+};
+
+class GpioGroupInstanceSpecific;
+
+class GpioGroup: public Driver {
+  uint8_t m_is_output:1;
+  GpioGroupInstanceSpecific* p_instance_specific;
+
+public:
+  static constexpr size_t max_pins = 16;
+  static constexpr size_t max_ports = 4;
+
+  GpioGroup();
+  static expected::expected<void, Error> start();
+  expected::expected<void, Error> init(const Config&);
+  expected::expected<void, Error> stop();
+
+  // Drives the pins selected by `mask` to the levels of `value` (1 = active)
+  expected::expected<void, Error> write(uint16_t value, uint16_t mask = 0xFFFF);
+  // Active pins, one bit per pin
+  expected::expected<uint16_t, Error> read() const;
+};
+
 } // namespace ru::driver
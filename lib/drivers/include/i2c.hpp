@@ -2,8 +2,10 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <span>
 
 #include "common/common.hpp"
+#include "timer.hpp"
 
 namespace ru::driver {
 
@@ -11,7 +13,7 @@ enum class I2cSpeed {
   standard_100k,
   fast_400k,
   fast_plus_1m,
-  high_3m
+  high_3m  // not supported by the STM32 I2C
 };
 
 enum class I2cAddressing {
@@ -19,6 +21,8 @@ enum class I2cAddressing {
   addr_10bit
 };
 
+// Bus of the 'i2c' module of config.yaml, always master. m_own_address is
+// unused in master mode.
 class I2cConfig : public Config {
 public:
   const I2cId m_id;
@@ -29,21 +33,121 @@ public:
             I2cAddressing addressing = I2cAddressing::addr_7bit, uint16_t own_address = 0);
 };
 
+enum class I2cStatus : uint8_t {
+  idle,    // never submitted
+  queued,
+  active,  // on the bus
+  done,
+  nack,    // address or data not acknowledged
+  failed   // bus error, arbitration lost, DMA error, or the bus stopped
+};
+
+struct I2cTransaction;
+
+// Called from the I2C interrupt once a transaction is over, whatever its
+// status. It may submit again, this transaction included.
+using I2cCallback = void (*)(I2cTransaction& transaction, void* ctx);
+
+// One START to one STOP: tx_len bytes written, then rx_len bytes read after a
+// repeated start (a register read), or either alone; both 0 only checks the
+// address. Up to I2c::max_bytes each. The transaction and its buffers belong
+// to the bus from I2c::submit until the status is no longer pending.
+struct I2cTransaction {
+  uint16_t addr;
+  const uint8_t* tx;
+  uint16_t tx_len;
+  uint8_t* rx;
+  uint16_t rx_len;
+  I2cCallback callback;
+  void* ctx;
+
+  // Driver state; the instants give the latency of the transaction
+  volatile I2cStatus status;
+  TimerInstant submitted;
+  TimerInstant started;   // START on the bus
+  TimerInstant finished;  // STOP
+  I2cTransaction* next;
+  void* waiter;  // task blocked in I2c::wait
+};
+
+// Register block read by the poll list: len bytes from register reg
+struct I2cPollEntry {
+  uint16_t addr;
+  uint8_t reg;
+  uint8_t len;  // up to I2cReading::max_bytes
+};
+
+// Latest value of a poll entry
+struct I2cReading {
+  static constexpr size_t max_bytes = 16;
+
+  TimerInstant timestamp;  // STOP of the read
+  uint32_t sequence;       // reads of the entry so far, 0 before the first
+  uint8_t data[max_bytes];
+};
+
+struct I2cStats {
+  uint32_t transactions;     // completed, NACKed and failed ones included
+  uint32_t nacks;
+  uint32_t errors;           // bus errors, arbitration lost, DMA errors
+  uint32_t poll_overruns;    // poll entries still pending when their next cycle came
+  float utilisation;         // share of the time between a START and its STOP
+  uint32_t latency_avg_us;   // submit to STOP
+  uint32_t latency_max_us;
+  uint32_t transfer_max_us;  // START to STOP
+};
+
 class I2cInstanceSpecific;
 
+// Transaction queue of one bus, in the manner of Spi: any task or interrupt
+// submits transactions, the DMA moves the bytes and the I2C interrupts only
+// chain the phases (the repeated start of a register read, the STOP, the next
+// transaction), so the CPU is not involved between bytes. One GPDMA1 channel
+// serves both directions, reprogrammed between the write and the read.
+// The poll list reads a fixed set of registers every period: a FreeRTOS timer
+// queues one transaction per entry, and their completions publish the data to
+// latest-value slots read with I2c::latest.
 class I2c : public Driver {
   I2cInstanceSpecific* p_instance_specific;
 
 public:
+  static constexpr uint32_t wait_forever = UINT32_MAX;
+  static constexpr size_t max_bytes = 255;
+  static constexpr size_t max_poll_entries = 8;
+
   I2c();
   static expected::expected<void, Error> start();
   expected::expected<void, Error> init(const Config&);
+  // Stops the poll list, fails the queued transactions (no callbacks) and
+  // releases the bus
   expected::expected<void, Error> stop();
 
+  // Queues a transaction, from a task or an interrupt (priority 5 or more).
+  // Fails with CommonError::busy while the transaction is still pending.
+  expected::expected<void, Error> submit(I2cTransaction& transaction);
+  // Blocks until the transaction is over: I2cError::nack or bus_error if it
+  // did not complete. On timeout it stays queued, and its buffers in use.
+  expected::expected<void, Error> wait(I2cTransaction& transaction,
+                                       uint32_t timeout_ms = wait_forever);
+
+  // Single transactions, blocking until done
   expected::expected<void, Error> write(uint16_t addr, const uint8_t* data, size_t len);
   expected::expected<void, Error> read(uint16_t addr, uint8_t* data, size_t len);
   expected::expected<void, Error> write_read(uint16_t addr, const uint8_t* tx, size_t tx_len,
                                         uint8_t* rx, size_t rx_len);
+
+  // Reads every entry each period_ms, from the next timer tick on. The
+  // entries are copied; a running poll list is replaced.
+  expected::expected<void, Error> start_polling(std::span<const I2cPollEntry> entries,
+                                                uint32_t period_ms);
+  // Returns once the reads in flight are over
+  expected::expected<void, Error> stop_polling();
+  // Latest value of entries[index], sequence 0 until it is read once
+  expected::expected<I2cReading, Error> latest(size_t index) const;
+
+  // Counters, utilisation and latencies since init() or reset_stats()
+  expected::expected<I2cStats, Error> stats() const;
+  expected::expected<void, Error> reset_stats();
 };
 
 } // namespace ru::driver
@@ -0,0 +1,300 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "common/common.hpp"
+#include "i2c.hpp"
+#include "timer.hpp"
+
+namespace ru::driver {
+
+// Common command codes of the I3C specification: broadcast ones below 0x80,
+// direct ones (to a single target) from 0x80
+namespace i3c_ccc {
+constexpr uint8_t enec = 0x00;  // enable events (the byte below), to every target
+constexpr uint8_t disec = 0x01;
+constexpr uint8_t rstdaa = 0x06;  // forget the dynamic addresses
+constexpr uint8_t entdaa = 0x07;  // dynamic address assignment
+constexpr uint8_t enec_direct = 0x80;
+constexpr uint8_t disec_direct = 0x81;
+constexpr uint8_t getpid = 0x8D;  // 6 bytes
+constexpr uint8_t getbcr = 0x8E;
+constexpr uint8_t getdcr = 0x8F;
+constexpr uint8_t getstatus = 0x90;  // 2 bytes
+
+// Event bits of ENEC and DISEC
+constexpr uint8_t event_interrupt = 0x01;
+constexpr uint8_t event_hot_join = 0x08;
+} // namespace i3c_ccc
+
+// Bus of the 'i3c' module of config.yaml, controller only. m_sdr_hz is the
+// push-pull rate of I3C messages; m_i2c_speed the one of the legacy I2C
+// devices, which also sets the open-drain phases of I3C messages (the address
+// header and the dynamic address assignment).
+class I3cConfig : public Config {
+public:
+  const I3cId m_id;
+  uint32_t m_sdr_hz;
+  I2cSpeed m_i2c_speed;
+  I3cConfig(I3cId id, uint32_t sdr_hz = 12500000, I2cSpeed i2c_speed = I2cSpeed::fast_plus_1m);
+};
+
+// Index of a device in the table of the bus, in the order of I3c::add_device
+// and I3c::add_i2c_device
+using I3cDevice = uint8_t;
+
+struct I3cDeviceInfo {
+  uint64_t pid;     // 48-bit provisioned ID, 0 for an I2C device
+  uint8_t bcr;      // bus characteristics, bit 1: IBI capable, bit 2: IBI payload
+  uint8_t dcr;      // device characteristics (kind of sensor)
+  uint8_t address;  // dynamic address, 0 until assigned; static for an I2C device
+  bool legacy_i2c;
+};
+
+enum class I3cStatus : uint8_t {
+  idle,    // never submitted
+  queued,
+  active,  // on the bus
+  done,
+  nack,    // address not acknowledged
+  failed   // protocol error, DMA error, or the bus stopped
+};
+
+struct I3cTransaction;
+
+// Called from the I3C interrupt once a transaction is over, whatever its
+// status. It may submit again, this transaction included.
+using I3cCallback = void (*)(I3cTransaction& transaction, void* ctx);
+
+// One frame, START to STOP. With ccc I3c::no_ccc, a private transfer to the
+// device: tx_len bytes written, then rx_len read after a repeated start, or
+// either alone. Otherwise a CCC: broadcast with device I3c::broadcast and
+// tx_len bytes of data, or direct (from 0x80) writing tx_len or reading
+// rx_len bytes. An I3C target may end a read early: rx_count says how much
+// arrived. The transaction and its buffers belong to the bus from
+// I3c::submit until the status is no longer pending.
+struct I3cTransaction {
+  I3cDevice device;
+  uint8_t ccc;
+  const uint8_t* tx;
+  uint16_t tx_len;
+  uint8_t* rx;
+  uint16_t rx_len;
+  I3cCallback callback;
+  void* ctx;
+
+  // Driver state
+  volatile I3cStatus status;
+  uint16_t rx_count;
+  I3cTransaction* next;
+  void* waiter;  // task blocked in I3c::wait
+};
+
+// Latest in-band interrupt of a device
+struct I3cIbi {
+  static constexpr size_t max_payload = 4;
+
+  TimerInstant timestamp;
+  uint32_t count;  // IBIs of the device so far: a gap means missed ones
+  uint8_t payload_len;
+  uint8_t payload[max_payload];  // mandatory data byte first
+};
+
+struct I3cStats {
+  uint32_t transactions;  // completed, NACKed and failed ones included
+  uint32_t nacks;
+  uint32_t errors;
+  uint32_t ibis;
+  uint32_t unknown_ibis;     // from an address outside the table
+  uint32_t daa_targets;      // given an address by the last assignment
+  uint32_t unknown_targets;  // of which not in the table
+  uint32_t hot_joins;        // refused
+};
+
+// One message of a frame, as the controller sends it
+enum class I3cMessageType : uint8_t {
+  private_transfer,  // SDR, to a dynamic address
+  legacy_i2c,        // I2C, to a static address
+  ccc,               // 0x7E then the command code, and the data of a broadcast CCC
+  direct,            // the data of the direct CCC of the previous message
+};
+
+struct I3cMessage {
+  I3cMessageType type;
+  uint8_t address;
+  uint8_t ccc;
+  bool read;
+  uint16_t len;
+};
+
+enum class I3cFrameOutcome : uint8_t {
+  done,   // STOP, reads possibly ended early by the target
+  nack,   // address not acknowledged
+  error
+};
+
+// What the protocol asks of the controller. Called with the bus locked.
+class I3cPort {
+public:
+  // Sends the messages, the write data taken in order from tx and the read
+  // data stored in order to rx, then reports I3cProtocol::frame_done
+  virtual void start_frame(const I3cMessage* messages, size_t count, const uint8_t* tx,
+                           size_t tx_len, uint8_t* rx, size_t rx_len) = 0;
+  // ENTDAA: each target arbitrating is reported to I3cProtocol::daa_payload,
+  // then I3cProtocol::frame_done once none is left
+  virtual void start_daa() = 0;
+  // Whether IBIs of the address are acknowledged, and with their payload;
+  // false if the controller cannot track the address
+  virtual bool set_ibi(uint8_t address, bool accept, bool payload) = 0;
+
+protected:
+  ~I3cPort() = default;
+};
+
+// The controller protocol, without the hardware: the device table, dynamic
+// address allocation, the transaction queue turned into frames, and the IBI
+// slots of the devices. I3c drives it from the I3C interrupts through an
+// I3cPort on the peripheral; scripts/i3c_protocol_sim.cpp through simulated
+// targets. Not locked: every call holds the bus lock.
+class I3cProtocol {
+public:
+  static constexpr size_t max_devices = 8;
+  static constexpr I3cDevice broadcast = 0xFF;
+  static constexpr uint8_t no_ccc = 0xFF;
+
+  explicit I3cProtocol(I3cPort& port);
+
+  // Device table; an I3C device gets `dynamic_address` at the next
+  // assignment if it is free and valid, the first free one otherwise.
+  // max_devices when the table is full or the address invalid or taken.
+  I3cDevice add_device(uint64_t pid, uint8_t dynamic_address);
+  I3cDevice add_i2c_device(uint8_t static_address);
+  size_t device_count() const { return m_count; }
+  const I3cDeviceInfo& info(I3cDevice device) const { return m_devices[device].info; }
+
+  // Checks the transaction and queues it. The dynamic address assignment is a
+  // broadcast ENTDAA transaction (RSTDAA first); its rx_count is the number
+  // of targets given an address. False if invalid.
+  bool submit(I3cTransaction& transaction);
+  // Takes the queued transactions out, marked failed, and returns the first
+  // one; the one on the bus is left to frame_done
+  I3cTransaction* flush();
+
+  // Controller events. frame_done returns the finished transactions, with
+  // their status set and linked by next: the one of the frame, then any the
+  // next frame skipped, already started.
+  I3cTransaction* frame_done(I3cFrameOutcome outcome, size_t rx_count);
+  // A target in the dynamic address assignment: the address to give it, 0
+  // to leave it without
+  uint8_t daa_payload(uint64_t pid, uint8_t bcr, uint8_t dcr);
+  // An acknowledged IBI: the device it came from, max_devices if unknown
+  I3cDevice ibi(uint8_t address, const uint8_t* payload, size_t len, TimerInstant timestamp);
+  void hot_join() { ++m_stats.hot_joins; }
+
+  // IBIs of the device acknowledged or not, in the port; takes effect on
+  // the target with ENEC/DISEC. Tracked across assignments.
+  bool accept_ibi(I3cDevice device, bool accept);
+  // The latest IBI of the device if one came since the previous call
+  bool take_ibi(I3cDevice device, I3cIbi& out);
+
+  bool busy() const { return m_current != nullptr; }
+  const I3cStats& stats() const { return m_stats; }
+  void reset_stats() { m_stats = {}; }
+
+private:
+  enum class DaaPhase : uint8_t { none, reset, assign };
+
+  struct Device {
+    I3cDeviceInfo info;
+    uint8_t wanted;  // address asked for at add_device
+    bool ibi_accepted;
+    uint32_t ibi_taken;  // count of the IBI last taken
+    I3cIbi ibi;
+  };
+
+  I3cPort& m_port;
+  Device m_devices[max_devices];
+  size_t m_count;
+  I3cTransaction* m_head;
+  I3cTransaction* m_tail;
+  I3cTransaction* m_current;
+  DaaPhase m_daa;
+  uint16_t m_assigned;
+  uint32_t m_strays[4];  // addresses given to targets outside the table
+  I3cMessage m_messages[2];
+  I3cStats m_stats;
+
+  bool valid(const I3cTransaction& t) const;
+  bool address_free(uint8_t address, size_t except) const;
+  uint8_t allocate(uint8_t wanted, size_t device) const;
+  I3cTransaction* start_next();
+  void start(I3cTransaction& t);
+  void apply_ibi();
+};
+
+class I3cInstanceSpecific;
+
+// Controller of one I3C bus, with a transaction queue in the manner of I2c:
+// any task or interrupt submits transactions, the DMA moves the data and the
+// interrupts only chain the frames. I3C devices are listed by their
+// provisioned ID and get a dynamic address from assign_addresses(); legacy
+// I2C devices share the bus at their static address. In-band interrupts of a
+// device wake the task that enabled them, blocked in wait_ibi().
+class I3c : public Driver {
+  I3cInstanceSpecific* p_instance_specific;
+
+public:
+  static constexpr uint32_t wait_forever = UINT32_MAX;
+  static constexpr size_t max_devices = I3cProtocol::max_devices;
+  static constexpr I3cDevice broadcast = I3cProtocol::broadcast;
+  static constexpr uint8_t no_ccc = I3cProtocol::no_ccc;
+
+  I3c();
+  static expected::expected<void, Error> start();
+  expected::expected<void, Error> init(const Config&);
+  // Fails the queued transactions (no callbacks), wakes the tasks in
+  // wait_ibi() and releases the bus
+  expected::expected<void, Error> stop();
+
+  // Device table; the devices stay listed until stop()
+  expected::expected<I3cDevice, Error> add_device(uint64_t pid, uint8_t dynamic_address = 0);
+  expected::expected<I3cDevice, Error> add_i2c_device(uint8_t static_address);
+  // RSTDAA then ENTDAA: the number of targets given an address, listed or not
+  expected::expected<size_t, Error> assign_addresses(uint32_t timeout_ms = wait_forever);
+  expected::expected<I3cDeviceInfo, Error> device_info(I3cDevice device) const;
+
+  // Queues a transaction, from a task or an interrupt (priority 5 or more).
+  // Fails with CommonError::busy while the transaction is still pending.
+  expected::expected<void, Error> submit(I3cTransaction& transaction);
+  // Blocks until the transaction is over: I3cError::nack or bus_error if it
+  // did not complete. On timeout it stays queued, and its buffers in use.
+  expected::expected<void, Error> wait(I3cTransaction& transaction,
+                                       uint32_t timeout_ms = wait_forever);
+
+  // Single private transfers, blocking until done; read returns the bytes
+  // the target sent
+  expected::expected<void, Error> write(I3cDevice device, const uint8_t* data, size_t len);
+  expected::expected<size_t, Error> read(I3cDevice device, uint8_t* data, size_t len);
+  expected::expected<size_t, Error> write_read(I3cDevice device, const uint8_t* tx, size_t tx_len,
+                                               uint8_t* rx, size_t rx_len);
+
+  // IBIs of the device acknowledged and enabled on the target (ENEC); each
+  // one wakes the calling task if it waits in wait_ibi(). CommonError::busy if
+  // another task owns the device's IBIs, not_inited if a stop() from another
+  // task ends the call.
+  expected::expected<void, Error> enable_ibi(I3cDevice device);
+  expected::expected<void, Error> disable_ibi(I3cDevice device);
+  // The latest IBI of the device, waiting for one if none came since the
+  // previous call. I3cError::timeout if none came. Only the task that
+  // enabled the IBIs (or, if none did, the first to wait) may wait on a
+  // device until disable_ibi(); others fail with CommonError::busy. A stop()
+  // from another task wakes it with CommonError::not_inited.
+  expected::expected<I3cIbi, Error> wait_ibi(I3cDevice device, uint32_t timeout_ms = wait_forever);
+
+  // Counters since init() or reset_stats()
+  expected::expected<I3cStats, Error> stats() const;
+  expected::expected<void, Error> reset_stats();
+};
+
+} // namespace ru::driver
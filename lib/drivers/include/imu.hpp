@@ -0,0 +1,180 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "common/common.hpp"
+#include "gpio.hpp"
+#include "spi.hpp"
+#include "timer.hpp"
+
+namespace ru::driver {
+
+struct ImuSample {
+  static constexpr size_t max_bytes = 20;
+
+  TimerInstant timestamp;   // data-ready edge
+  uint32_t sequence;        // data-ready edges before this one, missed ones included
+  uint8_t data[max_bytes];  // the burst read, without the command byte
+};
+
+struct ImuStats {
+  uint32_t samples;     // stored in the ring
+  uint32_t missed;      // data-ready edges without a sample (sequence gaps)
+  uint32_t overruns;    // of which: edges while the previous burst read ran
+  uint32_t dropped;     // samples lost to a full ring
+  uint32_t bus_errors;  // failed burst reads
+};
+
+// Data-ready to ring bookkeeping, independent of the hardware. The producer
+// reports each data-ready edge, starts the burst read when told to, and
+// reports its end; the consumer takes the samples out of a lock-free single
+// producer, single consumer ring. Edges the producer never saw (merged by a
+// late interrupt) are found from the timestamps: an interval of n nominal
+// periods means n - 1 missed samples. Imu feeds it from the EXTI and DMA
+// interrupts; scripts/imu_pipeline_sim.cpp from a model of the sensor.
+class ImuCapture {
+public:
+  static constexpr size_t ring_size = 128;  // power of two: 16 ms at 8 kHz
+
+  // Back to sequence 0. period: nominal data-ready interval, in TimerInstant
+  // units; sample_bytes: bytes of each burst read kept in ImuSample::data.
+  void reset(TimerInstant period, size_t sample_bytes) {
+    m_period = period ? period : 1;
+    m_sample_bytes = sample_bytes < ImuSample::max_bytes ? sample_bytes : ImuSample::max_bytes;
+    m_head = 0;
+    m_tail = 0;
+    m_edges = 0;
+    m_last_edge = 0;
+    m_reading = false;
+    m_stats = {};
+  }
+
+  // Producer side: data-ready edge at `timestamp`. True when the burst read
+  // of the sample must start now, false when one is still running.
+  bool data_ready(TimerInstant timestamp) {
+    uint32_t edges = 1;
+    if (m_edges) {
+      const TimerInstant intervals = (timestamp - m_last_edge + m_period / 2) / m_period;
+      edges = intervals > 1 ? static_cast<uint32_t>(intervals) : 1;
+      m_stats.missed += edges - 1;
+    }
+    m_edges += edges;
+    m_last_edge = timestamp;
+    if (m_reading) {
+      ++m_stats.overruns;
+      ++m_stats.missed;
+      return false;
+    }
+    m_reading = true;
+    m_pending = {timestamp, m_edges - 1};
+    return true;
+  }
+
+  // Producer side: the burst read started by data_ready() is over; data is
+  // the sample, ok false if the read failed
+  void burst_done(const uint8_t* data, bool ok) {
+    m_reading = false;
+    if (!ok) {
+      ++m_stats.bus_errors;
+      ++m_stats.missed;
+      return;
+    }
+    const uint32_t head = m_head;
+    if (head - m_tail == ring_size) {
+      ++m_stats.dropped;
+      ++m_stats.missed;
+      return;
+    }
+    ImuSample& sample = m_ring[head % ring_size];
+    sample.timestamp = m_pending.timestamp;
+    sample.sequence = m_pending.sequence;
+    std::memcpy(sample.data, data, m_sample_bytes);
+    // The sample is written before it is published
+    std::atomic_signal_fence(std::memory_order_release);
+    m_head = head + 1;
+    ++m_stats.samples;
+  }
+
+  // Consumer side
+  size_t available() const { return m_head - m_tail; }
+
+  // Copies out up to max of the oldest samples
+  size_t pop(ImuSample* out, size_t max) {
+    const uint32_t tail = m_tail;
+    const size_t count = available() < max ? available() : max;
+    std::atomic_signal_fence(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = m_ring[(tail + i) % ring_size];
+    }
+    std::atomic_signal_fence(std::memory_order_release);
+    m_tail = tail + static_cast<uint32_t>(count);
+    return count;
+  }
+
+  bool reading() const { return m_reading; }
+  const ImuStats& stats() const { return m_stats; }
+
+private:
+  struct Pending {
+    TimerInstant timestamp;
+    uint32_t sequence;
+  };
+
+  ImuSample m_ring[ring_size];
+  volatile uint32_t m_head = 0;  // written by the producer
+  volatile uint32_t m_tail = 0;  // written by the consumer
+  TimerInstant m_period = 1;
+  size_t m_sample_bytes = 0;
+  uint32_t m_edges = 0;
+  TimerInstant m_last_edge = 0;
+  volatile bool m_reading = false;
+  Pending m_pending{};
+  ImuStats m_stats{};
+};
+
+// An IMU on a Spi bus with its data-ready pin on an EXTI line (an 'interrupt'
+// entry of the gpio list, rising edge, debounce_us 0). Each sample is a burst
+// read of m_sample_bytes after the m_read_command byte, e.g. the first data
+// register with the read bit set.
+class ImuConfig : public Config {
+public:
+  Spi* m_spi;
+  SpiDevice m_device;
+  GpioId m_data_ready;
+  uint8_t m_read_command;
+  uint8_t m_sample_bytes;
+  uint32_t m_sample_rate_hz;
+  size_t m_batch;  // samples that wake Imu::read_batch
+  ImuConfig(Spi& spi, SpiDevice device, GpioId data_ready, uint8_t read_command,
+            uint8_t sample_bytes, uint32_t sample_rate_hz, size_t batch = 8);
+};
+
+class ImuInstanceSpecific;
+
+// Acquisition with no task in the loop: the data-ready interrupt timestamps
+// the edge and submits a transaction built once at init(), so the burst read
+// starts within the interrupt latency; its DMA completion interrupt appends
+// the sample to the ImuCapture ring and wakes the consumer once a batch is
+// there. Other devices on the bus delay the read by their transactions.
+class Imu : public Driver {
+  ImuInstanceSpecific* p_instance_specific;
+
+public:
+  static constexpr uint32_t wait_forever = UINT32_MAX;
+
+  Imu();
+  static expected::expected<void, Error> start();
+  expected::expected<void, Error> init(const Config&);
+  expected::expected<void, Error> stop();
+
+  // Waits for a batch, or for the timeout, then copies out up to max of the
+  // oldest samples. ImuError::timeout if there were none.
+  expected::expected<size_t, Error> read_batch(ImuSample* out, size_t max,
+                                               uint32_t timeout_ms = wait_forever);
+  expected::expected<ImuStats, Error> stats() const;
+};
+
+} // namespace ru::driver
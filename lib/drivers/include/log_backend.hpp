@@ -0,0 +1,102 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "FreeRTOS.h"
+
+namespace ru::driver {
+
+class Serial;
+
+namespace debug {
+
+// Deferred logging: callers (tasks or ISRs) only append a record to a lock-free
+// multi-producer ring; a low priority drain task formats the records and sends
+// them to a Serial port, or keeps the text in a RAM ring for the debugger.
+// A full ring drops the record and counts it against the caller's core.
+
+const size_t log_max_args = 5;
+// Longest raw text write (one stdout line, stdout being line buffered)
+const size_t log_max_write_size = 384;
+// Longest text or frame the drain task sends for one log()/RU_LOG_* record
+const size_t log_line_size = 128;
+
+struct LogStats {
+  uint32_t records;                         // appended
+  uint32_t dropped[configNUMBER_OF_CORES];  // ring full, per core
+};
+
+// Record formatted by the drain task: only fmt and the raw 32-bit arguments
+// are stored, so fmt and any %s argument must outlive the record (literals)
+bool log_deferred(const char* fmt, const uint32_t* args, size_t argc);
+
+// Interned record (RU_LOG_* in debug_log.hpp): `index` is the offset of the
+// format string in the non-loaded .ru_log_fmt section. The drain task sends it
+// as a binary frame with the raw arguments, scripts/log_decode.py formats it.
+bool log_interned(uint32_t index, const uint32_t* args, size_t argc);
+
+template <typename T>
+uint32_t log_word(T value) {
+  static_assert(std::is_pointer_v<T> || sizeof(T) <= sizeof(uint32_t),
+                "log arguments must fit 32 bits");
+  if constexpr (std::is_pointer_v<T>) {
+    return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(value));
+  } else if constexpr (std::is_floating_point_v<T>) {
+    // Raw bits, only the host decoder can format them (log_id)
+    return std::bit_cast<uint32_t>(value);
+  } else {
+    return static_cast<uint32_t>(value);
+  }
+}
+
+template <typename... Args>
+bool log(const char* fmt, Args... args) {
+  static_assert(sizeof...(Args) <= log_max_args, "too many log arguments");
+  static_assert((!std::is_floating_point_v<Args> && ...),
+                "snprintf cannot format the raw bits of a float, use RU_LOG_* instead");
+  const uint32_t words[] = {log_word(args)..., 0};
+  return log_deferred(fmt, words, sizeof...(Args));
+}
+
+template <typename... Args>
+bool log_id(const char* interned, Args... args) {
+  static_assert(sizeof...(Args) <= log_max_args, "too many log arguments");
+  const uint32_t words[] = {log_word(args)..., 0};
+  return log_interned(log_word(interned), words, sizeof...(Args));
+}
+
+// Raw text (stdout/stderr), copied into consecutive slots claimed at once, so
+// a write is never split between other records. A write longer than
+// log_max_write_size is dropped and counted like a full ring.
+bool log_write(const char* text, size_t len);
+
+// What the drain task sends for a record, written to line (log_line_size
+// bytes), returning its size: the text of a log() record, its args holding
+// log_max_args words, or the binary frame of an interned one
+size_t log_format(const char* fmt, const uint32_t* args, char* line);
+size_t log_frame(uint32_t index, const uint32_t* args, size_t argc, char* line);
+
+// Formats and outputs the pending records, returns how many were consumed.
+// With no sink the text goes to the RAM ring (log_ram_text).
+size_t log_drain(Serial* sink);
+
+// Drain task body: drains every period_ms, never returns
+void log_drain_loop(Serial* sink, uint32_t period_ms);
+
+LogStats log_stats();
+
+// Logs the cycles a caller spends in log(), in RU_LOG_INFO and in a 32 byte
+// log_write(), then the cycles and wire bytes of the drain side of the same
+// record: log_format() (also what a synchronous printf costs its caller) and
+// log_frame(). Over `calls` calls of each (DWT cycle counter). Target only.
+void report_log_cycles(size_t calls = 8);
+
+// RAM ring of the drained text when no sink is attached: `size` bytes
+// starting at `head` (oldest), wrapping around
+const char* log_ram_text(size_t& size, size_t& head);
+
+} // namespace debug
+} // namespace ru::driver
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <span>
 
+#include "adc.hpp"
 #include "common/common.hpp"
 
 namespace ru::driver {
@@ -32,11 +35,98 @@ public:
   expected::expected<void, Error> init(const Config&);
   expected::expected<void, Error> stop();
 
+  // The output stays at its inactive level from init() until enable(), and
+  // returns to it on disable() instead of freezing where the period stopped:
+  // MOE gates it on TIM1/TIM8 (idle level through OSSI/OISx), a forced
+  // inactive compare mode on the other timers.
   expected::expected<void, Error> enable();
   expected::expected<void, Error> disable();
   expected::expected<void, Error> set_frequency(uint32_t frequency_hz);
   expected::expected<void, Error> set_duty_cycle(uint16_t duty_cycle_permille);
   expected::expected<uint16_t, Error> get_duty_cycle() const;
+  // ADC trigger at phase_permille of every PWM period (0 is the period start),
+  // on the timer's sync compare channel (config.yaml): pass it to
+  // AdcScanConfig. The phase follows set_frequency.
+  expected::expected<AdcHardwareTrigger, Error> adc_trigger(uint16_t phase_permille);
+};
+
+// Output of a PwmGroup: a compare channel (1-4) and, when complementary, its
+// CHxN pin too (advanced timers, channels 1-3), driven inverted with the dead
+// time of the group inserted at both edges
+struct PwmGroupChannel {
+  uint8_t channel;
+  bool complementary;
+  PwmPolarity polarity;
+};
+
+// Timer of the 'pwm' module of config.yaml marked 'group'. The channels are
+// copied by init(); m_dead_time_ns is rounded up to what the timer can insert.
+class PwmGroupConfig : public Config {
+public:
+  const PwmId m_id;
+  uint32_t m_frequency_hz;
+  std::span<const PwmGroupChannel> m_channels;
+  uint32_t m_dead_time_ns;
+  PwmGroupConfig(PwmId id, uint32_t frequency_hz, std::span<const PwmGroupChannel> channels,
+                 uint32_t dead_time_ns = 0);
+};
+
+class PwmGroupInstanceSpecific;
+
+// Several outputs of one timer whose duties change together, at the period
+// boundary: a new set of duties is staged, then committed whole, so no period
+// ever mixes old and new compare values. With a 'burst_dma' channel in
+// config.yaml, a waveform table can instead reload the compares every period
+// by DMA, without the CPU.
+class PwmGroup : public Driver {
+  PwmGroupInstanceSpecific* p_instance_specific;
+
+public:
+  static constexpr size_t max_channels = 4;
+
+  PwmGroup();
+  static expected::expected<void, Error> start();
+  expected::expected<void, Error> init(const Config&);
+  expected::expected<void, Error> stop();
+
+  // Starts the counter. On TIM1/TIM8 the outputs are held at their inactive
+  // level (MOE low, OSSI) from init() until enable() sets MOE, and disable()
+  // clears MOE before stopping the counter, so they return to that level
+  // (after the dead time) instead of freezing wherever the period stops.
+  expected::expected<void, Error> enable();
+  expected::expected<void, Error> disable();
+  // New period, with the committed duties, from the next update event.
+  // CommonError::busy from play_waveform() until stop_waveform().
+  expected::expected<void, Error> set_frequency(uint32_t frequency_hz);
+
+  // Duty of the output at `index` in the config channels, kept aside until
+  // commit(). From a task or an interrupt (priority 5 or more).
+  expected::expected<void, Error> stage(size_t index, uint16_t duty_cycle_permille);
+  // Writes the staged duties with the update event held off, so they all take
+  // effect at the same period boundary: the next one, or the one after if the
+  // counter wrapped meanwhile. CommonError::busy from play_waveform() until
+  // stop_waveform().
+  expected::expected<void, Error> commit();
+  // stage() of every output, in config order, then commit()
+  expected::expected<void, Error> set_duty_cycles(std::span<const uint16_t> duty_cycle_permille);
+  expected::expected<uint16_t, Error> get_duty_cycle(size_t index) const;
+
+  // Waveform tables are rows of waveform_row_words() compare values, one per
+  // channel from the lowest to the highest of the group (any unused one in
+  // between included), in timer ticks as given by compare_of()
+  expected::expected<size_t, Error> waveform_row_words() const;
+  expected::expected<uint32_t, Error> compare_of(uint16_t duty_cycle_permille) const;
+  // Each update event loads the next row into the compare preload registers,
+  // in effect one period later; with `loop` the table starts over, otherwise
+  // the last row stays. The table belongs to the group until stop_waveform().
+  // PwmError::not_supported without a burst DMA channel.
+  expected::expected<void, Error> play_waveform(std::span<const uint32_t> table, bool loop);
+  // Back to the committed duties, from the next update event
+  expected::expected<void, Error> stop_waveform();
+  // Whether the table is still being played, false once a table without
+  // `loop` is over; CommonError::general_error if the DMA failed, which
+  // stops it
+  expected::expected<bool, Error> waveform_running() const;
 };
 
 } // namespace ru::driver
@@ -0,0 +1,153 @@
+/**
+ * @file raceup_can_loadgen.h
+ * @date 2026
+ * @brief RaceUp Team CAN Traffic Generator.
+ * * This file contains the structures and API of the CAN load generator. It replays
+ * a traffic profile (IDs, periods, bursts, DLC mix) through @ref RUP_FDCAN_Send,
+ * optionally in internal loopback, and reports the achieved frame rate, bus load,
+ * Rx loss and CPU load so driver changes can be benchmarked at full bus load.
+ *
+ * @version 1.0
+ */
+
+#ifndef _RACEUP_CAN_LOADGEN_H
+#define _RACEUP_CAN_LOADGEN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "raceup_fdcan.h"
+
+/** @addtogroup RaceUp_Drivers RaceUp Drivers
+ * @{
+ */
+
+/** @defgroup RUP_CANLOAD CAN Load Generator
+ * @brief Traffic profile replay and throughput benchmarking.
+ * @{
+ */
+
+/* Exported constants --------------------------------------------------------*/
+
+/** @brief Maximum number of streams in a traffic profile */
+#define RUP_CANLOAD_MAX_STREAMS         16U
+
+/** @brief Maximum number of entries in a stream DLC mix */
+#define RUP_CANLOAD_MAX_DLC_MIX         4U
+
+/** @brief Depth of the ring collecting the generated frames received back */
+#define RUP_CANLOAD_RX_RING_LENGTH      64U
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief  Traffic Stream.
+ * @details Every `period_us` a burst of `burst` frames with ID `id` is released. The
+ * frame lengths cycle through `dlc`. A period of 0 turns the stream into background
+ * load that takes every free Tx FIFO slot, i.e. saturates the bus.
+ */
+typedef struct {
+    uint16_t id;                                /*!< Standard CAN ID (11-bit) */
+    uint8_t  dlc[RUP_CANLOAD_MAX_DLC_MIX];      /*!< DLC mix (0-8 bytes), cycled frame after frame */
+    uint8_t  dlc_count;                         /*!< Used entries of `dlc` (1 to RUP_CANLOAD_MAX_DLC_MIX) */
+    uint8_t  burst;                             /*!< Frames released back-to-back at each period */
+    uint32_t period_us;                         /*!< Period between bursts (0 = saturate) */
+    uint32_t offset_us;                         /*!< Release time of the first burst */
+} RUP_CANLOAD_StreamTypeDef;
+
+/**
+ * @brief  Traffic Profile.
+ * @details Generated by `generate.py` from the YAML file referenced by the `load_test`
+ * block of an FDCAN instance in `config.yaml` (e.g. `FDCAN1_LOAD_PROFILE`).
+ */
+typedef struct {
+    const char* name;                           /*!< Profile name */
+    uint32_t bitrate;                           /*!< Nominal bitrate of the bus under test (bit/s) */
+    uint32_t duration_ms;                       /*!< Test duration */
+    uint8_t  loopback;                          /*!< 1 = run in internal loopback */
+    uint8_t  count;                             /*!< Number of streams */
+    const RUP_CANLOAD_StreamTypeDef* streams;   /*!< Stream table */
+} RUP_CANLOAD_ProfileTypeDef;
+
+/**
+ * @brief  Load Test Report.
+ * @details Bus load counts the nominal frame length (47 + 8 * DLC bits, including the
+ * interframe space, excluding stuff bits). Rx figures are only meaningful when the
+ * frames come back to this node (loopback, or a peer echoing them) and pass the filters.
+ */
+typedef struct {
+    uint32_t elapsed_us;        /*!< Measured test duration */
+    uint32_t tx_frames;         /*!< Frames accepted by the Tx FIFO */
+    uint32_t tx_deferred;       /*!< Polls that found the Tx FIFO full with periodic frames pending */
+    uint32_t tx_overruns;       /*!< Periodic bursts released before the previous one was sent */
+    uint32_t rx_frames;         /*!< Generated frames received back */
+    uint32_t rx_lost;           /*!< Generated frames never received back */
+    uint32_t frame_rate;        /*!< Achieved Tx rate (frames/s) */
+    uint32_t bus_load_permille; /*!< Share of the bus occupied by the generated frames */
+    uint32_t isr_load_permille; /*!< Share of CPU time spent in the FDCAN interrupt handlers */
+    uint32_t gen_load_permille; /*!< Share of CPU time spent in @ref RUP_CANLOAD_Poll */
+} RUP_CANLOAD_ReportTypeDef;
+
+/**
+ * @brief  Load Generator State.
+ */
+typedef enum {
+    RUP_CANLOAD_IDLE    = 0x00U, /*!< No test configured or report already collected */
+    RUP_CANLOAD_RUNNING = 0x01U, /*!< Test in progress, keep calling @ref RUP_CANLOAD_Poll */
+    RUP_CANLOAD_DONE    = 0x02U  /*!< Duration elapsed, report available */
+} RUP_CANLOAD_StateTypeDef;
+
+/* Exported functions --------------------------------------------------------*/
+/** @defgroup RUP_CANLOAD_Exported_Functions API Functions
+ * @{
+ */
+
+/**
+ * @brief  Starts replaying a traffic profile.
+ * @details Switches the instance to internal loopback if the profile asks for it and
+ * subscribes to the stream IDs to count the frames received back (released again when the
+ * test ends or is stopped, so repeated tests do not pile up). The first two payload
+ * bytes of each frame carry a per-stream sequence number (little endian).
+ * * @param  Instance  Pointer to FDCAN peripheral (initialized and started).
+ * @param  profile   Profile to replay (must stay valid until the test ends).
+ * * @return RUP_FDCAN_OK on success, RUP_FDCAN_BUSY if a test is running,
+ * RUP_FDCAN_ERROR on an invalid profile or if no subscriber slot is left.
+ * * @note   The stream IDs must pass the active filters to be counted as received; frames
+ * matched by High Priority filters go to the fast lane and are counted as lost.
+ */
+RUP_FDCAN_StatusTypeDef RUP_CANLOAD_Start(FDCAN_GlobalTypeDef *Instance,
+    const RUP_CANLOAD_ProfileTypeDef *profile);
+
+/**
+ * @brief  Runs the generator: releases due bursts, fills the Tx FIFO and counts Rx frames.
+ * @details Call as often as possible (busy loop or a high rate task); the release
+ * jitter is the interval between two calls. Stops the test once the duration elapsed.
+ * * @return Current state of the generator.
+ */
+RUP_CANLOAD_StateTypeDef RUP_CANLOAD_Poll(void);
+
+/**
+ * @brief  Stops the test early (the report covers the time elapsed so far).
+ */
+void RUP_CANLOAD_Stop(void);
+
+/**
+ * @brief  Retrieves the report of the last test and returns the generator to idle.
+ * * @param  report  Output report.
+ * * @return RUP_FDCAN_OK on success, RUP_FDCAN_BUSY while the test is still running.
+ */
+RUP_FDCAN_StatusTypeDef RUP_CANLOAD_GetReport(RUP_CANLOAD_ReportTypeDef *report);
+
+/** @} */ /* End of RUP_CANLOAD_Exported_Functions */
+
+/** @} */ /* End of RUP_CANLOAD */
+
+/** @} */ /* End of RaceUp_Drivers */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RACEUP_CAN_LOADGEN_H */
@@ -30,8 +30,113 @@ extern "C" {
  * @{
  */
 
+/* Exported constants --------------------------------------------------------*/
+
+/** @brief Number of standard filter elements reserved in message RAM */
+#define RUP_FDCAN_STD_FILTER_NBR        28U
+
+/** @brief Number of distinct Standard (11-bit) identifiers */
+#define RUP_FDCAN_STD_ID_COUNT          2048U
+
+/** @brief Bound (loop iterations) of the bus-idle wait and of the INIT entry/exit polls */
+#define RUP_FDCAN_IDLE_WAIT_SPINS       20000U
+
+/** @brief Maximum number of Rx subscribers per FDCAN instance (width of the ID mask) */
+#define RUP_FDCAN_MAX_SUBSCRIBERS       8U
+
+/** @brief Depth of each Rx FIFO in message RAM (fixed by the STM32H5 FDCAN) */
+#define RUP_FDCAN_RX_FIFO_ELEMENTS      3U
+
+/** @brief Words of an Rx element kept across a configuration window (2 header + 8 data bytes) */
+#define RUP_FDCAN_SAVED_RX_WORDS        4U
+
+/** @brief Rx elements a configuration window can take out of the FIFOs (both full) */
+#define RUP_FDCAN_SAVED_RX_ELEMENTS     (2U * RUP_FDCAN_RX_FIFO_ELEMENTS)
+
+/** @brief Buckets of the High Priority latency histogram (see @ref RUP_FDCAN_HpLatencyTypeDef) */
+#define RUP_FDCAN_HP_LATENCY_BUCKETS    8U
+
+/** @brief Size of the software acceptance bitmap in 32-bit words (one bit per Standard ID) */
+#define RUP_FDCAN_ACCEPT_BITMAP_WORDS   (RUP_FDCAN_STD_ID_COUNT / 32U)
+
 /* Exported types ------------------------------------------------------------*/
 
+/**
+ * @brief  Rx element taken out of its FIFO by a configuration window.
+ * @details Copied raw with interrupts masked and dispatched later by the Rx interrupt, so
+ * no callback runs inside the window.
+ */
+typedef struct {
+    uint32_t words[RUP_FDCAN_SAVED_RX_WORDS]; /*!< Element header (R0, R1) and data */
+    uint32_t fifo;                            /*!< RUP_FDCAN_RX_FIFO0 or RUP_FDCAN_RX_FIFO1 */
+    uint32_t receipt;                         /*!< DWT cycle count when the window took it out */
+} RUP_FDCAN_SavedRxTypeDef;
+
+/**
+ * @brief  Receipt-to-delivery latency distribution of one High Priority delivery path.
+ * @details Bucket 0 counts frames delivered within 1 us of receipt, bucket n (1..6) those
+ * within [2^(n-1), 2^n) us, the last bucket everything from 64 us on.
+ */
+typedef struct {
+    uint32_t count;             /*!< Frames measured */
+    uint32_t last_cycles;       /*!< Latency of the last frame in CPU cycles */
+    uint32_t max_cycles;        /*!< Worst latency observed in CPU cycles */
+    uint32_t buckets[RUP_FDCAN_HP_LATENCY_BUCKETS]; /*!< Frames per latency range */
+} RUP_FDCAN_HpLatencyTypeDef;
+
+/**
+ * @brief  Software Acceptance Bitmap.
+ * @details One bit per Standard ID (2048 bits, 256 bytes). Bit `id` set means
+ * frames with that identifier are accepted. Usually generated by `generate.py`
+ * from the `accept` block of an FDCAN instance in `config.yaml`.
+ */
+typedef struct {
+    uint32_t words[RUP_FDCAN_ACCEPT_BITMAP_WORDS]; /*!< Bit (id % 32) of word (id / 32) */
+} RUP_FDCAN_AcceptBitmapTypeDef;
+
+
+/**
+ * @brief  Received Standard ID frame as stored in a subscriber ring.
+ */
+typedef struct {
+    uint16_t id;        /*!< Standard CAN ID (11-bit) */
+    uint8_t  len;       /*!< Length of the data (0-8 bytes) */
+    uint8_t  data[8];   /*!< Data payload */
+    uint32_t timestamp; /*!< DWT cycle count when the ISR fetched the frame */
+} RUP_FDCAN_FrameTypeDef;
+
+/**
+ * @brief  Per-ID subscriber bitmask (bit n set = subscriber slot n wants the ID).
+ */
+typedef uint8_t RUP_FDCAN_SubscriberMaskTypeDef;
+
+/**
+ * @brief  Rx Subscriber.
+ * @details A bounded single-producer/single-consumer ring filled by the Rx ISR with the
+ * frames whose ID the subscriber registered for, and drained by one consumer task
+ * through @ref RUP_FDCAN_SubscriberPop. A full ring only affects its own subscriber:
+ * the frame is dropped for it and counted in `Dropped`.
+ * @note   Initialize with @ref RUP_FDCAN_SubscriberInit; fields are owned by the driver.
+ */
+typedef struct RUP_FDCAN_Subscriber {
+    RUP_FDCAN_FrameTypeDef* Ring;   /*!< Caller-provided frame storage */
+    uint16_t RingMask;              /*!< Capacity - 1 (capacity is a power of two) */
+    volatile uint16_t Head;         /*!< Next slot written by the ISR */
+    volatile uint16_t Tail;         /*!< Next slot read by the consumer */
+    volatile uint32_t Dropped;      /*!< Frames lost because the ring was full */
+
+    /**
+     * @brief Optional hook called from the ISR after a frame has been queued.
+     * @param ctx User context given to @ref RUP_FDCAN_SubscriberInit.
+     * @note  Typically wakes the consumer task (e.g. vTaskNotifyGiveFromISR).
+     */
+    void (*Notify)(void* ctx);
+    void* NotifyCtx;                /*!< Context passed to Notify */
+
+    FDCAN_GlobalTypeDef* Instance;  /*!< Instance the subscriber is registered on (NULL if none) */
+    uint8_t Slot;                   /*!< Bit of this subscriber in the ID mask table */
+} RUP_FDCAN_SubscriberTypeDef;
+
 /**
  * @brief  FDCAN Wrapper Handle Structure.
  * @note   This structure extends the standard HAL handle to include custom 
@@ -68,6 +173,50 @@ typedef struct {
      */
     void (*HpCallback)(FDCAN_HpMsgStatusTypeDef* hpStatus);
 
+    /**
+     * @brief Fast lane ISR handler for frames matched by a High Priority filter.
+     * @param frame Frame fetched from message RAM (valid only during the call).
+     */
+    void (*HpFrameCallback)(const RUP_FDCAN_FrameTypeDef* frame);
+
+    RUP_FDCAN_SubscriberTypeDef* HpSubscriber; /*!< Fast lane ring of the High Priority task (or NULL) */
+    uint32_t HpFilterMask;          /*!< Bit n set = standard filter element n stores as High Priority */
+    uint8_t HpDelivered[2];         /*!< Per FIFO: element indexes already handed to the fast lane */
+    volatile uint32_t HpFrames;     /*!< Frames delivered through the fast lane */
+    volatile uint32_t HpLost;       /*!< High Priority frames lost because their FIFO was full */
+    uint32_t HpCyclesPerUs;         /*!< SystemCoreClock in cycles per microsecond, for the histograms */
+    RUP_FDCAN_HpLatencyTypeDef HpHandlerLatency; /*!< Receipt to HP frame handler entry (ISR side) */
+    RUP_FDCAN_HpLatencyTypeDef HpTaskLatency;    /*!< Receipt to @ref RUP_FDCAN_HpPop (HP task side) */
+    volatile uint32_t RxIrqEntry;   /*!< DWT cycle count at the entry of the running FDCAN interrupt */
+
+    volatile uint32_t IsrCycles;    /*!< CPU cycles spent in the FDCAN interrupt handlers (wraps) */
+
+    /**
+     * @brief Software acceptance bitmap checked in the Rx ISR (NULL = disabled).
+     * @note  Swapped at runtime through @ref RUP_FDCAN_SetAcceptBitmap.
+     */
+    const RUP_FDCAN_AcceptBitmapTypeDef* volatile AcceptBitmap;
+
+    volatile uint32_t BitmapRejected; /*!< Frames dropped in the ISR by the acceptance bitmap */
+
+    uint8_t StdFilterCount;         /*!< Standard filter elements in use (next free index) */
+
+    const struct RUP_FDCAN_FilterSet* ActiveFilterSet; /*!< Last set applied by @ref RUP_FDCAN_ApplyFilterSet */
+    uint32_t FilterSwitches;        /*!< Number of filter set switches since init */
+    uint32_t LastBlackoutCycles;    /*!< CPU cycles spent in INIT during the last switch */
+    uint32_t MaxBlackoutCycles;     /*!< Worst INIT window observed since init */
+
+    /** @brief Rx elements taken out by configuration windows, oldest first, not yet dispatched */
+    RUP_FDCAN_SavedRxTypeDef SavedRx[RUP_FDCAN_SAVED_RX_ELEMENTS];
+    volatile uint8_t SavedRxCount;  /*!< Used entries of SavedRx (reset by the Rx interrupt) */
+    volatile uint32_t SavedRxDropped; /*!< Frames lost because SavedRx was still full */
+
+    RUP_FDCAN_SubscriberTypeDef* Subscribers[RUP_FDCAN_MAX_SUBSCRIBERS]; /*!< Registered Rx subscribers */
+    uint8_t SubscriberCount;        /*!< Number of used subscriber slots */
+
+    /** @brief Precomputed ID -> subscriber bitmask consulted by the Rx ISR */
+    volatile RUP_FDCAN_SubscriberMaskTypeDef SubscriberMask[RUP_FDCAN_STD_ID_COUNT];
+
     volatile uint8_t Initialized;   /*!< Flag indicating if the driver is initialized (1) or not (0) */
 
 } RUP_FDCAN_HandleTypeDef;
@@ -154,6 +303,77 @@ typedef enum {
     RUP_FDCAN_IT_ALL       = 0x03U  /*!< Enable both FIFO 0 and FIFO 1 Interrupts */
 } RUP_FDCAN_RxItModeTypeDef;
 
+/**
+ * @brief  Precompiled Filter Set (message RAM image).
+ * @details Generated by `generate.py` from the `filter_sets` block of an FDCAN instance
+ * in `config.yaml`. `elements` is copied verbatim into the standard filter list of the
+ * message RAM by @ref RUP_FDCAN_ApplyFilterSet; unused elements are 0 (disabled).
+ */
+typedef struct RUP_FDCAN_FilterSet {
+    const char* name;                                     /*!< Set name as written in config.yaml */
+    RUP_FDCAN_GlobalFilterTypeDef global_filter;          /*!< Behavior for non-matching frames */
+    uint8_t count;                                        /*!< Number of used filter elements */
+    const RUP_FDCAN_AcceptBitmapTypeDef* accept_bitmap;   /*!< Bitmap installed with the set (or NULL) */
+    uint32_t elements[RUP_FDCAN_STD_FILTER_NBR];          /*!< Standard filter elements (S0 words) */
+} RUP_FDCAN_FilterSetTypeDef;
+
+/**
+ * @brief  Filter Set Switch Statistics.
+ * @details Blackout is the time the node spent in INIT mode (no Rx/Tx), measured with
+ * the DWT cycle counter. After leaving INIT the node also needs 11 recessive bits to
+ * re-integrate into the bus before the next frame can be received.
+ */
+typedef struct {
+    uint32_t switches;          /*!< Number of filter set switches since init */
+    uint32_t last_cycles;       /*!< INIT window of the last switch in CPU cycles */
+    uint32_t max_cycles;        /*!< Worst INIT window observed in CPU cycles */
+    uint32_t last_us;           /*!< INIT window of the last switch in microseconds */
+    uint32_t max_us;            /*!< Worst INIT window observed in microseconds */
+} RUP_FDCAN_FilterSwitchStatsTypeDef;
+
+/**
+ * @brief  High Priority Fast Lane Statistics.
+ * @details Latency from receipt, per frame: receipt is the DWT cycle count at the entry of
+ * the Rx interrupt raised by the High Priority message, so the time the interrupt spent
+ * pending (masked, or behind higher priority handlers) is not included. A frame collected
+ * without its own interrupt (High Priority status overwritten by a later frame, or taken
+ * out by a configuration window) is stamped when it was collected. Both delivery paths
+ * are measured separately: to the entry of the HP frame handler, and to
+ * @ref RUP_FDCAN_HpPop in the HP task.
+ */
+typedef struct {
+    uint32_t frames;            /*!< Frames delivered through the fast lane */
+    uint32_t lost;              /*!< HP frames lost in hardware (Rx FIFO full) */
+    uint32_t dropped;           /*!< HP frames dropped because the HP task ring was full */
+    uint32_t cycles_per_us;     /*!< CPU cycles per microsecond, to convert the latencies */
+    RUP_FDCAN_HpLatencyTypeDef handler; /*!< Receipt to the HP frame handler */
+    RUP_FDCAN_HpLatencyTypeDef task;    /*!< Receipt to @ref RUP_FDCAN_HpPop */
+} RUP_FDCAN_HpStatsTypeDef;
+
+/* Exported macros -----------------------------------------------------------*/
+
+/**
+ * @brief  Builds a standard filter element word (S0) as stored in message RAM.
+ * @param  type    @ref RUP_FDCAN_FilterTypeTypeDef value.
+ * @param  config  @ref RUP_FDCAN_FilterConfigTypeDef value.
+ * @param  id1     First ID (or ID in Mask mode).
+ * @param  id2     Second ID (or Mask in Mask mode).
+ */
+#define RUP_FDCAN_STD_FILTER_ELEMENT(type, config, id1, id2) \
+    (((uint32_t)(type) << 30U) | ((uint32_t)(config) << 27U) | \
+     (((uint32_t)(id1) & 0x7FFU) << 16U) | ((uint32_t)(id2) & 0x7FFU))
+
+/**
+ * @brief  Checks whether a Standard ID is set in an acceptance bitmap.
+ * @param  bitmap Pointer to the acceptance bitmap.
+ * @param  id     Standard CAN ID (11-bit).
+ * @return 1 if the ID is accepted, 0 otherwise.
+ */
+static inline uint8_t RUP_FDCAN_BitmapTest(const RUP_FDCAN_AcceptBitmapTypeDef* bitmap, uint16_t id) {
+    id &= (RUP_FDCAN_STD_ID_COUNT - 1U);
+    return (uint8_t)((bitmap->words[id >> 5] >> (id & 0x1FU)) & 1U);
+}
+
 /* Exported variables --------------------------------------------------------*/
 
 /** @brief Global handle for FDCAN1 wrapper instance */
@@ -203,7 +423,9 @@ RUP_FDCAN_StatusTypeDef RUP_FDCAN_Start(FDCAN_GlobalTypeDef *Instance);
  * @param  config    Action to take on match (FIFO assignment or Reject).
  * @param  id1       First ID (or ID in Mask mode, or ID1 in Dual mode).
  * @param  id2       Second ID (or Mask in Mask mode, or ID2 in Dual mode).
- * * @return RUP_FDCAN_OK on success.
+ * * @return RUP_FDCAN_OK on success, RUP_FDCAN_ERROR if all
+ * @ref RUP_FDCAN_STD_FILTER_NBR elements are in use.
+ * * @note   Elements are allocated in order; the index restarts at 0 on @ref RUP_FDCAN_Init.
  */
 RUP_FDCAN_StatusTypeDef RUP_FDCAN_AddFilter(FDCAN_GlobalTypeDef *Instance,
     RUP_FDCAN_FilterTypeTypeDef type,
@@ -226,7 +448,10 @@ RUP_FDCAN_StatusTypeDef RUP_FDCAN_PollRxMessage(FDCAN_GlobalTypeDef *Instance,
 /**
  * @brief  Reads a message from the FIFO and triggers the registered callback.
  * @details Use this in polling mode after @ref RUP_FDCAN_PollRxMessage returns OK,
- * or rely on the IRQ handler which calls this internally.
+ * or rely on the IRQ handler which drains the FIFO the same way. The frame is also
+ * fanned out to the matching subscribers.
+ * @warning Do not mix with Rx interrupts on the same FIFO: subscriber rings accept a
+ * single producer.
  * * @param  Instance  Pointer to FDCAN peripheral.
  * @param  RxFifo    FIFO to read from.
  * * @return RUP_FDCAN_OK on success.
@@ -250,6 +475,81 @@ void RUP_FDCAN_RegisterRxFIFO0Callback(FDCAN_GlobalTypeDef *Instance,
 void RUP_FDCAN_RegisterRxFIFO1Callback(FDCAN_GlobalTypeDef *Instance,
     void (*Callback)(uint16_t id, uint8_t* data, uint8_t len));
 
+/**
+ * @brief  Prepares an Rx subscriber and its ring.
+ * * @param  sub       Subscriber to initialize.
+ * @param  storage   Frame storage for the ring (must outlive the subscriber).
+ * @param  capacity  Number of frames in `storage` (power of two, at least 2; one slot stays free).
+ * @param  Notify    Optional ISR hook called after each queued frame (may be NULL).
+ * @param  ctx       Context passed to `Notify`.
+ * * @return RUP_FDCAN_OK on success, RUP_FDCAN_ERROR on invalid arguments.
+ */
+RUP_FDCAN_StatusTypeDef RUP_FDCAN_SubscriberInit(RUP_FDCAN_SubscriberTypeDef *sub,
+    RUP_FDCAN_FrameTypeDef *storage,
+    uint16_t capacity,
+    void (*Notify)(void* ctx),
+    void *ctx);
+
+/**
+ * @brief  Subscribes to a range of Standard IDs.
+ * @details Registers the subscriber on the instance on first use, then marks
+ * `id_lo`..`id_hi` in the ID mask table. May be called several times to build
+ * scattered ID sets. The frames still have to pass the hardware filters and the
+ * acceptance bitmap. Frames are fanned out in the Rx ISR, next to the per-FIFO callbacks.
+ * * @param  Instance  Pointer to FDCAN peripheral.
+ * @param  sub       Subscriber initialized with @ref RUP_FDCAN_SubscriberInit.
+ * @param  id_lo     First Standard ID of the range.
+ * @param  id_hi     Last Standard ID of the range (inclusive).
+ * * @return RUP_FDCAN_OK on success, RUP_FDCAN_ERROR if all @ref RUP_FDCAN_MAX_SUBSCRIBERS
+ * slots are taken or the subscriber belongs to another instance.
+ */
+RUP_FDCAN_StatusTypeDef RUP_FDCAN_Subscribe(FDCAN_GlobalTypeDef *Instance,
+    RUP_FDCAN_SubscriberTypeDef *sub,
+    uint16_t id_lo,
+    uint16_t id_hi);
+
+/**
+ * @brief  Subscribes to every Standard ID set in a bitmap.
+ * * @param  Instance  Pointer to FDCAN peripheral.
+ * @param  sub       Subscriber initialized with @ref RUP_FDCAN_SubscriberInit.
+ * @param  ids       ID set (same layout as the acceptance bitmap).
+ * * @return RUP_FDCAN_OK on success, RUP_FDCAN_ERROR as for @ref RUP_FDCAN_Subscribe.
+ */
+RUP_FDCAN_StatusTypeDef RUP_FDCAN_SubscribeBitmap(FDCAN_GlobalTypeDef *Instance,
+    RUP_FDCAN_SubscriberTypeDef *sub,
+    const RUP_FDCAN_AcceptBitmapTypeDef *ids);
+
+/**
+ * @brief  Stops delivering a range of Standard IDs to a subscriber.
+ * @details Clears `id_lo`..`id_hi` in the ID mask table. The subscriber keeps its slot on
+ * the instance, so it can subscribe again later without using up another one.
+ * * @param  Instance  Pointer to FDCAN peripheral.
+ * @param  sub       Subscriber registered on `Instance`.
+ * @param  id_lo     First Standard ID of the range.
+ * @param  id_hi     Last Standard ID of the range (inclusive).
+ * * @return RUP_FDCAN_OK on success, RUP_FDCAN_ERROR on invalid arguments.
+ */
+RUP_FDCAN_StatusTypeDef RUP_FDCAN_Unsubscribe(FDCAN_GlobalTypeDef *Instance,
+    RUP_FDCAN_SubscriberTypeDef *sub,
+    uint16_t id_lo,
+    uint16_t id_hi);
+
+/**
+ * @brief  Takes the oldest frame out of a subscriber ring (consumer side).
+ * @note   Only one task may consume a given subscriber.
+ * * @param  sub    Subscriber to read from.
+ * @param  frame  Output frame.
+ * * @return 1 if a frame was copied, 0 if the ring is empty.
+ */
+uint8_t RUP_FDCAN_SubscriberPop(RUP_FDCAN_SubscriberTypeDef *sub, RUP_FDCAN_FrameTypeDef *frame);
+
+/**
+ * @brief  Returns the number of frames a subscriber lost because its ring was full.
+ * * @param  sub  Subscriber.
+ * @return Dropped frame count.
+ */
+uint32_t RUP_FDCAN_SubscriberGetDropped(const RUP_FDCAN_SubscriberTypeDef *sub);
+
 /**
  * @brief  Registers a custom callback for Error events.
  * * @param  Instance  Pointer to FDCAN peripheral.
@@ -266,6 +566,123 @@ void RUP_FDCAN_RegisterErrorCallback(FDCAN_GlobalTypeDef *Instance,
 void RUP_FDCAN_RegisterHpCallback(FDCAN_GlobalTypeDef *Instance,
     void (*Callback)(FDCAN_HpMsgStatusTypeDef* hpStatus));
 
+/**
+ * @brief  Registers the fast lane ISR handler for High Priority frames.
+ * @details Frames matched by a `RUP_FDCAN_FILTER_RXFIFOx_HP` filter are read from message
+ * RAM by the index reported in the High Priority Message Status, ahead of any older frame
+ * still waiting in the same FIFO, and handed to this handler from the FDCAN IT0 interrupt.
+ * While the fast lane is active (handler or HP subscriber set) these frames bypass the
+ * software acceptance bitmap, the regular subscribers and the per-FIFO callbacks.
+ * * @param  Instance  Pointer to FDCAN peripheral.
+ * @param  Callback  Handler run in ISR context (NULL to remove).
+ */
+void RUP_FDCAN_RegisterHpFrameCallback(FDCAN_GlobalTypeDef *Instance,
+    void (*Callback)(const RUP_FDCAN_FrameTypeDef* frame));
+
+/**
+ * @brief  Routes High Priority frames to a dedicated task through its own ring.
+ * @details Same fast lane as @ref RUP_FDCAN_RegisterHpFrameCallback, but the frame is queued
+ * in `sub` and its Notify hook wakes the consumer. The latency bound is the IT0 interrupt
+ * entry plus one message RAM read plus one context switch, provided the consumer is the
+ * highest priority task and IT0 the most urgent interrupt allowed to call FreeRTOS.
+ * * @param  Instance  Pointer to FDCAN peripheral.
+ * @param  sub       Subscriber initialized with @ref RUP_FDCAN_SubscriberInit (NULL to remove).
+ * Must not be registered for regular IDs with @ref RUP_FDCAN_Subscribe.
+ * * @return RUP_FDCAN_OK on success, RUP_FDCAN_ERROR on invalid arguments.
+ */
+RUP_FDCAN_StatusTypeDef RUP_FDCAN_SetHpSubscriber(FDCAN_GlobalTypeDef *Instance,
+    RUP_FDCAN_SubscriberTypeDef *sub);
+
+/**
+ * @brief  Takes the oldest frame out of the High Priority ring and records its latency
+ * from receipt.
+ * @note   Call from the HP task only (single consumer).
+ * * @param  Instance  Pointer to FDCAN peripheral.
+ * @param  frame     Output frame.
+ * * @return 1 if a frame was copied, 0 if the ring is empty.
+ */
+uint8_t RUP_FDCAN_HpPop(FDCAN_GlobalTypeDef *Instance, RUP_FDCAN_FrameTypeDef *frame);
+
+/**
+ * @brief  Retrieves the High Priority fast lane statistics.
+ * * @param  Instance  Pointer to FDCAN peripheral.
+ * @param  stats     Output statistics.
+ */
+void RUP_FDCAN_GetHpStats(FDCAN_GlobalTypeDef *Instance, RUP_FDCAN_HpStatsTypeDef *stats);
+
+/**
+ * @brief  Switches to a precompiled filter set at runtime.
+ * @details Waits (bounded by @ref RUP_FDCAN_IDLE_WAIT_SPINS) for the bus to be idle so the
+ * frame in progress is not cut, then enters INIT/CCE with interrupts masked, copies the
+ * message RAM image and the global filter, installs the set's acceptance bitmap and leaves
+ * INIT. The INIT window is measured and reported by @ref RUP_FDCAN_GetFilterSwitchStats.
+ * Setting CCE resets the Rx FIFO, Tx FIFO and High Priority status, so inside the window,
+ * before CCE, the frames waiting in the Rx FIFOs are copied raw and released, and the
+ * pending Tx requests are saved and queued again, in order, after INIT. The copied frames
+ * are delivered (fast lane, subscribers and callbacks) by the Rx interrupt, pended once
+ * interrupts are unmasked, ahead of any newer frame: no user code runs in the window.
+ * * @param  Instance  Pointer to FDCAN peripheral (must be initialized).
+ * @param  set       Filter set to apply (e.g. `FDCAN1_FILTER_SET_DRIVE` from raceup_setup.h).
+ * * @return RUP_FDCAN_OK on success, RUP_FDCAN_TIMEOUT if the peripheral did not acknowledge
+ * INIT (request withdrawn, old set kept and the node still on the bus) or has not left it yet (new set applied, Tx requests held until it does).
+ * * @note   No stored Rx frame nor pending Tx request is lost. Filters added afterwards with
+ * @ref RUP_FDCAN_AddFilter are appended after the set's elements.
+ */
+RUP_FDCAN_StatusTypeDef RUP_FDCAN_ApplyFilterSet(FDCAN_GlobalTypeDef *Instance,
+    const RUP_FDCAN_FilterSetTypeDef *set);
+
+/**
+ * @brief  Retrieves the filter set switch blackout statistics.
+ * * @param  Instance  Pointer to FDCAN peripheral.
+ * @param  stats     Output statistics.
+ */
+void RUP_FDCAN_GetFilterSwitchStats(FDCAN_GlobalTypeDef *Instance,
+    RUP_FDCAN_FilterSwitchStatsTypeDef *stats);
+
+/**
+ * @brief  Enables or disables the internal loopback test mode.
+ * @details Transmitted frames are fed straight back to the receiver (filters, FIFOs and
+ * interrupts behave as on a real bus) and the Tx pin stays recessive, so no transceiver
+ * or second node is needed. The switch goes through INIT/CCE like @ref RUP_FDCAN_ApplyFilterSet,
+ * with the same delivery of stored Rx frames and re-queuing of pending Tx requests.
+ * * @param  Instance  Pointer to FDCAN peripheral (must be initialized).
+ * @param  enable    1 to enter internal loopback, 0 to return to normal operation.
+ * * @return RUP_FDCAN_OK on success, RUP_FDCAN_TIMEOUT if the peripheral did not acknowledge INIT.
+ */
+RUP_FDCAN_StatusTypeDef RUP_FDCAN_SetLoopback(FDCAN_GlobalTypeDef *Instance, uint8_t enable);
+
+/**
+ * @brief  Returns the CPU cycles spent so far in the FDCAN interrupt handlers.
+ * @details Free-running 32-bit counter: take the difference of two readings to get the
+ * interrupt cost over a time window (used for CPU load by the load generator).
+ * * @param  Instance  Pointer to FDCAN peripheral.
+ * @return Accumulated DWT cycles.
+ */
+uint32_t RUP_FDCAN_GetIsrCycles(FDCAN_GlobalTypeDef *Instance);
+
+/**
+ * @brief  Installs (or removes) the software acceptance bitmap.
+ * @details While a bitmap is installed, every frame read by the Rx ISR (or by
+ * @ref RUP_FDCAN_ReadRxMessage) is checked against it before the user callback
+ * runs: frames whose ID bit is clear, and Extended ID frames, are dropped and
+ * counted. The swap is a single atomic pointer store, so it is safe to call
+ * while the peripheral is running.
+ * * @param  Instance  Pointer to FDCAN peripheral.
+ * @param  bitmap    New bitmap, or NULL to accept every frame passed by the hardware filters.
+ * * @return The previously installed bitmap (NULL if none).
+ * * @note   The bitmap is not copied and must stay valid while installed. The ISR may still
+ * be reading the previous bitmap for the frame in flight when this function returns.
+ */
+const RUP_FDCAN_AcceptBitmapTypeDef* RUP_FDCAN_SetAcceptBitmap(FDCAN_GlobalTypeDef *Instance,
+    const RUP_FDCAN_AcceptBitmapTypeDef* bitmap);
+
+/**
+ * @brief  Returns the number of frames dropped by the acceptance bitmap.
+ * * @param  Instance  Pointer to FDCAN peripheral.
+ * @return Rejected frame count since the last @ref RUP_FDCAN_Init.
+ */
+uint32_t RUP_FDCAN_GetBitmapRejectedCount(FDCAN_GlobalTypeDef *Instance);
+
 /**
  * @brief  Sends a Standard ID CAN message.
  * @details Simplifies transmission by automatically handling header configuration.
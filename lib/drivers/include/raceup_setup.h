@@ -1,4 +1,6 @@
 #include "main.h"
+#include "raceup_fdcan.h"
+#include "raceup_can_loadgen.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -8,11 +10,65 @@ extern "C" {
 #define USER_LED_BANK  GPIOE
 #define USER_LED_PIN   GPIO_PIN_3
 
+#define DEBUG_LED_BANK  GPIOB
+#define DEBUG_LED_PIN   GPIO_PIN_2
+
+#define PUMP_PWM_BANK  GPIOE
+#define PUMP_PWM_PIN   GPIO_PIN_9
+
+#define INVERTER_PWM_U_BANK  GPIOC
+#define INVERTER_PWM_U_PIN   GPIO_PIN_7
+
+#define INVERTER_PWM_U_N_BANK  GPIOB
+#define INVERTER_PWM_U_N_PIN   GPIO_PIN_14
+
+#define INVERTER_PWM_V_BANK  GPIOC
+#define INVERTER_PWM_V_PIN   GPIO_PIN_8
+
+#define INVERTER_PWM_V_N_BANK  GPIOB
+#define INVERTER_PWM_V_N_PIN   GPIO_PIN_15
+
+#define SHUTDOWN_LOOP_BANK  GPIOD
+#define SHUTDOWN_LOOP_PIN   GPIO_PIN_8
+
+#define IMU_SPI_SCK_BANK  GPIOA
+#define IMU_SPI_SCK_PIN   GPIO_PIN_5
+
+#define IMU_SPI_MISO_BANK  GPIOA
+#define IMU_SPI_MISO_PIN   GPIO_PIN_6
+
+#define IMU_SPI_MOSI_BANK  GPIOA
+#define IMU_SPI_MOSI_PIN   GPIO_PIN_7
+
+#define IMU_CS_BANK  GPIOA
+#define IMU_CS_PIN   GPIO_PIN_4
+
+#define IMU_DRDY_BANK  GPIOB
+#define IMU_DRDY_PIN   GPIO_PIN_0
+
+#define SENSOR_I2C_SCL_BANK  GPIOB
+#define SENSOR_I2C_SCL_PIN   GPIO_PIN_6
+
+#define SENSOR_I2C_SDA_BANK  GPIOB
+#define SENSOR_I2C_SDA_PIN   GPIO_PIN_7
+
+#define SENSOR_I3C_SCL_BANK  GPIOB
+#define SENSOR_I3C_SCL_PIN   GPIO_PIN_8
+
+#define SENSOR_I3C_SDA_BANK  GPIOB
+#define SENSOR_I3C_SDA_PIN   GPIO_PIN_9
+
+extern const RUP_FDCAN_FilterSetTypeDef FDCAN1_FILTER_SET_DEFAULT;
+extern const RUP_FDCAN_FilterSetTypeDef FDCAN1_FILTER_SET_PITS;
+extern const RUP_FDCAN_FilterSetTypeDef FDCAN1_FILTER_SET_CHARGING;
+extern const RUP_CANLOAD_ProfileTypeDef FDCAN1_LOAD_PROFILE;
 
 void SystemClock_Config(void);
 
 void config_FDCAN(void);
 
+void config_USART(void);
+
 void config_GPIO(void);
 
 #ifdef __cplusplus
@@ -0,0 +1,30 @@
+/**
+ * @file raceup_timer.h
+ * @date 2026
+ * @brief RaceUp Team 64-bit Cycle Timer Hook.
+ * * This file contains the C entry point of ru::driver::Timer (timer.hpp) that the
+ * FreeRTOS tick hook calls, so the 64-bit extension of the DWT cycle counter sees
+ * every wrap of the 32-bit counter even when no task or interrupt reads the time.
+ *
+ * @version 1.0
+ */
+
+#ifndef _RACEUP_TIMER_H
+#define _RACEUP_TIMER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  Counts a wrap of the DWT cycle counter if one happened since the last read.
+ * @note   Called from vApplicationTickHook (configUSE_TICK_HOOK), well within the
+ *         17 s period of the counter at 250 MHz. Does nothing while it is stopped.
+ */
+void RUP_Timer_TickHook(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RACEUP_TIMER_H */
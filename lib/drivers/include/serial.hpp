@@ -24,16 +24,45 @@ enum class SerialFlowControl {
   rts_cts
 };
 
+// Reception runs continuously: a circular DMA fills the Rx ring and idle-line,
+// half and full transfer events publish the new bytes to the reader.
+// The ring size must be a power of two (max 32768); with no ring given the
+// driver allocates one of default_rx_ring_size bytes.
+// Transmission is double buffered: the Tx buffer is split in two halves, one
+// on the wire while writers append to the other. With no buffer given the
+// driver allocates one of default_tx_buffer_size bytes.
 class SerialConfig : public Config {
 public:
+  static constexpr size_t default_rx_ring_size = 256;
+  static constexpr size_t default_tx_buffer_size = 256;
+
   const SerialId m_id;
   uint32_t m_baud_rate;
   SerialParity m_parity;
   SerialStopBits m_stop_bits;
   SerialFlowControl m_flow_control;
+  uint8_t* m_rx_ring;
+  size_t m_rx_ring_size;
+  uint8_t* m_tx_buffer;
+  size_t m_tx_buffer_size;
   SerialConfig(SerialId id, uint32_t baud_rate, SerialParity parity = SerialParity::none,
                SerialStopBits stop_bits = SerialStopBits::one,
-               SerialFlowControl flow_control = SerialFlowControl::none);
+               SerialFlowControl flow_control = SerialFlowControl::none,
+               uint8_t* rx_ring = nullptr, size_t rx_ring_size = default_rx_ring_size,
+               uint8_t* tx_buffer = nullptr, size_t tx_buffer_size = default_tx_buffer_size);
+};
+
+// Called from the DMA interrupt once an asynchronous write left the buffer
+using SerialTxCallback = void (*)(void* ctx);
+
+// CPU cost of transmission, while the DWT cycle counter runs. write() cycles
+// leave out the time blocked on a full buffer; the interrupt cycles cover
+// write() and write_async() blocks alike.
+struct SerialTxStats {
+  uint32_t bytes;         // queued by write()
+  uint32_t write_cycles;  // spent in write()
+  uint32_t irqs;          // Tx DMA interrupts
+  uint32_t irq_cycles;    // spent in them
 };
 
 class SerialInstanceSpecific;
@@ -42,14 +71,36 @@ class Serial : public Driver {
   SerialInstanceSpecific* p_instance_specific;
 
 public:
+  static constexpr uint32_t wait_forever = UINT32_MAX;
+
   Serial();
   static expected::expected<void, Error> start();
   expected::expected<void, Error> init(const Config&);
   expected::expected<void, Error> stop();
 
+  // Copies data into the Tx buffer and returns once it is queued, blocking
+  // only while both halves are full. Must not be called from an interrupt.
   expected::expected<size_t, Error> write(const uint8_t* data, size_t len);
-  expected::expected<size_t, Error> read(uint8_t* data, size_t len);
+  // Queues data without copying it; data must stay valid until callback runs
+  // (or flush returns). Blocks only while both Tx slots are in use.
+  expected::expected<void, Error> write_async(const uint8_t* data, size_t len,
+                                              SerialTxCallback callback = nullptr,
+                                              void* ctx = nullptr);
+  // Waits until everything queued has been shifted out of the USART;
+  // SerialError::timeout if it is not within timeout_ms
+  expected::expected<void, Error> flush(uint32_t timeout_ms = wait_forever);
+  // Blocks until len bytes arrived or timeout_ms elapsed, then returns the
+  // bytes read. Fails with SerialError::timeout if nothing arrived and with
+  // SerialError::overrun if the ring overflowed (its content is discarded).
+  expected::expected<size_t, Error> read(uint8_t* data, size_t len,
+                                         uint32_t timeout_ms = wait_forever);
   expected::expected<std::optional<size_t>, Error> try_read(uint8_t* data, size_t len);
+  expected::expected<SerialTxStats, Error> tx_stats() const;
 };
 
+// Writes `bytes` bytes to a free port in 64 byte write() calls, flushes, and
+// logs the CPU cycles per KiB spent in write() and in the Tx DMA interrupt
+// (DWT cycle counter) beside the wire time. Target only.
+void report_serial_cycles(SerialId id, uint32_t baud_rate, size_t bytes = 4096);
+
 } // namespace ru::driver
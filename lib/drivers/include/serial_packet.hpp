@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "serial.hpp"
+
+namespace ru::driver {
+
+// Binary packets over a Serial port.
+//
+// Wire format: COBS(type | payload | CRC-16/CCITT-FALSE of type and payload,
+// little endian) followed by a 0x00 delimiter. A packet fits a single COBS
+// block, so it is encoded in place in its Tx buffer and handed to the DMA
+// without copies, and decoded in place in the Rx buffer the port reads into.
+// After a corrupted packet the decoder drops bytes up to the next delimiter.
+class SerialPacket {
+public:
+  // COBS block (254) minus type and CRC
+  static constexpr size_t max_payload = 251;
+  static constexpr size_t max_handlers = 16;
+
+  // Called from poll() with the payload still in the Rx buffer: copy what
+  // must outlive the call
+  using Handler = void (*)(uint8_t type, std::span<const uint8_t> payload, void* ctx);
+
+  struct Stats {
+    uint32_t packets;         // dispatched to a handler
+    uint32_t unhandled;       // valid, but no handler for the type
+    uint32_t crc_errors;
+    uint32_t framing_errors;  // invalid COBS or shorter than type + CRC
+    uint32_t overflows;       // no delimiter within the largest encoded packet
+  };
+
+  explicit SerialPacket(Serial& serial);
+
+  expected::expected<void, Error> on(uint8_t type, Handler handler, void* ctx = nullptr);
+
+  // Payload area (max_payload bytes) of the next packet to send: fill it,
+  // then call send(type, len). Waits while both Tx buffers are on the wire.
+  expected::expected<std::span<uint8_t>, Error> prepare();
+  // Encodes the first len bytes of the prepared payload in place and queues them
+  expected::expected<void, Error> send(uint8_t type, size_t len);
+  // Copies payload into the next Tx buffer, then sends it
+  expected::expected<void, Error> send(uint8_t type, std::span<const uint8_t> payload);
+
+  // Reads the bytes received so far (waiting up to timeout_ms for the first
+  // one) and dispatches every complete packet. Returns the packets dispatched.
+  expected::expected<size_t, Error> poll(uint32_t timeout_ms = 0);
+
+  const Stats& stats() const { return m_stats; }
+
+private:
+  // Code byte, COBS block, delimiter
+  static constexpr size_t max_encoded = 1 + 254 + 1;
+
+  struct HandlerEntry {
+    Handler handler;
+    void* ctx;
+    uint8_t type;
+  };
+
+  void process(uint8_t* frame, size_t len);
+
+  Serial& m_serial;
+  HandlerEntry m_handlers[max_handlers];
+  size_t m_handler_count;
+
+  uint8_t m_tx[2][max_encoded];
+  volatile bool m_tx_busy[2];
+  uint8_t m_tx_next;
+  bool m_tx_prepared;
+
+  // Raw bytes: [m_rx_start, m_rx_len) is the frame being received
+  uint8_t m_rx[2 * max_encoded];
+  size_t m_rx_start;
+  size_t m_rx_len;
+  bool m_rx_discard;
+
+  Stats m_stats;
+};
+
+} // namespace ru::driver
@@ -4,9 +4,11 @@
 #include <cstdint>
 
 #include "common/common.hpp"
+#include "gpio.hpp"
 
 namespace ru::driver {
 
+// Clock polarity (CPOL) in the high bit, clock phase (CPHA) in the low one
 enum class SpiMode {
   mode0,
   mode1,
@@ -14,51 +16,134 @@ enum class SpiMode {
   mode3
 };
 
-enum class SpiClockPolarity {
-  idle_low,
-  idle_high
-};
-
 enum class SpiBitOrder {
   msb_first,
   lsb_first
 };
 
-enum class SpiDirection {
-  master,
-  slave
-};
-
+// Bus of the 'spi' module of config.yaml. The controller is always master;
+// the devices on it are registered with Spi::add_device.
 class SpiConfig : public Config {
 public:
   const SpiId m_id;
-  uint32_t m_frequency_hz;
+  explicit SpiConfig(SpiId id);
+};
+
+// Settings of one device on the bus. The clock is the fastest the kernel
+// clock prescaler gives without exceeding m_max_frequency_hz.
+// m_min_deselect_ns is the shortest time chip select may stay inactive (the
+// tCSH / tSHSL of the datasheet), enforced with the DWT cycle counter between
+// segments with deselect_after and between transactions to the device.
+class SpiDeviceConfig {
+public:
+  static constexpr uint32_t default_min_deselect_ns = 100;
+
+  GpioId m_chip_select;
+  uint32_t m_max_frequency_hz;
   SpiMode m_mode;
-  SpiClockPolarity m_clock_polarity;
   SpiBitOrder m_bit_order;
-  SpiDirection m_direction;
   bool m_chip_select_active_low;
-  SpiConfig(SpiId id, uint32_t frequency_hz, SpiMode mode = SpiMode::mode0,
-            SpiClockPolarity clock_polarity = SpiClockPolarity::idle_low,
-            SpiBitOrder bit_order = SpiBitOrder::msb_first,
-            SpiDirection direction = SpiDirection::master,
-            bool chip_select_active_low = true);
+  uint32_t m_min_deselect_ns;
+  SpiDeviceConfig(GpioId chip_select, uint32_t max_frequency_hz, SpiMode mode = SpiMode::mode0,
+                  SpiBitOrder bit_order = SpiBitOrder::msb_first,
+                  bool chip_select_active_low = true,
+                  uint32_t min_deselect_ns = default_min_deselect_ns);
+};
+
+// Device handle returned by Spi::add_device
+using SpiDevice = uint8_t;
+
+// Part of a transaction: len bytes clocked out of tx while rx fills
+struct SpiSegment {
+  const uint8_t* tx;    // nullptr sends 0xFF
+  uint8_t* rx;          // nullptr drops the received bytes
+  uint16_t len;
+  bool deselect_after;  // pulses chip select (m_min_deselect_ns) before the next segment
+};
+
+enum class SpiStatus : uint8_t {
+  idle,    // never submitted
+  queued,
+  active,  // on the bus
+  done,
+  failed   // DMA error, or the bus stopped
+};
+
+struct SpiTransaction;
+
+// Called from the DMA interrupt once a transaction is done or failed. It may
+// submit again, this transaction included.
+using SpiCallback = void (*)(SpiTransaction& transaction, void* ctx);
+
+// Segments run back to back with chip select held, from the first byte of the
+// first segment to the last byte of the last one. The transaction, its
+// segments and their buffers belong to the bus from Spi::submit until the
+// status is done or failed.
+struct SpiTransaction {
+  SpiDevice device;
+  const SpiSegment* segments;
+  size_t segment_count;
+  SpiCallback callback;
+  void* ctx;
+
+  // Driver state
+  volatile SpiStatus status;
+  SpiTransaction* next;
+  void* waiter;  // task blocked in Spi::wait
+};
+
+struct SpiStats {
+  uint32_t transactions;      // completed, failed ones included
+  uint32_t segments;
+  uint32_t reconfigurations;  // transactions that changed the mode or bit order
+  uint32_t dma_errors;
 };
 
 class SpiInstanceSpecific;
 
+// Transaction queue of one bus. Any task or interrupt submits transactions
+// to the devices it registered; the DMA runs them one after the other, the
+// next one started from the completion interrupt of the previous one, so the
+// bus stays busy without the CPU. Completion comes through the callback of
+// the transaction, or Spi::wait wakes the waiting task.
+// The mode and bit order are written to the controller only when they differ
+// from those of the previous transaction: devices sharing their settings
+// follow each other with no reconfiguration, and the clock line settles to
+// its new idle level before chip select goes active.
 class Spi : public Driver {
   SpiInstanceSpecific* p_instance_specific;
 
 public:
+  static constexpr uint32_t wait_forever = UINT32_MAX;
+  static constexpr size_t max_devices = 8;
+
   Spi();
   static expected::expected<void, Error> start();
   expected::expected<void, Error> init(const Config&);
+  // Fails the queued transactions (no callbacks) and releases the bus
   expected::expected<void, Error> stop();
 
-  expected::expected<void, Error> write(const uint8_t* data, size_t len);
-  expected::expected<void, Error> read(uint8_t* data, size_t len);
-  expected::expected<void, Error> transfer(const uint8_t* tx, uint8_t* rx, size_t len);
+  // Sets the chip select pin up, inactive, and precomputes the settings.
+  // Chip select is driven from the DMA interrupt with BSRR stores.
+  expected::expected<SpiDevice, Error> add_device(const SpiDeviceConfig& config);
+  // Actual clock of a device
+  expected::expected<uint32_t, Error> frequency(SpiDevice device) const;
+
+  // Queues a transaction, from a task or an interrupt (priority 5 or more).
+  // Fails with CommonError::busy while the transaction is still pending.
+  expected::expected<void, Error> submit(SpiTransaction& transaction);
+  // Blocks until the transaction is done. On timeout it stays queued, and its
+  // buffers in use.
+  expected::expected<void, Error> wait(SpiTransaction& transaction,
+                                       uint32_t timeout_ms = wait_forever);
+
+  // Single segment transactions, blocking until done
+  expected::expected<void, Error> write(SpiDevice device, const uint8_t* data, size_t len);
+  expected::expected<void, Error> read(SpiDevice device, uint8_t* data, size_t len);
+  expected::expected<void, Error> transfer(SpiDevice device, const uint8_t* tx, uint8_t* rx,
+                                           size_t len);
+
+  expected::expected<SpiStats, Error> stats() const;
 };
 
 } // namespace ru::driver
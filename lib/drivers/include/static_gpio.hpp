@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+
+#include "gpio.hpp"
+#include "stm32h5xx_hal.h"
+
+namespace ru::driver {
+
+// Configures the pins of `mask` on the port at `port_base` (clock included),
+// shared by the compile-time pin types
+void init_gpio_pins(uintptr_t port_base, uint16_t mask, GpioFunction function, GpioSpeed speed);
+
+// Port and pin mask of the pin `id` of config.yaml, for drivers that pick the
+// pin at run time but drive it from an interrupt with plain BSRR stores.
+// False when the id has no pin.
+bool find_gpio_pin(GpioId id, uintptr_t& port_base, uint16_t& mask);
+
+// Puts the pin `id` back to its config.yaml settings, as Gpio::start() left it
+void restore_gpio_pin(GpioId id);
+
+// GPIO pin known at compile time: every access is a constant-address load or
+// store to the port registers, no object, no checks. set/clear are a single
+// BSRR store, toggle an ODR load plus a BSRR store (atomic for the other pins
+// of the port, unlike ODR ^= mask). Use it where Gpio's runtime lookup and
+// error reporting are too slow (bit-banging, timing probes); Port is 'A'..'I'.
+template <char Port, uint8_t Pin, bool ActiveHigh = true>
+class StaticGpio {
+  static_assert(Port >= 'A' && Port <= 'I', "STM32H563 has ports A to I");
+  static_assert(Pin < 16, "pins are 0 to 15");
+
+public:
+  static constexpr uintptr_t port_base = GPIOA_BASE + (Port - 'A') * (GPIOB_BASE - GPIOA_BASE);
+  static constexpr uint16_t mask = static_cast<uint16_t>(1u << Pin);
+
+  static GPIO_TypeDef* port() { return reinterpret_cast<GPIO_TypeDef*>(port_base); }
+
+  static void init(GpioFunction function = GpioFunction::output_pushpull_pulldown,
+                   GpioSpeed speed = GpioSpeed::low) {
+    init_gpio_pins(port_base, mask, function, speed);
+  }
+
+  static void set_high() { port()->BSRR = mask; }
+  static void set_low() { port()->BSRR = static_cast<uint32_t>(mask) << 16; }
+
+  static void set_active() {
+    if constexpr (ActiveHigh) {
+      set_high();
+    } else {
+      set_low();
+    }
+  }
+
+  static void set_inactive() {
+    if constexpr (ActiveHigh) {
+      set_low();
+    } else {
+      set_high();
+    }
+  }
+
+  // Branchless: selects the set or reset half of BSRR
+  static void set_level(bool active) {
+    port()->BSRR = static_cast<uint32_t>(mask) << ((active == ActiveHigh) ? 0 : 16);
+  }
+
+  static void toggle() {
+    const uint32_t odr = port()->ODR;
+    port()->BSRR = ((odr & mask) << 16) | (~odr & mask);
+  }
+
+  static bool is_high() { return port()->IDR & mask; }
+  static bool is_low() { return !is_high(); }
+  static bool is_active() { return is_high() == ActiveHigh; }
+  static bool is_inactive() { return !is_active(); }
+};
+
+// Toggles the pin `id` of config.yaml `toggles` times through Gpio and through
+// its StaticGpio, then drives it with set_level() the same way, and logs the
+// cycles per 1000 calls of each (DWT cycle counter). Only pins that config.yaml
+// makes outputs are accepted; the pin runs as a very high speed push-pull
+// output meanwhile, then gets its config.yaml settings and level back. Target
+// only.
+void report_toggle_cycles(GpioId id, size_t toggles = 1000);
+
+} // namespace ru::driver
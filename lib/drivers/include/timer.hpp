@@ -6,16 +6,26 @@
 
 namespace ru::driver {
 
+// SystemCoreClock cycles: the DWT cycle counter extended to 64 bits. The
+// FreeRTOS tick hook reads it every tick (RUP_Timer_TickHook, raceup_timer.h),
+// so every wrap of the 32-bit counter (17 s at 250 MHz) is counted.
 using TimerInstant = uint64_t;
 
 class Timer : public Driver {
 public:
   Timer();
+  // Starts the cycle counter; init() does it too
   static expected::expected<void, Error> start();
   expected::expected<void, Error> init(const Config&);
   expected::expected<void, Error> stop();
 
+  // Callable from tasks and from interrupts at or below
+  // configMAX_SYSCALL_INTERRUPT_PRIORITY: its critical section does not mask
+  // the ones above, which must not call it
   expected::expected<TimerInstant, Error> time_now() const;
+  // Instant of a DWT cycle count read less than one wrap ago, e.g. the
+  // timestamp of a GpioEvent
+  expected::expected<TimerInstant, Error> instant_of(uint32_t cycles) const;
 };
 
 } // namespace ru::driver
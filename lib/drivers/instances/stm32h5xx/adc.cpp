@@ -1,9 +1,284 @@
 #include <optional>
 
+#include "FreeRTOS.h"
+#include "stm32h5xx_hal.h"
+#include "task.h"
+
 #include "adc.hpp"
+#include "dma_helpers.hpp"
 
 namespace ru::driver {
 
+namespace {
+// Task notification slot used to wake a task blocked in AdcScan::wait_block,
+// the one Serial uses: a task waits on one driver at a time
+const UBaseType_t adc_notify_index = 1;
+
+const uint8_t max_adc_channel = 19;
+// Voltage regulator start-up time (tADCVREG_STUP)
+const uint32_t adc_regulator_startup_us = 20;
+// Polling bound of the calibration, enable and stop sequences
+const uint32_t adc_poll_limit = 1000000;
+
+struct AdcHw {
+  AdcId id;
+  ADC_TypeDef* adc;
+  IRQn_Type adc_irq;
+  DMA_Channel_TypeDef* dma;
+  IRQn_Type dma_irq;
+  uint32_t dma_request;
+  uint32_t irq_priority;
+};
+
+// ADCs generated from config.yaml, closed by an invalid entry so the table is
+// never empty
+#define X_adc_instance(index, id, periph, dma_channel, irq_priority)           \
+  {AdcId::id, periph, periph##_IRQn, GPDMA1_Channel##dma_channel,              \
+   GPDMA1_Channel##dma_channel##_IRQn, GPDMA1_REQUEST_##periph, irq_priority},
+const AdcHw adc_hw[] = {
+#include "adc_instances.hpp"
+  {},  // AdcId::invalid
+};
+#undef X_adc_instance
+
+const size_t adc_hw_count = sizeof(adc_hw) / sizeof(adc_hw[0]) - 1;
+
+const AdcHw* find_hw(AdcId id) {
+  for (size_t i = 0; i < adc_hw_count; ++i) {
+    if (adc_hw[i].id == id) {
+      return &adc_hw[i];
+    }
+  }
+  return nullptr;
+}
+
+bool to_res_field(AdcResolution resolution, uint32_t& res) {
+  switch (resolution) {
+    case AdcResolution::bits_12:
+      res = 0;
+      return true;
+    case AdcResolution::bits_10:
+      res = 1;
+      return true;
+    case AdcResolution::bits_8:
+      res = 2;
+      return true;
+    case AdcResolution::bits_6:
+      res = 3;
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool poll_clear(volatile uint32_t& reg, uint32_t mask) {
+  for (uint32_t i = 0; i < adc_poll_limit; ++i) {
+    if (!(reg & mask)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool poll_set(volatile uint32_t& reg, uint32_t mask) {
+  for (uint32_t i = 0; i < adc_poll_limit; ++i) {
+    if (reg & mask) {
+      return true;
+    }
+  }
+  return false;
+}
+} // namespace
+
+// GPDMA linked-list item reloading the block size and the destination address
+// at the end of the buffer: the channel loops on itself
+struct AdcDmaNode {
+  uint32_t cbr1;
+  uint32_t cdar;
+  uint32_t cllr;
+};
+
+class AdcScanInstanceSpecific {
+public:
+  const AdcHw* hw;
+  AdcBlockRing ring;
+  uint16_t* buffer;
+  bool buffer_owned;
+  uint32_t buffer_bytes;
+  uint32_t block_bytes;
+  alignas(4) AdcDmaNode node;
+  bool enabled;
+  volatile uint32_t dma_errors;
+  volatile TaskHandle_t waiter;
+
+  // Trigger latency probe, run from the end of scan interrupt
+  AdcTriggerTimer trigger_timer;
+  volatile uint32_t probe_remaining;
+  volatile uint32_t probe_scans;
+  volatile uint32_t probe_min;
+  volatile uint32_t probe_max;
+};
+
+namespace {
+AdcScanInstanceSpecific* adc_owner[adc_hw_count];
+
+void handle_adc_dma_irq(size_t index) {
+  AdcScanInstanceSpecific* hw = adc_owner[index];
+  DMA_Channel_TypeDef* dma = adc_hw[index].dma;
+  const uint32_t csr = dma->CSR;
+  dma->CFCR = dma_clear_flags;
+  if (!hw) {
+    return;
+  }
+  if (csr & dma_error_flags) {
+    hw->dma_errors = hw->dma_errors + 1;
+  }
+
+  // The half being filled, from the bytes left before the reload: late
+  // interrupts (both flags set) still complete every block in order
+  const uint32_t remaining = dma->CBR1 & DMA_CBR1_BNDT;
+  const uint32_t half = remaining && remaining <= hw->block_bytes ? 1 : 0;
+  if (!hw->ring.advance_to(half)) {
+    return;
+  }
+
+  BaseType_t woken = pdFALSE;
+  TaskHandle_t waiter = hw->waiter;
+  if (waiter) {
+    hw->waiter = nullptr;
+    vTaskNotifyGiveIndexedFromISR(waiter, adc_notify_index, &woken);
+  }
+  portYIELD_FROM_ISR(woken);
+}
+
+// End of scan: how long after the trigger event the sequence completed, from
+// the trigger timer's counter
+void handle_adc_irq(size_t index) {
+  AdcScanInstanceSpecific* hw = adc_owner[index];
+  ADC_TypeDef* adc = adc_hw[index].adc;
+  const uint32_t isr = adc->ISR;
+  adc->ISR = isr & (ADC_ISR_EOS | ADC_ISR_OVR);
+  if (!hw || !(isr & ADC_ISR_EOS) || !hw->probe_remaining) {
+    return;
+  }
+
+  const AdcTriggerTimer& timer = hw->trigger_timer;
+  const uint32_t period = *timer.reload + 1;
+  const uint32_t ticks = (*timer.counter + period - *timer.compare) % period;
+  hw->probe_min = ticks < hw->probe_min ? ticks : hw->probe_min;
+  hw->probe_max = ticks > hw->probe_max ? ticks : hw->probe_max;
+  hw->probe_scans = hw->probe_scans + 1;
+  hw->probe_remaining = hw->probe_remaining - 1;
+  if (!hw->probe_remaining) {
+    adc->IER &= ~ADC_IER_EOSIE;
+  }
+}
+
+void start_dma(AdcScanInstanceSpecific* hw) {
+  DMA_Channel_TypeDef* dma = hw->hw->dma;
+  const uint32_t node = reinterpret_cast<uint32_t>(&hw->node);
+
+  RCC->AHB1ENR |= RCC_AHB1ENR_GPDMA1EN;
+  (void)RCC->AHB1ENR;
+
+  dma->CCR = DMA_CCR_RESET;
+  dma->CFCR = dma_clear_flags;
+
+  hw->node.cbr1 = hw->buffer_bytes;
+  hw->node.cdar = reinterpret_cast<uint32_t>(hw->buffer);
+  hw->node.cllr = DMA_CLLR_UB1 | DMA_CLLR_UDA | DMA_CLLR_ULL | (node & DMA_CLLR_LA);
+
+  // Half-word to half-word, peripheral to incrementing memory
+  dma->CTR1 = DMA_CTR1_SDW_LOG2_0 | DMA_CTR1_DDW_LOG2_0 | DMA_CTR1_DINC;
+  dma->CTR2 = (hw->hw->dma_request << DMA_CTR2_REQSEL_Pos) & DMA_CTR2_REQSEL;
+  dma->CBR1 = hw->buffer_bytes;
+  dma->CSAR = reinterpret_cast<uint32_t>(&hw->hw->adc->DR);
+  dma->CDAR = reinterpret_cast<uint32_t>(hw->buffer);
+  dma->CLBAR = node & DMA_CLBAR_LBA;
+  dma->CLLR = hw->node.cllr;
+
+  dma->CCR = DMA_CCR_TCIE | DMA_CCR_HTIE | DMA_CCR_DTEIE | DMA_CCR_ULEIE | DMA_CCR_USEIE;
+  dma->CCR |= DMA_CCR_EN;
+}
+
+// Stops the conversions, then the DMA. Leaves the ADC enabled.
+void stop_conversions(AdcScanInstanceSpecific* hw) {
+  ADC_TypeDef* adc = hw->hw->adc;
+  if (adc->CR & ADC_CR_ADSTART) {
+    adc->CR |= ADC_CR_ADSTP;
+    (void)poll_clear(adc->CR, ADC_CR_ADSTART);
+  }
+  adc->IER &= ~ADC_IER_EOSIE;
+  hw->probe_remaining = 0;
+  NVIC_DisableIRQ(hw->hw->adc_irq);
+  NVIC_DisableIRQ(hw->hw->dma_irq);
+  hw->hw->dma->CCR = DMA_CCR_RESET;
+  NVIC_ClearPendingIRQ(hw->hw->adc_irq);
+  NVIC_ClearPendingIRQ(hw->hw->dma_irq);
+  hw->enabled = false;
+}
+
+// Regulator start-up, single-ended calibration and enable, from deep power down
+bool power_up(ADC_TypeDef* adc) {
+  RCC->AHB2ENR |= RCC_AHB2ENR_ADCEN;
+  (void)RCC->AHB2ENR;
+  // Synchronous clock HCLK / 4: no kernel clock to set up, below the 75 MHz
+  // limit, and a fixed delay from a timer trigger to the sampling (no clock
+  // domain crossing). Shared by ADC1 and ADC2, only writable with both disabled.
+  if (!(ADC12_COMMON->CCR & ADC_CCR_CKMODE)) {
+    ADC12_COMMON->CCR |= 3u << ADC_CCR_CKMODE_Pos;
+  }
+
+  adc->CR &= ~ADC_CR_DEEPPWD;
+  adc->CR |= ADC_CR_ADVREGEN;
+  for (volatile uint32_t i = SystemCoreClock / 1000000 * adc_regulator_startup_us; i; --i) {}
+
+  adc->CR &= ~ADC_CR_ADCALDIF;
+  adc->CR |= ADC_CR_ADCAL;
+  if (!poll_clear(adc->CR, ADC_CR_ADCAL)) {
+    return false;
+  }
+
+  adc->ISR = ADC_ISR_ADRDY;
+  adc->CR |= ADC_CR_ADEN;
+  return poll_set(adc->ISR, ADC_ISR_ADRDY);
+}
+
+void power_down(ADC_TypeDef* adc) {
+  if (adc->CR & ADC_CR_ADEN) {
+    adc->CR |= ADC_CR_ADDIS;
+    (void)poll_clear(adc->CR, ADC_CR_ADEN);
+  }
+  adc->CR &= ~ADC_CR_ADVREGEN;
+  adc->CR |= ADC_CR_DEEPPWD;
+}
+
+// Sequence and sampling times of the channel list
+void write_sequence(ADC_TypeDef* adc, std::span<const AdcScanChannel> channels) {
+  volatile uint32_t* const sqr[] = {&adc->SQR1, &adc->SQR2, &adc->SQR3, &adc->SQR4};
+  uint32_t sq[4] = {static_cast<uint32_t>(channels.size() - 1) << ADC_SQR1_L_Pos, 0, 0, 0};
+  uint32_t smpr[2] = {adc->SMPR1, adc->SMPR2};
+
+  for (size_t rank = 1; rank <= channels.size(); ++rank) {
+    const AdcScanChannel& ch = channels[rank - 1];
+    // SQR1 holds L then ranks 1 to 4, the others 5 ranks each
+    const size_t reg = rank / 5;
+    const size_t slot = reg ? rank - 5 * reg : rank;
+    sq[reg] |= static_cast<uint32_t>(ch.channel) << (6 * slot);
+
+    const uint32_t shift = 3 * (ch.channel % 10);
+    smpr[ch.channel / 10] = (smpr[ch.channel / 10] & ~(0x7u << shift)) |
+                            (static_cast<uint32_t>(ch.sample_time) << shift);
+  }
+
+  for (size_t i = 0; i < 4; ++i) {
+    *sqr[i] = sq[i];
+  }
+  adc->SMPR1 = smpr[0];
+  adc->SMPR2 = smpr[1];
+}
+} // namespace
+
 AdcConfig::AdcConfig(AdcId id, uint8_t channel, AdcResolution resolution,
                      AdcAlignment alignment, bool continuous)
     : m_id(id),
@@ -34,4 +309,265 @@ expected::expected<std::optional<uint16_t>, Error> Adc::try_read() {
   return std::optional<uint16_t>{};
 }
 
+AdcScanConfig::AdcScanConfig(AdcId id, std::span<const AdcScanChannel> channels,
+                             size_t scans_per_block, AdcTrigger trigger, uint8_t trigger_source,
+                             AdcResolution resolution, uint16_t* buffer,
+                             AdcBlockCallback callback, void* ctx)
+    : m_id(id),
+      m_channels(channels),
+      m_scans_per_block(scans_per_block),
+      m_trigger(trigger),
+      m_trigger_source(trigger_source),
+      m_resolution(resolution),
+      m_buffer(buffer),
+      m_callback(callback),
+      m_ctx(ctx),
+      m_trigger_timer{} {}
+
+AdcScanConfig::AdcScanConfig(AdcId id, std::span<const AdcScanChannel> channels,
+                             size_t scans_per_block, const AdcHardwareTrigger& trigger,
+                             AdcResolution resolution, uint16_t* buffer,
+                             AdcBlockCallback callback, void* ctx)
+    : AdcScanConfig(id, channels, scans_per_block, trigger.edge, trigger.source, resolution,
+                    buffer, callback, ctx) {
+  m_trigger_timer = trigger.timer;
+}
+
+AdcScan::AdcScan() : p_instance_specific(nullptr) {}
+
+expected::expected<void, Error> AdcScan::start() {
+  return {};
+}
+
+expected::expected<void, Error> AdcScan::init(const Config& config) {
+  const auto* cfg = dynamic_cast<const AdcScanConfig*>(&config);
+  if (!cfg) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid adc scan config"));
+  }
+
+  const AdcHw* adc_entry = find_hw(cfg->m_id);
+  if (!adc_entry) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "unsupported adc id"));
+  }
+
+  const size_t channel_count = cfg->m_channels.size();
+  if (!channel_count || channel_count > AdcScanConfig::max_channels) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid adc channel count"));
+  }
+  for (const auto& ch : cfg->m_channels) {
+    if (ch.channel > max_adc_channel) {
+      return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid adc channel"));
+    }
+  }
+
+  uint32_t res = 0;
+  if (!to_res_field(cfg->m_resolution, res)) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "unsupported adc resolution"));
+  }
+
+  // Two blocks of half-words, counted in bytes by the DMA
+  const size_t block_size = channel_count * cfg->m_scans_per_block;
+  if (!cfg->m_scans_per_block || 4 * block_size > DMA_CBR1_BNDT) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid adc block size"));
+  }
+
+  const size_t index = static_cast<size_t>(adc_entry - adc_hw);
+  if (adc_owner[index] && adc_owner[index] != p_instance_specific) {
+    return expected::unexpected(RU_ERROR(CommonError::busy, "adc already in use"));
+  }
+
+  if (p_instance_specific) {
+    (void)stop();
+  }
+  p_instance_specific = new AdcScanInstanceSpecific();
+
+  auto* hw = p_instance_specific;
+  hw->hw = adc_entry;
+  hw->buffer_owned = !cfg->m_buffer;
+  hw->buffer = hw->buffer_owned ? new uint16_t[2 * block_size] : cfg->m_buffer;
+  hw->buffer_bytes = static_cast<uint32_t>(4 * block_size);
+  hw->block_bytes = static_cast<uint32_t>(2 * block_size);
+  hw->ring.reset(hw->buffer, channel_count, cfg->m_scans_per_block, cfg->m_callback, cfg->m_ctx);
+  hw->enabled = false;
+  hw->dma_errors = 0;
+  hw->waiter = nullptr;
+  hw->trigger_timer = cfg->m_trigger != AdcTrigger::continuous ? cfg->m_trigger_timer
+                                                                 : AdcTriggerTimer{};
+  hw->probe_remaining = 0;
+
+  ADC_TypeDef* adc = adc_entry->adc;
+  if (!power_up(adc)) {
+    power_down(adc);
+    if (hw->buffer_owned) {
+      delete[] hw->buffer;
+    }
+    delete hw;
+    p_instance_specific = nullptr;
+    return expected::unexpected(RU_ERROR(CommonError::general_error, "adc calibration failed"));
+  }
+
+  // Circular DMA requests, right aligned, the DMA always reads the newest
+  // result (an overrun only loses samples, it never stops the scan)
+  uint32_t cfgr = ADC_CFGR_DMAEN | ADC_CFGR_DMACFG | ADC_CFGR_OVRMOD | (res << ADC_CFGR_RES_Pos);
+  switch (cfg->m_trigger) {
+    case AdcTrigger::continuous:
+      cfgr |= ADC_CFGR_CONT;
+      break;
+    case AdcTrigger::external_rising:
+    case AdcTrigger::external_falling:
+    case AdcTrigger::external_both:
+      cfgr |= (static_cast<uint32_t>(cfg->m_trigger) << ADC_CFGR_EXTEN_Pos) |
+              ((static_cast<uint32_t>(cfg->m_trigger_source) << ADC_CFGR_EXTSEL_Pos) &
+               ADC_CFGR_EXTSEL);
+      break;
+  }
+  adc->CFGR = cfgr;
+  write_sequence(adc, cfg->m_channels);
+
+  adc_owner[index] = hw;
+  NVIC_SetPriority(adc_entry->adc_irq, adc_entry->irq_priority);
+  NVIC_SetPriority(adc_entry->dma_irq, adc_entry->irq_priority);
+  return {};
+}
+
+expected::expected<void, Error> AdcScan::stop() {
+  auto* hw = p_instance_specific;
+  if (hw) {
+    stop_conversions(hw);
+    power_down(hw->hw->adc);
+    adc_owner[hw->hw - adc_hw] = nullptr;
+    if (hw->buffer_owned) {
+      delete[] hw->buffer;
+    }
+  }
+  delete hw;
+  p_instance_specific = nullptr;
+  return {};
+}
+
+expected::expected<void, Error> AdcScan::enable() {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "adc scan not initialized"));
+  }
+  if (hw->enabled) {
+    return {};
+  }
+
+  ADC_TypeDef* adc = hw->hw->adc;
+  hw->ring.restart();
+  hw->dma_errors = 0;
+  start_dma(hw);
+  NVIC_ClearPendingIRQ(hw->hw->adc_irq);
+  NVIC_ClearPendingIRQ(hw->hw->dma_irq);
+  NVIC_EnableIRQ(hw->hw->adc_irq);
+  NVIC_EnableIRQ(hw->hw->dma_irq);
+
+  adc->ISR = ADC_ISR_OVR | ADC_ISR_EOC | ADC_ISR_EOS;
+  hw->enabled = true;
+  adc->CR |= ADC_CR_ADSTART;
+  return {};
+}
+
+expected::expected<void, Error> AdcScan::disable() {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "adc scan not initialized"));
+  }
+  stop_conversions(hw);
+  return {};
+}
+
+expected::expected<AdcBlock, Error> AdcScan::wait_block(uint32_t timeout_ms) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "adc scan not initialized"));
+  }
+  if (!hw->enabled) {
+    return expected::unexpected(RU_ERROR(CommonError::not_started, "adc scan not enabled"));
+  }
+
+  const TickType_t start = xTaskGetTickCount();
+  const TickType_t timeout = to_ticks(timeout_ms);
+  for (;;) {
+    AdcBlock block{};
+    taskENTER_CRITICAL();
+    const bool taken = hw->ring.take(block);
+    // Register before waiting, so a block landing meanwhile still wakes us
+    hw->waiter = taken ? nullptr : xTaskGetCurrentTaskHandle();
+    taskEXIT_CRITICAL();
+    if (taken) {
+      return block;
+    }
+
+    const TickType_t elapsed = xTaskGetTickCount() - start;
+    if (timeout != portMAX_DELAY && elapsed >= timeout) {
+      hw->waiter = nullptr;
+      return expected::unexpected(RU_ERROR(AdcError::timeout, "adc block timeout"));
+    }
+    ulTaskNotifyTakeIndexed(adc_notify_index, pdTRUE,
+                            timeout == portMAX_DELAY ? portMAX_DELAY : timeout - elapsed);
+  }
+}
+
+bool AdcScan::is_intact(const AdcBlock& block) const {
+  const auto* hw = p_instance_specific;
+  return hw && hw->enabled && hw->ring.is_intact(block);
+}
+
+expected::expected<AdcScanStats, Error> AdcScan::stats() const {
+  const auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "adc scan not initialized"));
+  }
+  return AdcScanStats{hw->ring.completed(), hw->ring.missed(), hw->dma_errors};
+}
+
+expected::expected<void, Error> AdcScan::probe_trigger_latency(uint32_t scans) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "adc scan not initialized"));
+  }
+  if (!hw->trigger_timer.counter) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "no adc trigger timer"));
+  }
+
+  ADC_TypeDef* adc = hw->hw->adc;
+  taskENTER_CRITICAL();
+  adc->IER &= ~ADC_IER_EOSIE;
+  hw->probe_scans = 0;
+  hw->probe_min = UINT32_MAX;
+  hw->probe_max = 0;
+  hw->probe_remaining = scans;
+  adc->ISR = ADC_ISR_EOS;
+  if (scans) {
+    adc->IER |= ADC_IER_EOSIE;
+  }
+  taskEXIT_CRITICAL();
+  return {};
+}
+
+expected::expected<AdcLatencyStats, Error> AdcScan::trigger_latency() const {
+  const auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "adc scan not initialized"));
+  }
+  taskENTER_CRITICAL();
+  const uint32_t scans = hw->probe_scans;
+  AdcLatencyStats latency{scans, scans ? hw->probe_min : 0, hw->probe_max,
+                          hw->trigger_timer.tick_hz};
+  taskEXIT_CRITICAL();
+  return latency;
+}
+
 } // namespace ru::driver
+
+#define X_adc_instance(index, id, periph, dma_channel, irq_priority) \
+  extern "C" void periph##_IRQHandler(void) {                        \
+    ru::driver::handle_adc_irq(index);                                \
+  }                                                                   \
+  extern "C" void GPDMA1_Channel##dma_channel##_IRQHandler(void) {   \
+    ru::driver::handle_adc_dma_irq(index);                            \
+  }
+#include "adc_instances.hpp"
+#undef X_adc_instance
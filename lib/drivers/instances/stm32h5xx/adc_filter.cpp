@@ -0,0 +1,345 @@
+#include <cmath>
+#include <cstring>
+
+#include "adc_filter.hpp"
+
+#if defined(__ARM_FEATURE_SIMD32)
+#include <arm_acle.h>
+#endif
+
+namespace ru::driver::dsp {
+
+namespace {
+// Two 16-bit samples in one word, the first one in the low half (the order
+// of a little endian load)
+using Pair = int32_t;
+
+const Pair pair_ones = 0x00010001;
+
+Pair load_pair(const int16_t* p) {
+  Pair word;
+  std::memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+void store_pair(int16_t* p, Pair word) {
+  std::memcpy(p, &word, sizeof(word));
+}
+
+int16_t low(Pair word) {
+  return static_cast<int16_t>(word);
+}
+
+int16_t high(Pair word) {
+  return static_cast<int16_t>(static_cast<uint32_t>(word) >> 16);
+}
+
+// PKHBT
+Pair pack(int16_t lo, int16_t hi) {
+  return static_cast<Pair>((static_cast<uint32_t>(static_cast<uint16_t>(hi)) << 16) |
+                           static_cast<uint16_t>(lo));
+}
+
+int16_t saturate16(int32_t value) {
+  return static_cast<int16_t>(value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : value);
+}
+
+#if defined(__ARM_FEATURE_SIMD32)
+int32_t smlad(Pair x, Pair y, int32_t acc) {
+  return __smlad(x, y, acc);
+}
+
+int64_t smlald(Pair x, Pair y, int64_t acc) {
+  return __smlald(x, y, acc);
+}
+
+Pair ssub16(Pair x, Pair y) {
+  return __ssub16(x, y);
+}
+
+// SSUB16 sets the GE flags of the lanes where a >= b, SEL picks from its
+// first operand in those lanes
+Pair min16x2(Pair a, Pair b) {
+  (void)__ssub16(a, b);
+  return static_cast<Pair>(__sel(static_cast<uint8x4_t>(b), static_cast<uint8x4_t>(a)));
+}
+
+Pair max16x2(Pair a, Pair b) {
+  (void)__ssub16(a, b);
+  return static_cast<Pair>(__sel(static_cast<uint8x4_t>(a), static_cast<uint8x4_t>(b)));
+}
+
+int16_t ssat16(int32_t value) {
+  return static_cast<int16_t>(__ssat(value, 16));
+}
+#else
+// Bit-exact emulation of the DSP instructions, so the packed kernels also run
+// (and are cross-checked) where the extension is missing
+int32_t smlad(Pair x, Pair y, int32_t acc) {
+  const int32_t lo = int32_t{low(x)} * low(y);
+  const int32_t hi = int32_t{high(x)} * high(y);
+  return static_cast<int32_t>(static_cast<uint32_t>(acc) + static_cast<uint32_t>(lo) +
+                              static_cast<uint32_t>(hi));
+}
+
+int64_t smlald(Pair x, Pair y, int64_t acc) {
+  return acc + int64_t{low(x)} * low(y) + int64_t{high(x)} * high(y);
+}
+
+Pair ssub16(Pair x, Pair y) {
+  return pack(static_cast<int16_t>(low(x) - low(y)), static_cast<int16_t>(high(x) - high(y)));
+}
+
+Pair min16x2(Pair a, Pair b) {
+  return pack(low(a) < low(b) ? low(a) : low(b), high(a) < high(b) ? high(a) : high(b));
+}
+
+Pair max16x2(Pair a, Pair b) {
+  return pack(low(a) > low(b) ? low(a) : low(b), high(a) > high(b) ? high(a) : high(b));
+}
+
+int16_t ssat16(int32_t value) {
+  return saturate16(value);
+}
+#endif
+
+int16_t q14(float value) {
+  return saturate16(static_cast<int32_t>(std::lround(value * 16384.0f)));
+}
+
+uint16_t isqrt(uint32_t value) {
+  uint32_t root = 0;
+  for (uint32_t bit = 1u << 30; bit; bit >>= 2) {
+    if (value >= root + bit) {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+  }
+  return static_cast<uint16_t>(root);
+}
+
+SampleStats finish_stats(int16_t min, int16_t max, int32_t sum, int64_t squares, size_t count) {
+  const auto n = static_cast<int32_t>(count);
+  return {min, max, static_cast<int16_t>(sum / n),
+          isqrt(static_cast<uint32_t>(static_cast<uint64_t>(squares) / count))};
+}
+} // namespace
+
+void deinterleave(const AdcBlock& block, size_t channel, int16_t* out) {
+  const uint16_t* in = block.samples + channel;
+  for (size_t scan = 0; scan < block.scans; ++scan) {
+    out[scan] = static_cast<int16_t>(in[scan * block.channels]);
+  }
+}
+
+MovingAverage::MovingAverage(uint8_t log2_window)
+    : m_log2_window(log2_window < 1                 ? 1
+                    : log2_window > max_log2_window ? max_log2_window
+                                                    : log2_window) {
+  reset();
+}
+
+void MovingAverage::reset() {
+  std::memset(m_history, 0, sizeof(m_history));
+  m_pos = 0;
+  m_sum = 0;
+}
+
+void MovingAverage::process_reference(const int16_t* in, int16_t* out, size_t count) {
+  const uint32_t mask = (1u << m_log2_window) - 1;
+  for (size_t i = 0; i < count; ++i) {
+    m_sum += in[i] - m_history[m_pos];
+    m_history[m_pos] = in[i];
+    m_pos = (m_pos + 1) & mask;
+    out[i] = static_cast<int16_t>(m_sum >> m_log2_window);
+  }
+}
+
+// Two samples per iteration: one SSUB16 gives both differences with the
+// samples leaving the window, which sit side by side in the history (the
+// window is even and the position kept even)
+void MovingAverage::process(const int16_t* in, int16_t* out, size_t count) {
+  const uint32_t mask = (1u << m_log2_window) - 1;
+  size_t i = 0;
+  if (m_pos & 1 && count) {
+    process_reference(in, out, 1);
+    i = 1;
+  }
+
+  int32_t sum = m_sum;
+  uint32_t pos = m_pos;
+  for (; i + 2 <= count; i += 2) {
+    const Pair x = load_pair(in + i);
+    const Pair diff = ssub16(x, load_pair(m_history + pos));
+    store_pair(m_history + pos, x);
+    pos = (pos + 2) & mask;
+    sum += low(diff);
+    const int16_t y0 = static_cast<int16_t>(sum >> m_log2_window);
+    sum += high(diff);
+    store_pair(out + i, pack(y0, static_cast<int16_t>(sum >> m_log2_window)));
+  }
+  m_sum = sum;
+  m_pos = pos;
+
+  process_reference(in + i, out + i, count - i);
+}
+
+Biquad::Biquad(int16_t b0, int16_t b1, int16_t b2, int16_t a1, int16_t a2)
+    : m_b{b0, b1, b2},
+      m_a{saturate16(-int32_t{a1}), saturate16(-int32_t{a2})} {
+  reset();
+}
+
+Biquad Biquad::lowpass(float cutoff_hz, float sample_rate_hz) {
+  const float w0 = 2.0f * 3.14159265f * cutoff_hz / sample_rate_hz;
+  const float alpha = std::sin(w0) / (2.0f * 0.70710678f);
+  const float cos_w0 = std::cos(w0);
+  const float a0 = 1.0f + alpha;
+  const float b1 = (1.0f - cos_w0) / a0;
+  return Biquad(q14(b1 / 2), q14(b1), q14(b1 / 2), q14(-2.0f * cos_w0 / a0),
+                q14((1.0f - alpha) / a0));
+}
+
+void Biquad::reset() {
+  m_x[0] = m_x[1] = 0;
+  m_y[0] = m_y[1] = 0;
+}
+
+void Biquad::process_reference(const int16_t* in, int16_t* out, size_t count) {
+  int16_t x1 = m_x[0], x2 = m_x[1], y1 = m_y[0], y2 = m_y[1];
+  for (size_t i = 0; i < count; ++i) {
+    const int32_t acc = (1 << 13) + m_b[0] * in[i] + m_b[1] * x1 + m_b[2] * x2 + m_a[0] * y1 +
+                        m_a[1] * y2;
+    x2 = x1;
+    x1 = in[i];
+    y2 = y1;
+    y1 = saturate16(acc >> 14);
+    out[i] = y1;
+  }
+  m_x[0] = x1;
+  m_x[1] = x2;
+  m_y[0] = y1;
+  m_y[1] = y2;
+}
+
+// The five products in two SMLADs and one multiply, on the state kept packed
+// as (x[n], x[n-1]) and (x[n-2], y[n-1])
+void Biquad::process(const int16_t* in, int16_t* out, size_t count) {
+  const Pair b01 = pack(m_b[0], m_b[1]);
+  const Pair b2a1 = pack(m_b[2], m_a[0]);
+  const int32_t a2 = m_a[1];
+  int16_t x1 = m_x[0], x2 = m_x[1], y1 = m_y[0], y2 = m_y[1];
+  for (size_t i = 0; i < count; ++i) {
+    const int32_t acc = smlad(pack(in[i], x1), b01,
+                              smlad(pack(x2, y1), b2a1, (1 << 13) + a2 * y2));
+    x2 = x1;
+    x1 = in[i];
+    y2 = y1;
+    y1 = ssat16(acc >> 14);
+    out[i] = y1;
+  }
+  m_x[0] = x1;
+  m_x[1] = x2;
+  m_y[0] = y1;
+  m_y[1] = y2;
+}
+
+Decimator::Decimator(uint8_t log2_factor)
+    : m_log2_factor(log2_factor < 1                 ? 1
+                    : log2_factor > max_log2_factor ? max_log2_factor
+                                                    : log2_factor) {
+  reset();
+}
+
+void Decimator::reset() {
+  m_sum = 0;
+  m_phase = 0;
+}
+
+size_t Decimator::process_reference(const int16_t* in, int16_t* out, size_t count) {
+  const uint32_t factor = 1u << m_log2_factor;
+  size_t produced = 0;
+  for (size_t i = 0; i < count; ++i) {
+    m_sum += in[i];
+    if (++m_phase == factor) {
+      out[produced++] = static_cast<int16_t>(m_sum >> m_log2_factor);
+      m_sum = 0;
+      m_phase = 0;
+    }
+  }
+  return produced;
+}
+
+// SMLAD against (1, 1) adds two samples per instruction; the factor is even,
+// so a pair never straddles two output samples once the phase is even
+size_t Decimator::process(const int16_t* in, int16_t* out, size_t count) {
+  const uint32_t factor = 1u << m_log2_factor;
+  size_t i = 0;
+  size_t produced = 0;
+  if (m_phase & 1 && count) {
+    produced = process_reference(in, out, 1);
+    i = 1;
+  }
+
+  int32_t sum = m_sum;
+  uint32_t phase = m_phase;
+  for (; i + 2 <= count; i += 2) {
+    sum = smlad(load_pair(in + i), pair_ones, sum);
+    phase += 2;
+    if (phase == factor) {
+      out[produced++] = static_cast<int16_t>(sum >> m_log2_factor);
+      sum = 0;
+      phase = 0;
+    }
+  }
+  m_sum = sum;
+  m_phase = phase;
+
+  return produced + process_reference(in + i, out + produced, count - i);
+}
+
+SampleStats stats_reference(const int16_t* in, size_t count) {
+  int16_t min = INT16_MAX;
+  int16_t max = INT16_MIN;
+  int32_t sum = 0;
+  int64_t squares = 0;
+  for (size_t i = 0; i < count; ++i) {
+    min = in[i] < min ? in[i] : min;
+    max = in[i] > max ? in[i] : max;
+    sum += in[i];
+    squares += int32_t{in[i]} * in[i];
+  }
+  return finish_stats(min, max, sum, squares, count);
+}
+
+// Per lane minimum and maximum (SSUB16 + SEL), sum (SMLAD against (1, 1)) and
+// 64-bit sum of squares (SMLALD), folded at the end
+SampleStats stats(const int16_t* in, size_t count) {
+  Pair mins = pack(INT16_MAX, INT16_MAX);
+  Pair maxs = pack(INT16_MIN, INT16_MIN);
+  int32_t sum = 0;
+  int64_t squares = 0;
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    const Pair x = load_pair(in + i);
+    mins = min16x2(mins, x);
+    maxs = max16x2(maxs, x);
+    sum = smlad(x, pair_ones, sum);
+    squares = smlald(x, x, squares);
+  }
+  if (i < count) {
+    const Pair x = pack(in[i], in[i]);
+    mins = min16x2(mins, x);
+    maxs = max16x2(maxs, x);
+    sum += in[i];
+    squares += int32_t{in[i]} * in[i];
+  }
+
+  const int16_t min = low(mins) < high(mins) ? low(mins) : high(mins);
+  const int16_t max = low(maxs) > high(maxs) ? low(maxs) : high(maxs);
+  return finish_stats(min, max, sum, squares, count);
+}
+
+} // namespace ru::driver::dsp
@@ -0,0 +1,74 @@
+#include "FreeRTOS.h"
+#include "stm32h5xx_hal.h"
+#include "task.h"
+
+#include "adc_filter.hpp"
+#include "debug_log.hpp"
+#include "timer.hpp"
+
+namespace ru::driver::dsp {
+
+namespace {
+// Cycles of one run, without preemption by the tasks and the FreeRTOS-aware
+// interrupts
+template <typename Kernel>
+uint32_t measure(Kernel&& kernel) {
+  taskENTER_CRITICAL();
+  const uint32_t start = DWT->CYCCNT;
+  kernel();
+  const uint32_t cycles = DWT->CYCCNT - start;
+  taskEXIT_CRITICAL();
+  return cycles;
+}
+
+// kernel must be a string literal
+void log_cycles([[maybe_unused]] const char* kernel, uint32_t cycles, uint32_t reference_cycles,
+                size_t samples) {
+  [[maybe_unused]] const uint32_t hundredths = cycles * 100 / samples;
+  [[maybe_unused]] const uint32_t reference_hundredths = reference_cycles * 100 / samples;
+  RU_LOG_INFO("%s: %u.%02u cycles/sample, reference %u.%02u", kernel, hundredths / 100,
+              hundredths % 100, reference_hundredths / 100, reference_hundredths % 100);
+}
+} // namespace
+
+void report_filter_cycles(size_t samples) {
+  if (!samples) {
+    return;
+  }
+  (void)Timer::start();
+
+  // Triangle wave with pseudo-random noise, in the 12-bit range
+  auto* in = new int16_t[samples];
+  auto* out = new int16_t[samples];
+  uint32_t noise = 1;
+  for (size_t i = 0; i < samples; ++i) {
+    noise = noise * 1664525u + 1013904223u;
+    const auto ramp = static_cast<int32_t>(i % 512);
+    in[i] = static_cast<int16_t>((ramp < 256 ? ramp : 511 - ramp) * 16 + (noise >> 26));
+  }
+
+  MovingAverage average(4);
+  MovingAverage average_reference(4);
+  log_cycles("moving_average/16", measure([&] { average.process(in, out, samples); }),
+             measure([&] { average_reference.process_reference(in, out, samples); }), samples);
+
+  Biquad lowpass = Biquad::lowpass(100.0f, 10000.0f);
+  Biquad lowpass_reference = lowpass;
+  log_cycles("biquad_lowpass", measure([&] { lowpass.process(in, out, samples); }),
+             measure([&] { lowpass_reference.process_reference(in, out, samples); }), samples);
+
+  Decimator decimator(3);
+  Decimator decimator_reference(3);
+  log_cycles("decimate/8", measure([&] { (void)decimator.process(in, out, samples); }),
+             measure([&] { (void)decimator_reference.process_reference(in, out, samples); }),
+             samples);
+
+  SampleStats result{};
+  log_cycles("stats", measure([&] { result = stats(in, samples); }),
+             measure([&] { result = stats_reference(in, samples); }), samples);
+
+  delete[] in;
+  delete[] out;
+}
+
+} // namespace ru::driver::dsp
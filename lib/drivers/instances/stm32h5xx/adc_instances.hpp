@@ -0,0 +1,14 @@
+// ADCs of the board, generated by generate.py from the 'adc' module of
+// config.yaml. Do not edit, regenerate instead.
+//
+// X_adc_instance(index, id, periph, dma_channel, irq_priority)
+// - id:           AdcId bound to the ADC
+// - periph:       ADC instance
+// - dma_channel:  GPDMA1 channel filling the sample buffer
+// - irq_priority: NVIC priority of the DMA handler
+
+#ifndef X_adc_instance
+#define X_adc_instance(index, id, periph, dma_channel, irq_priority)
+#endif
+
+X_adc_instance(0, analog_sensors, ADC1, 2, 6)
\ No newline at end of file
@@ -0,0 +1,366 @@
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#if defined(__arm__)
+#include "stm32h5xx_hal.h"
+#endif
+
+#include "cordic.hpp"
+
+namespace ru::driver::math {
+
+namespace {
+const float pi = 3.14159265358979f;
+const float q31_scale = 1.0f / 2147483648.0f;
+const int32_t q31_one = INT32_MAX;
+// Below it (2^-90), square roots scale the input by 2^64 first
+const float min_normalized = 8.0779e-28f;
+
+// Table points: 256 segments plus a copy of the last point, so an index of
+// 256 with a zero fraction still has a right neighbour
+constexpr size_t table_segments = 256;
+constexpr size_t table_size = table_segments + 2;
+
+// The tables are computed at compile time, without libm
+
+constexpr double const_pi = 3.14159265358979323846;
+
+constexpr double const_sqrt(double x) {
+  double r = x > 1 ? x : 1;
+  for (int i = 0; i < 64; ++i) {
+    r = 0.5 * (r + x / r);
+  }
+  return r;
+}
+
+// Taylor series, x in [0, pi/2]
+constexpr double const_sin(double x) {
+  double term = x;
+  double sum = x;
+  for (int n = 1; n < 20; ++n) {
+    term *= -x * x / ((2 * n) * (2 * n + 1));
+    sum += term;
+  }
+  return sum;
+}
+
+// Two argument halvings bring x in [0, 1] below 0.2, then the series
+constexpr double const_atan(double x) {
+  for (int i = 0; i < 2; ++i) {
+    x = x / (1 + const_sqrt(1 + x * x));
+  }
+  double term = x;
+  double sum = x;
+  for (int n = 1; n < 40; ++n) {
+    term *= -x * x;
+    sum += term / (2 * n + 1);
+  }
+  return 4 * sum;
+}
+
+template <typename T, typename F>
+constexpr std::array<T, table_size> make_table(F f, double scale) {
+  std::array<T, table_size> table{};
+  for (size_t k = 0; k <= table_segments; ++k) {
+    const double value = f(static_cast<double>(k) / table_segments) * scale + 0.5;
+    const double max = static_cast<double>(static_cast<T>(~T{0}) > 0 ? ~T{0} : INT32_MAX);
+    table[k] = static_cast<T>(value > max ? max : value);
+  }
+  table[table_segments + 1] = table[table_segments];
+  return table;
+}
+
+// sin over a quarter turn, Q1.31
+constexpr auto sin_points = make_table<int32_t>(
+    [](double t) { return const_sin(t * const_pi / 2); }, 2147483648.0);
+// atan(t) for t in [0, 1], in Q1.31 half turns (pi = 2^31)
+constexpr auto atan_points = make_table<int32_t>(
+    [](double t) { return const_atan(t) / const_pi; }, 2147483648.0);
+// sqrt(1 + t) and sqrt(2 + 2t), Q2.30
+constexpr auto sqrt_points = make_table<uint32_t>(
+    [](double t) { return const_sqrt(1 + t); }, 1073741824.0);
+constexpr auto sqrt2_points = make_table<uint32_t>(
+    [](double t) { return const_sqrt(2 + 2 * t); }, 1073741824.0);
+
+// Linear interpolation at index + frac / 2^16
+template <typename T>
+int64_t lerp(const std::array<T, table_size>& table, uint32_t index, uint32_t frac) {
+  const int64_t a = table[index];
+  const int64_t b = table[index + 1];
+  return a + (((b - a) * frac) >> 16);
+}
+
+uint32_t float_bits(float x) {
+  uint32_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  return bits;
+}
+
+// 2^e, e in [-126, 127]
+float power_of_two(int e) {
+  const uint32_t bits = static_cast<uint32_t>(e + 127) << 23;
+  float x;
+  std::memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+// Angle in radians as Q1.31 of angle / pi, wrapped to [-pi, pi). As an
+// unsigned number it is the fraction of a turn.
+int32_t angle_q31(float angle) {
+  float t = angle * (1.0f / pi);
+  t -= 2.0f * std::floor(t * 0.5f + 0.5f);
+  return t >= 1.0f ? q31_one : static_cast<int32_t>(t * 2147483648.0f);
+}
+
+float angle_float(int32_t angle) {
+  return static_cast<float>(angle) * (pi * q31_scale);
+}
+
+// Exponent e with max(|x|, |y|) / 2^e in [0.25, 0.5), clamped where the
+// scale factors 2^-e, 2^(31 - e) and 2^(e - 31) stay normal floats
+int vector_exponent(float x, float y) {
+  const float m = std::fabs(x) > std::fabs(y) ? std::fabs(x) : std::fabs(y);
+  const int e = static_cast<int>((float_bits(m) >> 23) & 0xFF) - 125;
+  return e < -95 ? -95 : e > 126 ? 126 : e;
+}
+
+int32_t sin_q31(uint32_t turn) {
+  const uint32_t quadrant = turn >> 30;
+  uint32_t x = turn & 0x3FFFFFFF;
+  if (quadrant & 1) {
+    x = 0x40000000 - x;
+  }
+  const auto value = static_cast<int32_t>(lerp(sin_points, x >> 22, (x >> 6) & 0xFFFF));
+  return quadrant & 2 ? -value : value;
+}
+
+int32_t atan2_q31(float y, float x) {
+  const float ax = std::fabs(x);
+  const float ay = std::fabs(y);
+  if (ax == 0.0f && ay == 0.0f) {
+    return 0;
+  }
+  const bool steep = ay > ax;
+  const float ratio = steep ? ax / ay : ay / ax;
+  const auto pos = static_cast<uint32_t>(ratio * 16777216.0f);
+  auto angle = static_cast<uint32_t>(lerp(atan_points, pos >> 16, pos & 0xFFFF));
+  if (steep) {
+    angle = 0x40000000 - angle;
+  }
+  if (x < 0.0f) {
+    angle = 0x80000000 - angle;
+  }
+  return static_cast<int32_t>(y < 0.0f ? 0u - angle : angle);
+}
+
+float sqrt_one_table(float x) {
+  if (!(x > 0.0f) || std::isinf(x)) {
+    return x == 0.0f || x > 0.0f ? x : NAN;
+  }
+  int adjust = 0;
+  if (x < min_normalized) {
+    x *= 18446744073709551616.0f;  // 2^64: subnormals become normal
+    adjust = -32;
+  }
+  const uint32_t bits = float_bits(x);
+  const int e = static_cast<int>(bits >> 23) - 127;
+  const uint32_t f = bits & 0x7FFFFF;
+  const auto& table = e & 1 ? sqrt2_points : sqrt_points;
+  const auto root = static_cast<float>(lerp(table, f >> 15, (f << 1) & 0xFFFF));
+  return root * power_of_two(((e - (e & 1)) >> 1) + adjust - 30);
+}
+} // namespace
+
+void sincos_table(const float* angles, float* sin, float* cos, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    const auto turn = static_cast<uint32_t>(angle_q31(angles[i]));
+    if (sin) {
+      sin[i] = static_cast<float>(sin_q31(turn)) * q31_scale;
+    }
+    if (cos) {
+      cos[i] = static_cast<float>(sin_q31(turn + 0x40000000)) * q31_scale;
+    }
+  }
+}
+
+void atan2_table(const float* y, const float* x, float* angles, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    angles[i] = angle_float(atan2_q31(y[i], x[i]));
+  }
+}
+
+void polar_table(const float* x, const float* y, float* magnitude, float* angle, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    const float xi = x[i];
+    const float yi = y[i];
+    if (angle) {
+      angle[i] = angle_float(atan2_q31(yi, xi));
+    }
+    if (magnitude) {
+      // Scaled so the squares neither overflow nor underflow
+      const int e = vector_exponent(xi, yi);
+      const float down = power_of_two(-e);
+      const float sx = xi * down;
+      const float sy = yi * down;
+      magnitude[i] = sqrt_one_table(sx * sx + sy * sy) * power_of_two(e);
+    }
+  }
+}
+
+void sqrt_table(const float* in, float* out, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = sqrt_one_table(in[i]);
+  }
+}
+
+#if defined(CORDIC)
+namespace {
+// CORDIC_CSR.FUNC
+const uint32_t cordic_sine = 1;
+const uint32_t cordic_phase = 2;
+const uint32_t cordic_sqrt = 9;
+// 6 x 4 iterations: the Q1.31 results converge to about 2^-20
+const uint32_t cordic_precision = 6;
+
+std::atomic_flag cordic_busy = ATOMIC_FLAG_INIT;
+
+// Claims the CORDIC for one batch, from a task or an interrupt, and sets the
+// function up: Q1.31 arguments and results, nargs and nres of them
+bool claim(uint32_t function, uint32_t nargs, uint32_t nres) {
+  if (cordic_busy.test_and_set(std::memory_order_acquire)) {
+    return false;
+  }
+  RCC->AHB1ENR |= RCC_AHB1ENR_CORDICEN;
+  (void)RCC->AHB1ENR;
+  CORDIC->CSR = (function << CORDIC_CSR_FUNC_Pos) | (cordic_precision << CORDIC_CSR_PRECISION_Pos) |
+                (nargs == 2 ? CORDIC_CSR_NARGS : 0) | (nres == 2 ? CORDIC_CSR_NRES : 0);
+  return true;
+}
+
+void release() {
+  cordic_busy.clear(std::memory_order_release);
+}
+
+// In each loop below, the arguments of element i + 1 go in before the results
+// of element i are read: the CORDIC starts on them as soon as those reads
+// complete, while the CPU converts the results.
+
+void sincos_cordic(const float* angles, float* sin, float* cos, size_t count) {
+  CORDIC->WDATA = static_cast<uint32_t>(angle_q31(angles[0]));
+  CORDIC->WDATA = static_cast<uint32_t>(q31_one);
+  for (size_t i = 0; i < count; ++i) {
+    if (i + 1 < count) {
+      CORDIC->WDATA = static_cast<uint32_t>(angle_q31(angles[i + 1]));
+      CORDIC->WDATA = static_cast<uint32_t>(q31_one);
+    }
+    const auto s = static_cast<int32_t>(CORDIC->RDATA);
+    const auto c = static_cast<int32_t>(CORDIC->RDATA);
+    if (sin) {
+      sin[i] = static_cast<float>(s) * q31_scale;
+    }
+    if (cos) {
+      cos[i] = static_cast<float>(c) * q31_scale;
+    }
+  }
+}
+
+// Both coordinates scaled by the same power of two, so the modulus stays
+// below 1
+int write_vector(float x, float y) {
+  const int e = vector_exponent(x, y);
+  const float scale = power_of_two(31 - e);
+  CORDIC->WDATA = static_cast<uint32_t>(static_cast<int32_t>(x * scale));
+  CORDIC->WDATA = static_cast<uint32_t>(static_cast<int32_t>(y * scale));
+  return e;
+}
+
+void polar_cordic(const float* x, const float* y, float* magnitude, float* angle, size_t count) {
+  int e = write_vector(x[0], y[0]);
+  for (size_t i = 0; i < count; ++i) {
+    const int next = i + 1 < count ? write_vector(x[i + 1], y[i + 1]) : 0;
+    const auto phase = static_cast<int32_t>(CORDIC->RDATA);
+    if (magnitude) {
+      const auto modulus = static_cast<int32_t>(CORDIC->RDATA);
+      magnitude[i] = static_cast<float>(modulus) * power_of_two(e - 31);
+    }
+    if (angle) {
+      angle[i] = angle_float(phase);
+    }
+    e = next;
+  }
+}
+
+// Split of a positive normal x into m * 4^k, m in [0.125, 0.5): the CORDIC
+// square root range at scale 0. Returns the even exponent 2k.
+int sqrt_exponent(float x) {
+  // x = f * 2^e, f in [0.5, 1)
+  const int e = static_cast<int>((float_bits(x) >> 23) & 0xFF) - 126;
+  return (e + 2) & ~1;
+}
+
+// Argument m of x = m * 4^k; zero for the inputs handled without the CORDIC
+int write_sqrt(float x) {
+  if (!(x > 0.0f) || std::isinf(x) || x < min_normalized) {
+    CORDIC->WDATA = 0;
+    return 0;
+  }
+  const int e2 = sqrt_exponent(x);
+  CORDIC->WDATA = static_cast<uint32_t>(static_cast<int32_t>(x * power_of_two(31 - e2)));
+  return e2;
+}
+
+void sqrt_cordic(const float* in, float* out, size_t count) {
+  float x = in[0];
+  int e2 = write_sqrt(x);
+  for (size_t i = 0; i < count; ++i) {
+    const float next_x = i + 1 < count ? in[i + 1] : 0.0f;
+    const int next_e2 = i + 1 < count ? write_sqrt(next_x) : 0;
+    const auto root = static_cast<int32_t>(CORDIC->RDATA);
+    out[i] = e2 ? static_cast<float>(root) * power_of_two((e2 >> 1) - 31) : sqrt_one_table(x);
+    x = next_x;
+    e2 = next_e2;
+  }
+}
+} // namespace
+#endif
+
+void sincos(const float* angles, float* sin, float* cos, size_t count) {
+#if defined(CORDIC)
+  if (count && claim(cordic_sine, 2, 2)) {
+    sincos_cordic(angles, sin, cos, count);
+    release();
+    return;
+  }
+#endif
+  sincos_table(angles, sin, cos, count);
+}
+
+void atan2(const float* y, const float* x, float* angles, size_t count) {
+  polar(x, y, nullptr, angles, count);
+}
+
+void polar(const float* x, const float* y, float* magnitude, float* angle, size_t count) {
+#if defined(CORDIC)
+  if (count && claim(cordic_phase, 2, magnitude ? 2 : 1)) {
+    polar_cordic(x, y, magnitude, angle, count);
+    release();
+    return;
+  }
+#endif
+  polar_table(x, y, magnitude, angle, count);
+}
+
+void sqrt(const float* in, float* out, size_t count) {
+#if defined(CORDIC)
+  if (count && claim(cordic_sqrt, 1, 1)) {
+    sqrt_cordic(in, out, count);
+    release();
+    return;
+  }
+#endif
+  sqrt_table(in, out, count);
+}
+
+} // namespace ru::driver::math
@@ -0,0 +1,135 @@
+#include <cmath>
+
+#include "FreeRTOS.h"
+#include "stm32h5xx_hal.h"
+#include "task.h"
+
+#include "cordic.hpp"
+#include "debug_log.hpp"
+#include "timer.hpp"
+
+namespace ru::driver::math {
+
+namespace {
+// Cycles per element of f, run with interrupts masked
+template <typename F>
+uint32_t cycles_per_element(size_t count, F f) {
+  taskENTER_CRITICAL();
+  const uint32_t start = DWT->CYCCNT;
+  f();
+  const uint32_t cycles = DWT->CYCCNT - start;
+  taskEXIT_CRITICAL();
+  return static_cast<uint32_t>(cycles / count);
+}
+
+// Worst difference, in millionths (relative to the reference if `relative`)
+unsigned worst_error(const float* out, const float* reference, size_t count,
+                     bool relative = false) {
+  float worst = 0.0f;
+  for (size_t i = 0; i < count; ++i) {
+    float error = std::fabs(out[i] - reference[i]);
+    if (relative && reference[i] != 0.0f) {
+      error /= std::fabs(reference[i]);
+    }
+    worst = error > worst ? error : worst;
+  }
+  return static_cast<unsigned>(worst * 1e6f + 0.5f);
+}
+
+void log_result(const char* name, uint32_t cordic, uint32_t table, uint32_t libm,
+                unsigned cordic_error, unsigned table_error) {
+  RU_LOG_INFO("math %s: %u cycles/element on cordic, %u from tables, %u in libm", name,
+              static_cast<unsigned>(cordic), static_cast<unsigned>(table),
+              static_cast<unsigned>(libm));
+  RU_LOG_INFO("math %s: worst error %u e-6 on cordic, %u e-6 from tables", name, cordic_error,
+              table_error);
+}
+} // namespace
+
+void report_math_cycles(size_t count) {
+  if (!count) {
+    return;
+  }
+  (void)Timer::start();
+
+  // Angles over two turns each way, vectors of all directions and of
+  // magnitudes 2^-8 to 2^8, square roots of 2^-16 to 2^16
+  auto* a = new float[count];
+  auto* b = new float[count];
+  auto* out = new float[count];
+  auto* out2 = new float[count];
+  auto* reference = new float[count];
+  auto* reference2 = new float[count];
+  uint32_t noise = 1;
+  const auto next = [&noise]() {
+    noise = noise * 1664525u + 1013904223u;
+    return static_cast<float>(noise >> 8) * (1.0f / 16777216.0f);
+  };
+  for (size_t i = 0; i < count; ++i) {
+    a[i] = (next() * 2.0f - 1.0f) * 12.566371f;
+  }
+
+  const uint32_t libm_sincos = cycles_per_element(count, [&] {
+    for (size_t i = 0; i < count; ++i) {
+      reference[i] = sinf(a[i]);
+      reference2[i] = cosf(a[i]);
+    }
+  });
+  const uint32_t cordic_sincos = cycles_per_element(count, [&] { sincos(a, out, out2, count); });
+  unsigned cordic_error = worst_error(out, reference, count);
+  const unsigned cordic_error2 = worst_error(out2, reference2, count);
+  cordic_error = cordic_error2 > cordic_error ? cordic_error2 : cordic_error;
+  const uint32_t table_sincos =
+      cycles_per_element(count, [&] { sincos_table(a, out, out2, count); });
+  unsigned table_error = worst_error(out, reference, count);
+  const unsigned table_error2 = worst_error(out2, reference2, count);
+  table_error = table_error2 > table_error ? table_error2 : table_error;
+  log_result("sincos", cordic_sincos, table_sincos, libm_sincos, cordic_error, table_error);
+
+  for (size_t i = 0; i < count; ++i) {
+    const float magnitude = ldexpf(1.0f, static_cast<int>(next() * 16.0f) - 8);
+    const float angle = (next() * 2.0f - 1.0f) * 3.1415926f;
+    a[i] = magnitude * cosf(angle);
+    b[i] = magnitude * sinf(angle);
+  }
+
+  const uint32_t libm_polar = cycles_per_element(count, [&] {
+    for (size_t i = 0; i < count; ++i) {
+      reference[i] = hypotf(a[i], b[i]);
+      reference2[i] = atan2f(b[i], a[i]);
+    }
+  });
+  const uint32_t cordic_polar = cycles_per_element(count, [&] { polar(a, b, out, out2, count); });
+  const unsigned cordic_magnitude_error = worst_error(out, reference, count, true);
+  const unsigned cordic_angle_error = worst_error(out2, reference2, count);
+  const uint32_t table_polar =
+      cycles_per_element(count, [&] { polar_table(a, b, out, out2, count); });
+  log_result("magnitude", cordic_polar, table_polar, libm_polar, cordic_magnitude_error,
+             worst_error(out, reference, count, true));
+  log_result("angle", cordic_polar, table_polar, libm_polar, cordic_angle_error,
+             worst_error(out2, reference2, count));
+
+  for (size_t i = 0; i < count; ++i) {
+    a[i] = ldexpf(1.0f + next(), static_cast<int>(next() * 32.0f) - 16);
+  }
+
+  const uint32_t libm_sqrt = cycles_per_element(count, [&] {
+    for (size_t i = 0; i < count; ++i) {
+      reference[i] = sqrtf(a[i]);
+    }
+  });
+  const uint32_t cordic_sqrt = cycles_per_element(count, [&] { sqrt(a, out, count); });
+  cordic_error = worst_error(out, reference, count, true);
+  const uint32_t table_sqrt = cycles_per_element(count, [&] { sqrt_table(a, out, count); });
+  log_result("sqrt", cordic_sqrt, table_sqrt, libm_sqrt, cordic_error,
+             worst_error(out, reference, count, true));
+
+  delete[] a;
+  delete[] b;
+  delete[] out;
+  delete[] out2;
+  delete[] reference;
+  delete[] reference2;
+}
+
+} // namespace ru::driver::math
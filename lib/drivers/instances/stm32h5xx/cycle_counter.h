@@ -0,0 +1,26 @@
+/**
+ * @file cycle_counter.h
+ * @date 2026
+ * @brief DWT cycle counter start-up, shared by the C drivers and ru::driver::Timer.
+ * * The only copy of the enable sequence: raceup_fdcan.c and spi.cpp call it
+ * directly, the other C++ drivers and the cycle reports through Timer::start().
+ */
+
+#ifndef _RACEUP_CYCLE_COUNTER_H
+#define _RACEUP_CYCLE_COUNTER_H
+
+#include "stm32h5xx_hal.h"
+
+/**
+ * @brief  Starts the DWT cycle counter (SystemCoreClock cycles) if it is not running.
+ * @note   A running counter is never reset: other drivers keep timestamps taken from it.
+ */
+static inline void RUP_CycleCounter_Start(void) {
+    if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0U) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+}
+
+#endif /* _RACEUP_CYCLE_COUNTER_H */
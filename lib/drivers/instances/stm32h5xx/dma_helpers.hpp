@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "FreeRTOS.h"
+#include "stm32h5xx_hal.h"
+#include "task.h"
+
+// GPDMA1 channel set-up and FreeRTOS timeouts shared by the DMA drivers of
+// this directory (serial, spi, i2c, i3c, pwm, adc, filter). Not part of the
+// driver API.
+namespace ru::driver {
+
+// Error flags of a channel in CSR, and every flag CFCR clears
+inline constexpr uint32_t dma_error_flags = DMA_CSR_DTEF | DMA_CSR_ULEF | DMA_CSR_USEF;
+inline constexpr uint32_t dma_clear_flags = DMA_CFCR_TCF | DMA_CFCR_HTF | DMA_CFCR_DTEF |
+                                            DMA_CFCR_ULEF | DMA_CFCR_USEF | DMA_CFCR_SUSPF |
+                                            DMA_CFCR_TOF;
+
+// Single block between memory and a peripheral data register: byte to byte,
+// the memory side incrementing, the request on the peripheral side. Only the
+// error interrupts are enabled; the peripheral reports the end of the block.
+inline void arm_dma(DMA_Channel_TypeDef* dma, uint32_t request, bool to_peripheral,
+                    const volatile void* src, volatile void* dst, size_t len) {
+  dma->CCR = DMA_CCR_RESET;
+  dma->CFCR = dma_clear_flags;
+  dma->CTR1 = to_peripheral ? DMA_CTR1_SINC : DMA_CTR1_DINC;
+  dma->CTR2 = ((request << DMA_CTR2_REQSEL_Pos) & DMA_CTR2_REQSEL) |
+              (to_peripheral ? DMA_CTR2_DREQ : 0);
+  dma->CBR1 = static_cast<uint32_t>(len);
+  dma->CSAR = reinterpret_cast<uint32_t>(src);
+  dma->CDAR = reinterpret_cast<uint32_t>(dst);
+  dma->CLLR = 0;
+  dma->CCR = DMA_CCR_DTEIE | DMA_CCR_ULEIE | DMA_CCR_USEIE | DMA_CCR_EN;
+}
+
+// Timeout of a blocking call in ticks; the drivers' wait_forever (UINT32_MAX)
+// blocks for good
+inline TickType_t to_ticks(uint32_t timeout_ms) {
+  return timeout_ms == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+}
+
+// Ticks left before the timeout expires (0 once expired)
+inline TickType_t ticks_left(TickType_t start, TickType_t timeout) {
+  if (timeout == portMAX_DELAY) {
+    return portMAX_DELAY;
+  }
+  const TickType_t elapsed = xTaskGetTickCount() - start;
+  return elapsed < timeout ? timeout - elapsed : 0;
+}
+
+} // namespace ru::driver
@@ -0,0 +1,347 @@
+#include "FreeRTOS.h"
+#include "stm32h5xx_hal.h"
+#include "task.h"
+
+#include "dma_helpers.hpp"
+#include "filter.hpp"
+
+namespace ru::driver {
+
+namespace {
+// Task notification slot used to wake a task blocked in Filter::process, the
+// one Serial uses: a task waits on one driver at a time
+const UBaseType_t filter_notify_index = 1;
+
+// FMAC_PARAM.FUNC
+const uint32_t fmac_load_x1 = 1;
+const uint32_t fmac_load_x2 = 2;
+const uint32_t fmac_load_y = 3;
+const uint32_t fmac_fir = 8;
+const uint32_t fmac_iir = 9;
+
+const uint32_t fmac_memory_words = 256;
+// Samples of one DMA transfer: the block size is counted in bytes
+const size_t max_dma_samples = DMA_CBR1_BNDT / sizeof(int16_t);
+// Polling bound of the reset and preload sequences
+const uint32_t fmac_poll_limit = 100000;
+
+struct FmacHw {
+  DMA_Channel_TypeDef* write_dma;
+  IRQn_Type write_irq;
+  DMA_Channel_TypeDef* read_dma;
+  IRQn_Type read_irq;
+  uint32_t irq_priority;
+};
+
+// FMAC setup generated from config.yaml, closed by an empty entry so the
+// table is never empty
+#define X_fmac(write_channel, read_channel, irq_priority)                        \
+  {GPDMA1_Channel##write_channel, GPDMA1_Channel##write_channel##_IRQn,          \
+   GPDMA1_Channel##read_channel, GPDMA1_Channel##read_channel##_IRQn, irq_priority},
+const FmacHw fmac_hw[] = {
+#include "fmac_instances.hpp"
+  {},  // no FMAC
+};
+#undef X_fmac
+
+const bool fmac_configured = sizeof(fmac_hw) / sizeof(fmac_hw[0]) > 1;
+
+bool poll_clear(volatile uint32_t& reg, uint32_t mask) {
+  for (uint32_t i = 0; i < fmac_poll_limit; ++i) {
+    if (!(reg & mask)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void write_samples(const int16_t* values, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    FMAC->WDATA = static_cast<uint16_t>(values[i]);
+  }
+}
+
+// Runs a load function: the values go to the base of the buffer, START
+// clears once they are all written
+bool preload(uint32_t function, const int16_t* values, uint8_t p, const int16_t* more = nullptr,
+             uint8_t q = 0) {
+  FMAC->PARAM = (function << FMAC_PARAM_FUNC_Pos) | (static_cast<uint32_t>(p) << FMAC_PARAM_P_Pos) |
+                (static_cast<uint32_t>(q) << FMAC_PARAM_Q_Pos) | FMAC_PARAM_START;
+  write_samples(values, p);
+  write_samples(more, q);
+  return poll_clear(FMAC->PARAM, FMAC_PARAM_START);
+}
+} // namespace
+
+class FilterInstanceSpecific {
+public:
+  FilterInstanceSpecific(FilterId filter_id, const FilterCoefficients& coefficients)
+      : id(filter_id), kernel(coefficients) {}
+
+  FilterId id;
+  FilterKernel kernel;
+  FilterStats stats{};
+  volatile TaskHandle_t waiter = nullptr;
+  volatile bool done = false;
+  volatile bool failed = false;
+  volatile uint32_t irq_cycles = 0;
+};
+
+namespace {
+// Filter whose block runs on the FMAC
+FilterInstanceSpecific* volatile fmac_runner;
+
+void handle_fmac_dma_irq(DMA_Channel_TypeDef* dma) {
+  const uint32_t start = DWT->CYCCNT;
+  const uint32_t csr = dma->CSR;
+  dma->CFCR = dma_clear_flags;
+  FilterInstanceSpecific* hw = fmac_runner;
+  if (!hw) {
+    return;
+  }
+
+  // The block is over once its last output is read back
+  if (csr & dma_error_flags) {
+    hw->failed = true;
+  } else if (dma != fmac_hw[0].read_dma || !(csr & DMA_CSR_TCF)) {
+    return;
+  }
+  hw->done = true;
+
+  BaseType_t woken = pdFALSE;
+  TaskHandle_t waiter = hw->waiter;
+  if (waiter) {
+    hw->waiter = nullptr;
+    vTaskNotifyGiveIndexedFromISR(waiter, filter_notify_index, &woken);
+  }
+  hw->irq_cycles = hw->irq_cycles + (DWT->CYCCNT - start);
+  portYIELD_FROM_ISR(woken);
+}
+
+void start_dma(DMA_Channel_TypeDef* dma, uint32_t request, bool to_fmac, const volatile void* src,
+               volatile void* dst, size_t count) {
+  dma->CCR = DMA_CCR_RESET;
+  dma->CFCR = dma_clear_flags;
+
+  // Half-word to half-word, the memory side incrementing; the FMAC requests
+  // a write while X1 has room and a read while Y holds a result
+  dma->CTR1 = DMA_CTR1_SDW_LOG2_0 | DMA_CTR1_DDW_LOG2_0 | (to_fmac ? DMA_CTR1_SINC : DMA_CTR1_DINC);
+  dma->CTR2 = ((request << DMA_CTR2_REQSEL_Pos) & DMA_CTR2_REQSEL) | (to_fmac ? DMA_CTR2_DREQ : 0);
+  dma->CBR1 = static_cast<uint32_t>(count * sizeof(int16_t));
+  dma->CSAR = reinterpret_cast<uint32_t>(src);
+  dma->CDAR = reinterpret_cast<uint32_t>(dst);
+  dma->CLLR = 0;
+
+  dma->CCR = (to_fmac ? 0 : DMA_CCR_TCIE) | DMA_CCR_DTEIE | DMA_CCR_ULEIE | DMA_CCR_USEIE;
+  dma->CCR |= DMA_CCR_EN;
+}
+
+// Memory layout, coefficients and history of the filter, then starts it: it
+// computes as soon as the DMA brings the inputs
+bool start_fmac(const FilterKernel& kernel) {
+  const FilterCoefficients& c = kernel.coefficients();
+  RCC->AHB1ENR |= RCC_AHB1ENR_FMACEN | RCC_AHB1ENR_GPDMA1EN;
+  (void)RCC->AHB1ENR;
+
+  FMAC->CR = FMAC_CR_RESET;
+  if (!poll_clear(FMAC->CR, FMAC_CR_RESET)) {
+    return false;
+  }
+
+  // X2 holds the coefficients, X1 and Y split the rest of the memory: what is
+  // above p - 1 inputs and q outputs decouples the DMA from the computation.
+  // The watermarks stay at one sample, as the DMA needs.
+  const uint32_t coefficients = c.p + c.q;
+  const uint32_t spare = (fmac_memory_words - 2 * coefficients) / 2;
+  const uint32_t x1_size = c.p + spare;
+  const uint32_t y_size = c.q + spare;
+  FMAC->X2BUFCFG = coefficients << FMAC_X2BUFCFG_X2_BUF_SIZE_Pos;
+  FMAC->X1BUFCFG = (coefficients << FMAC_X1BUFCFG_X1_BASE_Pos) |
+                   (x1_size << FMAC_X1BUFCFG_X1_BUF_SIZE_Pos);
+  FMAC->YBUFCFG = ((coefficients + x1_size) << FMAC_YBUFCFG_Y_BASE_Pos) |
+                  (y_size << FMAC_YBUFCFG_Y_BUF_SIZE_Pos);
+
+  int16_t inputs[FilterKernel::max_feedforward];
+  int16_t outputs[FilterKernel::max_feedback];
+  kernel.input_history(inputs);
+  kernel.output_history(outputs);
+  if (!preload(fmac_load_x2, c.feedforward, c.p, c.feedback, c.q) ||
+      !preload(fmac_load_x1, inputs, static_cast<uint8_t>(c.p - 1)) ||
+      (c.q && !preload(fmac_load_y, outputs, c.q))) {
+    return false;
+  }
+
+  FMAC->CR = FMAC_CR_CLIPEN | FMAC_CR_DMAREN | FMAC_CR_DMAWEN;
+  FMAC->PARAM = ((c.q ? fmac_iir : fmac_fir) << FMAC_PARAM_FUNC_Pos) |
+                (static_cast<uint32_t>(c.p) << FMAC_PARAM_P_Pos) |
+                (static_cast<uint32_t>(c.q) << FMAC_PARAM_Q_Pos) |
+                (static_cast<uint32_t>(c.gain) << FMAC_PARAM_R_Pos) | FMAC_PARAM_START;
+  return true;
+}
+
+void stop_fmac() {
+  fmac_hw[0].write_dma->CCR = DMA_CCR_RESET;
+  fmac_hw[0].read_dma->CCR = DMA_CCR_RESET;
+  FMAC->PARAM = 0;
+  FMAC->CR = 0;
+}
+} // namespace
+
+FilterConfig::FilterConfig(FilterId id) : m_id(id) {}
+
+Filter::Filter() : p_instance_specific(nullptr) {}
+
+expected::expected<void, Error> Filter::start() {
+  return {};
+}
+
+expected::expected<void, Error> Filter::init(const Config& config) {
+  const auto* cfg = dynamic_cast<const FilterConfig*>(&config);
+  if (!cfg) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid filter config"));
+  }
+  if (!fmac_configured) {
+    return expected::unexpected(RU_ERROR(CommonError::not_started, "fmac not configured"));
+  }
+
+  const FilterCoefficients* coefficients = filter_coefficients(cfg->m_id);
+  if (!coefficients) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "unsupported filter id"));
+  }
+  if (coefficients->p < 2 || coefficients->p > FilterKernel::max_feedforward ||
+      coefficients->q > FilterKernel::max_feedback) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid filter order"));
+  }
+
+  if (p_instance_specific) {
+    (void)stop();
+  }
+  p_instance_specific = new FilterInstanceSpecific(cfg->m_id, *coefficients);
+
+  const FmacHw& fmac = fmac_hw[0];
+  NVIC_SetPriority(fmac.write_irq, fmac.irq_priority);
+  NVIC_SetPriority(fmac.read_irq, fmac.irq_priority);
+  NVIC_EnableIRQ(fmac.write_irq);
+  NVIC_EnableIRQ(fmac.read_irq);
+  return {};
+}
+
+expected::expected<void, Error> Filter::stop() {
+  delete p_instance_specific;
+  p_instance_specific = nullptr;
+  return {};
+}
+
+expected::expected<void, Error> Filter::process(const int16_t* in, int16_t* out, size_t count,
+                                                uint32_t timeout_ms) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "filter not initialized"));
+  }
+  if (!count) {
+    return {};
+  }
+
+  taskENTER_CRITICAL();
+  const bool busy = fmac_runner != nullptr;
+  if (!busy) {
+    fmac_runner = hw;
+  }
+  taskEXIT_CRITICAL();
+  if (busy) {
+    return expected::unexpected(RU_ERROR(CommonError::busy, "fmac in use by another filter"));
+  }
+
+  uint32_t mark = DWT->CYCCNT;
+  uint32_t cpu_cycles = 0;
+  hw->irq_cycles = 0;
+  if (!start_fmac(hw->kernel)) {
+    stop_fmac();
+    fmac_runner = nullptr;
+    return expected::unexpected(RU_ERROR(CommonError::general_error, "fmac preload failed"));
+  }
+
+  const TickType_t start = xTaskGetTickCount();
+  const TickType_t timeout = to_ticks(timeout_ms);
+  const FmacHw& fmac = fmac_hw[0];
+  bool timed_out = false;
+  for (size_t done = 0; done < count && !hw->failed && !timed_out;) {
+    const size_t chunk = count - done < max_dma_samples ? count - done : max_dma_samples;
+    hw->done = false;
+    hw->waiter = xTaskGetCurrentTaskHandle();
+    // Reader first, so no result waits in Y for it
+    start_dma(fmac.read_dma, GPDMA1_REQUEST_FMAC_READ, false, &FMAC->RDATA, out + done, chunk);
+    start_dma(fmac.write_dma, GPDMA1_REQUEST_FMAC_WRITE, true, in + done, &FMAC->WDATA, chunk);
+    cpu_cycles += DWT->CYCCNT - mark;
+
+    while (!hw->done) {
+      const TickType_t elapsed = xTaskGetTickCount() - start;
+      if (timeout != portMAX_DELAY && elapsed >= timeout) {
+        timed_out = true;
+        break;
+      }
+      ulTaskNotifyTakeIndexed(filter_notify_index, pdTRUE,
+                              timeout == portMAX_DELAY ? portMAX_DELAY : timeout - elapsed);
+    }
+    mark = DWT->CYCCNT;
+    done += chunk;
+  }
+
+  hw->waiter = nullptr;
+  stop_fmac();
+  fmac_runner = nullptr;
+  if (hw->failed) {
+    hw->failed = false;
+    ++hw->stats.dma_errors;
+    return expected::unexpected(RU_ERROR(FilterError::dma_error, "fmac dma error"));
+  }
+  if (timed_out) {
+    return expected::unexpected(RU_ERROR(FilterError::timeout, "fmac block timeout"));
+  }
+
+  // The stream goes on from the last samples, on either side
+  hw->kernel.append_history(in, out, count);
+  ++hw->stats.blocks;
+  hw->stats.samples += static_cast<uint32_t>(count);
+  hw->stats.cpu_cycles += cpu_cycles + (DWT->CYCCNT - mark) + hw->irq_cycles;
+  return {};
+}
+
+expected::expected<void, Error> Filter::process_software(const int16_t* in, int16_t* out,
+                                                         size_t count) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "filter not initialized"));
+  }
+  hw->kernel.process(in, out, count);
+  return {};
+}
+
+expected::expected<void, Error> Filter::reset() {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "filter not initialized"));
+  }
+  hw->kernel.reset();
+  return {};
+}
+
+expected::expected<FilterStats, Error> Filter::stats() const {
+  const auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "filter not initialized"));
+  }
+  return hw->stats;
+}
+
+} // namespace ru::driver
+
+#define X_fmac(write_channel, read_channel, irq_priority)                           \
+  extern "C" void GPDMA1_Channel##write_channel##_IRQHandler(void) {                 \
+    ru::driver::handle_fmac_dma_irq(GPDMA1_Channel##write_channel);                   \
+  }                                                                                  \
+  extern "C" void GPDMA1_Channel##read_channel##_IRQHandler(void) {                  \
+    ru::driver::handle_fmac_dma_irq(GPDMA1_Channel##read_channel);                    \
+  }
+#include "fmac_instances.hpp"
+#undef X_fmac
@@ -0,0 +1,79 @@
+#include "FreeRTOS.h"
+#include "stm32h5xx_hal.h"
+#include "task.h"
+
+#include "debug_log.hpp"
+#include "filter.hpp"
+#include "timer.hpp"
+
+namespace ru::driver {
+
+namespace {
+uint32_t per_1000(uint32_t cycles, size_t samples) {
+  return static_cast<uint32_t>(static_cast<uint64_t>(cycles) * 1000 / samples);
+}
+} // namespace
+
+void report_fmac_cycles(FilterId id, size_t samples) {
+  if (!samples) {
+    return;
+  }
+  (void)Timer::start();
+
+  Filter fmac;
+  Filter software;
+  const FilterConfig config(id);
+  if (!fmac.init(config) || !software.init(config)) {
+    RU_LOG_WARN("fmac filter %u: no such filter", static_cast<unsigned>(id));
+    return;
+  }
+
+  // Triangle wave with pseudo-random noise, at a quarter of full scale
+  auto* in = new int16_t[samples];
+  auto* out = new int16_t[samples];
+  auto* out_software = new int16_t[samples];
+  uint32_t noise = 1;
+  for (size_t i = 0; i < samples; ++i) {
+    noise = noise * 1664525u + 1013904223u;
+    const auto ramp = static_cast<int32_t>(i % 512);
+    in[i] = static_cast<int16_t>((ramp < 256 ? ramp : 511 - ramp) * 32 + (noise >> 22) - 512);
+  }
+
+  // The software path cannot be preempted, the FMAC one sleeps: only its CPU
+  // time (setup and interrupt) counts, the wall time is logged beside it
+  taskENTER_CRITICAL();
+  const uint32_t start = DWT->CYCCNT;
+  (void)software.process_software(in, out_software, samples);
+  const uint32_t software_cycles = DWT->CYCCNT - start;
+  taskEXIT_CRITICAL();
+
+  const uint32_t wall_start = DWT->CYCCNT;
+  const auto result = fmac.process(in, out, samples, 100);
+  const uint32_t wall_cycles = DWT->CYCCNT - wall_start;
+  const auto stats = fmac.stats();
+  if (!result || !stats) {
+    RU_LOG_WARN("fmac filter %u: fmac block failed", static_cast<unsigned>(id));
+  } else {
+    size_t mismatches = 0;
+    for (size_t i = 0; i < samples; ++i) {
+      mismatches += out[i] != out_software[i];
+    }
+    const uint32_t software_1000 = per_1000(software_cycles, samples);
+    const uint32_t fmac_1000 = per_1000(stats->cpu_cycles, samples);
+    RU_LOG_INFO("fmac filter %u: %u cycles/1000 samples in software, %u on fmac (%u wall)",
+                static_cast<unsigned>(id), software_1000, fmac_1000,
+                per_1000(wall_cycles, samples));
+    RU_LOG_INFO("fmac filter %u: %d cycles/1000 samples saved, %u mismatches",
+                static_cast<unsigned>(id),
+                static_cast<int>(software_1000) - static_cast<int>(fmac_1000),
+                static_cast<unsigned>(mismatches));
+  }
+
+  delete[] in;
+  delete[] out;
+  delete[] out_software;
+  (void)fmac.stop();
+  (void)software.stop();
+}
+
+} // namespace ru::driver
@@ -0,0 +1,125 @@
+#include <cstring>
+
+#include "filter.hpp"
+
+namespace ru::driver {
+
+namespace {
+// Only the filters of the generated header: no FMAC registers in this file,
+// so it also builds on the host (scripts/check_fmac_filters.py)
+#define X_fmac_filter(index, id, feedforward, feedback, gain, ...) \
+  const int16_t id##_coefficients[] = {__VA_ARGS__};
+#include "fmac_instances.hpp"
+#undef X_fmac_filter
+
+struct FilterEntry {
+  FilterId id;
+  FilterCoefficients coefficients;
+};
+
+// Filters generated from config.yaml, closed by an invalid entry so the table
+// is never empty
+#define X_fmac_filter(index, id, feedforward, feedback, gain, ...)                 \
+  {FilterId::id,                                                                   \
+   {id##_coefficients, id##_coefficients + feedforward, feedforward, feedback, gain}},
+const FilterEntry filter_table[] = {
+#include "fmac_instances.hpp"
+  {},  // FilterId::invalid
+};
+#undef X_fmac_filter
+
+const size_t filter_table_count = sizeof(filter_table) / sizeof(filter_table[0]) - 1;
+
+// Product truncated to Q.22, as it enters the FMAC accumulator
+int32_t product(int16_t coefficient, int16_t sample) {
+  return (static_cast<int32_t>(coefficient) * sample) >> 8;
+}
+
+// 26-bit accumulator (Q4.22) shifted by the gain, truncated to Q1.15 and
+// saturated (FMAC_CR.CLIPEN)
+int16_t fmac_output(int32_t acc, uint8_t gain) {
+  const int32_t wrapped = static_cast<int32_t>(static_cast<uint32_t>(acc) << 6) >> 6;
+  const int64_t y = (static_cast<int64_t>(wrapped) << gain) >> 7;
+  return static_cast<int16_t>(y > INT16_MAX ? INT16_MAX : y < INT16_MIN ? INT16_MIN : y);
+}
+} // namespace
+
+const FilterCoefficients* filter_coefficients(FilterId id) {
+  for (size_t i = 0; i < filter_table_count; ++i) {
+    if (filter_table[i].id == id) {
+      return &filter_table[i].coefficients;
+    }
+  }
+  return nullptr;
+}
+
+FilterKernel::FilterKernel(const FilterCoefficients& coefficients)
+    : m_coefficients(&coefficients) {
+  reset();
+}
+
+void FilterKernel::reset() {
+  std::memset(m_x, 0, sizeof(m_x));
+  std::memset(m_y, 0, sizeof(m_y));
+  m_x_pos = 0;
+  m_y_pos = 0;
+}
+
+void FilterKernel::push_input(int16_t x) {
+  const uint8_t p = m_coefficients->p;
+  m_x[m_x_pos] = x;
+  m_x[m_x_pos + p] = x;
+  m_x_pos = m_x_pos + 1 == p ? 0 : m_x_pos + 1;
+}
+
+void FilterKernel::push_output(int16_t y) {
+  const uint8_t q = m_coefficients->q;
+  if (!q) {
+    return;
+  }
+  m_y[m_y_pos] = y;
+  m_y[m_y_pos + q] = y;
+  m_y_pos = m_y_pos + 1 == q ? 0 : m_y_pos + 1;
+}
+
+void FilterKernel::process(const int16_t* in, int16_t* out, size_t count) {
+  const FilterCoefficients& c = *m_coefficients;
+  for (size_t i = 0; i < count; ++i) {
+    push_input(in[i]);
+    // Windows oldest first: x[n-p+1] .. x[n] and y[n-q] .. y[n-1]
+    const int16_t* x = m_x + m_x_pos;
+    const int16_t* y = m_y + m_y_pos;
+    int32_t acc = 0;
+    for (uint8_t k = 0; k < c.p; ++k) {
+      acc += product(c.feedforward[k], x[c.p - 1 - k]);
+    }
+    for (uint8_t k = 0; k < c.q; ++k) {
+      acc += product(c.feedback[k], y[c.q - 1 - k]);
+    }
+    const int16_t result = fmac_output(acc, c.gain);
+    push_output(result);
+    out[i] = result;
+  }
+}
+
+void FilterKernel::append_history(const int16_t* in, const int16_t* out, size_t count) {
+  // Only the samples still in the windows matter
+  const size_t inputs = count < m_coefficients->p ? count : m_coefficients->p;
+  const size_t outputs = count < m_coefficients->q ? count : m_coefficients->q;
+  for (size_t i = count - inputs; i < count; ++i) {
+    push_input(in[i]);
+  }
+  for (size_t i = count - outputs; i < count; ++i) {
+    push_output(out[i]);
+  }
+}
+
+void FilterKernel::input_history(int16_t* out) const {
+  std::memcpy(out, m_x + m_x_pos + 1, (m_coefficients->p - 1) * sizeof(int16_t));
+}
+
+void FilterKernel::output_history(int16_t* out) const {
+  std::memcpy(out, m_y + m_y_pos, m_coefficients->q * sizeof(int16_t));
+}
+
+} // namespace ru::driver
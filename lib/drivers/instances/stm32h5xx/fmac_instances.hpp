@@ -0,0 +1,30 @@
+// FMAC setup and filters of the board, generated by generate.py from the 'fmac'
+// module of config.yaml. Do not edit, regenerate instead.
+//
+// X_fmac(write_channel, read_channel, irq_priority)
+// - write_channel: GPDMA1 channel streaming the input samples to the FMAC
+// - read_channel:  GPDMA1 channel streaming the output samples back
+// - irq_priority:  NVIC priority of the DMA handlers
+//
+// X_fmac_filter(index, id, feedforward, feedback, gain, coefficients...)
+// - id:           FilterId of the filter
+// - feedforward:  number of b coefficients (FMAC P)
+// - feedback:     number of a coefficients after a0, 0 for a FIR (FMAC Q)
+// - gain:         output shift (FMAC R), the coefficients are scaled by 2^-gain
+// - coefficients: b0..b[feedforward-1] then -a1..-a[feedback], Q1.15
+
+#ifndef X_fmac
+#define X_fmac(write_channel, read_channel, irq_priority)
+#endif
+#ifndef X_fmac_filter
+#define X_fmac_filter(index, id, feedforward, feedback, gain, ...)
+#endif
+
+X_fmac(3, 4, 6)
+X_fmac_filter(0, pressure_lp, 31, 0, 0,
+              89, 111, 162, 246, 365, 519, 705, 915, 1140, 1371,
+              1595, 1799, 1972, 2103, 2186, 2214, 2186, 2103, 1972, 1799,
+              1595, 1371, 1140, 915, 705, 519, 365, 246, 162, 111,
+              89)
+X_fmac_filter(1, current_lp, 3, 2, 1,
+              329, 658, 329, 25576, -10508)
\ No newline at end of file
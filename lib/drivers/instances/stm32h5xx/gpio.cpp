@@ -1,13 +1,182 @@
-#include "gpio.hpp"
+#include <array>
+#include <atomic>
 
+#include "FreeRTOS.h"
 #include "stm32h5xx_hal.h"
+#include "task.h"
+
+#include "gpio.hpp"
+#include "static_gpio.hpp"
+#include "timer.hpp"
 
 namespace ru::driver {
 
+namespace {
+const uint32_t exti_line_count = 16;
+
+struct GpioIrqHw {
+  GpioId id;
+  uint8_t port;
+  uint8_t line;
+  bool rising;
+  bool falling;
+  uint32_t irq_priority;
+  uint32_t debounce_us;
+};
+
+// Edge interrupts generated from config.yaml, closed by an invalid entry so the
+// table is never empty
+#define X_gpio_interrupt(id, port, line, rising, falling, irq_priority, debounce_us) \
+  {GpioId::id, port, line, rising, falling, irq_priority, debounce_us},
+const GpioIrqHw gpio_irq_hw[] = {
+#include "gpio_interrupts.hpp"
+  {},  // GpioId::invalid
+};
+#undef X_gpio_interrupt
+
+const size_t gpio_irq_count = sizeof(gpio_irq_hw) / sizeof(gpio_irq_hw[0]) - 1;
+
+const GpioIrqHw* find_irq_hw(GpioId id) {
+  for (size_t i = 0; i < gpio_irq_count; ++i) {
+    if (gpio_irq_hw[i].id == id) {
+      return &gpio_irq_hw[i];
+    }
+  }
+  return nullptr;
+}
+} // namespace
+
+// Edge recorder of one EXTI line. The handler writes head, pop_event tail.
+struct GpioExtiState {
+  const GpioIrqHw* hw;
+  GPIO_TypeDef* port;
+  GpioEvent ring[Gpio::event_ring_size];
+  volatile uint32_t head;
+  volatile uint32_t tail;
+  uint32_t window;       // debounce window, cycles
+  uint32_t last_time;    // last recorded edge
+  uint32_t last_bounce;  // last rejected edge
+  bool has_event;
+  bool bounce_pending;
+  bool level;            // pin level after the last recorded edge
+  GpioEventCallback callback;
+  void* ctx;
+  GpioEventStats stats;
+};
+
+namespace {
+GpioExtiState gpio_exti_state[gpio_irq_count + 1];
+GpioExtiState* volatile exti_lines[exti_line_count];
+
+bool pin_level(const GpioExtiState& state) {
+  return state.port->IDR & (1u << state.hw->line);
+}
+
+void record_edge(GpioExtiState& state, uint32_t timestamp, bool level) {
+  state.has_event = true;
+  state.bounce_pending = false;
+  state.last_time = timestamp;
+  state.level = level;
+
+  const uint32_t head = state.head;
+  if (head - state.tail == Gpio::event_ring_size) {
+    ++state.stats.dropped;
+    return;
+  }
+  state.ring[head % Gpio::event_ring_size] = {timestamp, level ? GpioEdge::rising : GpioEdge::falling};
+  // The event is written before it is published
+  std::atomic_signal_fence(std::memory_order_release);
+  state.head = head + 1;
+  ++state.stats.events;
+}
+
+// With both edges enabled, a transition rejected as a bounce may be the last
+// one: once the window has passed, a pin left on the other level gets the
+// edge it missed, stamped with the rejected edge's time
+void settle(GpioExtiState& state) {
+  if (!state.bounce_pending || DWT->CYCCNT - state.last_time < state.window) {
+    return;
+  }
+  state.bounce_pending = false;
+  const bool level = pin_level(state);
+  if (state.hw->rising && state.hw->falling && level != state.level) {
+    record_edge(state, state.last_bounce, level);
+  }
+}
+
+// Oldest recorded edge, with the interrupts that record them masked
+bool take_event(GpioExtiState& state, GpioEvent& event) {
+  settle(state);
+  const uint32_t tail = state.tail;
+  if (tail == state.head) {
+    return false;
+  }
+  event = state.ring[tail % Gpio::event_ring_size];
+  state.tail = tail + 1;
+  return true;
+}
+} // namespace
+
+void handle_exti_irq(uint32_t line) {
+  const uint32_t timestamp = DWT->CYCCNT;
+  const uint32_t bit = 1u << line;
+  const uint32_t rising = EXTI->RPR1 & bit;
+  const uint32_t falling = EXTI->FPR1 & bit;
+  EXTI->RPR1 = rising;
+  EXTI->FPR1 = falling;
+
+  GpioExtiState* state = exti_lines[line];
+  if (!state) {
+    return;
+  }
+
+  bool level = rising;
+  if (state->hw->rising && state->hw->falling) {
+    // Both edges pending, or a second edge before the pin was read: the
+    // current level tells which one is last
+    level = pin_level(*state);
+    if (state->has_event && level == state->level) {
+      ++state->stats.bounces;
+      return;
+    }
+  }
+
+  if (state->has_event && timestamp - state->last_time < state->window) {
+    ++state->stats.bounces;
+    state->last_bounce = timestamp;
+    state->bounce_pending = true;
+    return;
+  }
+
+  record_edge(*state, timestamp, level);
+  if (state->callback) {
+    state->callback(state->ctx);
+  }
+}
+
 class GpioInstanceSpecific {
 public:
+  GpioId id;
   GPIO_TypeDef* port;
   uint16_t pin;
+  GpioExtiState* exti;
+};
+
+// Per port of the group: where each group bit lands among the port pins and
+// back, one 16-entry table per nibble so the conversion is 4 lookups
+class GpioGroupInstanceSpecific {
+public:
+  struct Port {
+    GPIO_TypeDef* port;
+    uint16_t group_mask;
+    uint16_t pin_mask;
+    uint16_t to_pins[4][16];
+    uint16_t to_group[4][16];
+  };
+  Port ports[GpioGroup::max_ports];
+  uint8_t port_count;
+  uint16_t all;
+  uint16_t invert;
 };
 
 namespace {
@@ -18,53 +187,157 @@ bool is_output_function(GpioFunction function) {
          function == GpioFunction::output_pushpull_pulldown;
 }
 
-uint32_t to_hal_pull(GpioFunction function) {
+// Register field values of a pin: MODER, OTYPER, PUPDR, OSPEEDR, AFR
+struct GpioPinFields {
+  uint8_t mode;
+  uint8_t otype;
+  uint8_t pull;
+  uint8_t speed;
+  uint8_t alternate;
+};
+
+struct GpioPinHw {
+  uintptr_t port_base;  // 0 when the GpioId has no pin in config.yaml
+  uint16_t pin;
+  GpioPinFields board;  // config.yaml settings, applied by Gpio::start()
+};
+
+constexpr size_t gpio_id_count = 1  // GpioId::invalid
+#undef X_gpio
+#define X_gpio(name) + 1
+#include "custom_board/driver_ids.hpp"
+#undef X_gpio
+#define X_gpio(name)
+    ;
+
+constexpr uintptr_t gpio_port_base(uint32_t port) {
+  return GPIOA_BASE + port * (GPIOB_BASE - GPIOA_BASE);
+}
+
+// Pins generated from config.yaml, indexed by GpioId
+constexpr std::array<GpioPinHw, gpio_id_count> gpio_pin_hw = [] {
+  std::array<GpioPinHw, gpio_id_count> table{};
+#define X_gpio_pin(id, port, pin, mode, otype, pull, speed, alternate)        \
+  table[static_cast<size_t>(GpioId::id)] = {gpio_port_base(port), 1u << pin, \
+                                            {mode, otype, pull, speed, alternate}};
+#include "gpio_pins.hpp"
+#undef X_gpio_pin
+  return table;
+}();
+
+const GpioPinHw* find_pin(GpioId id) {
+  const size_t index = static_cast<size_t>(id);
+  if (index >= gpio_id_count || !gpio_pin_hw[index].port_base) {
+    return nullptr;
+  }
+  return &gpio_pin_hw[index];
+}
+
+GpioPinFields to_fields(GpioFunction function, GpioSpeed speed) {
+  GpioPinFields fields{};
+  fields.mode = is_output_function(function) ? 1 : 0;
+  fields.otype = function == GpioFunction::output_opendrain_pullup ||
+                 function == GpioFunction::output_opendrain_pulldown;
   switch (function) {
     case GpioFunction::input_pullup:
     case GpioFunction::output_opendrain_pullup:
     case GpioFunction::output_pushpull_pullup:
-      return GPIO_PULLUP;
+      fields.pull = 1;
+      break;
     case GpioFunction::input_pulldown:
     case GpioFunction::output_opendrain_pulldown:
     case GpioFunction::output_pushpull_pulldown:
-      return GPIO_PULLDOWN;
+      fields.pull = 2;
+      break;
     case GpioFunction::input_floating:
     default:
-      return GPIO_NOPULL;
+      fields.pull = 0;
+      break;
   }
+  // GpioSpeed follows the OSPEEDR encoding
+  fields.speed = static_cast<uint8_t>(speed);
+  return fields;
 }
 
-uint32_t to_hal_mode(GpioFunction function) {
-  switch (function) {
-    case GpioFunction::output_opendrain_pullup:
-    case GpioFunction::output_opendrain_pulldown:
-      return GPIO_MODE_OUTPUT_OD;
-    case GpioFunction::output_pushpull_pullup:
-    case GpioFunction::output_pushpull_pulldown:
-      return GPIO_MODE_OUTPUT_PP;
-    case GpioFunction::input_floating:
-    case GpioFunction::input_pullup:
-    case GpioFunction::input_pulldown:
-    default:
-      return GPIO_MODE_INPUT;
+// Applies the same fields to every pin of `mask`: clock, then the registers in
+// the order that avoids glitches (alternate function and output stage before
+// the mode)
+void configure_pins(uintptr_t port_base, uint16_t mask, const GpioPinFields& fields) {
+  // GPIOAEN..GPIOIEN are consecutive, as are the port register blocks
+  const uint32_t port_index = (port_base - GPIOA_BASE) / (GPIOB_BASE - GPIOA_BASE);
+  SET_BIT(RCC->AHB2ENR, RCC_AHB2ENR_GPIOAEN << port_index);
+  // Delay after an RCC peripheral clock enabling
+  (void)READ_BIT(RCC->AHB2ENR, RCC_AHB2ENR_GPIOAEN << port_index);
+
+  uint32_t field2_mask = 0;
+  uint32_t mode = 0;
+  uint32_t pull = 0;
+  uint32_t speed = 0;
+  uint32_t otype = 0;
+  uint32_t afr_mask[2] = {};
+  uint32_t afr[2] = {};
+  for (uint32_t pin = 0; pin < 16; ++pin) {
+    if (!(mask & (1u << pin))) {
+      continue;
+    }
+    field2_mask |= 0x3u << (2 * pin);
+    mode |= static_cast<uint32_t>(fields.mode) << (2 * pin);
+    pull |= static_cast<uint32_t>(fields.pull) << (2 * pin);
+    speed |= static_cast<uint32_t>(fields.speed) << (2 * pin);
+    otype |= static_cast<uint32_t>(fields.otype) << pin;
+    afr_mask[pin / 8] |= 0xFu << (4 * (pin % 8));
+    afr[pin / 8] |= static_cast<uint32_t>(fields.alternate) << (4 * (pin % 8));
   }
+
+  auto* port = reinterpret_cast<GPIO_TypeDef*>(port_base);
+  // The other pins of the port may be reconfigured concurrently
+  taskENTER_CRITICAL();
+  MODIFY_REG(port->AFR[0], afr_mask[0], afr[0]);
+  MODIFY_REG(port->AFR[1], afr_mask[1], afr[1]);
+  MODIFY_REG(port->OSPEEDR, field2_mask, speed);
+  MODIFY_REG(port->OTYPER, mask, otype);
+  MODIFY_REG(port->PUPDR, field2_mask, pull);
+  MODIFY_REG(port->MODER, field2_mask, mode);
+  taskEXIT_CRITICAL();
 }
 
-uint32_t to_hal_speed(GpioSpeed speed) {
-  switch (speed) {
-    case GpioSpeed::medium:
-      return GPIO_SPEED_FREQ_MEDIUM;
-    case GpioSpeed::high:
-      return GPIO_SPEED_FREQ_HIGH;
-    case GpioSpeed::very_high:
-      return GPIO_SPEED_FREQ_VERY_HIGH;
-    case GpioSpeed::low:
-    default:
-      return GPIO_SPEED_FREQ_LOW;
+uint16_t remap(const uint16_t (&table)[4][16], uint16_t bits) {
+  return table[0][bits & 0xF] | table[1][(bits >> 4) & 0xF] | table[2][(bits >> 8) & 0xF] |
+         table[3][bits >> 12];
+}
+
+void add_to_table(uint16_t (&table)[4][16], uint16_t from_bit, uint16_t to_mask) {
+  const uint32_t nibble = from_bit / 4;
+  const uint32_t bit = 1u << (from_bit % 4);
+  for (uint32_t value = 0; value < 16; ++value) {
+    if (value & bit) {
+      table[nibble][value] |= to_mask;
+    }
   }
 }
 } // namespace
 
+void init_gpio_pins(uintptr_t port_base, uint16_t mask, GpioFunction function, GpioSpeed speed) {
+  configure_pins(port_base, mask, to_fields(function, speed));
+}
+
+bool find_gpio_pin(GpioId id, uintptr_t& port_base, uint16_t& mask) {
+  const GpioPinHw* pin = find_pin(id);
+  if (!pin) {
+    return false;
+  }
+  port_base = pin->port_base;
+  mask = pin->pin;
+  return true;
+}
+
+void restore_gpio_pin(GpioId id) {
+  const GpioPinHw* pin = find_pin(id);
+  if (pin) {
+    configure_pins(pin->port_base, pin->pin, pin->board);
+  }
+}
+
 GpioConfig::GpioConfig(GpioId id, GpioFunction function, bool active_high, GpioSpeed speed)
     : m_id(id), m_function(function), m_active_high(active_high), m_gpio_speed(speed) {}
 
@@ -74,6 +347,12 @@ GpioConfigFriend::GpioConfigFriend(GpioId id, const GpioFunction function)
 Gpio::Gpio() : m_active_high(1), m_is_output(0), p_instance_specific(nullptr) {}
 
 expected::expected<void, Error> Gpio::start() {
+  // Board pins: the config.yaml settings of every GpioId, no HAL on the way
+  for (const auto& pin : gpio_pin_hw) {
+    if (pin.port_base) {
+      configure_pins(pin.port_base, pin.pin, pin.board);
+    }
+  }
   return {};
 }
 
@@ -83,8 +362,9 @@ expected::expected<void, Error> Gpio::init(const Config& config) {
     return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid gpio config"));
   }
 
-  if (cfg->m_id != GpioId::debug_led) {
-    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "unsupported gpio id"));
+  const GpioPinHw* pin = find_pin(cfg->m_id);
+  if (!pin) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "gpio id without a pin"));
   }
 
   if (!p_instance_specific) {
@@ -92,17 +372,11 @@ expected::expected<void, Error> Gpio::init(const Config& config) {
   }
 
   auto* hw = static_cast<GpioInstanceSpecific*>(p_instance_specific);
-  hw->port = GPIOB;
-  hw->pin = GPIO_PIN_2;
-
-  __HAL_RCC_GPIOB_CLK_ENABLE();
+  hw->id = cfg->m_id;
+  hw->port = reinterpret_cast<GPIO_TypeDef*>(pin->port_base);
+  hw->pin = pin->pin;
 
-  GPIO_InitTypeDef init{};
-  init.Pin = hw->pin;
-  init.Mode = to_hal_mode(cfg->m_function);
-  init.Pull = to_hal_pull(cfg->m_function);
-  init.Speed = to_hal_speed(cfg->m_gpio_speed);
-  HAL_GPIO_Init(hw->port, &init);
+  configure_pins(pin->port_base, pin->pin, to_fields(cfg->m_function, cfg->m_gpio_speed));
 
   m_active_high = cfg->m_active_high ? 1 : 0;
   m_is_output = is_output_function(cfg->m_function) ? 1 : 0;
@@ -111,6 +385,9 @@ expected::expected<void, Error> Gpio::init(const Config& config) {
 }
 
 expected::expected<void, Error> Gpio::stop() {
+  if (p_instance_specific && p_instance_specific->exti) {
+    (void)disable_interrupt();
+  }
   delete static_cast<GpioInstanceSpecific*>(p_instance_specific);
   p_instance_specific = nullptr;
   return {};
@@ -177,10 +454,242 @@ expected::expected<void, Error> Gpio::toggle() {
   return {};
 }
 
+expected::expected<void, Error> Gpio::enable_interrupt(GpioEventCallback callback, void* ctx) {
+  auto* hw = static_cast<GpioInstanceSpecific*>(p_instance_specific);
+  if (!hw || !hw->port) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "gpio not initialized"));
+  }
+  const GpioIrqHw* irq = find_irq_hw(hw->id);
+  if (!irq) {
+    return expected::unexpected(
+        RU_ERROR(GpioError::interrupt_not_supported, "no interrupt configured for this gpio"));
+  }
+  if (exti_lines[irq->line] && exti_lines[irq->line] != hw->exti) {
+    return expected::unexpected(RU_ERROR(CommonError::busy, "exti line in use"));
+  }
+
+  const uint32_t bit = 1u << irq->line;
+  const IRQn_Type irqn = static_cast<IRQn_Type>(EXTI0_IRQn + irq->line);
+  CLEAR_BIT(EXTI->IMR1, bit);
+  NVIC_DisableIRQ(irqn);
+
+  (void)Timer::start();
+  GpioExtiState& state = gpio_exti_state[irq - gpio_irq_hw];
+  state = {};
+  state.hw = irq;
+  state.port = hw->port;
+  state.window = irq->debounce_us * (SystemCoreClock / 1000000U);
+  state.level = pin_level(state);
+  state.callback = callback;
+  state.ctx = ctx;
+  hw->exti = &state;
+  exti_lines[irq->line] = &state;
+
+  // EXTICR holds one port selection byte per line
+  const uint32_t shift = 8 * (irq->line % 4);
+  MODIFY_REG(EXTI->EXTICR[irq->line / 4], 0xFFu << shift, static_cast<uint32_t>(irq->port) << shift);
+  if (irq->rising) {
+    SET_BIT(EXTI->RTSR1, bit);
+  } else {
+    CLEAR_BIT(EXTI->RTSR1, bit);
+  }
+  if (irq->falling) {
+    SET_BIT(EXTI->FTSR1, bit);
+  } else {
+    CLEAR_BIT(EXTI->FTSR1, bit);
+  }
+  EXTI->RPR1 = bit;
+  EXTI->FPR1 = bit;
+
+  NVIC_ClearPendingIRQ(irqn);
+  NVIC_SetPriority(irqn, irq->irq_priority);
+  NVIC_EnableIRQ(irqn);
+  SET_BIT(EXTI->IMR1, bit);
+  return {};
+}
+
+expected::expected<void, Error> Gpio::disable_interrupt() {
+  auto* hw = static_cast<GpioInstanceSpecific*>(p_instance_specific);
+  if (!hw || !hw->port) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "gpio not initialized"));
+  }
+  if (!hw->exti) {
+    return {};
+  }
+
+  const uint32_t line = hw->exti->hw->line;
+  CLEAR_BIT(EXTI->IMR1, 1u << line);
+  NVIC_DisableIRQ(static_cast<IRQn_Type>(EXTI0_IRQn + line));
+  exti_lines[line] = nullptr;
+  hw->exti = nullptr;
+  return {};
+}
+
+expected::expected<bool, Error> Gpio::pop_event(GpioEvent& event) {
+  auto* hw = static_cast<GpioInstanceSpecific*>(p_instance_specific);
+  if (!hw || !hw->port) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "gpio not initialized"));
+  }
+  GpioExtiState* state = hw->exti;
+  if (!state) {
+    return expected::unexpected(RU_ERROR(CommonError::not_started, "gpio interrupt not enabled"));
+  }
+
+  taskENTER_CRITICAL();
+  const bool available = take_event(*state, event);
+  taskEXIT_CRITICAL();
+  return available;
+}
+
+expected::expected<bool, Error> Gpio::pop_event_from_isr(GpioEvent& event) {
+  auto* hw = static_cast<GpioInstanceSpecific*>(p_instance_specific);
+  if (!hw || !hw->port) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "gpio not initialized"));
+  }
+  GpioExtiState* state = hw->exti;
+  if (!state) {
+    return expected::unexpected(RU_ERROR(CommonError::not_started, "gpio interrupt not enabled"));
+  }
+
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  const bool available = take_event(*state, event);
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+  return available;
+}
+
+expected::expected<GpioEventStats, Error> Gpio::event_stats() const {
+  auto* hw = static_cast<GpioInstanceSpecific*>(p_instance_specific);
+  if (!hw || !hw->exti) {
+    return expected::unexpected(RU_ERROR(CommonError::not_started, "gpio interrupt not enabled"));
+  }
+  taskENTER_CRITICAL();
+  const GpioEventStats stats = hw->exti->stats;
+  taskEXIT_CRITICAL();
+  return stats;
+}
+
 expected::expected<void, Error> Gpio::init(struct capability::Token1<Can>, const GpioConfigFriend& config) {
   return init(GpioConfig(config.m_id, config.m_function));
 }
 
 void Gpio::reverse_protected_example(struct capability::Token1<Can>) {}
 
+GpioGroupConfig::GpioGroupConfig(std::span<const GpioId> ids, GpioFunction function,
+                                 bool active_high, GpioSpeed speed)
+    : m_ids(ids), m_function(function), m_active_high(active_high), m_gpio_speed(speed) {}
+
+GpioGroup::GpioGroup() : m_is_output(0), p_instance_specific(nullptr) {}
+
+expected::expected<void, Error> GpioGroup::start() {
+  return {};
+}
+
+expected::expected<void, Error> GpioGroup::init(const Config& config) {
+  const auto* cfg = dynamic_cast<const GpioGroupConfig*>(&config);
+  if (!cfg) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid gpio group config"));
+  }
+  if (cfg->m_ids.empty() || cfg->m_ids.size() > max_pins) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "gpio group size"));
+  }
+
+  GpioGroupInstanceSpecific group{};
+  for (size_t i = 0; i < cfg->m_ids.size(); ++i) {
+    const GpioPinHw* hw_pin = find_pin(cfg->m_ids[i]);
+    if (!hw_pin) {
+      return expected::unexpected(RU_ERROR(CommonError::out_of_range, "gpio id without a pin"));
+    }
+    auto* port = reinterpret_cast<GPIO_TypeDef*>(hw_pin->port_base);
+    const uint16_t pin = hw_pin->pin;
+
+    size_t p = 0;
+    while (p < group.port_count && group.ports[p].port != port) {
+      ++p;
+    }
+    if (p == group.port_count) {
+      if (p == max_ports) {
+        return expected::unexpected(RU_ERROR(CommonError::out_of_range, "too many gpio ports"));
+      }
+      group.ports[p].port = port;
+      ++group.port_count;
+    }
+
+    auto& entry = group.ports[p];
+    if (entry.pin_mask & pin) {
+      return expected::unexpected(RU_ERROR(CommonError::out_of_range, "gpio listed twice"));
+    }
+    entry.group_mask |= static_cast<uint16_t>(1u << i);
+    group.all |= static_cast<uint16_t>(1u << i);
+    entry.pin_mask |= pin;
+    add_to_table(entry.to_pins, static_cast<uint16_t>(i), pin);
+    add_to_table(entry.to_group, static_cast<uint16_t>(__builtin_ctz(pin)),
+                 static_cast<uint16_t>(1u << i));
+  }
+  group.invert = cfg->m_active_high ? 0 : 0xFFFF;
+
+  // One register update per port
+  for (size_t p = 0; p < group.port_count; ++p) {
+    init_gpio_pins(reinterpret_cast<uintptr_t>(group.ports[p].port), group.ports[p].pin_mask,
+                   cfg->m_function, cfg->m_gpio_speed);
+  }
+
+  if (!p_instance_specific) {
+    p_instance_specific = new GpioGroupInstanceSpecific();
+  }
+  *p_instance_specific = group;
+  m_is_output = is_output_function(cfg->m_function) ? 1 : 0;
+
+  return {};
+}
+
+expected::expected<void, Error> GpioGroup::stop() {
+  delete p_instance_specific;
+  p_instance_specific = nullptr;
+  return {};
+}
+
+expected::expected<void, Error> GpioGroup::write(uint16_t value, uint16_t mask) {
+  const auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "gpio group not initialized"));
+  }
+  if (!m_is_output) {
+    return expected::unexpected(RU_ERROR(GpioError::wrong_direction, "gpio group is an input"));
+  }
+
+  const uint16_t levels = value ^ hw->invert;
+  for (size_t p = 0; p < hw->port_count; ++p) {
+    const auto& entry = hw->ports[p];
+    const uint16_t selected = mask & entry.group_mask;
+    if (!selected) {
+      continue;
+    }
+    const uint32_t set = remap(entry.to_pins, levels & selected);
+    const uint32_t reset = remap(entry.to_pins, ~levels & selected);
+    entry.port->BSRR = set | (reset << 16);
+  }
+  return {};
+}
+
+expected::expected<uint16_t, Error> GpioGroup::read() const {
+  const auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "gpio group not initialized"));
+  }
+
+  uint16_t levels = 0;
+  for (size_t p = 0; p < hw->port_count; ++p) {
+    const auto& entry = hw->ports[p];
+    levels |= remap(entry.to_group, static_cast<uint16_t>(entry.port->IDR) & entry.pin_mask);
+  }
+  return static_cast<uint16_t>((levels ^ hw->invert) & hw->all);
+}
+
 } // namespace ru::driver
+
+#define X_gpio_interrupt(id, port, line, rising, falling, irq_priority, debounce_us) \
+  extern "C" void EXTI##line##_IRQHandler(void) {                                     \
+    ru::driver::handle_exti_irq(line);                                               \
+  }
+#include "gpio_interrupts.hpp"
+#undef X_gpio_interrupt
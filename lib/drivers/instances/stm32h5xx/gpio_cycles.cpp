@@ -0,0 +1,120 @@
+#include "FreeRTOS.h"
+#include "stm32h5xx_hal.h"
+#include "task.h"
+
+#include "debug_log.hpp"
+#include "static_gpio.hpp"
+#include "timer.hpp"
+
+namespace ru::driver {
+
+namespace {
+uint32_t per_1000(uint32_t cycles, size_t count) {
+  return static_cast<uint32_t>(static_cast<uint64_t>(cycles) * 1000 / count);
+}
+
+struct ToggleCycles {
+  uint32_t toggle;
+  uint32_t set_level;
+};
+
+template <char Port, uint8_t Pin>
+ToggleCycles static_gpio_cycles(size_t toggles) {
+  using Probe = StaticGpio<Port, Pin>;
+  ToggleCycles cycles{};
+  uint32_t start = DWT->CYCCNT;
+  for (size_t i = 0; i < toggles; ++i) {
+    Probe::toggle();
+  }
+  cycles.toggle = DWT->CYCCNT - start;
+  start = DWT->CYCCNT;
+  for (size_t i = 0; i < toggles; ++i) {
+    Probe::set_level(i & 1);
+  }
+  cycles.set_level = DWT->CYCCNT - start;
+  return cycles;
+}
+
+ToggleCycles gpio_cycles(Gpio& pin, size_t toggles) {
+  ToggleCycles cycles{};
+  uint32_t start = DWT->CYCCNT;
+  for (size_t i = 0; i < toggles; ++i) {
+    (void)pin.toggle();
+  }
+  cycles.toggle = DWT->CYCCNT - start;
+  start = DWT->CYCCNT;
+  for (size_t i = 0; i < toggles; ++i) {
+    (void)pin.set_level(i & 1);
+  }
+  cycles.set_level = DWT->CYCCNT - start;
+  return cycles;
+}
+
+struct StaticPin {
+  GpioId id;
+  bool output;  // MODER output in config.yaml
+  ToggleCycles (*run)(size_t toggles);
+};
+
+// The StaticGpio of every pin generated from config.yaml
+const StaticPin static_pins[] = {
+#define X_gpio_pin(id, port, pin, mode, otype, pull, speed, alternate) \
+  {GpioId::id, mode == 1, &static_gpio_cycles<'A' + port, pin>},
+#include "gpio_pins.hpp"
+#undef X_gpio_pin
+};
+} // namespace
+
+void report_toggle_cycles(GpioId id, size_t toggles) {
+  if (!toggles) {
+    return;
+  }
+  (void)Timer::start();
+
+  const StaticPin* probe = nullptr;
+  for (const auto& pin : static_pins) {
+    if (pin.id == id) {
+      probe = &pin;
+    }
+  }
+  uintptr_t port_base = 0;
+  uint16_t mask = 0;
+  if (!probe || !find_gpio_pin(id, port_base, mask)) {
+    RU_LOG_WARN("gpio %u: no such pin", static_cast<unsigned>(id));
+    return;
+  }
+  // Toggling an input or a chip select would drive whatever sits on the pin
+  if (!probe->output) {
+    RU_LOG_WARN("gpio %u: not an output in config.yaml", static_cast<unsigned>(id));
+    return;
+  }
+  auto* port = reinterpret_cast<GPIO_TypeDef*>(port_base);
+  const bool was_high = port->ODR & mask;
+
+  Gpio pin;
+  if (!pin.init(GpioConfig(id, GpioFunction::output_pushpull_pulldown, true,
+                           GpioSpeed::very_high))) {
+    RU_LOG_WARN("gpio %u: no such pin", static_cast<unsigned>(id));
+    return;
+  }
+
+  // Loop overhead included on both sides
+  taskENTER_CRITICAL();
+  const ToggleCycles runtime = gpio_cycles(pin, toggles);
+  const ToggleCycles compiled = probe->run(toggles);
+  taskEXIT_CRITICAL();
+
+  // Level, then the config.yaml settings, as they were
+  port->BSRR = was_high ? mask : static_cast<uint32_t>(mask) << 16;
+  (void)pin.stop();
+  restore_gpio_pin(id);
+
+  RU_LOG_INFO("gpio %u: toggle %u cycles/1000 with Gpio, %u with StaticGpio",
+              static_cast<unsigned>(id), per_1000(runtime.toggle, toggles),
+              per_1000(compiled.toggle, toggles));
+  RU_LOG_INFO("gpio %u: set_level %u cycles/1000 with Gpio, %u with StaticGpio",
+              static_cast<unsigned>(id), per_1000(runtime.set_level, toggles),
+              per_1000(compiled.set_level, toggles));
+}
+
+} // namespace ru::driver
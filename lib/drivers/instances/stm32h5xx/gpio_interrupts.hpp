@@ -0,0 +1,19 @@
+// GPIO edge interrupts of the board, generated by generate.py from the
+// 'interrupt' entries of the gpio list in config.yaml. Do not edit, regenerate
+// instead.
+//
+// X_gpio_interrupt(id, port, line, rising, falling, irq_priority, debounce_us)
+// - id:           GpioId bound to the pin
+// - port:         GPIO port index (0 = GPIOA)
+// - line:         pin number, which is also the EXTI line
+// - rising:       1 to record rising edges
+// - falling:      1 to record falling edges
+// - irq_priority: NVIC priority of the EXTI line handler
+// - debounce_us:  edges closer than this to the last recorded one are bounces
+
+#ifndef X_gpio_interrupt
+#define X_gpio_interrupt(id, port, line, rising, falling, irq_priority, debounce_us)
+#endif
+
+X_gpio_interrupt(shutdown_loop, 3, 8, 1, 1, 7, 500)
+X_gpio_interrupt(imu_drdy, 1, 0, 1, 0, 5, 0)
\ No newline at end of file
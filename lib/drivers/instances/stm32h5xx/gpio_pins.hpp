@@ -0,0 +1,21 @@
+// GPIO pins of the board, generated by generate.py from the entries of the gpio
+// list in config.yaml that have an 'id'. Do not edit, regenerate instead.
+//
+// X_gpio_pin(id, port, pin, mode, otype, pull, speed, alternate)
+// - id:        GpioId bound to the pin
+// - port:      GPIO port index (0 = GPIOA)
+// - pin:       pin number
+// - mode:      MODER field (0 input, 1 output, 2 alternate function, 3 analog)
+// - otype:     OTYPER bit (1 = open drain)
+// - pull:      PUPDR field (0 none, 1 pull-up, 2 pull-down)
+// - speed:     OSPEEDR field (0 low to 3 very high)
+// - alternate: AFR field, alternate function modes only
+
+#ifndef X_gpio_pin
+#define X_gpio_pin(id, port, pin, mode, otype, pull, speed, alternate)
+#endif
+
+X_gpio_pin(debug_led, 1, 2, 1, 0, 0, 0, 0)
+X_gpio_pin(imu_cs, 0, 4, 1, 0, 1, 2, 0)
+X_gpio_pin(imu_drdy, 1, 0, 0, 0, 0, 0, 0)
+X_gpio_pin(shutdown_loop, 3, 8, 0, 0, 1, 0, 0)
\ No newline at end of file
@@ -1,7 +1,394 @@
+#include <cstring>
+
+#include "FreeRTOS.h"
+#include "stm32h5xx_hal.h"
+#include "task.h"
+#include "timers.h"
+
+#include "dma_helpers.hpp"
 #include "i2c.hpp"
 
 namespace ru::driver {
 
+namespace {
+// Task notification slot used to wake a task blocked in I2c::wait (slot 0 is
+// left to the application)
+const UBaseType_t i2c_notify_index = 1;
+
+const uint32_t i2c_error_flags = I2C_ISR_BERR | I2C_ISR_ARLO | I2C_ISR_OVR | I2C_ISR_TIMEOUT;
+const uint32_t i2c_error_clear = I2C_ICR_BERRCF | I2C_ICR_ARLOCF | I2C_ICR_OVRCF |
+                                 I2C_ICR_TIMOUTCF;
+
+// The phase changes and the errors interrupt; the DMA requests stay enabled,
+// each direction only requests while its phase runs
+const uint32_t i2c_cr1 = I2C_CR1_PE | I2C_CR1_NACKIE | I2C_CR1_STOPIE | I2C_CR1_TCIE |
+                         I2C_CR1_ERRIE | I2C_CR1_TXDMAEN | I2C_CR1_RXDMAEN;
+
+// A device holding SCL low this long fails the transaction (SMBus tTIMEOUT)
+const uint32_t scl_timeout_us = 25000;
+
+// How long stop_polling() lets the reads in flight finish
+const uint32_t poll_stop_timeout_ms = 100;
+
+struct I2cHw {
+  I2cId id;
+  I2C_TypeDef* i2c;
+  volatile uint32_t* enable_reg;
+  uint32_t enable_bit;
+  uint64_t kernel_clock;
+  DMA_Channel_TypeDef* dma;
+  IRQn_Type dma_irq;
+  uint32_t rx_request;
+  uint32_t tx_request;
+  IRQn_Type ev_irq;
+  IRQn_Type er_irq;
+  uint32_t irq_priority;
+};
+
+// Controllers generated from config.yaml, closed by an invalid entry so the
+// table is never empty
+#define X_i2c_instance(index, id, periph, bus, channel, irq_priority)                    \
+  {I2cId::id, periph, &RCC->bus##ENR, RCC_##bus##ENR_##periph##EN, RCC_PERIPHCLK_##periph, \
+   GPDMA1_Channel##channel, GPDMA1_Channel##channel##_IRQn, GPDMA1_REQUEST_##periph##_RX,  \
+   GPDMA1_REQUEST_##periph##_TX, periph##_EV_IRQn, periph##_ER_IRQn, irq_priority},
+const I2cHw i2c_hw[] = {
+#include "i2c_instances.hpp"
+  {},  // I2cId::invalid
+};
+#undef X_i2c_instance
+
+const size_t i2c_hw_count = sizeof(i2c_hw) / sizeof(i2c_hw[0]) - 1;
+
+const I2cHw* find_hw(I2cId id) {
+  for (size_t i = 0; i < i2c_hw_count; ++i) {
+    if (i2c_hw[i].id == id) {
+      return &i2c_hw[i];
+    }
+  }
+  return nullptr;
+}
+
+// SCL of a speed and the share of its period SCL is low; the data setup time
+// of the specification plus the rise time of a typical bus (2.2 kOhm, 100 pF
+// for standard and fast mode); the time each SCL edge takes to rise or fall,
+// pass the analog filter and resynchronise the I2C, outside its counts
+struct I2cTiming {
+  uint32_t frequency_hz;
+  uint32_t low_percent;
+  uint32_t setup_ns;
+  uint32_t edge_ns;
+};
+
+const I2cTiming i2c_timings[] = {
+  {100000, 50, 250 + 300, 400},  // standard_100k
+  {400000, 66, 100 + 300, 400},  // fast_400k
+  {1000000, 66, 50 + 120, 200},  // fast_plus_1m
+};
+
+// TIMINGR of a speed for the kernel clock, 0 if out of reach: the finest
+// prescaler fitting the SCL low and high counts and the data setup delay.
+// SDADEL stays 0, the hold time of the specification. The counts are rounded
+// up so the clock never exceeds the speed.
+uint32_t timing_register(uint32_t kernel_hz, const I2cTiming& timing) {
+  const uint64_t period_ps = 1000000000000ULL / timing.frequency_hz;
+  const uint64_t sync_ps = 2 * timing.edge_ns * 1000ULL;
+  const uint64_t clock_ps = 1000000000000ULL / kernel_hz;
+  for (uint32_t presc = 0; presc < 16; ++presc) {
+    const uint64_t tick_ps = clock_ps * (presc + 1);
+    const uint64_t ticks = (period_ps - sync_ps + tick_ps - 1) / tick_ps;
+    const uint64_t low = (ticks * timing.low_percent + 99) / 100;
+    const uint64_t high = ticks - low;
+    const uint64_t setup = (timing.setup_ns * 1000ULL + tick_ps - 1) / tick_ps;
+    if (low <= 256 && high >= 1 && setup <= 16) {
+      return (presc << I2C_TIMINGR_PRESC_Pos) |
+             (static_cast<uint32_t>(setup ? setup - 1 : 0) << I2C_TIMINGR_SCLDEL_Pos) |
+             (static_cast<uint32_t>(high - 1) << I2C_TIMINGR_SCLH_Pos) |
+             (static_cast<uint32_t>(low - 1) << I2C_TIMINGR_SCLL_Pos);
+    }
+  }
+  return 0;
+}
+
+bool is_pending(I2cStatus status) {
+  return status == I2cStatus::queued || status == I2cStatus::active;
+}
+} // namespace
+
+// Since init() or reset_stats(), in TimerInstant cycles
+struct I2cCounters {
+  TimerInstant window_start;
+  uint64_t busy;  // between START and STOP
+  uint64_t latency_sum;
+  uint64_t latency_max;
+  uint64_t transfer_max;
+  uint32_t transactions;
+  uint32_t nacks;
+  uint32_t errors;
+  uint32_t poll_overruns;
+};
+
+// Entry of the poll list: its read, the buffer the DMA fills, and the slot
+// the completed reads are published to
+struct I2cPollSlot {
+  I2cPollEntry entry;
+  I2cTransaction transaction;
+  uint8_t rx[I2cReading::max_bytes];
+  I2cReading latest;
+};
+
+class I2cInstanceSpecific {
+public:
+  const I2cHw* hw;
+  bool ten_bit;
+  Timer timer;
+
+  // Transactions waiting for the bus, oldest first, and the one on it
+  I2cTransaction* head;
+  I2cTransaction* tail;
+  I2cTransaction* current;
+  bool nacked;
+
+  I2cPollSlot polls[I2c::max_poll_entries];
+  size_t poll_count;
+  volatile bool polling;
+  TimerHandle_t poll_timer;
+
+  I2cCounters counters;
+};
+
+namespace {
+I2cInstanceSpecific* i2c_owner[i2c_hw_count];
+
+TimerInstant now(const I2cInstanceSpecific* hw) {
+  auto instant = hw->timer.time_now();
+  return instant ? *instant : 0;
+}
+
+uint32_t address_bits(const I2cInstanceSpecific* hw, uint16_t addr) {
+  if (hw->ten_bit) {
+    return I2C_CR2_ADD10 | ((addr << I2C_CR2_SADD_Pos) & I2C_CR2_SADD);
+  }
+  return ((addr & 0x7F) << 1) << I2C_CR2_SADD_Pos;
+}
+
+// START and the address, then the bytes of tx. With a read to follow there is
+// no STOP: TC interrupts for the repeated start.
+void start_write(I2cInstanceSpecific* hw) {
+  const I2cTransaction* t = hw->current;
+  I2C_TypeDef* i2c = hw->hw->i2c;
+  if (t->tx_len) {
+    arm_dma(hw->hw->dma, hw->hw->tx_request, true, t->tx, &i2c->TXDR, t->tx_len);
+  }
+  i2c->CR2 = address_bits(hw, t->addr) | (t->tx_len << I2C_CR2_NBYTES_Pos) |
+             (t->rx_len ? 0 : I2C_CR2_AUTOEND) | I2C_CR2_START;
+}
+
+// (Repeated) START and the address, the bytes into rx, then STOP
+void start_read(I2cInstanceSpecific* hw) {
+  const I2cTransaction* t = hw->current;
+  I2C_TypeDef* i2c = hw->hw->i2c;
+  arm_dma(hw->hw->dma, hw->hw->rx_request, false, &i2c->RXDR, t->rx, t->rx_len);
+  i2c->CR2 = address_bits(hw, t->addr) | I2C_CR2_RD_WRN | (t->rx_len << I2C_CR2_NBYTES_Pos) |
+             I2C_CR2_AUTOEND | I2C_CR2_START;
+}
+
+// Puts the oldest queued transaction on the bus. Called with the I2C and DMA
+// interrupts masked (critical section or the handlers) and the bus idle.
+void start_next(I2cInstanceSpecific* hw) {
+  I2cTransaction* t = hw->head;
+  hw->current = t;
+  if (!t) {
+    return;
+  }
+  hw->head = t->next;
+  if (!hw->head) {
+    hw->tail = nullptr;
+  }
+  t->next = nullptr;
+  t->status = I2cStatus::active;
+  t->started = now(hw);
+  hw->nacked = false;
+  if (t->tx_len || !t->rx_len) {
+    start_write(hw);
+  } else {
+    start_read(hw);
+  }
+}
+
+// Queues a transaction, and starts it if the bus is idle. False while it is
+// still pending.
+bool enqueue(I2cInstanceSpecific* hw, I2cTransaction& transaction) {
+  // Masks the I2C handlers, and is valid in an interrupt as well as in a task
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  if (is_pending(transaction.status)) {
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    return false;
+  }
+  transaction.status = I2cStatus::queued;
+  transaction.submitted = now(hw);
+  transaction.next = nullptr;
+  transaction.waiter = nullptr;
+  if (hw->tail) {
+    hw->tail->next = &transaction;
+  } else {
+    hw->head = &transaction;
+  }
+  hw->tail = &transaction;
+  if (!hw->current) {
+    start_next(hw);
+  }
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+  return true;
+}
+
+void account(I2cCounters& counters, const I2cTransaction& t, I2cStatus status) {
+  ++counters.transactions;
+  if (status == I2cStatus::nack) {
+    ++counters.nacks;
+  } else if (status == I2cStatus::failed) {
+    ++counters.errors;
+  }
+  const uint64_t transfer = t.finished - t.started;
+  const uint64_t latency = t.finished - t.submitted;
+  counters.busy += transfer;
+  counters.latency_sum += latency;
+  counters.latency_max = latency > counters.latency_max ? latency : counters.latency_max;
+  counters.transfer_max = transfer > counters.transfer_max ? transfer : counters.transfer_max;
+}
+
+void wake_waiter(I2cTransaction* t, BaseType_t* woken) {
+  auto waiter = static_cast<TaskHandle_t>(t->waiter);
+  if (waiter) {
+    t->waiter = nullptr;
+    vTaskNotifyGiveIndexedFromISR(waiter, i2c_notify_index, woken);
+  }
+}
+
+// End of the current transaction, from the handlers: the next one on the bus,
+// then the waiter and the callback of this one
+void transaction_done(I2cInstanceSpecific* hw, I2cStatus status) {
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  I2cTransaction* t = hw->current;
+  if (!t) {
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    return;
+  }
+  hw->hw->dma->CCR = DMA_CCR_RESET;
+  if (status != I2cStatus::done) {
+    // A NACKed or failed write leaves its next byte in TXDR, which the next
+    // transaction would send first: setting TXE flushes it
+    hw->hw->i2c->ISR = I2C_ISR_TXE;
+  }
+  t->finished = now(hw);
+  account(hw->counters, *t, status);
+  t->status = status;
+  start_next(hw);
+  BaseType_t woken = pdFALSE;
+  wake_waiter(t, &woken);
+  const I2cCallback callback = t->callback;
+  void* ctx = t->ctx;
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+
+  // Outside the critical section, so it can submit again
+  if (callback) {
+    callback(*t, ctx);
+  }
+  portYIELD_FROM_ISR(woken);
+}
+
+// After an error the I2C may still hold the lines: PE low for three APB
+// clocks resets it and releases them
+void reset_i2c(const I2cHw* i2c_hw) {
+  i2c_hw->dma->CCR = DMA_CCR_RESET;
+  i2c_hw->i2c->CR1 = 0;
+  (void)i2c_hw->i2c->CR1;
+  (void)i2c_hw->i2c->CR1;
+  (void)i2c_hw->i2c->CR1;
+  i2c_hw->i2c->CR1 = i2c_cr1;
+}
+
+// NACK, end of the write phase, STOP
+void handle_ev_irq(size_t index) {
+  I2C_TypeDef* i2c = i2c_hw[index].i2c;
+  const uint32_t isr = i2c->ISR;
+  // The flags are at the same position in ISR and ICR; TC clears on START
+  i2c->ICR = isr & (I2C_ICR_NACKCF | I2C_ICR_STOPCF);
+  I2cInstanceSpecific* hw = i2c_owner[index];
+  if (!hw) {
+    return;
+  }
+
+  if (isr & I2C_ISR_NACKF) {
+    // The controller sends STOP after a NACK, AUTOEND or not: STOPF ends it
+    hw->nacked = true;
+  }
+  if (isr & I2C_ISR_STOPF) {
+    // The DMA read the last byte at RXNE, a clock period before the STOP
+    transaction_done(hw, hw->nacked ? I2cStatus::nack : I2cStatus::done);
+  } else if ((isr & I2C_ISR_TC) && hw->current && !hw->nacked) {
+    start_read(hw);
+  }
+}
+
+// Bus error, arbitration lost, overrun, SCL held low
+void handle_er_irq(size_t index) {
+  I2C_TypeDef* i2c = i2c_hw[index].i2c;
+  const uint32_t isr = i2c->ISR;
+  i2c->ICR = i2c_error_clear;
+  I2cInstanceSpecific* hw = i2c_owner[index];
+  if (hw && (isr & i2c_error_flags)) {
+    reset_i2c(hw->hw);
+    transaction_done(hw, I2cStatus::failed);
+  }
+}
+
+// The channel only reports errors: the I2C interrupts end the phases
+void handle_dma_irq(size_t index) {
+  DMA_Channel_TypeDef* dma = i2c_hw[index].dma;
+  const uint32_t csr = dma->CSR;
+  dma->CFCR = dma_clear_flags;
+  I2cInstanceSpecific* hw = i2c_owner[index];
+  if (hw && (csr & dma_error_flags)) {
+    reset_i2c(hw->hw);
+    transaction_done(hw, I2cStatus::failed);
+  }
+}
+
+// Publishes a completed read of the poll list
+void poll_done(I2cTransaction& transaction, void* ctx) {
+  auto* slot = static_cast<I2cPollSlot*>(ctx);
+  if (transaction.status != I2cStatus::done) {
+    return;
+  }
+  // I2c::latest copies the slot out with the interrupts masked
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  std::memcpy(slot->latest.data, slot->rx, slot->entry.len);
+  slot->latest.timestamp = transaction.finished;
+  ++slot->latest.sequence;
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+// Timer daemon task: one read per entry, run back to back by the interrupts.
+// Queued as a whole, so stop_polling() and stop() never see a cycle halfway.
+void poll_cycle(TimerHandle_t timer) {
+  taskENTER_CRITICAL();
+  auto* hw = static_cast<I2cInstanceSpecific*>(pvTimerGetTimerID(timer));
+  if (hw && hw->polling) {
+    for (size_t i = 0; i < hw->poll_count; ++i) {
+      if (!enqueue(hw, hw->polls[i].transaction)) {
+        ++hw->counters.poll_overruns;
+      }
+    }
+  }
+  taskEXIT_CRITICAL();
+}
+
+uint32_t to_us(uint64_t cycles) {
+  const uint32_t cycles_per_us = SystemCoreClock / 1000000;
+  return static_cast<uint32_t>(cycles / (cycles_per_us ? cycles_per_us : 1));
+}
+} // namespace
+
 I2cConfig::I2cConfig(I2cId id, I2cSpeed speed, I2cAddressing addressing, uint16_t own_address)
     : m_id(id),
       m_speed(speed),
@@ -14,24 +401,336 @@ expected::expected<void, Error> I2c::start() {
   return {};
 }
 
-expected::expected<void, Error> I2c::init(const Config&) {
+expected::expected<void, Error> I2c::init(const Config& config) {
+  const auto* cfg = dynamic_cast<const I2cConfig*>(&config);
+  if (!cfg) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid i2c config"));
+  }
+
+  const I2cHw* i2c = find_hw(cfg->m_id);
+  if (!i2c) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "unsupported i2c id"));
+  }
+
+  const size_t index = static_cast<size_t>(i2c - i2c_hw);
+  if (i2c_owner[index] && i2c_owner[index] != p_instance_specific) {
+    return expected::unexpected(RU_ERROR(CommonError::busy, "i2c already in use"));
+  }
+
+  const auto speed = static_cast<size_t>(cfg->m_speed);
+  const uint32_t kernel_hz = HAL_RCCEx_GetPeriphCLKFreq(i2c->kernel_clock);
+  const uint32_t timing = speed < sizeof(i2c_timings) / sizeof(i2c_timings[0]) && kernel_hz
+                              ? timing_register(kernel_hz, i2c_timings[speed])
+                              : 0;
+  if (!timing) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "unsupported i2c speed"));
+  }
+
+  if (p_instance_specific) {
+    (void)stop();
+  }
+  auto started = Timer::start();
+  if (!started) {
+    return started;
+  }
+
+  auto* hw = new I2cInstanceSpecific();
+  hw->hw = i2c;
+  hw->ten_bit = cfg->m_addressing == I2cAddressing::addr_10bit;
+  hw->head = nullptr;
+  hw->tail = nullptr;
+  hw->current = nullptr;
+  hw->poll_count = 0;
+  hw->polling = false;
+  hw->poll_timer = xTimerCreate("i2c_poll", 1, pdTRUE, hw, poll_cycle);
+  if (!hw->poll_timer) {
+    delete hw;
+    return expected::unexpected(RU_ERROR(CommonError::general_error, "i2c poll timer"));
+  }
+  p_instance_specific = hw;
+  (void)reset_stats();
+
+  RCC->AHB1ENR |= RCC_AHB1ENR_GPDMA1EN;
+  *i2c->enable_reg |= i2c->enable_bit;
+  (void)*i2c->enable_reg;
+
+  // SCL timeout in units of 2048 kernel clocks
+  uint32_t timeout = static_cast<uint32_t>(static_cast<uint64_t>(kernel_hz) * scl_timeout_us /
+                                           1000000 / 2048);
+  timeout = timeout < 1 ? 1 : timeout > 4096 ? 4096 : timeout;
+  i2c->i2c->CR1 = 0;
+  i2c->i2c->TIMINGR = timing;
+  i2c->i2c->TIMEOUTR = I2C_TIMEOUTR_TIMOUTEN | ((timeout - 1) << I2C_TIMEOUTR_TIMEOUTA_Pos);
+  i2c->i2c->ICR = i2c_error_clear | I2C_ICR_NACKCF | I2C_ICR_STOPCF;
+  i2c->i2c->CR1 = i2c_cr1;
+
+  i2c->dma->CCR = DMA_CCR_RESET;
+  i2c_owner[index] = hw;
+
+  NVIC_SetPriority(i2c->ev_irq, i2c->irq_priority);
+  NVIC_SetPriority(i2c->er_irq, i2c->irq_priority);
+  NVIC_SetPriority(i2c->dma_irq, i2c->irq_priority);
+  NVIC_EnableIRQ(i2c->ev_irq);
+  NVIC_EnableIRQ(i2c->er_irq);
+  NVIC_EnableIRQ(i2c->dma_irq);
+
   return {};
 }
 
 expected::expected<void, Error> I2c::stop() {
+  auto* hw = p_instance_specific;
+  if (hw) {
+    (void)stop_polling();
+    // A cycle still due finds no bus
+    vTimerSetTimerID(hw->poll_timer, nullptr);
+    (void)xTimerDelete(hw->poll_timer, portMAX_DELAY);
+
+    const I2cHw* i2c = hw->hw;
+    NVIC_DisableIRQ(i2c->ev_irq);
+    NVIC_DisableIRQ(i2c->er_irq);
+    NVIC_DisableIRQ(i2c->dma_irq);
+    taskENTER_CRITICAL();
+    if (hw->current) {
+      hw->current->next = hw->head;
+      hw->head = hw->current;
+      hw->current = nullptr;
+    }
+    i2c_owner[i2c - i2c_hw] = nullptr;
+    taskEXIT_CRITICAL();
+    NVIC_ClearPendingIRQ(i2c->ev_irq);
+    NVIC_ClearPendingIRQ(i2c->er_irq);
+    NVIC_ClearPendingIRQ(i2c->dma_irq);
+    i2c->dma->CCR = DMA_CCR_RESET;
+    i2c->i2c->CR1 = 0;
+
+    for (I2cTransaction* t = hw->head; t;) {
+      I2cTransaction* next = t->next;
+      t->next = nullptr;
+      t->status = I2cStatus::failed;
+      if (t->waiter) {
+        xTaskNotifyGiveIndexed(static_cast<TaskHandle_t>(t->waiter), i2c_notify_index);
+        t->waiter = nullptr;
+      }
+      t = next;
+    }
+  }
+  delete hw;
+  p_instance_specific = nullptr;
   return {};
 }
 
-expected::expected<void, Error> I2c::write(uint16_t, const uint8_t*, size_t) {
+expected::expected<void, Error> I2c::submit(I2cTransaction& transaction) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "i2c not initialized"));
+  }
+  if (transaction.addr > (hw->ten_bit ? 0x3FF : 0x7F)) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid i2c address"));
+  }
+  if (transaction.tx_len > max_bytes || transaction.rx_len > max_bytes ||
+      (transaction.tx_len && !transaction.tx) || (transaction.rx_len && !transaction.rx)) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid i2c buffer"));
+  }
+  if (!enqueue(hw, transaction)) {
+    return expected::unexpected(RU_ERROR(CommonError::busy, "i2c transaction pending"));
+  }
   return {};
 }
 
-expected::expected<void, Error> I2c::read(uint16_t, uint8_t*, size_t) {
+expected::expected<void, Error> I2c::wait(I2cTransaction& transaction, uint32_t timeout_ms) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "i2c not initialized"));
+  }
+
+  const TickType_t start = xTaskGetTickCount();
+  const TickType_t timeout = to_ticks(timeout_ms);
+  for (;;) {
+    taskENTER_CRITICAL();
+    const bool pending = is_pending(transaction.status);
+    if (pending) {
+      transaction.waiter = xTaskGetCurrentTaskHandle();
+    }
+    taskEXIT_CRITICAL();
+    if (!pending) {
+      break;
+    }
+
+    const TickType_t left = ticks_left(start, timeout);
+    if (!left) {
+      taskENTER_CRITICAL();
+      transaction.waiter = nullptr;
+      taskEXIT_CRITICAL();
+      return expected::unexpected(RU_ERROR(I2cError::timeout, "i2c transaction timeout"));
+    }
+    ulTaskNotifyTakeIndexed(i2c_notify_index, pdTRUE, left);
+  }
+
+  if (transaction.status == I2cStatus::nack) {
+    return expected::unexpected(RU_ERROR(I2cError::nack, "i2c transaction not acknowledged"));
+  }
+  if (transaction.status == I2cStatus::failed) {
+    return expected::unexpected(RU_ERROR(I2cError::bus_error, "i2c transaction failed"));
+  }
   return {};
 }
 
-expected::expected<void, Error> I2c::write_read(uint16_t, const uint8_t*, size_t, uint8_t*, size_t) {
+expected::expected<void, Error> I2c::write(uint16_t addr, const uint8_t* data, size_t len) {
+  return write_read(addr, data, len, nullptr, 0);
+}
+
+expected::expected<void, Error> I2c::read(uint16_t addr, uint8_t* data, size_t len) {
+  if (!len) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid i2c length"));
+  }
+  return write_read(addr, nullptr, 0, data, len);
+}
+
+expected::expected<void, Error> I2c::write_read(uint16_t addr, const uint8_t* tx, size_t tx_len,
+                                                uint8_t* rx, size_t rx_len) {
+  if (tx_len > max_bytes || rx_len > max_bytes) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid i2c length"));
+  }
+  I2cTransaction transaction{};
+  transaction.addr = addr;
+  transaction.tx = tx;
+  transaction.tx_len = static_cast<uint16_t>(tx_len);
+  transaction.rx = rx;
+  transaction.rx_len = static_cast<uint16_t>(rx_len);
+  auto queued = submit(transaction);
+  if (!queued) {
+    return queued;
+  }
+  // Never completes late: the transaction is on this stack
+  return wait(transaction, wait_forever);
+}
+
+expected::expected<void, Error> I2c::start_polling(std::span<const I2cPollEntry> entries,
+                                                   uint32_t period_ms) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "i2c not initialized"));
+  }
+  const TickType_t period = pdMS_TO_TICKS(period_ms);
+  if (entries.empty() || entries.size() > max_poll_entries || !period) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid i2c poll list"));
+  }
+  for (const I2cPollEntry& entry : entries) {
+    if (!entry.len || entry.len > I2cReading::max_bytes ||
+        entry.addr > (hw->ten_bit ? 0x3FF : 0x7F)) {
+      return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid i2c poll entry"));
+    }
+  }
+
+  auto stopped = stop_polling();
+  if (!stopped) {
+    return stopped;
+  }
+  for (size_t i = 0; i < entries.size(); ++i) {
+    I2cPollSlot& slot = hw->polls[i];
+    slot.entry = entries[i];
+    slot.transaction = {};
+    slot.transaction.addr = slot.entry.addr;
+    slot.transaction.tx = &slot.entry.reg;
+    slot.transaction.tx_len = 1;
+    slot.transaction.rx = slot.rx;
+    slot.transaction.rx_len = slot.entry.len;
+    slot.transaction.callback = poll_done;
+    slot.transaction.ctx = &slot;
+    slot.latest = {};
+  }
+  hw->poll_count = entries.size();
+  hw->polling = true;
+  // Also starts the timer
+  if (xTimerChangePeriod(hw->poll_timer, period, portMAX_DELAY) != pdPASS) {
+    hw->polling = false;
+    return expected::unexpected(RU_ERROR(CommonError::general_error, "i2c poll timer"));
+  }
+  return {};
+}
+
+expected::expected<void, Error> I2c::stop_polling() {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "i2c not initialized"));
+  }
+  taskENTER_CRITICAL();
+  hw->polling = false;
+  taskEXIT_CRITICAL();
+  (void)xTimerStop(hw->poll_timer, portMAX_DELAY);
+
+  // The slots belong to the bus until their reads are over
+  for (size_t i = 0; i < hw->poll_count; ++i) {
+    auto done = wait(hw->polls[i].transaction, poll_stop_timeout_ms);
+    if (!done && std::holds_alternative<I2cError>(done.error().code) &&
+        std::get<I2cError>(done.error().code) == I2cError::timeout) {
+      return done;
+    }
+  }
+  return {};
+}
+
+expected::expected<I2cReading, Error> I2c::latest(size_t index) const {
+  const auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "i2c not initialized"));
+  }
+  if (index >= hw->poll_count) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "unknown i2c poll entry"));
+  }
+  taskENTER_CRITICAL();
+  const I2cReading reading = hw->polls[index].latest;
+  taskEXIT_CRITICAL();
+  return reading;
+}
+
+expected::expected<I2cStats, Error> I2c::stats() const {
+  const auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "i2c not initialized"));
+  }
+  const TimerInstant end = now(hw);
+  taskENTER_CRITICAL();
+  const I2cCounters copy = hw->counters;
+  taskEXIT_CRITICAL();
+
+  I2cStats stats{};
+  stats.transactions = copy.transactions;
+  stats.nacks = copy.nacks;
+  stats.errors = copy.errors;
+  stats.poll_overruns = copy.poll_overruns;
+  const TimerInstant window = end - copy.window_start;
+  stats.utilisation = window ? static_cast<float>(copy.busy) / static_cast<float>(window) : 0;
+  stats.latency_avg_us = copy.transactions ? to_us(copy.latency_sum / copy.transactions) : 0;
+  stats.latency_max_us = to_us(copy.latency_max);
+  stats.transfer_max_us = to_us(copy.transfer_max);
+  return stats;
+}
+
+expected::expected<void, Error> I2c::reset_stats() {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "i2c not initialized"));
+  }
+  const TimerInstant start = now(hw);
+  taskENTER_CRITICAL();
+  hw->counters = {};
+  hw->counters.window_start = start;
+  taskEXIT_CRITICAL();
   return {};
 }
 
 } // namespace ru::driver
+
+#define X_i2c_instance(index, id, periph, bus, channel, irq_priority) \
+  extern "C" void periph##_EV_IRQHandler(void) {                      \
+    ru::driver::handle_ev_irq(index);                                 \
+  }                                                                   \
+  extern "C" void periph##_ER_IRQHandler(void) {                      \
+    ru::driver::handle_er_irq(index);                                 \
+  }                                                                   \
+  extern "C" void GPDMA1_Channel##channel##_IRQHandler(void) {        \
+    ru::driver::handle_dma_irq(index);                                \
+  }
+#include "i2c_instances.hpp"
+#undef X_i2c_instance
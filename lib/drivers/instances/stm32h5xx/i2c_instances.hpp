@@ -0,0 +1,15 @@
+// I2C controllers of the board, generated by generate.py from the 'i2c' module of
+// config.yaml. Do not edit, regenerate instead.
+//
+// X_i2c_instance(index, id, periph, bus, channel, irq_priority)
+// - id:           I2cId bound to the controller
+// - periph:       I2C instance
+// - bus:          peripheral bus of the I2C clock enable (APB1L or APB3)
+// - channel:      GPDMA1 channel of the transfers, both directions
+// - irq_priority: NVIC priority of the I2C event, error and DMA handlers
+
+#ifndef X_i2c_instance
+#define X_i2c_instance(index, id, periph, bus, channel, irq_priority)
+#endif
+
+X_i2c_instance(0, sensor_i2c, I2C1, APB1L, 7, 6)
\ No newline at end of file
@@ -0,0 +1,866 @@
+#include "FreeRTOS.h"
+#include "stm32h5xx_hal.h"
+#include "task.h"
+
+#include "dma_helpers.hpp"
+#include "i3c.hpp"
+
+namespace ru::driver {
+
+namespace {
+// Task notification slot used to wake a task blocked in I3c::wait or
+// I3c::wait_ibi (slot 0 is left to the application)
+const UBaseType_t i3c_notify_index = 1;
+
+// Message types of the control words
+const uint32_t mtype_private = 2;
+const uint32_t mtype_direct = 3;
+const uint32_t mtype_legacy_i2c = 4;
+const uint32_t mtype_ccc = 6;
+
+// Frame ends, errors, in-band interrupts and hot-joins interrupt; the control
+// FIFO and the address assignment steps only while a frame needs them
+const uint32_t i3c_ier = I3C_IER_FCIE | I3C_IER_RXTGTENDIE | I3C_IER_ERRIE | I3C_IER_IBIIE |
+                         I3C_IER_HJIE;
+
+// Devices whose IBIs the controller acknowledges: DEVR1 to DEVR4
+const size_t ibi_slots = 4;
+
+struct I3cHw {
+  I3cId id;
+  I3C_TypeDef* i3c;
+  volatile uint32_t* enable_reg;
+  uint32_t enable_bit;
+  uint64_t kernel_clock;
+  DMA_Channel_TypeDef* rx_dma;
+  IRQn_Type rx_dma_irq;
+  DMA_Channel_TypeDef* tx_dma;
+  IRQn_Type tx_dma_irq;
+  uint32_t rx_request;
+  uint32_t tx_request;
+  IRQn_Type ev_irq;
+  IRQn_Type er_irq;
+  uint32_t irq_priority;
+};
+
+// Controllers generated from config.yaml, closed by an invalid entry so the
+// table is never empty. GPDMA2 has the same request lines as GPDMA1.
+#define X_i3c_instance(index, id, periph, bus, rx_channel, tx_channel, irq_priority)          \
+  {I3cId::id, periph, &RCC->bus##ENR, RCC_##bus##ENR_##periph##EN, RCC_PERIPHCLK_##periph,     \
+   GPDMA2_Channel##rx_channel, GPDMA2_Channel##rx_channel##_IRQn, GPDMA2_Channel##tx_channel, \
+   GPDMA2_Channel##tx_channel##_IRQn, GPDMA1_REQUEST_##periph##_RX,                           \
+   GPDMA1_REQUEST_##periph##_TX, periph##_EV_IRQn, periph##_ER_IRQn, irq_priority},
+const I3cHw i3c_hw[] = {
+#include "i3c_instances.hpp"
+  {},  // I3cId::invalid
+};
+#undef X_i3c_instance
+
+const size_t i3c_hw_count = sizeof(i3c_hw) / sizeof(i3c_hw[0]) - 1;
+
+const I3cHw* find_hw(I3cId id) {
+  for (size_t i = 0; i < i3c_hw_count; ++i) {
+    if (i3c_hw[i].id == id) {
+      return &i3c_hw[i];
+    }
+  }
+  return nullptr;
+}
+
+// What the legacy I2C devices need of SCL, in ns: low and high at their
+// speed, and the bus free time between a STOP and the next START
+struct I3cLegacyTiming {
+  uint32_t frequency_hz;
+  uint32_t low_ns;
+  uint32_t high_ns;
+  uint32_t bus_free_ns;
+};
+
+const I3cLegacyTiming legacy_timings[] = {
+  {100000, 4700, 4000, 4700},  // standard_100k
+  {400000, 1300, 600, 1300},   // fast_400k
+  {1000000, 500, 260, 500},    // fast_plus_1m
+};
+
+// SCL high of the I3C phases, push-pull and open-drain alike: short enough
+// for the 50 ns spike filter of the I2C devices to ignore it
+const uint32_t i3c_high_max_ns = 40;
+// SCL low of the open-drain I3C phases, at least
+const uint32_t i3c_od_low_ns = 200;
+// Bus available condition, before a target may start an IBI
+const uint32_t bus_available_ns = 1000;
+
+uint32_t clocks(uint32_t kernel_hz, uint32_t ns) {
+  return static_cast<uint32_t>((static_cast<uint64_t>(kernel_hz) * ns + 999999999) / 1000000000);
+}
+
+// TIMINGR0 and TIMINGR1 for the kernel clock, false if out of reach. The
+// push-pull period is split with at most i3c_high_max_ns high; the open-drain
+// low serves the I3C address phases and the I2C messages alike, so it takes
+// the longer of the two. Counts are rounded so the clock never exceeds a rate.
+bool timing_registers(uint32_t kernel_hz, uint32_t sdr_hz, const I3cLegacyTiming& legacy,
+                      uint32_t& timingr0, uint32_t& timingr1) {
+  if (!kernel_hz || !sdr_hz || sdr_hz > kernel_hz / 2) {
+    return false;
+  }
+  const uint32_t pp_period = (kernel_hz + sdr_hz - 1) / sdr_hz;
+  const uint32_t high_max = static_cast<uint32_t>(static_cast<uint64_t>(kernel_hz) *
+                                                  i3c_high_max_ns / 1000000000);
+  const uint32_t pp_high = pp_period / 2 < high_max ? pp_period / 2 : high_max;
+  const uint32_t pp_low = pp_period - pp_high;
+
+  const uint32_t od_low = clocks(kernel_hz, legacy.low_ns > i3c_od_low_ns ? legacy.low_ns
+                                                                          : i3c_od_low_ns);
+  const uint32_t i2c_period = (kernel_hz + legacy.frequency_hz - 1) / legacy.frequency_hz;
+  const uint32_t i2c_high_min = clocks(kernel_hz, legacy.high_ns);
+  const uint32_t i2c_high =
+      i2c_period > od_low + i2c_high_min ? i2c_period - od_low : i2c_high_min;
+
+  const uint32_t aval = clocks(kernel_hz, bus_available_ns);
+  const uint32_t free = clocks(kernel_hz, legacy.bus_free_ns);
+  if (!pp_high || pp_low > 256 || od_low > 256 || i2c_high > 256 || aval > 256 || free > 128) {
+    return false;
+  }
+  timingr0 = ((pp_low - 1) << I3C_TIMINGR0_SCLL_PP_Pos) |
+             ((pp_high - 1) << I3C_TIMINGR0_SCLH_I3C_Pos) |
+             ((od_low - 1) << I3C_TIMINGR0_SCLL_OD_Pos) |
+             ((i2c_high - 1) << I3C_TIMINGR0_SCLH_I2C_Pos);
+  timingr1 = ((aval - 1) << I3C_TIMINGR1_AVAL_Pos) | ((free - 1) << I3C_TIMINGR1_FREE_Pos);
+  return true;
+}
+
+bool is_pending(I3cStatus status) {
+  return status == I3cStatus::queued || status == I3cStatus::active;
+}
+
+uint32_t control_word(const I3cMessage& m) {
+  const uint32_t len = static_cast<uint32_t>(m.len) << I3C_CR_DCNT_Pos;
+  const uint32_t address = static_cast<uint32_t>(m.address) << I3C_CR_ADD_Pos;
+  const uint32_t read = m.read ? I3C_CR_RNW : 0;
+  switch (m.type) {
+  case I3cMessageType::ccc:
+    return (mtype_ccc << I3C_CR_MTYPE_Pos) | (static_cast<uint32_t>(m.ccc) << I3C_CR_CCC_Pos) |
+           len;
+  case I3cMessageType::direct:
+    return (mtype_direct << I3C_CR_MTYPE_Pos) | address | read | len;
+  case I3cMessageType::legacy_i2c:
+    return (mtype_legacy_i2c << I3C_CR_MTYPE_Pos) | address | read | len;
+  case I3cMessageType::private_transfer:
+  default:
+    return (mtype_private << I3C_CR_MTYPE_Pos) | address | read | len;
+  }
+}
+} // namespace
+
+// The peripheral behind the protocol. Every call runs with the I3C and DMA
+// interrupts masked: a critical section or the handlers.
+class I3cInstanceSpecific final : public I3cPort {
+public:
+  const I3cHw* hw;
+  Timer timer;
+  I3cProtocol protocol;
+
+  // Control words of the frame on the bus, fed to the control FIFO as it
+  // frees up; the read buffer of the frame
+  uint32_t control[2];
+  size_t control_count;
+  size_t control_next;
+  bool daa;
+  size_t rx_len;
+
+  uint8_t ibi_address[ibi_slots];  // DEVR1-4, 0 if free
+  volatile TaskHandle_t ibi_owner[I3c::max_devices];
+
+  explicit I3cInstanceSpecific(const I3cHw* i3c_hw)
+      : hw(i3c_hw),
+        protocol(*this),
+        control(),
+        control_count(0),
+        control_next(0),
+        daa(false),
+        rx_len(0),
+        ibi_address(),
+        ibi_owner() {}
+
+  void start_frame(const I3cMessage* messages, size_t count, const uint8_t* tx, size_t tx_len,
+                   uint8_t* rx, size_t rx_bytes) override {
+    I3C_TypeDef* i3c = hw->i3c;
+    daa = false;
+    rx_len = rx_bytes;
+    if (rx_bytes) {
+      arm_dma(hw->rx_dma, hw->rx_request, false, &i3c->RDR, rx, rx_bytes);
+    }
+    if (tx_len) {
+      arm_dma(hw->tx_dma, hw->tx_request, true, tx, &i3c->TDR, tx_len);
+    }
+    control_count = count < 2 ? count : 2;
+    for (size_t i = 0; i < control_count; ++i) {
+      control[i] = control_word(messages[i]) | (i + 1 == control_count ? I3C_CR_MEND : 0);
+    }
+    control_next = 0;
+    push_control();
+  }
+
+  // ENTDAA; each target's payload then shows up as TXFNF
+  void start_daa() override {
+    daa = true;
+    rx_len = 0;
+    control[0] = (mtype_ccc << I3C_CR_MTYPE_Pos) |
+                 (static_cast<uint32_t>(i3c_ccc::entdaa) << I3C_CR_CCC_Pos) | I3C_CR_MEND;
+    control_count = 1;
+    control_next = 0;
+    hw->i3c->IER |= I3C_IER_TXFNFIE;
+    push_control();
+  }
+
+  bool set_ibi(uint8_t address, bool accept, bool payload) override {
+    size_t slot = ibi_slots;
+    for (size_t i = 0; i < ibi_slots; ++i) {
+      if (ibi_address[i] == address) {
+        slot = i;
+        break;
+      }
+      if (!ibi_address[i] && slot == ibi_slots) {
+        slot = i;
+      }
+    }
+    if (slot == ibi_slots) {
+      return !accept;
+    }
+    ibi_address[slot] = accept ? address : 0;
+    hw->i3c->DEVRX[slot] = accept ? (static_cast<uint32_t>(address) << I3C_DEVR_DA_Pos) |
+                                        I3C_DEVR_IBIACK | (payload ? I3C_DEVR_IBIDEN : 0)
+                                  : 0;
+    return true;
+  }
+
+  void push_control() {
+    I3C_TypeDef* i3c = hw->i3c;
+    while (control_next < control_count && (i3c->EVR & I3C_EVR_CFNFF)) {
+      i3c->CR = control[control_next++];
+    }
+    if (control_next < control_count) {
+      i3c->IER |= I3C_IER_CFNFIE;
+    } else {
+      i3c->IER &= ~I3C_IER_CFNFIE;
+    }
+  }
+
+  // Bytes of the read the DMA stored: a target may end it early
+  size_t received() const {
+    return rx_len ? rx_len - (hw->rx_dma->CBR1 & DMA_CBR1_BNDT) : 0;
+  }
+
+  void stop_dma() {
+    hw->rx_dma->CCR = DMA_CCR_RESET;
+    hw->tx_dma->CCR = DMA_CCR_RESET;
+  }
+};
+
+namespace {
+I3cInstanceSpecific* i3c_owner[i3c_hw_count];
+
+TimerInstant now(const I3cInstanceSpecific* hw) {
+  auto instant = hw->timer.time_now();
+  return instant ? *instant : 0;
+}
+
+void wake_waiter(I3cTransaction* t, BaseType_t* woken) {
+  auto waiter = static_cast<TaskHandle_t>(t->waiter);
+  if (waiter) {
+    t->waiter = nullptr;
+    vTaskNotifyGiveIndexedFromISR(waiter, i3c_notify_index, woken);
+  }
+}
+
+// End of the frame on the bus, from the handlers: the protocol starts the
+// next one, then the waiters and the callbacks of the finished transactions
+void frame_done(I3cInstanceSpecific* hw, I3cFrameOutcome outcome) {
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  hw->hw->i3c->IER &= ~(I3C_IER_CFNFIE | I3C_IER_TXFNFIE);
+  const size_t rx_count = hw->received();
+  hw->stop_dma();
+  I3cTransaction* done = hw->protocol.frame_done(outcome, rx_count);
+  BaseType_t woken = pdFALSE;
+  for (I3cTransaction* t = done; t; t = t->next) {
+    wake_waiter(t, &woken);
+  }
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+
+  // Outside the critical section, so they can submit again; next is read
+  // first, as a callback may queue its transaction anew
+  while (done) {
+    I3cTransaction* next = done->next;
+    if (done->callback) {
+      done->callback(*done, done->ctx);
+    }
+    done = next;
+  }
+  portYIELD_FROM_ISR(woken);
+}
+
+// The flushes and the DMA stop leave the controller ready for the next frame
+void abort_frame(I3cInstanceSpecific* hw) {
+  hw->stop_dma();
+  hw->hw->i3c->CFGR |= I3C_CFGR_TXFLUSH | I3C_CFGR_RXFLUSH | I3C_CFGR_CFLUSH;
+}
+
+void handle_ibi(I3cInstanceSpecific* hw, BaseType_t* woken) {
+  I3C_TypeDef* i3c = hw->hw->i3c;
+  const uint32_t rmr = i3c->RMR;
+  const uint32_t data = i3c->IBIDR;
+  i3c->CEVR = I3C_CEVR_CIBIF;
+  const uint8_t payload[I3cIbi::max_payload] = {
+    static_cast<uint8_t>(data), static_cast<uint8_t>(data >> 8),
+    static_cast<uint8_t>(data >> 16), static_cast<uint8_t>(data >> 24)};
+  const auto address = static_cast<uint8_t>(rmr >> I3C_RMR_RADD_Pos);
+  const I3cDevice device = hw->protocol.ibi(address, payload, rmr & I3C_RMR_IBIRDCNT, now(hw));
+  if (device < I3c::max_devices && hw->ibi_owner[device]) {
+    vTaskNotifyGiveIndexedFromISR(hw->ibi_owner[device], i3c_notify_index, woken);
+  }
+}
+
+// A target of the address assignment: its 48-bit PID, BCR and DCR, first
+// byte on the bus in the low bits of the first word; its address in answer
+void handle_daa(I3cInstanceSpecific* hw) {
+  I3C_TypeDef* i3c = hw->hw->i3c;
+  const uint32_t low = i3c->RDWR;
+  const uint32_t high = i3c->RDWR;
+  uint8_t bytes[8];
+  for (size_t i = 0; i < 4; ++i) {
+    bytes[i] = static_cast<uint8_t>(low >> (8 * i));
+    bytes[4 + i] = static_cast<uint8_t>(high >> (8 * i));
+  }
+  uint64_t pid = 0;
+  for (size_t i = 0; i < 6; ++i) {
+    pid = pid << 8 | bytes[i];
+  }
+  // 0 leaves the target without: the controller NACKs it and ends the frame
+  i3c->TDR = hw->protocol.daa_payload(pid, bytes[6], bytes[7]);
+}
+
+// Control FIFO, address assignment, IBI, hot-join, end of frame
+void handle_ev_irq(size_t index) {
+  I3C_TypeDef* i3c = i3c_hw[index].i3c;
+  const uint32_t evr = i3c->EVR;
+  const uint32_t ier = i3c->IER;
+  I3cInstanceSpecific* hw = i3c_owner[index];
+  if (!hw) {
+    i3c->CEVR = I3C_CEVR_CFCF | I3C_CEVR_CRXTGTENDF | I3C_CEVR_CIBIF | I3C_CEVR_CHJF;
+    return;
+  }
+
+  BaseType_t woken = pdFALSE;
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  if ((evr & I3C_EVR_CFNFF) && (ier & I3C_IER_CFNFIE)) {
+    hw->push_control();
+  }
+  if ((evr & I3C_EVR_TXFNFF) && (ier & I3C_IER_TXFNFIE) && hw->daa) {
+    handle_daa(hw);
+  }
+  if (evr & I3C_EVR_IBIF) {
+    handle_ibi(hw, &woken);
+  }
+  if (evr & I3C_EVR_HJF) {
+    i3c->CEVR = I3C_CEVR_CHJF;
+    hw->protocol.hot_join();
+  }
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+
+  // A read ended by the target ends the frame as well
+  if (evr & (I3C_EVR_FCF | I3C_EVR_RXTGTENDF)) {
+    i3c->CEVR = evr & (I3C_CEVR_CFCF | I3C_CEVR_CRXTGTENDF);
+    frame_done(hw, I3cFrameOutcome::done);
+  }
+  portYIELD_FROM_ISR(woken);
+}
+
+// Address NACKed, protocol or data errors: the frame is aborted
+void handle_er_irq(size_t index) {
+  I3C_TypeDef* i3c = i3c_hw[index].i3c;
+  const uint32_t evr = i3c->EVR;
+  const uint32_t ser = i3c->SER;
+  i3c->CEVR = I3C_CEVR_CERRF;
+  I3cInstanceSpecific* hw = i3c_owner[index];
+  if (hw && (evr & I3C_EVR_ERRF)) {
+    abort_frame(hw);
+    frame_done(hw, ser & (I3C_SER_ANACK | I3C_SER_DNACK) ? I3cFrameOutcome::nack
+                                                         : I3cFrameOutcome::error);
+  }
+}
+
+// The channels only report errors: the I3C interrupts end the frames
+void handle_dma_irq(size_t index, bool rx) {
+  DMA_Channel_TypeDef* dma = rx ? i3c_hw[index].rx_dma : i3c_hw[index].tx_dma;
+  const uint32_t csr = dma->CSR;
+  dma->CFCR = dma_clear_flags;
+  I3cInstanceSpecific* hw = i3c_owner[index];
+  if (hw && (csr & dma_error_flags)) {
+    abort_frame(hw);
+    frame_done(hw, I3cFrameOutcome::error);
+  }
+}
+
+} // namespace
+
+I3cConfig::I3cConfig(I3cId id, uint32_t sdr_hz, I2cSpeed i2c_speed)
+    : m_id(id),
+      m_sdr_hz(sdr_hz),
+      m_i2c_speed(i2c_speed) {}
+
+I3c::I3c() : p_instance_specific(nullptr) {}
+
+expected::expected<void, Error> I3c::start() {
+  return {};
+}
+
+expected::expected<void, Error> I3c::init(const Config& config) {
+  const auto* cfg = dynamic_cast<const I3cConfig*>(&config);
+  if (!cfg) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid i3c config"));
+  }
+
+  const I3cHw* i3c = find_hw(cfg->m_id);
+  if (!i3c) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "unsupported i3c id"));
+  }
+
+  const size_t index = static_cast<size_t>(i3c - i3c_hw);
+  if (i3c_owner[index] && i3c_owner[index] != p_instance_specific) {
+    return expected::unexpected(RU_ERROR(CommonError::busy, "i3c already in use"));
+  }
+
+  const auto speed = static_cast<size_t>(cfg->m_i2c_speed);
+  const uint32_t kernel_hz = HAL_RCCEx_GetPeriphCLKFreq(i3c->kernel_clock);
+  uint32_t timingr0 = 0;
+  uint32_t timingr1 = 0;
+  if (speed >= sizeof(legacy_timings) / sizeof(legacy_timings[0]) ||
+      !timing_registers(kernel_hz, cfg->m_sdr_hz, legacy_timings[speed], timingr0, timingr1)) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "unsupported i3c speed"));
+  }
+
+  if (p_instance_specific) {
+    (void)stop();
+  }
+  auto started = Timer::start();
+  if (!started) {
+    return started;
+  }
+
+  auto* hw = new I3cInstanceSpecific(i3c);
+  p_instance_specific = hw;
+
+  RCC->AHB1ENR |= RCC_AHB1ENR_GPDMA2EN;
+  *i3c->enable_reg |= i3c->enable_bit;
+  (void)*i3c->enable_reg;
+
+  // Controller, hot-joins NACKed, the arbitrable header before each private
+  // transfer so targets can raise IBIs; the IBI payload is up to IBIDR
+  I3C_TypeDef* regs = i3c->i3c;
+  regs->CFGR = 0;
+  regs->TIMINGR0 = timingr0;
+  regs->TIMINGR1 = timingr1;
+  regs->MAXRLR = I3cIbi::max_payload << I3C_MAXRLR_IBIP_Pos;
+  for (size_t i = 0; i < ibi_slots; ++i) {
+    regs->DEVRX[i] = 0;
+  }
+  regs->CEVR = I3C_CEVR_CFCF | I3C_CEVR_CRXTGTENDF | I3C_CEVR_CERRF | I3C_CEVR_CIBIF |
+               I3C_CEVR_CHJF;
+  regs->CFGR = I3C_CFGR_CRINIT | I3C_CFGR_RXDMAEN | I3C_CFGR_TXDMAEN | I3C_CFGR_EN;
+  regs->IER = i3c_ier;
+
+  i3c->rx_dma->CCR = DMA_CCR_RESET;
+  i3c->tx_dma->CCR = DMA_CCR_RESET;
+  i3c_owner[index] = hw;
+
+  NVIC_SetPriority(i3c->ev_irq, i3c->irq_priority);
+  NVIC_SetPriority(i3c->er_irq, i3c->irq_priority);
+  NVIC_SetPriority(i3c->rx_dma_irq, i3c->irq_priority);
+  NVIC_SetPriority(i3c->tx_dma_irq, i3c->irq_priority);
+  NVIC_EnableIRQ(i3c->ev_irq);
+  NVIC_EnableIRQ(i3c->er_irq);
+  NVIC_EnableIRQ(i3c->rx_dma_irq);
+  NVIC_EnableIRQ(i3c->tx_dma_irq);
+
+  return {};
+}
+
+expected::expected<void, Error> I3c::stop() {
+  auto* hw = p_instance_specific;
+  if (hw) {
+    const I3cHw* i3c = hw->hw;
+    NVIC_DisableIRQ(i3c->ev_irq);
+    NVIC_DisableIRQ(i3c->er_irq);
+    NVIC_DisableIRQ(i3c->rx_dma_irq);
+    NVIC_DisableIRQ(i3c->tx_dma_irq);
+    taskENTER_CRITICAL();
+    i3c_owner[i3c - i3c_hw] = nullptr;
+    // Tasks in wait_ibi() look the instance up under the critical section:
+    // once woken below they see it gone, never the memory deleted at the end
+    p_instance_specific = nullptr;
+    abort_frame(hw);
+    // The queued ones first, so the frame on the bus starts none of them
+    I3cTransaction* queued = hw->protocol.flush();
+    I3cTransaction* current = hw->protocol.frame_done(I3cFrameOutcome::error, 0);
+    TaskHandle_t ibi_owners[max_devices];
+    for (size_t i = 0; i < max_devices; ++i) {
+      ibi_owners[i] = hw->ibi_owner[i];
+    }
+    taskEXIT_CRITICAL();
+    NVIC_ClearPendingIRQ(i3c->ev_irq);
+    NVIC_ClearPendingIRQ(i3c->er_irq);
+    NVIC_ClearPendingIRQ(i3c->rx_dma_irq);
+    NVIC_ClearPendingIRQ(i3c->tx_dma_irq);
+    i3c->i3c->IER = 0;
+    i3c->i3c->CFGR = 0;
+
+    for (I3cTransaction* list : {current, queued}) {
+      for (I3cTransaction* t = list; t;) {
+        I3cTransaction* next = t->next;
+        t->next = nullptr;
+        t->status = I3cStatus::failed;
+        if (t->waiter) {
+          xTaskNotifyGiveIndexed(static_cast<TaskHandle_t>(t->waiter), i3c_notify_index);
+          t->waiter = nullptr;
+        }
+        t = next;
+      }
+    }
+    for (TaskHandle_t owner : ibi_owners) {
+      if (owner) {
+        xTaskNotifyGiveIndexed(owner, i3c_notify_index);
+      }
+    }
+  }
+  delete hw;
+  p_instance_specific = nullptr;
+  return {};
+}
+
+expected::expected<I3cDevice, Error> I3c::add_device(uint64_t pid, uint8_t dynamic_address) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "i3c not initialized"));
+  }
+  taskENTER_CRITICAL();
+  const I3cDevice device = hw->protocol.add_device(pid, dynamic_address);
+  taskEXIT_CRITICAL();
+  if (device == max_devices) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid i3c device"));
+  }
+  return device;
+}
+
+expected::expected<I3cDevice, Error> I3c::add_i2c_device(uint8_t static_address) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "i3c not initialized"));
+  }
+  taskENTER_CRITICAL();
+  const I3cDevice device = hw->protocol.add_i2c_device(static_address);
+  taskEXIT_CRITICAL();
+  if (device == max_devices) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid i3c device"));
+  }
+  return device;
+}
+
+expected::expected<size_t, Error> I3c::assign_addresses(uint32_t timeout_ms) {
+  I3cTransaction transaction{};
+  transaction.device = broadcast;
+  transaction.ccc = i3c_ccc::entdaa;
+  auto queued = submit(transaction);
+  if (!queued) {
+    return expected::unexpected(queued.error());
+  }
+  // The transaction is on this stack: past the timeout, wait for it anyway
+  auto done = wait(transaction, timeout_ms);
+  if (!done && std::holds_alternative<I3cError>(done.error().code) &&
+      std::get<I3cError>(done.error().code) == I3cError::timeout) {
+    (void)wait(transaction, wait_forever);
+  }
+  if (!done) {
+    return expected::unexpected(done.error());
+  }
+  return transaction.rx_count;
+}
+
+expected::expected<I3cDeviceInfo, Error> I3c::device_info(I3cDevice device) const {
+  const auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "i3c not initialized"));
+  }
+  taskENTER_CRITICAL();
+  const bool listed = device < hw->protocol.device_count();
+  const I3cDeviceInfo info = listed ? hw->protocol.info(device) : I3cDeviceInfo{};
+  taskEXIT_CRITICAL();
+  if (!listed) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid i3c device"));
+  }
+  return info;
+}
+
+expected::expected<void, Error> I3c::submit(I3cTransaction& transaction) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "i3c not initialized"));
+  }
+  // Masks the I3C handlers, and is valid in an interrupt as well as in a task
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  if (is_pending(transaction.status)) {
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    return expected::unexpected(RU_ERROR(CommonError::busy, "i3c transaction pending"));
+  }
+  const I3cDevice device = transaction.device;
+  if (device != broadcast && device < hw->protocol.device_count() &&
+      !hw->protocol.info(device).address) {
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    return expected::unexpected(RU_ERROR(I3cError::no_address, "i3c device has no address"));
+  }
+  transaction.waiter = nullptr;
+  const bool queued = hw->protocol.submit(transaction);
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+  if (!queued) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid i3c transaction"));
+  }
+  return {};
+}
+
+expected::expected<void, Error> I3c::wait(I3cTransaction& transaction, uint32_t timeout_ms) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "i3c not initialized"));
+  }
+
+  const TickType_t start = xTaskGetTickCount();
+  const TickType_t timeout = to_ticks(timeout_ms);
+  for (;;) {
+    taskENTER_CRITICAL();
+    const bool pending = is_pending(transaction.status);
+    if (pending) {
+      transaction.waiter = xTaskGetCurrentTaskHandle();
+    }
+    taskEXIT_CRITICAL();
+    if (!pending) {
+      break;
+    }
+
+    const TickType_t left = ticks_left(start, timeout);
+    if (!left) {
+      taskENTER_CRITICAL();
+      transaction.waiter = nullptr;
+      taskEXIT_CRITICAL();
+      return expected::unexpected(RU_ERROR(I3cError::timeout, "i3c transaction timeout"));
+    }
+    ulTaskNotifyTakeIndexed(i3c_notify_index, pdTRUE, left);
+  }
+
+  if (transaction.status == I3cStatus::nack) {
+    return expected::unexpected(RU_ERROR(I3cError::nack, "i3c transaction not acknowledged"));
+  }
+  if (transaction.status == I3cStatus::failed) {
+    return expected::unexpected(RU_ERROR(I3cError::bus_error, "i3c transaction failed"));
+  }
+  return {};
+}
+
+expected::expected<void, Error> I3c::write(I3cDevice device, const uint8_t* data, size_t len) {
+  if (!len) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid i3c length"));
+  }
+  auto written = write_read(device, data, len, nullptr, 0);
+  if (!written) {
+    return expected::unexpected(written.error());
+  }
+  return {};
+}
+
+expected::expected<size_t, Error> I3c::read(I3cDevice device, uint8_t* data, size_t len) {
+  if (!len) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid i3c length"));
+  }
+  return write_read(device, nullptr, 0, data, len);
+}
+
+expected::expected<size_t, Error> I3c::write_read(I3cDevice device, const uint8_t* tx,
+                                                  size_t tx_len, uint8_t* rx, size_t rx_len) {
+  if (tx_len > UINT16_MAX || rx_len > UINT16_MAX) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid i3c length"));
+  }
+  I3cTransaction transaction{};
+  transaction.device = device;
+  transaction.ccc = no_ccc;
+  transaction.tx = tx;
+  transaction.tx_len = static_cast<uint16_t>(tx_len);
+  transaction.rx = rx;
+  transaction.rx_len = static_cast<uint16_t>(rx_len);
+  auto queued = submit(transaction);
+  if (!queued) {
+    return expected::unexpected(queued.error());
+  }
+  // Never completes late: the transaction is on this stack
+  auto done = wait(transaction, wait_forever);
+  if (!done) {
+    return expected::unexpected(done.error());
+  }
+  return transaction.rx_count;
+}
+
+expected::expected<void, Error> I3c::enable_ibi(I3cDevice device) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "i3c not initialized"));
+  }
+  const TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  // Acknowledged before the target may raise them
+  taskENTER_CRITICAL();
+  // One task per device, as in wait_ibi()
+  if (device < max_devices && hw->ibi_owner[device] && hw->ibi_owner[device] != self) {
+    taskEXIT_CRITICAL();
+    return expected::unexpected(RU_ERROR(CommonError::busy, "i3c ibi owned by another task"));
+  }
+  const bool accepted = hw->protocol.accept_ibi(device, true);
+  if (accepted) {
+    hw->ibi_owner[device] = self;
+  }
+  taskEXIT_CRITICAL();
+  if (!accepted) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "i3c ibi not available"));
+  }
+
+  const uint8_t events = i3c_ccc::event_interrupt;
+  I3cTransaction transaction{};
+  transaction.device = device;
+  transaction.ccc = i3c_ccc::enec_direct;
+  transaction.tx = &events;
+  transaction.tx_len = 1;
+  auto sent = submit(transaction);
+  if (sent) {
+    sent = wait(transaction, wait_forever);
+  }
+  if (!sent) {
+    // A stop() from another task may have ended the wait and deleted the
+    // instance: looked up again, as in wait_ibi()
+    taskENTER_CRITICAL();
+    if (p_instance_specific != hw) {
+      taskEXIT_CRITICAL();
+      return expected::unexpected(RU_ERROR(CommonError::not_inited, "i3c not initialized"));
+    }
+    (void)hw->protocol.accept_ibi(device, false);
+    hw->ibi_owner[device] = nullptr;
+    taskEXIT_CRITICAL();
+  }
+  return sent;
+}
+
+expected::expected<void, Error> I3c::disable_ibi(I3cDevice device) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "i3c not initialized"));
+  }
+  const uint8_t events = i3c_ccc::event_interrupt;
+  I3cTransaction transaction{};
+  transaction.device = device;
+  transaction.ccc = i3c_ccc::disec_direct;
+  transaction.tx = &events;
+  transaction.tx_len = 1;
+  auto sent = submit(transaction);
+  if (sent) {
+    sent = wait(transaction, wait_forever);
+  }
+  // NACKed from then on, whether the target heard the DISEC or not. Looked
+  // up again: a stop() from another task may have ended the wait
+  taskENTER_CRITICAL();
+  if (p_instance_specific != hw) {
+    taskEXIT_CRITICAL();
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "i3c not initialized"));
+  }
+  const bool refused = hw->protocol.accept_ibi(device, false);
+  if (refused) {
+    hw->ibi_owner[device] = nullptr;
+  }
+  taskEXIT_CRITICAL();
+  if (!refused) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid i3c device"));
+  }
+  return sent;
+}
+
+expected::expected<I3cIbi, Error> I3c::wait_ibi(I3cDevice device, uint32_t timeout_ms) {
+  const TickType_t start = xTaskGetTickCount();
+  const TickType_t timeout = to_ticks(timeout_ms);
+  const TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  for (;;) {
+    // Looked up again on each wake-up, under the critical section in which
+    // stop() clears it before waking the owners and deleting the instance
+    taskENTER_CRITICAL();
+    auto* hw = p_instance_specific;
+    if (!hw) {
+      taskEXIT_CRITICAL();
+      return expected::unexpected(RU_ERROR(CommonError::not_inited, "i3c not initialized"));
+    }
+    if (device >= hw->protocol.device_count()) {
+      taskEXIT_CRITICAL();
+      return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid i3c device"));
+    }
+    // One task per device: a second one would silently steal the wake-ups
+    if (hw->ibi_owner[device] && hw->ibi_owner[device] != self) {
+      taskEXIT_CRITICAL();
+      return expected::unexpected(RU_ERROR(CommonError::busy, "i3c ibi owned by another task"));
+    }
+    I3cIbi ibi{};
+    const bool taken = hw->protocol.take_ibi(device, ibi);
+    // Register before waiting, so an IBI arriving meanwhile still wakes us
+    hw->ibi_owner[device] = self;
+    taskEXIT_CRITICAL();
+    if (taken) {
+      return ibi;
+    }
+
+    const TickType_t left = ticks_left(start, timeout);
+    if (!left) {
+      return expected::unexpected(RU_ERROR(I3cError::timeout, "i3c ibi timeout"));
+    }
+    ulTaskNotifyTakeIndexed(i3c_notify_index, pdTRUE, left);
+  }
+}
+
+expected::expected<I3cStats, Error> I3c::stats() const {
+  const auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "i3c not initialized"));
+  }
+  taskENTER_CRITICAL();
+  const I3cStats stats = hw->protocol.stats();
+  taskEXIT_CRITICAL();
+  return stats;
+}
+
+expected::expected<void, Error> I3c::reset_stats() {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "i3c not initialized"));
+  }
+  taskENTER_CRITICAL();
+  hw->protocol.reset_stats();
+  taskEXIT_CRITICAL();
+  return {};
+}
+
+} // namespace ru::driver
+
+#define X_i3c_instance(index, id, periph, bus, rx_channel, tx_channel, irq_priority) \
+  extern "C" void periph##_EV_IRQHandler(void) {                                     \
+    ru::driver::handle_ev_irq(index);                                                \
+  }                                                                                  \
+  extern "C" void periph##_ER_IRQHandler(void) {                                     \
+    ru::driver::handle_er_irq(index);                                                \
+  }                                                                                  \
+  extern "C" void GPDMA2_Channel##rx_channel##_IRQHandler(void) {                    \
+    ru::driver::handle_dma_irq(index, true);                                         \
+  }                                                                                  \
+  extern "C" void GPDMA2_Channel##tx_channel##_IRQHandler(void) {                    \
+    ru::driver::handle_dma_irq(index, false);                                        \
+  }
+#include "i3c_instances.hpp"
+#undef X_i3c_instance
@@ -0,0 +1,16 @@
+// I3C controllers of the board, generated by generate.py from the 'i3c' module of
+// config.yaml. Do not edit, regenerate instead.
+//
+// X_i3c_instance(index, id, periph, bus, rx_channel, tx_channel, irq_priority)
+// - id:           I3cId bound to the controller
+// - periph:       I3C instance
+// - bus:          peripheral bus of the I3C clock enable (APB1L or APB3)
+// - rx_channel:   GPDMA2 channel of the received bytes
+// - tx_channel:   GPDMA2 channel of the transmitted bytes
+// - irq_priority: NVIC priority of the I3C event, error and DMA handlers
+
+#ifndef X_i3c_instance
+#define X_i3c_instance(index, id, periph, bus, rx_channel, tx_channel, irq_priority)
+#endif
+
+X_i3c_instance(0, sensor_i3c, I3C1, APB1L, 0, 1, 6)
\ No newline at end of file
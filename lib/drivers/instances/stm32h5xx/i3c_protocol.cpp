@@ -0,0 +1,351 @@
+#include <cstring>
+
+#include "i3c.hpp"
+
+namespace ru::driver {
+
+namespace {
+const uint8_t broadcast_address = 0x7E;
+
+// Dynamic addresses: the lowest win IBI arbitration. 0x00-0x07 are reserved,
+// and so are the addresses one bit away from 0x7E, so a bit error on the
+// broadcast address never selects a target.
+const uint8_t first_address = 0x08;
+const uint8_t last_address = 0x77;
+
+bool valid_address(uint8_t address) {
+  if (address < first_address || address > last_address) {
+    return false;
+  }
+  const uint8_t diff = address ^ broadcast_address;
+  return (diff & (diff - 1)) != 0;
+}
+
+const uint8_t bcr_ibi_payload = 0x04;
+
+bool is_broadcast_ccc(uint8_t ccc) {
+  return ccc < 0x80;
+}
+} // namespace
+
+I3cProtocol::I3cProtocol(I3cPort& port)
+    : m_port(port),
+      m_devices(),
+      m_count(0),
+      m_head(nullptr),
+      m_tail(nullptr),
+      m_current(nullptr),
+      m_daa(DaaPhase::none),
+      m_assigned(0),
+      m_strays(),
+      m_messages(),
+      m_stats() {}
+
+bool I3cProtocol::address_free(uint8_t address, size_t except) const {
+  if (m_strays[address / 32] & (1u << (address % 32))) {
+    return false;
+  }
+  for (size_t i = 0; i < m_count; ++i) {
+    if (i != except && (m_devices[i].info.address == address || m_devices[i].wanted == address)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The wanted address if free, the lowest free one otherwise, 0 if none is
+uint8_t I3cProtocol::allocate(uint8_t wanted, size_t device) const {
+  if (wanted && address_free(wanted, device)) {
+    return wanted;
+  }
+  for (uint8_t address = first_address; address <= last_address; ++address) {
+    if (valid_address(address) && address_free(address, device)) {
+      return address;
+    }
+  }
+  return 0;
+}
+
+I3cDevice I3cProtocol::add_device(uint64_t pid, uint8_t dynamic_address) {
+  pid &= 0xFFFFFFFFFFFFULL;
+  if (m_count == max_devices || !pid ||
+      (dynamic_address && (!valid_address(dynamic_address) ||
+                           !address_free(dynamic_address, max_devices)))) {
+    return max_devices;
+  }
+  for (size_t i = 0; i < m_count; ++i) {
+    if (m_devices[i].info.pid == pid) {
+      return max_devices;
+    }
+  }
+  Device& device = m_devices[m_count];
+  device = {};
+  device.info.pid = pid;
+  device.wanted = dynamic_address;
+  return static_cast<I3cDevice>(m_count++);
+}
+
+I3cDevice I3cProtocol::add_i2c_device(uint8_t static_address) {
+  if (m_count == max_devices || !valid_address(static_address) ||
+      !address_free(static_address, max_devices)) {
+    return max_devices;
+  }
+  Device& device = m_devices[m_count];
+  device = {};
+  device.info.address = static_address;
+  device.info.legacy_i2c = true;
+  device.wanted = static_address;
+  return static_cast<I3cDevice>(m_count++);
+}
+
+bool I3cProtocol::valid(const I3cTransaction& t) const {
+  if ((t.tx_len && !t.tx) || (t.rx_len && !t.rx)) {
+    return false;
+  }
+  if (t.device == broadcast) {
+    if (t.ccc == i3c_ccc::entdaa) {
+      return !t.tx_len && !t.rx_len;
+    }
+    return t.ccc != no_ccc && is_broadcast_ccc(t.ccc) && !t.rx_len;
+  }
+  if (t.device >= m_count || !m_devices[t.device].info.address) {
+    return false;
+  }
+  if (t.ccc == no_ccc) {
+    return t.tx_len || t.rx_len;
+  }
+  // Direct CCCs only, and never to an I2C device: they would not understand
+  return !is_broadcast_ccc(t.ccc) && !m_devices[t.device].info.legacy_i2c &&
+         (t.tx_len != 0) != (t.rx_len != 0);
+}
+
+bool I3cProtocol::submit(I3cTransaction& transaction) {
+  if (!valid(transaction)) {
+    return false;
+  }
+  transaction.status = I3cStatus::queued;
+  transaction.rx_count = 0;
+  transaction.next = nullptr;
+  if (m_tail) {
+    m_tail->next = &transaction;
+  } else {
+    m_head = &transaction;
+  }
+  m_tail = &transaction;
+  if (!m_current) {
+    // Nothing can be skipped: the transaction was just checked
+    (void)start_next();
+  }
+  return true;
+}
+
+I3cTransaction* I3cProtocol::flush() {
+  I3cTransaction* first = m_head;
+  for (I3cTransaction* t = m_head; t; t = t->next) {
+    t->status = I3cStatus::failed;
+  }
+  m_head = nullptr;
+  m_tail = nullptr;
+  return first;
+}
+
+// Puts the oldest queued transaction on the bus. Those addressed to a device
+// that lost its address since they were queued (an assignment it missed) end
+// NACKed without a frame, and are returned.
+I3cTransaction* I3cProtocol::start_next() {
+  I3cTransaction* skipped = nullptr;
+  I3cTransaction** last = &skipped;
+  m_current = nullptr;
+  while (m_head) {
+    I3cTransaction* t = m_head;
+    m_head = t->next;
+    if (!m_head) {
+      m_tail = nullptr;
+    }
+    t->next = nullptr;
+    if (t->device != broadcast && !m_devices[t->device].info.address) {
+      t->status = I3cStatus::nack;
+      ++m_stats.transactions;
+      ++m_stats.nacks;
+      *last = t;
+      last = &t->next;
+      continue;
+    }
+    m_current = t;
+    start(*t);
+    break;
+  }
+  return skipped;
+}
+
+void I3cProtocol::start(I3cTransaction& t) {
+  t.status = I3cStatus::active;
+  size_t count = 0;
+  if (t.device == broadcast && t.ccc == i3c_ccc::entdaa) {
+    // The IBI acceptance follows the addresses, given again at the end
+    for (size_t i = 0; i < m_count; ++i) {
+      Device& device = m_devices[i];
+      if (!device.info.legacy_i2c && device.info.address) {
+        if (device.ibi_accepted) {
+          (void)m_port.set_ibi(device.info.address, false, false);
+        }
+        device.info.address = 0;
+      }
+    }
+    std::memset(m_strays, 0, sizeof(m_strays));
+    m_assigned = 0;
+    m_stats.unknown_targets = 0;
+    m_daa = DaaPhase::reset;
+    m_messages[count++] = {I3cMessageType::ccc, broadcast_address, i3c_ccc::rstdaa, false, 0};
+  } else if (t.device == broadcast) {
+    m_messages[count++] = {I3cMessageType::ccc, broadcast_address, t.ccc, false, t.tx_len};
+  } else {
+    const I3cDeviceInfo& info = m_devices[t.device].info;
+    if (t.ccc != no_ccc) {
+      m_messages[count++] = {I3cMessageType::ccc, broadcast_address, t.ccc, false, 0};
+      const bool read = t.rx_len != 0;
+      m_messages[count++] = {I3cMessageType::direct, info.address, t.ccc, read,
+                             read ? t.rx_len : t.tx_len};
+    } else {
+      const auto type = info.legacy_i2c ? I3cMessageType::legacy_i2c
+                                        : I3cMessageType::private_transfer;
+      if (t.tx_len) {
+        m_messages[count++] = {type, info.address, 0, false, t.tx_len};
+      }
+      if (t.rx_len) {
+        m_messages[count++] = {type, info.address, 0, true, t.rx_len};
+      }
+    }
+  }
+  m_port.start_frame(m_messages, count, t.tx, t.tx_len, t.rx, t.rx_len);
+}
+
+I3cTransaction* I3cProtocol::frame_done(I3cFrameOutcome outcome, size_t rx_count) {
+  I3cTransaction* t = m_current;
+  if (!t) {
+    return nullptr;
+  }
+
+  if (m_daa == DaaPhase::reset && outcome == I3cFrameOutcome::done) {
+    m_daa = DaaPhase::assign;
+    m_port.start_daa();
+    return nullptr;
+  }
+
+  I3cStatus status = outcome == I3cFrameOutcome::done   ? I3cStatus::done
+                     : outcome == I3cFrameOutcome::nack ? I3cStatus::nack
+                                                        : I3cStatus::failed;
+  if (m_daa != DaaPhase::none) {
+    // A NACKed RSTDAA means no I3C target on the bus, and the assignment
+    // itself ends on the NACK of the last 0x7E header: both are done
+    if (status == I3cStatus::nack) {
+      status = I3cStatus::done;
+    }
+    m_daa = DaaPhase::none;
+    m_stats.daa_targets = m_assigned;
+    apply_ibi();
+    t->rx_count = m_assigned;
+  } else {
+    t->rx_count = static_cast<uint16_t>(rx_count < t->rx_len ? rx_count : t->rx_len);
+  }
+
+  ++m_stats.transactions;
+  if (status == I3cStatus::nack) {
+    ++m_stats.nacks;
+  } else if (status == I3cStatus::failed) {
+    ++m_stats.errors;
+  }
+  t->status = status;
+  t->next = start_next();
+  return t;
+}
+
+uint8_t I3cProtocol::daa_payload(uint64_t pid, uint8_t bcr, uint8_t dcr) {
+  pid &= 0xFFFFFFFFFFFFULL;
+  size_t index = max_devices;
+  for (size_t i = 0; i < m_count; ++i) {
+    const I3cDeviceInfo& info = m_devices[i].info;
+    if (!info.legacy_i2c && info.pid == pid && !info.address) {
+      index = i;
+      break;
+    }
+  }
+
+  // A target outside the table still gets an address, so the assignment
+  // goes on; the address stays reserved until the next one
+  const uint8_t address = allocate(index < m_count ? m_devices[index].wanted : 0, index);
+  if (!address) {
+    return 0;
+  }
+  if (index < m_count) {
+    I3cDeviceInfo& info = m_devices[index].info;
+    info.address = address;
+    info.bcr = bcr;
+    info.dcr = dcr;
+  } else {
+    m_strays[address / 32] |= 1u << (address % 32);
+    ++m_stats.unknown_targets;
+  }
+  ++m_assigned;
+  return address;
+}
+
+I3cDevice I3cProtocol::ibi(uint8_t address, const uint8_t* payload, size_t len,
+                           TimerInstant timestamp) {
+  for (size_t i = 0; i < m_count; ++i) {
+    Device& device = m_devices[i];
+    if (device.info.legacy_i2c || device.info.address != address) {
+      continue;
+    }
+    I3cIbi& ibi = device.ibi;
+    ibi.timestamp = timestamp;
+    ++ibi.count;
+    ibi.payload_len = static_cast<uint8_t>(len < I3cIbi::max_payload ? len : I3cIbi::max_payload);
+    if (ibi.payload_len) {
+      std::memcpy(ibi.payload, payload, ibi.payload_len);
+    }
+    ++m_stats.ibis;
+    return static_cast<I3cDevice>(i);
+  }
+  ++m_stats.unknown_ibis;
+  return max_devices;
+}
+
+bool I3cProtocol::accept_ibi(I3cDevice device, bool accept) {
+  if (device >= m_count || m_devices[device].info.legacy_i2c) {
+    return false;
+  }
+  Device& d = m_devices[device];
+  if (d.info.address &&
+      !m_port.set_ibi(d.info.address, accept, (d.info.bcr & bcr_ibi_payload) != 0)) {
+    return false;
+  }
+  d.ibi_accepted = accept;
+  return true;
+}
+
+bool I3cProtocol::take_ibi(I3cDevice device, I3cIbi& out) {
+  if (device >= m_count) {
+    return false;
+  }
+  Device& d = m_devices[device];
+  if (d.ibi.count == d.ibi_taken) {
+    return false;
+  }
+  out = d.ibi;
+  d.ibi_taken = d.ibi.count;
+  return true;
+}
+
+// After an assignment: the devices accepting IBIs, at their new addresses
+void I3cProtocol::apply_ibi() {
+  for (size_t i = 0; i < m_count; ++i) {
+    Device& d = m_devices[i];
+    if (d.ibi_accepted && d.info.address && !d.info.legacy_i2c) {
+      d.ibi_accepted =
+          m_port.set_ibi(d.info.address, true, (d.info.bcr & bcr_ibi_payload) != 0);
+    }
+  }
+}
+
+} // namespace ru::driver
@@ -0,0 +1,222 @@
+#include "FreeRTOS.h"
+#include "stm32h5xx_hal.h"
+#include "task.h"
+
+#include "imu.hpp"
+
+namespace ru::driver {
+
+namespace {
+// Task notification slot used to wake a task blocked in Imu::read_batch
+// (slot 0 is left to the application)
+const UBaseType_t imu_notify_index = 1;
+
+// How long stop() lets the burst read on the bus finish
+const uint32_t stop_timeout_ms = 10;
+} // namespace
+
+class ImuInstanceSpecific {
+public:
+  ImuCapture capture;
+  Gpio data_ready;
+  Timer timer;
+  Spi* spi;
+  size_t batch;
+
+  // The burst read, built once: the command byte then sample_bytes of 0xFF;
+  // the sample lands after the byte received during the command
+  uint8_t tx[1 + ImuSample::max_bytes];
+  uint8_t rx[1 + ImuSample::max_bytes];
+  SpiSegment segment;
+  SpiTransaction transaction;
+
+  volatile TaskHandle_t waiter = nullptr;
+};
+
+namespace {
+// Producer, from the DMA interrupt of the bus: the sample into the ring, and
+// the consumer woken once a batch is there
+void burst_done(SpiTransaction& transaction, void* ctx) {
+  auto* hw = static_cast<ImuInstanceSpecific*>(ctx);
+  BaseType_t woken = pdFALSE;
+
+  // The EXTI handler may run at a higher priority than the DMA one
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  hw->capture.burst_done(hw->rx + 1, transaction.status == SpiStatus::done);
+  TaskHandle_t waiter = hw->waiter;
+  if (waiter && hw->capture.available() >= hw->batch) {
+    hw->waiter = nullptr;
+    vTaskNotifyGiveIndexedFromISR(waiter, imu_notify_index, &woken);
+  }
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+  portYIELD_FROM_ISR(woken);
+}
+
+// Producer, from the EXTI handler of the data-ready pin: each edge is
+// timestamped from its GpioEvent, and starts the burst read unless one runs
+void data_ready(void* ctx) {
+  auto* hw = static_cast<ImuInstanceSpecific*>(ctx);
+  GpioEvent event{};
+  for (;;) {
+    auto popped = hw->data_ready.pop_event_from_isr(event);
+    if (!popped || !*popped) {
+      break;
+    }
+    auto timestamp = hw->timer.instant_of(event.timestamp);
+    if (!timestamp) {
+      break;
+    }
+
+    const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    if (hw->capture.data_ready(*timestamp) && !hw->spi->submit(hw->transaction)) {
+      hw->capture.burst_done(nullptr, false);
+    }
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+  }
+}
+} // namespace
+
+ImuConfig::ImuConfig(Spi& spi, SpiDevice device, GpioId data_ready, uint8_t read_command,
+                     uint8_t sample_bytes, uint32_t sample_rate_hz, size_t batch)
+    : m_spi(&spi),
+      m_device(device),
+      m_data_ready(data_ready),
+      m_read_command(read_command),
+      m_sample_bytes(sample_bytes),
+      m_sample_rate_hz(sample_rate_hz),
+      m_batch(batch) {}
+
+Imu::Imu() : p_instance_specific(nullptr) {}
+
+expected::expected<void, Error> Imu::start() {
+  return {};
+}
+
+expected::expected<void, Error> Imu::init(const Config& config) {
+  const auto* cfg = dynamic_cast<const ImuConfig*>(&config);
+  if (!cfg) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid imu config"));
+  }
+  if (!cfg->m_sample_bytes || cfg->m_sample_bytes > ImuSample::max_bytes) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid imu sample size"));
+  }
+  if (!cfg->m_sample_rate_hz || cfg->m_sample_rate_hz > SystemCoreClock) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid imu sample rate"));
+  }
+  if (!cfg->m_batch || cfg->m_batch > ImuCapture::ring_size) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid imu batch"));
+  }
+
+  if (p_instance_specific) {
+    auto stopped = stop();
+    if (!stopped) {
+      return stopped;
+    }
+  }
+  auto started = Timer::start();
+  if (!started) {
+    return started;
+  }
+
+  auto* hw = new ImuInstanceSpecific();
+  hw->spi = cfg->m_spi;
+  hw->batch = cfg->m_batch;
+  hw->capture.reset(SystemCoreClock / cfg->m_sample_rate_hz, cfg->m_sample_bytes);
+
+  hw->tx[0] = cfg->m_read_command;
+  for (size_t i = 1; i < sizeof(hw->tx); ++i) {
+    hw->tx[i] = 0xFF;
+  }
+  hw->segment = {hw->tx, hw->rx, static_cast<uint16_t>(1 + cfg->m_sample_bytes), false};
+  hw->transaction = {};
+  hw->transaction.device = cfg->m_device;
+  hw->transaction.segments = &hw->segment;
+  hw->transaction.segment_count = 1;
+  hw->transaction.callback = burst_done;
+  hw->transaction.ctx = hw;
+
+  auto pin = hw->data_ready.init(GpioConfig(cfg->m_data_ready, GpioFunction::input_floating));
+  if (pin) {
+    pin = hw->data_ready.enable_interrupt(data_ready, hw);
+  }
+  if (!pin) {
+    (void)hw->data_ready.stop();
+    delete hw;
+    return pin;
+  }
+  p_instance_specific = hw;
+  return {};
+}
+
+expected::expected<void, Error> Imu::stop() {
+  auto* hw = p_instance_specific;
+  if (hw) {
+    (void)hw->data_ready.disable_interrupt();
+    // The completion callback still points to hw; a bus stopped meanwhile
+    // failed the read without calling it
+    if (hw->transaction.status == SpiStatus::queued ||
+        hw->transaction.status == SpiStatus::active) {
+      auto done = hw->spi->wait(hw->transaction, stop_timeout_ms);
+      if (!done && std::holds_alternative<SpiError>(done.error().code) &&
+          std::get<SpiError>(done.error().code) == SpiError::timeout) {
+        return done;
+      }
+    }
+    (void)hw->data_ready.stop();
+    if (hw->waiter) {
+      xTaskNotifyGiveIndexed(hw->waiter, imu_notify_index);
+    }
+  }
+  delete hw;
+  p_instance_specific = nullptr;
+  return {};
+}
+
+expected::expected<size_t, Error> Imu::read_batch(ImuSample* out, size_t max,
+                                                  uint32_t timeout_ms) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "imu not initialized"));
+  }
+  if (!out || !max) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "empty imu buffer"));
+  }
+
+  const size_t wanted = max < hw->batch ? max : hw->batch;
+  const TickType_t start = xTaskGetTickCount();
+  const TickType_t timeout = timeout_ms == wait_forever ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+  for (;;) {
+    taskENTER_CRITICAL();
+    const size_t available = hw->capture.available();
+    // Register before waiting, so a batch completing meanwhile still wakes us
+    hw->waiter = available >= wanted ? nullptr : xTaskGetCurrentTaskHandle();
+    taskEXIT_CRITICAL();
+
+    const TickType_t elapsed = xTaskGetTickCount() - start;
+    const bool expired = timeout != portMAX_DELAY && elapsed >= timeout;
+    if (available >= wanted || (expired && available)) {
+      hw->waiter = nullptr;
+      // The only consumer: no lock against the producer
+      return hw->capture.pop(out, max);
+    }
+    if (expired) {
+      hw->waiter = nullptr;
+      return expected::unexpected(RU_ERROR(ImuError::timeout, "imu batch timeout"));
+    }
+    ulTaskNotifyTakeIndexed(imu_notify_index, pdTRUE,
+                            timeout == portMAX_DELAY ? portMAX_DELAY : timeout - elapsed);
+  }
+}
+
+expected::expected<ImuStats, Error> Imu::stats() const {
+  const auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "imu not initialized"));
+  }
+  taskENTER_CRITICAL();
+  const ImuStats stats = hw->capture.stats();
+  taskEXIT_CRITICAL();
+  return stats;
+}
+
+} // namespace ru::driver
@@ -0,0 +1,271 @@
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#include "task.h"
+
+#include "log_backend.hpp"
+#include "serial.hpp"
+
+namespace ru::driver::debug {
+
+namespace {
+// Ring of fixed size slots (power of two). A long text takes consecutive
+// slots claimed at once, so concurrent writes never interleave.
+const uint32_t log_slot_count = 128;
+const size_t log_text_per_slot = 24;
+const size_t log_max_write_slots = log_max_write_size / log_text_per_slot;
+static_assert(log_max_write_size % log_text_per_slot == 0 &&
+                  log_max_write_slots <= log_slot_count,
+              "a raw text write must fill whole slots of the ring");
+const size_t log_ram_size = 4096;
+// Interned frame payload: LEB128 index, then 4 bytes per argument
+const size_t log_frame_payload = 5 + 4 * log_max_args;
+
+enum LogKind : uint8_t {
+  log_kind_format,
+  log_kind_interned,
+  log_kind_text
+};
+
+// Bounded multi-producer queue (Vyukov): slot i is free for position pos when
+// its sequence equals pos, holds a record once it equals pos + 1. The stored
+// value is the sequence minus i, so the zero-initialized ring starts empty.
+struct LogSlot {
+  std::atomic<uint32_t> seq;
+  LogKind kind;
+  uint8_t len;
+  union {
+    char text[log_text_per_slot];
+    struct {
+      union {
+        const char* fmt;
+        uint32_t index;
+      };
+      uint32_t args[log_max_args];
+    } format;
+  };
+};
+
+LogSlot log_ring[log_slot_count];
+std::atomic<uint32_t> log_enqueue_pos;
+uint32_t log_dequeue_pos;
+
+std::atomic<uint32_t> log_records;
+std::atomic<uint32_t> log_dropped[configNUMBER_OF_CORES];
+
+char log_ram[log_ram_size];
+size_t log_ram_head;
+size_t log_ram_used;
+
+uint32_t core_id() {
+#if configNUMBER_OF_CORES > 1
+  return portGET_CORE_ID();
+#else
+  return 0;
+#endif
+}
+
+uint32_t slot_seq(uint32_t pos) {
+  const uint32_t index = pos & (log_slot_count - 1);
+  return log_ring[index].seq.load(std::memory_order_acquire) + index;
+}
+
+void set_slot_seq(uint32_t pos, uint32_t seq) {
+  const uint32_t index = pos & (log_slot_count - 1);
+  log_ring[index].seq.store(seq - index, std::memory_order_release);
+}
+
+// Claims `count` consecutive positions. The consumer frees slots in order,
+// so the last one being free means the whole run is.
+bool claim(uint32_t count, uint32_t& pos) {
+  pos = log_enqueue_pos.load(std::memory_order_relaxed);
+  for (;;) {
+    const uint32_t last = pos + count - 1;
+    if (slot_seq(last) == last) {
+      if (log_enqueue_pos.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+        log_records.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+      continue;
+    }
+    const uint32_t now = log_enqueue_pos.load(std::memory_order_relaxed);
+    if (now == pos) {
+      log_dropped[core_id()].fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    pos = now;
+  }
+}
+
+void ram_append(const char* text, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    log_ram[(log_ram_head + log_ram_used) % log_ram_size] = text[i];
+    if (log_ram_used < log_ram_size) {
+      ++log_ram_used;
+    } else {
+      log_ram_head = (log_ram_head + 1) % log_ram_size;
+    }
+  }
+}
+
+void output(Serial* sink, const char* text, size_t len) {
+  if (sink) {
+    (void)sink->write(reinterpret_cast<const uint8_t*>(text), len);
+  } else {
+    ram_append(text, len);
+  }
+}
+
+bool push_record(LogKind kind, uint32_t word, const char* fmt, const uint32_t* args,
+                 size_t argc) {
+  uint32_t pos;
+  if (argc > log_max_args || !claim(1, pos)) {
+    return false;
+  }
+  LogSlot& slot = log_ring[pos & (log_slot_count - 1)];
+  slot.kind = kind;
+  slot.len = static_cast<uint8_t>(argc);
+  if (kind == log_kind_interned) {
+    slot.format.index = word;
+  } else {
+    slot.format.fmt = fmt;
+  }
+  for (size_t i = 0; i < argc; ++i) {
+    slot.format.args[i] = args[i];
+  }
+  set_slot_seq(pos, pos + 1);
+  return true;
+}
+} // namespace
+
+bool log_deferred(const char* fmt, const uint32_t* args, size_t argc) {
+  return fmt && push_record(log_kind_format, 0, fmt, args, argc);
+}
+
+bool log_interned(uint32_t index, const uint32_t* args, size_t argc) {
+  return push_record(log_kind_interned, index, nullptr, args, argc);
+}
+
+// Arguments are 32-bit words, the way the AAPCS passes them anyway
+size_t log_format(const char* fmt, const uint32_t* args, char* line) {
+  const uint32_t* a = args;
+  const int n = std::snprintf(line, log_line_size, fmt, a[0], a[1], a[2], a[3], a[4]);
+  if (n <= 0) {
+    return 0;
+  }
+  return static_cast<size_t>(n) < log_line_size ? n : log_line_size - 1;
+}
+
+// An interned record goes out as 0x00 | COBS(payload) | 0x00: text never
+// contains a zero byte, so the decoder tells frames and text apart.
+size_t log_frame(uint32_t index, const uint32_t* args, size_t argc, char* line) {
+  uint8_t payload[log_frame_payload];
+  size_t len = 0;
+  argc = argc < log_max_args ? argc : log_max_args;
+  do {
+    payload[len++] = static_cast<uint8_t>((index & 0x7F) | (index > 0x7F ? 0x80 : 0));
+    index >>= 7;
+  } while (index);
+  for (size_t i = 0; i < argc; ++i) {
+    for (int byte = 0; byte < 4; ++byte) {
+      payload[len++] = static_cast<uint8_t>(args[i] >> (8 * byte));
+    }
+  }
+
+  // A payload shorter than 254 bytes is a single COBS block
+  size_t out = 0;
+  line[out++] = 0;
+  size_t code_pos = out++;
+  uint8_t code = 1;
+  for (size_t i = 0; i < len; ++i) {
+    if (payload[i]) {
+      line[out++] = static_cast<char>(payload[i]);
+      ++code;
+    } else {
+      line[code_pos] = static_cast<char>(code);
+      code_pos = out++;
+      code = 1;
+    }
+  }
+  line[code_pos] = static_cast<char>(code);
+  line[out++] = 0;
+  return out;
+}
+
+bool log_write(const char* text, size_t len) {
+  if (!len) {
+    return true;
+  }
+  // One claim per write: split in several, other records could land between
+  // the parts and a failed claim would leave a partial text behind
+  if (len > log_max_write_size) {
+    log_dropped[core_id()].fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  const uint32_t count = static_cast<uint32_t>((len + log_text_per_slot - 1) / log_text_per_slot);
+  uint32_t pos;
+  if (!claim(count, pos)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    LogSlot& slot = log_ring[(pos + i) & (log_slot_count - 1)];
+    const size_t offset = i * log_text_per_slot;
+    const size_t n = len - offset < log_text_per_slot ? len - offset : log_text_per_slot;
+    slot.kind = log_kind_text;
+    slot.len = static_cast<uint8_t>(n);
+    std::memcpy(slot.text, text + offset, n);
+    set_slot_seq(pos + i, pos + i + 1);
+  }
+  return true;
+}
+
+size_t log_drain(Serial* sink) {
+  char line[log_line_size];
+  size_t consumed = 0;
+  for (;;) {
+    const uint32_t pos = log_dequeue_pos;
+    // Empty, or the producer of the next record has not published it yet
+    if (slot_seq(pos) != pos + 1) {
+      break;
+    }
+
+    const LogSlot& slot = log_ring[pos & (log_slot_count - 1)];
+    if (slot.kind == log_kind_format) {
+      output(sink, line, log_format(slot.format.fmt, slot.format.args, line));
+    } else if (slot.kind == log_kind_interned) {
+      output(sink, line, log_frame(slot.format.index, slot.format.args, slot.len, line));
+    } else {
+      output(sink, slot.text, slot.len);
+    }
+
+    set_slot_seq(pos, pos + log_slot_count);
+    log_dequeue_pos = pos + 1;
+    ++consumed;
+  }
+  return consumed;
+}
+
+void log_drain_loop(Serial* sink, uint32_t period_ms) {
+  for (;;) {
+    log_drain(sink);
+    vTaskDelay(pdMS_TO_TICKS(period_ms));
+  }
+}
+
+LogStats log_stats() {
+  LogStats stats{};
+  stats.records = log_records.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < configNUMBER_OF_CORES; ++i) {
+    stats.dropped[i] = log_dropped[i].load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+const char* log_ram_text(size_t& size, size_t& head) {
+  size = log_ram_used;
+  head = log_ram_head;
+  return log_ram;
+}
+
+} // namespace ru::driver::debug
@@ -0,0 +1,83 @@
+#include "FreeRTOS.h"
+#include "stm32h5xx_hal.h"
+#include "task.h"
+
+#include "debug_log.hpp"
+#include "log_backend.hpp"
+#include "timer.hpp"
+
+namespace ru::driver::debug {
+
+namespace {
+struct CycleRange {
+  uint32_t min = UINT32_MAX;
+  uint32_t max = 0;
+
+  void add(uint32_t cycles) {
+    min = cycles < min ? cycles : min;
+    max = cycles > max ? cycles : max;
+  }
+};
+} // namespace
+
+void report_log_cycles(size_t calls) {
+  if (!calls) {
+    return;
+  }
+  (void)Timer::start();
+
+  static const char text[] = "log cost: 32 byte raw text....\r\n";
+  static_assert(sizeof(text) - 1 == 32);
+  static const char fmt[] = "log cost: deferred record %u of %u\r\n";
+  // Offset of an interned string past the first 128 bytes: 2 byte LEB128
+  const uint32_t index = 300;
+  char line[log_line_size];
+  CycleRange deferred;
+  CycleRange interned;
+  CycleRange written;
+  CycleRange formatted;
+  CycleRange framed;
+  size_t formatted_bytes = 0;
+  size_t framed_bytes = 0;
+
+  // Nothing preempts the calls; the records they queue go out with the rest
+  for (size_t i = 0; i < calls; ++i) {
+    const uint32_t args[log_max_args] = {static_cast<uint32_t>(i), static_cast<uint32_t>(calls)};
+    taskENTER_CRITICAL();
+    uint32_t start = DWT->CYCCNT;
+    (void)log(fmt, args[0], args[1]);
+    deferred.add(DWT->CYCCNT - start);
+
+    start = DWT->CYCCNT;
+    RU_LOG_INFO("log cost: interned record %u of %u", args[0], args[1]);
+    interned.add(DWT->CYCCNT - start);
+
+    start = DWT->CYCCNT;
+    (void)log_write(text, sizeof(text) - 1);
+    written.add(DWT->CYCCNT - start);
+
+    // The drain side of the same record. Formatting it is also what a
+    // synchronous printf costs its caller, output not included.
+    start = DWT->CYCCNT;
+    formatted_bytes = log_format(fmt, args, line);
+    formatted.add(DWT->CYCCNT - start);
+
+    start = DWT->CYCCNT;
+    framed_bytes = log_frame(index, args, 2, line);
+    framed.add(DWT->CYCCNT - start);
+    taskEXIT_CRITICAL();
+  }
+
+  RU_LOG_INFO("log cost: caller %s %u..%u cycles", "log()", deferred.min, deferred.max);
+  RU_LOG_INFO("log cost: caller %s %u..%u cycles", "RU_LOG_INFO", interned.min, interned.max);
+  RU_LOG_INFO("log cost: caller %s %u..%u cycles", "log_write(32 B)", written.min, written.max);
+  RU_LOG_INFO("log cost: drain %s %u..%u cycles, %u bytes on the wire", "log_format",
+              formatted.min, formatted.max, static_cast<unsigned>(formatted_bytes));
+  RU_LOG_INFO("log cost: drain %s %u..%u cycles, %u bytes on the wire", "log_frame", framed.min,
+              framed.max, static_cast<unsigned>(framed_bytes));
+  const auto stats = log_stats();
+  RU_LOG_INFO("log cost: %u records queued, %u dropped on core 0", stats.records,
+              stats.dropped[0]);
+}
+
+} // namespace ru::driver::debug
@@ -1,7 +1,149 @@
+#include "FreeRTOS.h"
+#include "stm32h5xx_hal.h"
+#include "task.h"
+
+#include "dma_helpers.hpp"
 #include "pwm.hpp"
 
 namespace ru::driver {
 
+namespace {
+const uint32_t max_permille = 1000;
+// Prescaler and auto-reload are 16-bit on every supported timer
+const uint32_t max_timer_count = 0x10000;
+
+// OCxM values, OCxM[3] (the split bit) left at 0
+const uint32_t oc_mode_force_inactive = 0x4;
+const uint32_t oc_mode_pwm1 = 0x6;
+const uint32_t oc_mode_pwm2 = 0x7;
+// TRGO = OC1REF .. OC4REF
+const uint32_t mms_oc1ref = 0x4;
+
+struct PwmHw {
+  PwmId id;
+  TIM_TypeDef* tim;
+  volatile uint32_t* clock_enable;
+  uint32_t clock_enable_bit;
+  bool apb2;
+  bool advanced;
+  uint8_t channel;
+  uint8_t sync_channel;
+  uint8_t adc_trigger;
+};
+
+// Timers generated from config.yaml, closed by an invalid entry so the table
+// is never empty. Channel 0: the timer belongs to a PwmGroup.
+#define X_pwm_instance(index, id, periph, bus, advanced, channel, sync_channel, adc_trigger) \
+  {PwmId::id, periph, &RCC->bus##ENR, RCC_##bus##ENR_##periph##EN,                           \
+   &RCC->bus##ENR == &RCC->APB2ENR, advanced, channel, sync_channel, adc_trigger},
+#define X_pwm_burst(index, id, periph, dma_channel, irq_priority)
+const PwmHw pwm_hw[] = {
+#include "pwm_instances.hpp"
+  {},  // PwmId::invalid
+};
+#undef X_pwm_burst
+#undef X_pwm_instance
+
+const size_t pwm_hw_count = sizeof(pwm_hw) / sizeof(pwm_hw[0]) - 1;
+
+// GPDMA2 channel reloading the compares of a group timer on its update
+// request (TIMx_UP). GPDMA2 has the same request lines as GPDMA1.
+struct PwmBurstHw {
+  PwmId id;
+  DMA_Channel_TypeDef* dma;
+  IRQn_Type dma_irq;
+  uint32_t request;
+  uint32_t irq_priority;
+};
+
+#define X_pwm_instance(index, id, periph, bus, advanced, channel, sync_channel, adc_trigger)
+#define X_pwm_burst(index, id, periph, dma_channel, irq_priority)                        \
+  {PwmId::id, GPDMA2_Channel##dma_channel, GPDMA2_Channel##dma_channel##_IRQn,           \
+   GPDMA1_REQUEST_##periph##_UP, irq_priority},
+const PwmBurstHw pwm_burst_hw[] = {
+#include "pwm_instances.hpp"
+  {},  // PwmId::invalid
+};
+#undef X_pwm_burst
+#undef X_pwm_instance
+
+const size_t pwm_burst_count = sizeof(pwm_burst_hw) / sizeof(pwm_burst_hw[0]) - 1;
+
+const PwmHw* find_hw(PwmId id) {
+  for (size_t i = 0; i < pwm_hw_count; ++i) {
+    if (pwm_hw[i].id == id) {
+      return &pwm_hw[i];
+    }
+  }
+  return nullptr;
+}
+
+// Timer kernel clock: the APB clock, doubled when the APB prescaler divides
+uint32_t timer_clock(bool apb2) {
+  const uint32_t pclk = apb2 ? HAL_RCC_GetPCLK2Freq() : HAL_RCC_GetPCLK1Freq();
+  return pclk == HAL_RCC_GetHCLKFreq() ? pclk : 2 * pclk;
+}
+
+volatile uint32_t& compare_register(TIM_TypeDef* tim, uint8_t channel) {
+  return (&tim->CCR1)[channel - 1];
+}
+
+// Output compare mode and preload of a channel, in CCMR1 (1, 2) or CCMR2 (3, 4)
+void set_oc_mode(TIM_TypeDef* tim, uint8_t channel, uint32_t mode) {
+  volatile uint32_t& ccmr = channel <= 2 ? tim->CCMR1 : tim->CCMR2;
+  const uint32_t shift = channel & 1 ? 0 : 8;
+  const uint32_t field = TIM_CCMR1_OC1M | TIM_CCMR1_OC1PE | TIM_CCMR1_CC1S;
+  ccmr = (ccmr & ~(field << shift)) |
+         (((mode << TIM_CCMR1_OC1M_Pos) | TIM_CCMR1_OC1PE) << shift);
+}
+
+uint32_t permille_of(uint32_t period, uint16_t permille) {
+  return static_cast<uint32_t>(static_cast<uint64_t>(period) * permille / max_permille);
+}
+} // namespace
+
+class PwmInstanceSpecific {
+public:
+  const PwmHw* hw;
+  uint32_t clock_hz;
+  uint32_t prescaler;      // PSC + 1
+  uint32_t period;         // ARR + 1
+  uint16_t duty_permille;
+  bool sync_enabled;
+  uint16_t sync_phase_permille;
+};
+
+namespace {
+PwmInstanceSpecific* pwm_owner[pwm_hw_count];
+
+// Smallest prescaler giving a 16-bit period: the finest duty resolution
+bool compute_timebase(uint32_t clock_hz, uint32_t frequency_hz, uint32_t& prescaler,
+                      uint32_t& period) {
+  if (!frequency_hz || frequency_hz > clock_hz / 2) {
+    return false;
+  }
+  const uint64_t ticks = clock_hz / frequency_hz;
+  prescaler = static_cast<uint32_t>((ticks + max_timer_count - 1) / max_timer_count);
+  if (prescaler > max_timer_count) {
+    return false;
+  }
+  period = static_cast<uint32_t>(ticks / prescaler);
+  return period >= 2;
+}
+
+// Compare values of both channels for the current period. The registers are
+// preloaded: a change takes effect at the next update event, glitch free.
+void write_compares(PwmInstanceSpecific* hw) {
+  TIM_TypeDef* tim = hw->hw->tim;
+  compare_register(tim, hw->hw->channel) = permille_of(hw->period, hw->duty_permille);
+  if (hw->sync_enabled) {
+    // OCxREF (PWM mode 2) rises at CNT == CCR: never 0, or it would not toggle
+    const uint32_t ccr = permille_of(hw->period, hw->sync_phase_permille);
+    compare_register(tim, hw->hw->sync_channel) = ccr ? ccr : 1;
+  }
+}
+} // namespace
+
 PwmConfig::PwmConfig(PwmId id, uint32_t frequency_hz, uint16_t duty_cycle_permille,
                      PwmPolarity polarity)
     : m_id(id),
@@ -15,32 +157,704 @@ expected::expected<void, Error> Pwm::start() {
   return {};
 }
 
-expected::expected<void, Error> Pwm::init(const Config&) {
+expected::expected<void, Error> Pwm::init(const Config& config) {
+  const auto* cfg = dynamic_cast<const PwmConfig*>(&config);
+  if (!cfg) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid pwm config"));
+  }
+
+  const PwmHw* timer = find_hw(cfg->m_id);
+  if (!timer) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "unsupported pwm id"));
+  }
+  if (cfg->m_duty_cycle_permille > max_permille) {
+    return expected::unexpected(RU_ERROR(PwmError::invalid_duty_cycle, "duty cycle above 1000"));
+  }
+
+  if (!timer->channel) {
+    return expected::unexpected(RU_ERROR(PwmError::not_supported, "pwm timer of a group"));
+  }
+  const uint32_t clock_hz = timer_clock(timer->apb2);
+  uint32_t prescaler = 0;
+  uint32_t period = 0;
+  if (!compute_timebase(clock_hz, cfg->m_frequency_hz, prescaler, period)) {
+    return expected::unexpected(RU_ERROR(PwmError::invalid_frequency, "unsupported frequency"));
+  }
+
+  const size_t index = static_cast<size_t>(timer - pwm_hw);
+  if (pwm_owner[index] && pwm_owner[index] != p_instance_specific) {
+    return expected::unexpected(RU_ERROR(CommonError::busy, "pwm already in use"));
+  }
+
+  if (p_instance_specific) {
+    (void)stop();
+  }
+  p_instance_specific = new PwmInstanceSpecific();
+
+  auto* hw = p_instance_specific;
+  hw->hw = timer;
+  hw->clock_hz = clock_hz;
+  hw->prescaler = prescaler;
+  hw->period = period;
+  hw->duty_permille = cfg->m_duty_cycle_permille;
+  hw->sync_enabled = false;
+  hw->sync_phase_permille = 0;
+
+  *timer->clock_enable |= timer->clock_enable_bit;
+  (void)*timer->clock_enable;
+
+  TIM_TypeDef* tim = timer->tim;
+  const bool active_low = cfg->m_polarity == PwmPolarity::active_low;
+  tim->CR1 = TIM_CR1_ARPE;
+  // Idle (MOE low) at the inactive level
+  tim->CR2 = timer->advanced && active_low ? TIM_CR2_OIS1 << (2 * (timer->channel - 1)) : 0;
+  tim->PSC = prescaler - 1;
+  tim->ARR = period - 1;
+  // Until enable(), the output sits at its inactive level: through MOE on the
+  // advanced timers, forced by the compare mode on the others
+  set_oc_mode(tim, timer->channel, timer->advanced ? oc_mode_pwm1 : oc_mode_force_inactive);
+  const uint32_t ccer_shift = 4 * (timer->channel - 1);
+  tim->CCER = (TIM_CCER_CC1E | (active_low ? TIM_CCER_CC1P : 0)) << ccer_shift;
+  write_compares(hw);
+  // Load the preloaded registers now, not at the first overflow
+  tim->EGR = TIM_EGR_UG;
+  if (timer->advanced) {
+    // Driven at the CR2.OIS1..4 level while MOE is low (OSSI); MOE is set by enable()
+    tim->BDTR = TIM_BDTR_OSSR | TIM_BDTR_OSSI;
+  }
+
+  pwm_owner[index] = hw;
   return {};
 }
 
 expected::expected<void, Error> Pwm::stop() {
+  auto* hw = p_instance_specific;
+  if (hw) {
+    TIM_TypeDef* tim = hw->hw->tim;
+    tim->CR1 = 0;
+    tim->CR2 = 0;
+    tim->CCER = 0;
+    if (hw->hw->advanced) {
+      tim->BDTR &= ~TIM_BDTR_MOE;
+    }
+    pwm_owner[hw->hw - pwm_hw] = nullptr;
+  }
+  delete hw;
+  p_instance_specific = nullptr;
   return {};
 }
 
 expected::expected<void, Error> Pwm::enable() {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "pwm not initialized"));
+  }
+  TIM_TypeDef* tim = hw->hw->tim;
+  tim->CR1 |= TIM_CR1_CEN;
+  if (hw->hw->advanced) {
+    tim->BDTR |= TIM_BDTR_MOE;
+  } else {
+    // CCMR is shared with the sync channel adc_trigger() programs
+    taskENTER_CRITICAL();
+    set_oc_mode(tim, hw->hw->channel, oc_mode_pwm1);
+    taskEXIT_CRITICAL();
+  }
   return {};
 }
 
 expected::expected<void, Error> Pwm::disable() {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "pwm not initialized"));
+  }
+  TIM_TypeDef* tim = hw->hw->tim;
+  // Output to its inactive level first, whatever the counter stops at
+  if (hw->hw->advanced) {
+    tim->BDTR &= ~TIM_BDTR_MOE;
+  } else {
+    taskENTER_CRITICAL();
+    set_oc_mode(tim, hw->hw->channel, oc_mode_force_inactive);
+    taskEXIT_CRITICAL();
+  }
+  tim->CR1 &= ~TIM_CR1_CEN;
   return {};
 }
 
-expected::expected<void, Error> Pwm::set_frequency(uint32_t) {
+expected::expected<void, Error> Pwm::set_frequency(uint32_t frequency_hz) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "pwm not initialized"));
+  }
+
+  uint32_t prescaler = 0;
+  uint32_t period = 0;
+  if (!compute_timebase(hw->clock_hz, frequency_hz, prescaler, period)) {
+    return expected::unexpected(RU_ERROR(PwmError::invalid_frequency, "unsupported frequency"));
+  }
+
+  // PSC, ARR and the compares are all preloaded: the new period starts whole
+  // at the next update event
+  taskENTER_CRITICAL();
+  hw->prescaler = prescaler;
+  hw->period = period;
+  hw->hw->tim->PSC = prescaler - 1;
+  hw->hw->tim->ARR = period - 1;
+  write_compares(hw);
+  taskEXIT_CRITICAL();
   return {};
 }
 
-expected::expected<void, Error> Pwm::set_duty_cycle(uint16_t) {
+expected::expected<void, Error> Pwm::set_duty_cycle(uint16_t duty_cycle_permille) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "pwm not initialized"));
+  }
+  if (duty_cycle_permille > max_permille) {
+    return expected::unexpected(RU_ERROR(PwmError::invalid_duty_cycle, "duty cycle above 1000"));
+  }
+
+  hw->duty_permille = duty_cycle_permille;
+  compare_register(hw->hw->tim, hw->hw->channel) = permille_of(hw->period, duty_cycle_permille);
   return {};
 }
 
 expected::expected<uint16_t, Error> Pwm::get_duty_cycle() const {
-  return 0;
+  const auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "pwm not initialized"));
+  }
+  return hw->duty_permille;
+}
+
+expected::expected<AdcHardwareTrigger, Error> Pwm::adc_trigger(uint16_t phase_permille) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "pwm not initialized"));
+  }
+  if (phase_permille >= max_permille) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "phase not below 1000"));
+  }
+
+  // The sync channel drives no pin: its reference signal rises at the phase
+  // and falls at the update event, and goes out on TRGO to the ADC
+  TIM_TypeDef* tim = hw->hw->tim;
+  const uint8_t sync = hw->hw->sync_channel;
+  taskENTER_CRITICAL();
+  hw->sync_enabled = true;
+  hw->sync_phase_permille = phase_permille;
+  set_oc_mode(tim, sync, oc_mode_pwm2);
+  write_compares(hw);
+  tim->CR2 = (tim->CR2 & ~TIM_CR2_MMS) | ((mms_oc1ref + sync - 1) << TIM_CR2_MMS_Pos);
+  taskEXIT_CRITICAL();
+
+  return AdcHardwareTrigger{AdcTrigger::external_rising,
+                            hw->hw->adc_trigger,
+                            {&tim->CNT, &compare_register(tim, sync), &tim->ARR,
+                             hw->clock_hz / hw->prescaler}};
+}
+
+namespace {
+// Dead time steps of BDTR.DTG, in tDTS: 1 up to 127, then 2, 8 and 16 up to 1008
+const uint32_t max_dead_time_dts = 1008;
+// tDTS is the kernel clock divided by 1, 2 or 4 (CR1.CKD)
+const uint32_t max_clock_division_log2 = 2;
+
+// DMA burst source: the update event (DCR.DBSS)
+const uint32_t dbss_update = 1;
+const uint32_t max_burst_bytes = 0xFFFF;
+
+const PwmBurstHw* find_burst(PwmId id) {
+  for (size_t i = 0; i < pwm_burst_count; ++i) {
+    if (pwm_burst_hw[i].id == id) {
+      return &pwm_burst_hw[i];
+    }
+  }
+  return nullptr;
+}
+
+uint32_t encode_dead_time(uint32_t dts) {
+  if (dts <= 127) {
+    return dts;
+  }
+  if (dts <= 254) {
+    return 0x80 | ((dts + 1) / 2 - 64);
+  }
+  if (dts <= 504) {
+    return 0xC0 | ((dts + 7) / 8 - 32);
+  }
+  return 0xE0 | ((dts + 15) / 16 - 32);
+}
+
+// BDTR.DTG and CR1.CKD of the shortest dead time of at least dead_time_ns,
+// the clock division kept as low as possible
+bool compute_dead_time(uint32_t clock_hz, uint32_t dead_time_ns, uint32_t& dtg, uint32_t& ckd) {
+  const uint64_t ticks = (static_cast<uint64_t>(dead_time_ns) * clock_hz + 999999999) / 1000000000;
+  for (uint32_t log2 = 0; log2 <= max_clock_division_log2; ++log2) {
+    const uint64_t dts = (ticks + (1u << log2) - 1) >> log2;
+    if (dts <= max_dead_time_dts) {
+      dtg = encode_dead_time(static_cast<uint32_t>(dts));
+      ckd = log2;
+      return true;
+    }
+  }
+  return false;
+}
+} // namespace
+
+// GPDMA linked-list item reloading the block size and the source address at
+// the end of the table: the channel loops on itself
+struct PwmBurstNode {
+  uint32_t cbr1;
+  uint32_t csar;
+  uint32_t cllr;
+};
+
+class PwmGroupInstanceSpecific {
+public:
+  const PwmHw* hw;
+  const PwmBurstHw* burst;  // nullptr without burst_dma
+  uint32_t clock_hz;
+  uint32_t prescaler;  // PSC + 1
+  uint32_t period;     // ARR + 1
+  size_t count;
+  PwmGroupChannel channels[PwmGroup::max_channels];
+  uint16_t staged_permille[PwmGroup::max_channels];
+  uint16_t duty_permille[PwmGroup::max_channels];  // committed
+  uint8_t first_channel;
+  uint8_t last_channel;
+  alignas(4) PwmBurstNode node;
+  bool waveform;
+  volatile bool waveform_failed;
+};
+
+namespace {
+PwmGroupInstanceSpecific* group_owner[pwm_hw_count];
+PwmGroupInstanceSpecific* burst_owner[pwm_burst_count];
+
+void write_group_compares(PwmGroupInstanceSpecific* hw) {
+  for (size_t i = 0; i < hw->count; ++i) {
+    compare_register(hw->hw->tim, hw->channels[i].channel) =
+        permille_of(hw->period, hw->duty_permille[i]);
+  }
+}
+
+// Commits `duties`, and the timebase, with the update event held off (UDIS)
+// while the preload registers are written: a counter overflow meanwhile
+// transfers none of them, so the next update event transfers them all. Valid
+// in an interrupt as well as in a task.
+void commit_duties(PwmGroupInstanceSpecific* hw, const uint16_t* duties, uint32_t prescaler,
+                   uint32_t period) {
+  TIM_TypeDef* tim = hw->hw->tim;
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  tim->CR1 |= TIM_CR1_UDIS;
+  if (period != hw->period || prescaler != hw->prescaler) {
+    hw->prescaler = prescaler;
+    hw->period = period;
+    tim->PSC = prescaler - 1;
+    tim->ARR = period - 1;
+  }
+  for (size_t i = 0; i < hw->count; ++i) {
+    hw->duty_permille[i] = duties[i];
+  }
+  write_group_compares(hw);
+  tim->CR1 &= ~TIM_CR1_UDIS;
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+void stop_burst(PwmGroupInstanceSpecific* hw) {
+  hw->hw->tim->DIER &= ~TIM_DIER_UDE;
+  hw->burst->dma->CCR = DMA_CCR_RESET;
+  hw->burst->dma->CFCR = dma_clear_flags;
+}
+
+void handle_burst_irq(size_t index) {
+  DMA_Channel_TypeDef* dma = pwm_burst_hw[index].dma;
+  const uint32_t csr = dma->CSR;
+  dma->CFCR = dma_clear_flags;
+  PwmGroupInstanceSpecific* hw = burst_owner[index];
+  if (hw && hw->waveform && (csr & dma_error_flags)) {
+    // The compares keep the last row written
+    stop_burst(hw);
+    hw->waveform_failed = true;
+  }
+}
+} // namespace
+
+PwmGroupConfig::PwmGroupConfig(PwmId id, uint32_t frequency_hz,
+                               std::span<const PwmGroupChannel> channels, uint32_t dead_time_ns)
+    : m_id(id),
+      m_frequency_hz(frequency_hz),
+      m_channels(channels),
+      m_dead_time_ns(dead_time_ns) {}
+
+PwmGroup::PwmGroup() : p_instance_specific(nullptr) {}
+
+expected::expected<void, Error> PwmGroup::start() {
+  return {};
+}
+
+expected::expected<void, Error> PwmGroup::init(const Config& config) {
+  const auto* cfg = dynamic_cast<const PwmGroupConfig*>(&config);
+  if (!cfg) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid pwm group config"));
+  }
+
+  const PwmHw* timer = find_hw(cfg->m_id);
+  if (!timer) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "unsupported pwm id"));
+  }
+  if (timer->channel) {
+    return expected::unexpected(RU_ERROR(PwmError::not_supported, "pwm timer not a group"));
+  }
+
+  const auto& channels = cfg->m_channels;
+  if (channels.empty() || channels.size() > max_channels) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "1 to 4 pwm channels"));
+  }
+  uint32_t used = 0;
+  bool complementary = false;
+  for (const PwmGroupChannel& c : channels) {
+    if (c.channel < 1 || c.channel > 4 || (used & (1u << c.channel))) {
+      return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid pwm channel"));
+    }
+    used |= 1u << c.channel;
+    if (c.complementary && (!timer->advanced || c.channel == 4)) {
+      return expected::unexpected(
+          RU_ERROR(PwmError::not_supported, "no complementary output on the channel"));
+    }
+    complementary |= c.complementary;
+  }
+
+  const uint32_t clock_hz = timer_clock(timer->apb2);
+  uint32_t prescaler = 0;
+  uint32_t period = 0;
+  if (!compute_timebase(clock_hz, cfg->m_frequency_hz, prescaler, period)) {
+    return expected::unexpected(RU_ERROR(PwmError::invalid_frequency, "unsupported frequency"));
+  }
+  uint32_t dtg = 0;
+  uint32_t ckd = 0;
+  if (cfg->m_dead_time_ns && !complementary) {
+    return expected::unexpected(
+        RU_ERROR(PwmError::not_supported, "dead time without complementary output"));
+  }
+  if (!compute_dead_time(clock_hz, cfg->m_dead_time_ns, dtg, ckd)) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "dead time too long"));
+  }
+
+  const size_t index = static_cast<size_t>(timer - pwm_hw);
+  if (group_owner[index] && group_owner[index] != p_instance_specific) {
+    return expected::unexpected(RU_ERROR(CommonError::busy, "pwm group already in use"));
+  }
+
+  if (p_instance_specific) {
+    (void)stop();
+  }
+  p_instance_specific = new PwmGroupInstanceSpecific();
+
+  auto* hw = p_instance_specific;
+  hw->hw = timer;
+  hw->burst = find_burst(cfg->m_id);
+  hw->clock_hz = clock_hz;
+  hw->prescaler = prescaler;
+  hw->period = period;
+  hw->count = channels.size();
+  hw->first_channel = 4;
+  hw->last_channel = 1;
+  for (size_t i = 0; i < hw->count; ++i) {
+    hw->channels[i] = channels[i];
+    hw->staged_permille[i] = 0;
+    hw->duty_permille[i] = 0;
+    if (channels[i].channel < hw->first_channel) {
+      hw->first_channel = channels[i].channel;
+    }
+    if (channels[i].channel > hw->last_channel) {
+      hw->last_channel = channels[i].channel;
+    }
+  }
+  hw->waveform = false;
+  hw->waveform_failed = false;
+
+  *timer->clock_enable |= timer->clock_enable_bit;
+  (void)*timer->clock_enable;
+
+  TIM_TypeDef* tim = timer->tim;
+  tim->CR1 = TIM_CR1_ARPE | (ckd << TIM_CR1_CKD_Pos);
+  tim->CR2 = 0;
+  tim->DIER = 0;
+  tim->PSC = prescaler - 1;
+  tim->ARR = period - 1;
+  uint32_t ccer = 0;
+  uint32_t idle = 0;
+  for (const PwmGroupChannel& c : channels) {
+    set_oc_mode(tim, c.channel, oc_mode_pwm1);
+    uint32_t bits = TIM_CCER_CC1E;
+    if (c.complementary) {
+      bits |= TIM_CCER_CC1NE;
+    }
+    if (c.polarity == PwmPolarity::active_low) {
+      bits |= TIM_CCER_CC1P | (c.complementary ? TIM_CCER_CC1NP : 0);
+      // Idle at the inactive level: high for both outputs of the channel
+      idle |= (TIM_CR2_OIS1 | (c.complementary ? TIM_CR2_OIS1N : 0)) << (2 * (c.channel - 1));
+    }
+    ccer |= bits << (4 * (c.channel - 1));
+  }
+  tim->CCER = ccer;
+  write_group_compares(hw);
+  // Load the preloaded registers now, not at the first overflow
+  tim->EGR = TIM_EGR_UG;
+  if (timer->advanced) {
+    // Dead time, the outputs driven at their inactive level while the timer
+    // runs with a channel off (OSSR) and at their idle level (CR2.OISx/OISxN,
+    // after the dead time) while MOE is low (OSSI). MOE is set by enable().
+    tim->CR2 = idle;
+    tim->BDTR = (dtg << TIM_BDTR_DTG_Pos) | TIM_BDTR_OSSR | TIM_BDTR_OSSI;
+  }
+
+  if (hw->burst) {
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPDMA2EN;
+    (void)RCC->AHB1ENR;
+    hw->burst->dma->CCR = DMA_CCR_RESET;
+    hw->burst->dma->CFCR = dma_clear_flags;
+    NVIC_SetPriority(hw->burst->dma_irq, hw->burst->irq_priority);
+    NVIC_EnableIRQ(hw->burst->dma_irq);
+    burst_owner[hw->burst - pwm_burst_hw] = hw;
+  }
+
+  group_owner[index] = hw;
+  return {};
+}
+
+expected::expected<void, Error> PwmGroup::stop() {
+  auto* hw = p_instance_specific;
+  if (hw) {
+    TIM_TypeDef* tim = hw->hw->tim;
+    if (hw->burst) {
+      stop_burst(hw);
+      NVIC_DisableIRQ(hw->burst->dma_irq);
+      burst_owner[hw->burst - pwm_burst_hw] = nullptr;
+    }
+    tim->CR1 = 0;
+    tim->CR2 = 0;
+    tim->DIER = 0;
+    tim->CCER = 0;
+    if (hw->hw->advanced) {
+      tim->BDTR = 0;
+    }
+    group_owner[hw->hw - pwm_hw] = nullptr;
+  }
+  delete hw;
+  p_instance_specific = nullptr;
+  return {};
+}
+
+expected::expected<void, Error> PwmGroup::enable() {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "pwm group not initialized"));
+  }
+  TIM_TypeDef* tim = hw->hw->tim;
+  tim->CR1 |= TIM_CR1_CEN;
+  if (hw->hw->advanced) {
+    tim->BDTR |= TIM_BDTR_MOE;
+  }
+  return {};
+}
+
+expected::expected<void, Error> PwmGroup::disable() {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "pwm group not initialized"));
+  }
+  TIM_TypeDef* tim = hw->hw->tim;
+  if (hw->hw->advanced) {
+    // Outputs to their idle level first, whatever the counter stops at
+    tim->BDTR &= ~TIM_BDTR_MOE;
+  }
+  tim->CR1 &= ~TIM_CR1_CEN;
+  return {};
+}
+
+expected::expected<void, Error> PwmGroup::set_frequency(uint32_t frequency_hz) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "pwm group not initialized"));
+  }
+  if (hw->waveform) {
+    return expected::unexpected(RU_ERROR(CommonError::busy, "pwm waveform playing"));
+  }
+
+  uint32_t prescaler = 0;
+  uint32_t period = 0;
+  if (!compute_timebase(hw->clock_hz, frequency_hz, prescaler, period)) {
+    return expected::unexpected(RU_ERROR(PwmError::invalid_frequency, "unsupported frequency"));
+  }
+
+  // The staged duties stay staged: only the committed ones follow the period
+  commit_duties(hw, hw->duty_permille, prescaler, period);
+  return {};
+}
+
+expected::expected<void, Error> PwmGroup::stage(size_t index, uint16_t duty_cycle_permille) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "pwm group not initialized"));
+  }
+  if (index >= hw->count) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid pwm group index"));
+  }
+  if (duty_cycle_permille > max_permille) {
+    return expected::unexpected(RU_ERROR(PwmError::invalid_duty_cycle, "duty cycle above 1000"));
+  }
+  hw->staged_permille[index] = duty_cycle_permille;
+  return {};
+}
+
+expected::expected<void, Error> PwmGroup::commit() {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "pwm group not initialized"));
+  }
+  if (hw->waveform) {
+    return expected::unexpected(RU_ERROR(CommonError::busy, "pwm waveform playing"));
+  }
+  commit_duties(hw, hw->staged_permille, hw->prescaler, hw->period);
+  return {};
+}
+
+expected::expected<void, Error>
+PwmGroup::set_duty_cycles(std::span<const uint16_t> duty_cycle_permille) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "pwm group not initialized"));
+  }
+  if (duty_cycle_permille.size() != hw->count) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "one duty per pwm channel"));
+  }
+  for (size_t i = 0; i < hw->count; ++i) {
+    auto staged = stage(i, duty_cycle_permille[i]);
+    if (!staged) {
+      return staged;
+    }
+  }
+  return commit();
+}
+
+expected::expected<uint16_t, Error> PwmGroup::get_duty_cycle(size_t index) const {
+  const auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "pwm group not initialized"));
+  }
+  if (index >= hw->count) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid pwm group index"));
+  }
+  return hw->duty_permille[index];
+}
+
+expected::expected<size_t, Error> PwmGroup::waveform_row_words() const {
+  const auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "pwm group not initialized"));
+  }
+  return static_cast<size_t>(hw->last_channel - hw->first_channel + 1);
+}
+
+expected::expected<uint32_t, Error> PwmGroup::compare_of(uint16_t duty_cycle_permille) const {
+  const auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "pwm group not initialized"));
+  }
+  if (duty_cycle_permille > max_permille) {
+    return expected::unexpected(RU_ERROR(PwmError::invalid_duty_cycle, "duty cycle above 1000"));
+  }
+  return permille_of(hw->period, duty_cycle_permille);
+}
+
+expected::expected<void, Error> PwmGroup::play_waveform(std::span<const uint32_t> table,
+                                                        bool loop) {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "pwm group not initialized"));
+  }
+  if (!hw->burst) {
+    return expected::unexpected(RU_ERROR(PwmError::not_supported, "pwm group without burst dma"));
+  }
+  if (hw->waveform) {
+    return expected::unexpected(RU_ERROR(CommonError::busy, "pwm waveform playing"));
+  }
+  const size_t row = static_cast<size_t>(hw->last_channel - hw->first_channel + 1);
+  const size_t bytes = table.size_bytes();
+  if (table.empty() || table.size() % row || bytes > max_burst_bytes) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid waveform table"));
+  }
+
+  TIM_TypeDef* tim = hw->hw->tim;
+  DMA_Channel_TypeDef* dma = hw->burst->dma;
+  const uint32_t node = reinterpret_cast<uint32_t>(&hw->node);
+  const uint32_t source = reinterpret_cast<uint32_t>(table.data());
+
+  // Each update request makes the timer write `row` words through DMAR into
+  // its registers from the first channel's CCR, one DMA request per word
+  const uint32_t base =
+      static_cast<uint32_t>(&compare_register(tim, hw->first_channel) - &tim->CR1);
+  tim->DCR = (base << TIM_DCR_DBA_Pos) | ((row - 1) << TIM_DCR_DBL_Pos) |
+             (dbss_update << TIM_DCR_DBSS_Pos);
+
+  dma->CCR = DMA_CCR_RESET;
+  dma->CFCR = dma_clear_flags;
+  hw->node.cbr1 = bytes;
+  hw->node.csar = source;
+  hw->node.cllr = DMA_CLLR_UB1 | DMA_CLLR_USA | DMA_CLLR_ULL | (node & DMA_CLLR_LA);
+
+  // Word to word, incrementing memory to the timer, paced by its requests
+  dma->CTR1 = DMA_CTR1_SDW_LOG2_1 | DMA_CTR1_DDW_LOG2_1 | DMA_CTR1_SINC;
+  dma->CTR2 = ((hw->burst->request << DMA_CTR2_REQSEL_Pos) & DMA_CTR2_REQSEL) | DMA_CTR2_DREQ;
+  dma->CBR1 = bytes;
+  dma->CSAR = source;
+  dma->CDAR = reinterpret_cast<uint32_t>(&tim->DMAR);
+  dma->CLBAR = node & DMA_CLBAR_LBA;
+  dma->CLLR = loop ? hw->node.cllr : 0;
+
+  hw->waveform_failed = false;
+  hw->waveform = true;
+  dma->CCR = DMA_CCR_DTEIE | DMA_CCR_ULEIE | DMA_CCR_USEIE;
+  dma->CCR |= DMA_CCR_EN;
+  tim->DIER |= TIM_DIER_UDE;
+  return {};
+}
+
+expected::expected<void, Error> PwmGroup::stop_waveform() {
+  auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "pwm group not initialized"));
+  }
+  if (!hw->waveform) {
+    return {};
+  }
+  stop_burst(hw);
+  hw->waveform = false;
+  commit_duties(hw, hw->duty_permille, hw->prescaler, hw->period);
+  return {};
+}
+
+expected::expected<bool, Error> PwmGroup::waveform_running() const {
+  const auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "pwm group not initialized"));
+  }
+  if (hw->waveform_failed) {
+    return expected::unexpected(RU_ERROR(CommonError::general_error, "pwm waveform dma error"));
+  }
+  // A one-shot table leaves the channel idle after its last row
+  return hw->waveform && !(hw->burst->dma->CSR & DMA_CSR_IDLEF);
 }
 
 } // namespace ru::driver
+
+#define X_pwm_instance(index, id, periph, bus, advanced, channel, sync_channel, adc_trigger)
+#define X_pwm_burst(index, id, periph, dma_channel, irq_priority)      \
+  extern "C" void GPDMA2_Channel##dma_channel##_IRQHandler(void) {     \
+    ru::driver::handle_burst_irq(index);                               \
+  }
+#include "pwm_instances.hpp"
+#undef X_pwm_burst
+#undef X_pwm_instance
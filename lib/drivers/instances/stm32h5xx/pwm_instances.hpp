@@ -0,0 +1,29 @@
+// PWM timers of the board, generated by generate.py from the 'pwm' module of
+// config.yaml. Do not edit, regenerate instead.
+//
+// X_pwm_instance(index, id, periph, bus, advanced, channel, sync_channel, adc_trigger)
+// - id:           PwmId bound to the timer
+// - periph:       TIM instance
+// - bus:          peripheral bus of the timer clock (APB1L or APB2)
+// - advanced:     1 for an advanced control timer (main output enable)
+// - channel:      compare channel of the PWM output, 0 for a PwmGroup timer
+// - sync_channel: compare channel routed to TRGO by Pwm::adc_trigger
+// - adc_trigger:  ADC1/ADC2 external trigger (EXTSEL) of the timer's TRGO
+//
+// X_pwm_burst(index, id, periph, dma_channel, irq_priority)
+// - id:           PwmId of a group timer playing waveform tables
+// - periph:       TIM instance, whose update request paces the DMA
+// - dma_channel:  GPDMA2 channel of the burst
+// - irq_priority: NVIC priority of its (error) interrupt
+
+#ifndef X_pwm_instance
+#define X_pwm_instance(index, id, periph, bus, advanced, channel, sync_channel, adc_trigger)
+#endif
+#ifndef X_pwm_burst
+#define X_pwm_burst(index, id, periph, dma_channel, irq_priority)
+#endif
+
+X_pwm_instance(0, pump_pwm, TIM1, APB2, 1, 1, 4, 9)
+X_pwm_instance(1, inverter_pwm, TIM8, APB2, 1, 0, 0, 7)
+
+X_pwm_burst(0, inverter_pwm, TIM8, 2, 6)
\ No newline at end of file
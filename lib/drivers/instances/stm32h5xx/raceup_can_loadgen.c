@@ -0,0 +1,341 @@
+/**
+ * @file raceup_can_loadgen.c
+ * @date 2026
+ * @brief Implementation of the RaceUp CAN Traffic Generator.
+ * * @details
+ * The generator is a cooperative scheduler driven by `RUP_CANLOAD_Poll`:
+ * * - **Time Base:** The DWT cycle counter (enabled by `RUP_FDCAN_Init`) is accumulated
+ * into a 64-bit elapsed time, so tests may outlast a 32-bit counter wrap.
+ * - **Scheduling:** Periodic bursts are released at their due time and sent first,
+ * in profile order. Saturating streams (period 0) then share the remaining Tx FIFO
+ * slots round-robin, which keeps the FIFO, and therefore the bus, always busy.
+ * - **Rx Accounting:** The generator owns one Rx subscriber, registered for the stream
+ * IDs for the duration of a test; after the last release it keeps counting for a few
+ * frame times so frames still in the Tx FIFO are not reported as lost.
+ * - **CPU Load:** Interrupt cost comes from `RUP_FDCAN_GetIsrCycles`, generator cost
+ * from the time spent inside `RUP_CANLOAD_Poll`.
+ */
+
+#include "raceup_can_loadgen.h"
+#include "main.h"
+#include <string.h>
+
+/* Private Defines -----------------------------------------------------------*/
+
+/** @brief Nominal length of a Classic CAN standard frame incl. interframe space (bits) */
+#define FRAME_BITS(len)         (47U + (8U * (uint32_t)(len)))
+
+/** @brief Frame times waited after the last release (Tx FIFO depth + frame on the wire) */
+#define SETTLE_FRAMES           4U
+
+/** @brief Payload filler: alternating bits never trigger bit stuffing */
+#define PAYLOAD_FILLER          0x55U
+
+/* Private Types -------------------------------------------------------------*/
+
+/**
+ * @brief  Run-time state of a stream.
+ * @internal
+ */
+typedef struct {
+    uint64_t NextReleaseUs;     /*!< Due time of the next burst */
+    uint32_t Pending;           /*!< Frames of the current burst not sent yet */
+    uint16_t Seq;               /*!< Sequence number of the next frame */
+    uint8_t  DlcIndex;          /*!< Next entry of the DLC mix */
+} Stream_StateTypeDef;
+
+/* Private Variables ---------------------------------------------------------*/
+
+static struct {
+    FDCAN_GlobalTypeDef *Instance;
+    const RUP_CANLOAD_ProfileTypeDef *Profile;
+    RUP_CANLOAD_StateTypeDef State;
+    uint8_t Settling;                   /*!< Releases are over, only Rx is counted */
+    uint8_t SaturateNext;               /*!< Round-robin cursor over saturating streams */
+    Stream_StateTypeDef Streams[RUP_CANLOAD_MAX_STREAMS];
+
+    uint32_t CyclesPerUs;
+    uint32_t LastCycles;
+    uint64_t ElapsedCycles;             /*!< Time since start */
+    uint64_t TxEndCycles;               /*!< Time of the end of the generation phase */
+    uint64_t SettleEndUs;
+    uint64_t BusyCycles;                /*!< Time spent inside RUP_CANLOAD_Poll */
+    uint64_t TxBits;
+    uint32_t IsrStartCycles;
+    uint32_t IsrCycles;
+
+    RUP_CANLOAD_ReportTypeDef Report;   /*!< Raw counters, completed on finish */
+} LoadGen;
+
+static RUP_FDCAN_FrameTypeDef RxRing[RUP_CANLOAD_RX_RING_LENGTH];
+static RUP_FDCAN_SubscriberTypeDef RxSubscriber;
+
+/* Private Functions ---------------------------------------------------------*/
+
+/**
+ * @brief  Checks a profile before running it.
+ * @internal
+ */
+static uint8_t Is_Profile_Valid(const RUP_CANLOAD_ProfileTypeDef *profile) {
+    if (!profile || !profile->streams || profile->bitrate == 0U ||
+        profile->count == 0U || profile->count > RUP_CANLOAD_MAX_STREAMS) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < profile->count; i++) {
+        const RUP_CANLOAD_StreamTypeDef *stream = &profile->streams[i];
+
+        if (stream->id >= RUP_FDCAN_STD_ID_COUNT || stream->burst == 0U ||
+            stream->dlc_count == 0U || stream->dlc_count > RUP_CANLOAD_MAX_DLC_MIX) {
+            return 0;
+        }
+        for (uint32_t d = 0; d < stream->dlc_count; d++) {
+            if (stream->dlc[d] > 8U) return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief  Queues the next frame of a stream in the Tx FIFO.
+ * @internal
+ * @return 1 if the frame was accepted, 0 if the Tx FIFO is full.
+ */
+static uint8_t Send_Frame(uint32_t index) {
+    const RUP_CANLOAD_StreamTypeDef *stream = &LoadGen.Profile->streams[index];
+    Stream_StateTypeDef *st = &LoadGen.Streams[index];
+    uint8_t len = stream->dlc[st->DlcIndex];
+    uint8_t data[8];
+
+    memset(data, PAYLOAD_FILLER, sizeof(data));
+    data[0] = (uint8_t)st->Seq;
+    data[1] = (uint8_t)(st->Seq >> 8);
+
+    if (RUP_FDCAN_Send(LoadGen.Instance, stream->id, data, len) != RUP_FDCAN_OK) {
+        return 0;
+    }
+
+    st->Seq++;
+    st->DlcIndex = (uint8_t)((st->DlcIndex + 1U) % stream->dlc_count);
+    LoadGen.Report.tx_frames++;
+    LoadGen.TxBits += FRAME_BITS(len);
+    return 1;
+}
+
+/**
+ * @brief  Releases the bursts that are due.
+ * @internal
+ */
+static void Release_Bursts(uint64_t nowUs) {
+    for (uint32_t i = 0; i < LoadGen.Profile->count; i++) {
+        const RUP_CANLOAD_StreamTypeDef *stream = &LoadGen.Profile->streams[i];
+        Stream_StateTypeDef *st = &LoadGen.Streams[i];
+
+        if (stream->period_us == 0U) continue;
+
+        while (nowUs >= st->NextReleaseUs) {
+            // The previous burst is still queued: the bus (or the poll rate) cannot keep up
+            if (st->Pending != 0U) {
+                LoadGen.Report.tx_overruns++;
+            }
+            st->Pending = stream->burst;
+            st->NextReleaseUs += stream->period_us;
+        }
+    }
+}
+
+/**
+ * @brief  Fills the Tx FIFO: pending bursts first, then saturating streams.
+ * @internal
+ */
+static void Fill_Tx_Fifo(void) {
+    const RUP_CANLOAD_ProfileTypeDef *profile = LoadGen.Profile;
+    uint32_t saturating = 0;
+
+    for (uint32_t i = 0; i < profile->count; i++) {
+        if (profile->streams[i].period_us == 0U) {
+            saturating++;
+            continue;
+        }
+        while (LoadGen.Streams[i].Pending != 0U) {
+            if (!Send_Frame(i)) {
+                LoadGen.Report.tx_deferred++;
+                return;
+            }
+            LoadGen.Streams[i].Pending--;
+        }
+    }
+
+    // Background load: one frame per saturating stream in turn until the FIFO is full
+    while (saturating != 0U) {
+        uint32_t i = LoadGen.SaturateNext;
+        LoadGen.SaturateNext = (uint8_t)((i + 1U) % profile->count);
+
+        if (profile->streams[i].period_us != 0U) continue;
+        if (!Send_Frame(i)) return;
+    }
+}
+
+/**
+ * @brief  Counts the generated frames received back.
+ * @internal
+ */
+static void Drain_Rx(void) {
+    RUP_FDCAN_FrameTypeDef frame;
+
+    while (RUP_FDCAN_SubscriberPop(&RxSubscriber, &frame)) {
+        LoadGen.Report.rx_frames++;
+    }
+}
+
+/**
+ * @brief  Ends the generation phase and snapshots the timing figures.
+ * @internal
+ */
+static void End_Generation(void) {
+    LoadGen.Settling = 1;
+    LoadGen.TxEndCycles = LoadGen.ElapsedCycles;
+    LoadGen.IsrCycles = RUP_FDCAN_GetIsrCycles(LoadGen.Instance) - LoadGen.IsrStartCycles;
+
+    uint64_t frameUs = ((uint64_t)FRAME_BITS(8U) * 1000000U) / LoadGen.Profile->bitrate;
+    LoadGen.SettleEndUs = (LoadGen.ElapsedCycles / LoadGen.CyclesPerUs) + (SETTLE_FRAMES * frameUs) + 1U;
+}
+
+/**
+ * @brief  Removes the stream IDs of a profile from the Rx subscriber.
+ * @internal
+ */
+static void Unsubscribe_Streams(FDCAN_GlobalTypeDef *Instance, const RUP_CANLOAD_ProfileTypeDef *profile) {
+    for (uint32_t i = 0; i < profile->count; i++) {
+        uint16_t id = profile->streams[i].id;
+        (void)RUP_FDCAN_Unsubscribe(Instance, &RxSubscriber, id, id);
+    }
+}
+
+/**
+ * @brief  Completes the report, releases the stream IDs and leaves loopback.
+ * @internal
+ */
+static void Finish(void) {
+    RUP_CANLOAD_ReportTypeDef *report = &LoadGen.Report;
+    uint64_t elapsedCycles = (LoadGen.TxEndCycles != 0U) ? LoadGen.TxEndCycles : 1U;
+    uint64_t elapsedUs = elapsedCycles / LoadGen.CyclesPerUs;
+
+    if (elapsedUs == 0U) elapsedUs = 1U;
+
+    Drain_Rx();
+    Unsubscribe_Streams(LoadGen.Instance, LoadGen.Profile);
+
+    report->elapsed_us = (uint32_t)elapsedUs;
+    report->rx_lost = (report->tx_frames > report->rx_frames) ? (report->tx_frames - report->rx_frames) : 0U;
+    report->frame_rate = (uint32_t)(((uint64_t)report->tx_frames * 1000000U) / elapsedUs);
+    report->bus_load_permille = (uint32_t)((LoadGen.TxBits * 1000000U * 1000U) /
+                                           ((uint64_t)LoadGen.Profile->bitrate * elapsedUs));
+    report->isr_load_permille = (uint32_t)(((uint64_t)LoadGen.IsrCycles * 1000U) / elapsedCycles);
+    report->gen_load_permille = (uint32_t)((LoadGen.BusyCycles * 1000U) / elapsedCycles);
+
+    if (LoadGen.Profile->loopback) {
+        (void)RUP_FDCAN_SetLoopback(LoadGen.Instance, 0);
+    }
+    LoadGen.State = RUP_CANLOAD_DONE;
+}
+
+/* Public Function Implementation --------------------------------------------*/
+
+RUP_FDCAN_StatusTypeDef RUP_CANLOAD_Start(FDCAN_GlobalTypeDef *Instance, const RUP_CANLOAD_ProfileTypeDef *profile) {
+    if (LoadGen.State == RUP_CANLOAD_RUNNING) return RUP_FDCAN_BUSY;
+    if (!Instance || !Is_Profile_Valid(profile)) return RUP_FDCAN_ERROR;
+
+    // 1. Rx accounting: the subscriber slot is taken once and reused by later tests,
+    // the stream IDs are released by Finish()
+    if (RxSubscriber.Ring == NULL &&
+        RUP_FDCAN_SubscriberInit(&RxSubscriber, RxRing, RUP_CANLOAD_RX_RING_LENGTH, NULL, NULL) != RUP_FDCAN_OK) {
+        return RUP_FDCAN_ERROR;
+    }
+    for (uint32_t i = 0; i < profile->count; i++) {
+        uint16_t id = profile->streams[i].id;
+        if (RUP_FDCAN_Subscribe(Instance, &RxSubscriber, id, id) != RUP_FDCAN_OK) {
+            Unsubscribe_Streams(Instance, profile);
+            return RUP_FDCAN_ERROR;
+        }
+    }
+
+    // 2. Test mode
+    if (profile->loopback) {
+        RUP_FDCAN_StatusTypeDef status = RUP_FDCAN_SetLoopback(Instance, 1);
+        if (status != RUP_FDCAN_OK) {
+            Unsubscribe_Streams(Instance, profile);
+            return status;
+        }
+    }
+
+    // 3. Fresh state (frames left over from a previous test are discarded)
+    RUP_FDCAN_FrameTypeDef stale;
+    while (RUP_FDCAN_SubscriberPop(&RxSubscriber, &stale)) {
+    }
+
+    memset(&LoadGen, 0, sizeof(LoadGen));
+    LoadGen.Instance = Instance;
+    LoadGen.Profile = profile;
+    for (uint32_t i = 0; i < profile->count; i++) {
+        LoadGen.Streams[i].NextReleaseUs = profile->streams[i].offset_us;
+    }
+
+    LoadGen.CyclesPerUs = SystemCoreClock / 1000000U;
+    if (LoadGen.CyclesPerUs == 0U) LoadGen.CyclesPerUs = 1U;
+
+    LoadGen.IsrStartCycles = RUP_FDCAN_GetIsrCycles(Instance);
+    LoadGen.LastCycles = DWT->CYCCNT;
+    LoadGen.State = RUP_CANLOAD_RUNNING;
+    return RUP_FDCAN_OK;
+}
+
+RUP_CANLOAD_StateTypeDef RUP_CANLOAD_Poll(void) {
+    if (LoadGen.State != RUP_CANLOAD_RUNNING) return LoadGen.State;
+
+    uint32_t start = DWT->CYCCNT;
+    LoadGen.ElapsedCycles += (uint32_t)(start - LoadGen.LastCycles);
+    LoadGen.LastCycles = start;
+
+    uint64_t nowUs = LoadGen.ElapsedCycles / LoadGen.CyclesPerUs;
+
+    if (!LoadGen.Settling) {
+        // 1. Generation phase
+        Release_Bursts(nowUs);
+        Fill_Tx_Fifo();
+        Drain_Rx();
+        LoadGen.BusyCycles += (uint32_t)(DWT->CYCCNT - start);
+
+        if (nowUs >= ((uint64_t)LoadGen.Profile->duration_ms * 1000U)) {
+            End_Generation();
+        }
+    } else {
+        // 2. Settling: collect the frames still in flight
+        Drain_Rx();
+        if (nowUs >= LoadGen.SettleEndUs) {
+            Finish();
+        }
+    }
+
+    return LoadGen.State;
+}
+
+void RUP_CANLOAD_Stop(void) {
+    if (LoadGen.State != RUP_CANLOAD_RUNNING) return;
+
+    if (!LoadGen.Settling) {
+        LoadGen.ElapsedCycles += (uint32_t)(DWT->CYCCNT - LoadGen.LastCycles);
+        End_Generation();
+    }
+    Finish();
+}
+
+RUP_FDCAN_StatusTypeDef RUP_CANLOAD_GetReport(RUP_CANLOAD_ReportTypeDef *report) {
+    if (!report) return RUP_FDCAN_ERROR;
+    if (LoadGen.State == RUP_CANLOAD_RUNNING) return RUP_FDCAN_BUSY;
+    if (LoadGen.State != RUP_CANLOAD_DONE) return RUP_FDCAN_ERROR;
+
+    *report = LoadGen.Report;
+    LoadGen.State = RUP_CANLOAD_IDLE;
+    return RUP_FDCAN_OK;
+}
@@ -16,12 +16,54 @@
  * - **Interrupt Routing:** The driver overrides the weak HAL callbacks (e.g., 
  * `HAL_FDCAN_RxFifo0Callback`) to look up the correct wrapper handle and execute 
  * the user's specific callback function.
+ * - **Acceptance Bitmap:** Frames read from the Rx FIFOs are checked against the
+ * optional software acceptance bitmap before any callback runs, so IDs that the
+ * 28 hardware filter elements cannot express exactly are dropped in the ISR.
+ * - **Rx Fan-out:** Each accepted frame is pushed into the ring of every subscriber
+ * whose bit is set in the precomputed ID -> subscriber mask, so consumers never share
+ * a queue and a slow one only overflows (and counts drops in) its own ring.
+ * - **High Priority Fast Lane:** Frames matched by an HP filter are read from message RAM
+ * by index as soon as they are flagged, without waiting for older frames in the FIFO, and
+ * handed to a dedicated handler or task. The drain loop skips them afterwards.
+ * - **Filter Sets:** Precompiled message RAM images are swapped in a single, measured
+ * INIT/CCE window (see `RUP_FDCAN_ApplyFilterSet`).
  */
 
 #include "raceup_fdcan.h"
+#include "cycle_counter.h"
 #include "main.h"
 #include <string.h>
 
+/* Private Defines -----------------------------------------------------------*/
+
+/** @brief Size of an Rx FIFO element in message RAM (2 header + 16 data words) */
+#define RX_ELEMENT_WORDS        18U
+
+/* Rx FIFO element header fields (RM0481, Rx FIFO element) */
+#define RX_ELEMENT_R0_XTD       (1UL << 30)
+#define RX_ELEMENT_R0_STDID_Pos 18U
+#define RX_ELEMENT_R1_ANMF      (1UL << 31)
+#define RX_ELEMENT_R1_FIDX_Pos  24U
+#define RX_ELEMENT_R1_DLC_Pos   16U
+
+/** @brief Tx FIFO elements in message RAM and their size (same layout as Rx) */
+#define TX_FIFO_ELEMENTS        3U
+#define TX_ELEMENT_WORDS        18U
+
+/** @brief Words of a pending Tx element kept across a CCE window (2 header + 8 data bytes) */
+#define TX_SAVED_WORDS          4U
+
+/* Private Types -------------------------------------------------------------*/
+
+/**
+ * @brief  Tx requests still pending when a configuration window starts, oldest first.
+ * @internal
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t words[TX_FIFO_ELEMENTS][TX_SAVED_WORDS];
+} Pending_Tx_TypeDef;
+
 /* Private Variables ---------------------------------------------------------*/
 
 /** @brief Wrapper handle for FDCAN1 */
@@ -113,6 +155,513 @@ static uint8_t Get_Len_From_DLC(uint32_t dlc) {
     }
 }
 
+/**
+ * @brief  Applies the software acceptance bitmap to a received frame.
+ * @internal
+ * @param  hWrapper Wrapper handle the frame was received on.
+ * @param  RxHeader Header of the received frame.
+ * @return 1 if the frame must be delivered, 0 if it has been dropped.
+ */
+static uint8_t Is_Frame_Accepted(RUP_FDCAN_HandleTypeDef *hWrapper, const FDCAN_RxHeaderTypeDef *RxHeader) {
+    const RUP_FDCAN_AcceptBitmapTypeDef *bitmap = hWrapper->AcceptBitmap;
+
+    if (bitmap == NULL) {
+        return 1;
+    }
+
+    if (RxHeader->IdType == FDCAN_STANDARD_ID &&
+        RUP_FDCAN_BitmapTest(bitmap, (uint16_t)RxHeader->Identifier)) {
+        return 1;
+    }
+
+    hWrapper->BitmapRejected++;
+    return 0;
+}
+
+/**
+ * @brief  Queues a frame into a subscriber ring (ISR side, single producer).
+ * @internal
+ */
+static void Subscriber_Push(RUP_FDCAN_SubscriberTypeDef *sub, uint16_t id, const uint8_t *data, uint8_t len, uint32_t timestamp) {
+    uint16_t head = sub->Head;
+    uint16_t next = (uint16_t)((head + 1U) & sub->RingMask);
+
+    if (next == sub->Tail) {
+        sub->Dropped++;
+        return;
+    }
+
+    RUP_FDCAN_FrameTypeDef *slot = &sub->Ring[head];
+    slot->id = id;
+    slot->len = len;
+    slot->timestamp = timestamp;
+    memcpy(slot->data, data, len);
+
+    // Publish the slot contents before the new head
+    __DMB();
+    sub->Head = next;
+
+    if (sub->Notify != NULL) {
+        sub->Notify(sub->NotifyCtx);
+    }
+}
+
+/**
+ * @brief  Delivers an accepted frame to the subscribers and the FIFO callback.
+ * @internal
+ */
+static void Dispatch_Frame(RUP_FDCAN_HandleTypeDef *hWrapper, RUP_FDCAN_RxFifoTypeDef RxFifo,
+                           const FDCAN_RxHeaderTypeDef *RxHeader, uint8_t *RxData) {
+    uint16_t id = (uint16_t)RxHeader->Identifier;
+    uint8_t len = Get_Len_From_DLC(RxHeader->DataLength);
+    uint32_t timestamp = DWT->CYCCNT;
+
+    // 1. Fan-out: one table lookup, then only the subscribers that asked for this ID
+    if (RxHeader->IdType == FDCAN_STANDARD_ID) {
+        uint32_t mask = hWrapper->SubscriberMask[id & (RUP_FDCAN_STD_ID_COUNT - 1U)];
+        while (mask != 0U) {
+            uint32_t slot = (uint32_t)__builtin_ctz(mask);
+            mask &= mask - 1U;
+            Subscriber_Push(hWrapper->Subscribers[slot], id, RxData, len, timestamp);
+        }
+    }
+
+    // 2. Per-FIFO user callback
+    if (RxFifo == RUP_FDCAN_RX_FIFO0) {
+        if (hWrapper->RxFIFO0Callback != NULL) {
+            hWrapper->RxFIFO0Callback(id, RxData, len);
+        }
+    }
+    else if (RxFifo == RUP_FDCAN_RX_FIFO1) {
+        if (hWrapper->RxFIFO1Callback != NULL) {
+            hWrapper->RxFIFO1Callback(id, RxData, len);
+        }
+    }
+}
+
+/**
+ * @brief  Checks whether the High Priority fast lane has a consumer.
+ * @internal
+ */
+static uint8_t Is_Hp_Lane_Active(const RUP_FDCAN_HandleTypeDef *hWrapper) {
+    return (uint8_t)(hWrapper->HpFilterMask != 0U &&
+                     (hWrapper->HpFrameCallback != NULL || hWrapper->HpSubscriber != NULL));
+}
+
+/**
+ * @brief  Checks whether a standard filter element stores as High Priority.
+ * @internal
+ */
+static uint8_t Is_Hp_Filter(const RUP_FDCAN_HandleTypeDef *hWrapper, uint32_t filterIndex) {
+    return (uint8_t)(filterIndex < RUP_FDCAN_STD_FILTER_NBR && ((hWrapper->HpFilterMask >> filterIndex) & 1U) != 0U);
+}
+
+/**
+ * @brief  Reads the Rx FIFO status register (fill level and get index).
+ * @internal
+ * @note   RXF0S and RXF1S share the same layout, so the FIFO0 field masks apply to both.
+ */
+static uint32_t Get_Rx_Fifo_Status(const RUP_FDCAN_HandleTypeDef *hWrapper, RUP_FDCAN_RxFifoTypeDef RxFifo) {
+    FDCAN_GlobalTypeDef *Instance = hWrapper->hfdcan.Instance;
+    return (RxFifo == RUP_FDCAN_RX_FIFO0) ? Instance->RXF0S : Instance->RXF1S;
+}
+
+/**
+ * @brief  Records the latency from receipt of a High Priority frame in one path's histogram.
+ * @internal
+ * @note   Each path has a single writer: the Rx ISR for the handler, the HP task for HpPop.
+ */
+static void Record_Hp_Latency(const RUP_FDCAN_HandleTypeDef *hWrapper, RUP_FDCAN_HpLatencyTypeDef *latency,
+                              const RUP_FDCAN_FrameTypeDef *frame) {
+    uint32_t cycles = DWT->CYCCNT - frame->timestamp;
+    uint32_t us = cycles / hWrapper->HpCyclesPerUs;
+    // 0 below 1 us, then one bucket per power of two
+    uint32_t bucket = (us == 0U) ? 0U : (32U - (uint32_t)__builtin_clz(us));
+
+    if (bucket >= RUP_FDCAN_HP_LATENCY_BUCKETS) {
+        bucket = RUP_FDCAN_HP_LATENCY_BUCKETS - 1U;
+    }
+    latency->count++;
+    latency->buckets[bucket]++;
+    latency->last_cycles = cycles;
+    if (cycles > latency->max_cycles) {
+        latency->max_cycles = cycles;
+    }
+}
+
+/**
+ * @brief  Hands a High Priority frame to the fast lane consumer(s).
+ * @internal
+ */
+static void Deliver_Hp_Frame(RUP_FDCAN_HandleTypeDef *hWrapper, const RUP_FDCAN_FrameTypeDef *frame) {
+    hWrapper->HpFrames++;
+
+    if (hWrapper->HpFrameCallback != NULL) {
+        Record_Hp_Latency(hWrapper, &hWrapper->HpHandlerLatency, frame);
+        hWrapper->HpFrameCallback(frame);
+    }
+    if (hWrapper->HpSubscriber != NULL) {
+        Subscriber_Push(hWrapper->HpSubscriber, frame->id, frame->data, frame->len, frame->timestamp);
+    }
+}
+
+/**
+ * @brief  Reads an Rx FIFO element straight from message RAM, without acknowledging it.
+ * @internal
+ * @return 1 if the element holds a Standard ID frame matched by a filter, 0 otherwise.
+ */
+static uint8_t Read_Rx_Element(const RUP_FDCAN_HandleTypeDef *hWrapper, RUP_FDCAN_RxFifoTypeDef RxFifo,
+                               uint32_t index, RUP_FDCAN_FrameTypeDef *frame, uint32_t *filterIndex) {
+    uint32_t base = (RxFifo == RUP_FDCAN_RX_FIFO0) ? hWrapper->hfdcan.msgRam.RxFIFO0SA
+                                                   : hWrapper->hfdcan.msgRam.RxFIFO1SA;
+    const volatile uint32_t *element = (const volatile uint32_t *)(base + (index * RX_ELEMENT_WORDS * 4U));
+    uint32_t r0 = element[0];
+    uint32_t r1 = element[1];
+
+    if ((r0 & RX_ELEMENT_R0_XTD) != 0U || (r1 & RX_ELEMENT_R1_ANMF) != 0U) {
+        return 0;
+    }
+
+    uint32_t dlc = (r1 >> RX_ELEMENT_R1_DLC_Pos) & 0xFU;
+    uint32_t data[2] = { element[2], element[3] };
+
+    frame->id = (uint16_t)((r0 >> RX_ELEMENT_R0_STDID_Pos) & 0x7FFU);
+    frame->len = (uint8_t)((dlc > 8U) ? 8U : dlc);
+    memcpy(frame->data, data, sizeof(frame->data));
+    *filterIndex = (r1 >> RX_ELEMENT_R1_FIDX_Pos) & 0x7FU;
+    return 1;
+}
+
+/**
+ * @brief  Delivers the frame flagged by the High Priority Message Status (ISR side).
+ * @internal
+ * @details The element is fetched by index while older frames stay queued ahead of it in
+ * the FIFO. Its index is remembered so that the drain loop acknowledges it without
+ * delivering it twice. A status left over from an already consumed frame is ignored:
+ * the index must still be pending and the element must come from an HP filter.
+ * @param  receipt DWT cycle count the frame is stamped with (Rx interrupt entry).
+ */
+static void Service_Hp_Message(RUP_FDCAN_HandleTypeDef *hWrapper, const FDCAN_HpMsgStatusTypeDef *hpStatus, uint32_t receipt) {
+    RUP_FDCAN_RxFifoTypeDef RxFifo;
+    uint32_t fifoSlot;
+
+    if (hpStatus->MessageLocation == FDCAN_HP_STORAGE_RXFIFO0) {
+        RxFifo = RUP_FDCAN_RX_FIFO0;
+        fifoSlot = 0;
+    } else if (hpStatus->MessageLocation == FDCAN_HP_STORAGE_RXFIFO1) {
+        RxFifo = RUP_FDCAN_RX_FIFO1;
+        fifoSlot = 1;
+    } else {
+        return;
+    }
+
+    uint32_t index = hpStatus->MessageIndex;
+    uint8_t bit = (uint8_t)(1U << index);
+    if (index >= RUP_FDCAN_RX_FIFO_ELEMENTS || (hWrapper->HpDelivered[fifoSlot] & bit) != 0U) {
+        return;
+    }
+
+    // Pending elements are the fill level entries starting at the get index
+    uint32_t rxfs = Get_Rx_Fifo_Status(hWrapper, RxFifo);
+    uint32_t fill = (rxfs & FDCAN_RXF0S_F0FL) >> FDCAN_RXF0S_F0FL_Pos;
+    uint32_t get = (rxfs & FDCAN_RXF0S_F0GI) >> FDCAN_RXF0S_F0GI_Pos;
+    if (((index + RUP_FDCAN_RX_FIFO_ELEMENTS - get) % RUP_FDCAN_RX_FIFO_ELEMENTS) >= fill) {
+        return;
+    }
+
+    RUP_FDCAN_FrameTypeDef frame;
+    uint32_t filterIndex;
+    if (!Read_Rx_Element(hWrapper, RxFifo, index, &frame, &filterIndex) || !Is_Hp_Filter(hWrapper, filterIndex)) {
+        return;
+    }
+
+    frame.timestamp = receipt;
+    hWrapper->HpDelivered[fifoSlot] |= bit;
+    Deliver_Hp_Frame(hWrapper, &frame);
+}
+
+/**
+ * @brief  Routes a frame not yet handed to the fast lane to the fast lane or the regular path.
+ * @internal
+ * @param  receipt DWT cycle count a fast lane frame is stamped with.
+ */
+static void Route_Rx_Frame(RUP_FDCAN_HandleTypeDef *hWrapper, RUP_FDCAN_RxFifoTypeDef RxFifo,
+                           const FDCAN_RxHeaderTypeDef *RxHeader, uint8_t *RxData, uint32_t receipt) {
+    // 1. HP frame whose status was overwritten by a later one: still goes to the fast lane
+    if (Is_Hp_Lane_Active(hWrapper) && RxHeader->IdType == FDCAN_STANDARD_ID &&
+        RxHeader->IsFilterMatchingFrame == 0U && Is_Hp_Filter(hWrapper, RxHeader->FilterIndex)) {
+        RUP_FDCAN_FrameTypeDef frame;
+
+        frame.id = (uint16_t)RxHeader->Identifier;
+        frame.len = Get_Len_From_DLC(RxHeader->DataLength);
+        frame.timestamp = receipt;
+        memcpy(frame.data, RxData, sizeof(frame.data));
+        Deliver_Hp_Frame(hWrapper, &frame);
+        return;
+    }
+
+    // 2. Regular traffic
+    if (Is_Frame_Accepted(hWrapper, RxHeader)) {
+        Dispatch_Frame(hWrapper, RxFifo, RxHeader, RxData);
+    }
+}
+
+/**
+ * @brief  Routes a frame read from an Rx FIFO to the fast lane or the regular path.
+ * @internal
+ * @param  index Element index the frame was read from (get index before the read).
+ * @param  receipt DWT cycle count a fast lane frame is stamped with.
+ */
+static void Handle_Rx_Frame(RUP_FDCAN_HandleTypeDef *hWrapper, RUP_FDCAN_RxFifoTypeDef RxFifo, uint32_t index,
+                            const FDCAN_RxHeaderTypeDef *RxHeader, uint8_t *RxData, uint32_t receipt) {
+    uint32_t fifoSlot = (RxFifo == RUP_FDCAN_RX_FIFO0) ? 0U : 1U;
+    uint8_t bit = (uint8_t)(1U << index);
+
+    // Already handed over by the fast lane: the read only released the element
+    if ((hWrapper->HpDelivered[fifoSlot] & bit) != 0U) {
+        hWrapper->HpDelivered[fifoSlot] &= (uint8_t)~bit;
+        return;
+    }
+    Route_Rx_Frame(hWrapper, RxFifo, RxHeader, RxData, receipt);
+}
+
+/**
+ * @brief  Reads every frame stored in an Rx FIFO (ISR side).
+ * @internal
+ * @note   The new-message interrupt fires once per flag set, so frames that arrived
+ * while the previous one was being handled must be collected here. A pending High
+ * Priority frame is served first, whatever its position in the FIFO.
+ */
+static void Drain_Rx_Fifo(RUP_FDCAN_HandleTypeDef *hWrapper, RUP_FDCAN_RxFifoTypeDef RxFifo) {
+    FDCAN_RxHeaderTypeDef RxHeader;
+    uint8_t RxData[8];
+
+    if (Is_Hp_Lane_Active(hWrapper)) {
+        FDCAN_HpMsgStatusTypeDef hpStatus;
+
+        if (HAL_FDCAN_GetHighPriorityMessageStatus(&hWrapper->hfdcan, &hpStatus) == HAL_OK) {
+            Service_Hp_Message(hWrapper, &hpStatus, hWrapper->RxIrqEntry);
+        }
+    }
+
+    while (HAL_FDCAN_GetRxFifoFillLevel(&hWrapper->hfdcan, RxFifo) > 0U) {
+        uint32_t index = (Get_Rx_Fifo_Status(hWrapper, RxFifo) & FDCAN_RXF0S_F0GI) >> FDCAN_RXF0S_F0GI_Pos;
+
+        if (HAL_FDCAN_GetRxMessage(&hWrapper->hfdcan, RxFifo, &RxHeader, RxData) != HAL_OK) {
+            break;
+        }
+        Handle_Rx_Frame(hWrapper, RxFifo, index, &RxHeader, RxData, hWrapper->RxIrqEntry);
+    }
+}
+
+/**
+ * @brief  Copies the pending elements of an Rx FIFO to SavedRx and releases them.
+ * @internal
+ * @details Configuration window side: raw copies and the acknowledge only, no decoding and
+ * no callback. Elements the fast lane already delivered are released without a copy.
+ */
+static void Save_Rx_Fifo(RUP_FDCAN_HandleTypeDef *hWrapper, RUP_FDCAN_RxFifoTypeDef RxFifo) {
+    FDCAN_GlobalTypeDef *Instance = hWrapper->hfdcan.Instance;
+    uint32_t receipt = DWT->CYCCNT;
+    uint32_t fifoSlot = (RxFifo == RUP_FDCAN_RX_FIFO0) ? 0U : 1U;
+    uint32_t base = (RxFifo == RUP_FDCAN_RX_FIFO0) ? hWrapper->hfdcan.msgRam.RxFIFO0SA
+                                                   : hWrapper->hfdcan.msgRam.RxFIFO1SA;
+    uint32_t rxfs = Get_Rx_Fifo_Status(hWrapper, RxFifo);
+    uint32_t fill = (rxfs & FDCAN_RXF0S_F0FL) >> FDCAN_RXF0S_F0FL_Pos;
+    uint32_t get = (rxfs & FDCAN_RXF0S_F0GI) >> FDCAN_RXF0S_F0GI_Pos;
+
+    if (fill == 0U) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < fill; i++) {
+        uint32_t index = (get + i) % RUP_FDCAN_RX_FIFO_ELEMENTS;
+        if ((hWrapper->HpDelivered[fifoSlot] & (1U << index)) != 0U) {
+            continue;
+        }
+        if (hWrapper->SavedRxCount >= RUP_FDCAN_SAVED_RX_ELEMENTS) {
+            hWrapper->SavedRxDropped++;
+            continue;
+        }
+        const volatile uint32_t *element = (const volatile uint32_t *)(base + (index * RX_ELEMENT_WORDS * 4U));
+        RUP_FDCAN_SavedRxTypeDef *saved = &hWrapper->SavedRx[hWrapper->SavedRxCount];
+        for (uint32_t w = 0; w < RUP_FDCAN_SAVED_RX_WORDS; w++) {
+            saved->words[w] = element[w];
+        }
+        saved->fifo = (uint32_t)RxFifo;
+        saved->receipt = receipt;
+        hWrapper->SavedRxCount++;
+    }
+
+    // Acknowledging the last element releases all of them
+    uint32_t last = (get + fill - 1U) % RUP_FDCAN_RX_FIFO_ELEMENTS;
+    if (RxFifo == RUP_FDCAN_RX_FIFO0) {
+        Instance->RXF0A = last;
+    } else {
+        Instance->RXF1A = last;
+    }
+}
+
+/**
+ * @brief  Delivers the elements saved by configuration windows (Rx interrupt side).
+ * @internal
+ * @details They are older than anything now in the FIFOs, so they go first. The frames the
+ * fast lane had delivered were never saved, so only the regular routing applies.
+ */
+static void Dispatch_Saved_Rx(RUP_FDCAN_HandleTypeDef *hWrapper) {
+    uint32_t count = hWrapper->SavedRxCount;
+
+    for (uint32_t i = 0; i < count; i++) {
+        const RUP_FDCAN_SavedRxTypeDef *saved = &hWrapper->SavedRx[i];
+        uint32_t r0 = saved->words[0];
+        uint32_t r1 = saved->words[1];
+        FDCAN_RxHeaderTypeDef RxHeader;
+        uint8_t RxData[8];
+
+        memset(&RxHeader, 0, sizeof(RxHeader));
+        if ((r0 & RX_ELEMENT_R0_XTD) != 0U) {
+            RxHeader.IdType = FDCAN_EXTENDED_ID;
+            RxHeader.Identifier = r0 & 0x1FFFFFFFU;
+        } else {
+            RxHeader.IdType = FDCAN_STANDARD_ID;
+            RxHeader.Identifier = (r0 >> RX_ELEMENT_R0_STDID_Pos) & 0x7FFU;
+        }
+        RxHeader.DataLength = (r1 >> RX_ELEMENT_R1_DLC_Pos) & 0xFU;
+        RxHeader.FilterIndex = (r1 >> RX_ELEMENT_R1_FIDX_Pos) & 0x7FU;
+        RxHeader.IsFilterMatchingFrame = ((r1 & RX_ELEMENT_R1_ANMF) != 0U) ? 1U : 0U;
+        memcpy(RxData, &saved->words[2], sizeof(RxData));
+
+        Route_Rx_Frame(hWrapper, (RUP_FDCAN_RxFifoTypeDef)saved->fifo, &RxHeader, RxData, saved->receipt);
+    }
+    hWrapper->SavedRxCount = 0;
+}
+
+/**
+ * @brief  Rx line (interrupt line 0) of an instance, pended to dispatch SavedRx.
+ * @internal
+ */
+static IRQn_Type Get_Rx_Line_IRQn(FDCAN_GlobalTypeDef *Instance) {
+#ifdef FDCAN2
+    if (Instance == FDCAN2) return FDCAN2_IT0_IRQn;
+#endif
+    (void)Instance;
+    return FDCAN1_IT0_IRQn;
+}
+
+/**
+ * @brief  Waits (bounded) for the protocol controller to be idle (PSR.ACT == 01).
+ * @internal
+ */
+static void Wait_Bus_Idle(FDCAN_GlobalTypeDef *Instance) {
+    uint32_t spins = RUP_FDCAN_IDLE_WAIT_SPINS;
+    while (((Instance->PSR & FDCAN_PSR_ACT) != FDCAN_PSR_ACT_0) && (--spins != 0U)) {
+    }
+}
+
+/**
+ * @brief  Copies the pending Tx elements out of message RAM, in FIFO order.
+ * @internal
+ * @note   Frames are capped at 8 bytes by @ref RUP_FDCAN_Send, so the header and two data
+ * words hold the whole element.
+ */
+static void Save_Pending_Tx(const RUP_FDCAN_HandleTypeDef *hWrapper, Pending_Tx_TypeDef *pending) {
+    FDCAN_GlobalTypeDef *Instance = hWrapper->hfdcan.Instance;
+    uint32_t get = (Instance->TXFQS & FDCAN_TXFQS_TFGI) >> FDCAN_TXFQS_TFGI_Pos;
+    uint32_t requests = Instance->TXBRP;
+
+    pending->count = 0;
+    for (uint32_t i = 0; i < TX_FIFO_ELEMENTS; i++) {
+        uint32_t index = (get + i) % TX_FIFO_ELEMENTS;
+        if ((requests & (1UL << index)) == 0U) {
+            continue;
+        }
+        const volatile uint32_t *element = (const volatile uint32_t *)
+            (hWrapper->hfdcan.msgRam.TxFIFOQSA + (index * TX_ELEMENT_WORDS * 4U));
+        for (uint32_t w = 0; w < TX_SAVED_WORDS; w++) {
+            pending->words[pending->count][w] = element[w];
+        }
+        pending->count++;
+    }
+}
+
+/**
+ * @brief  Queues the saved Tx elements again, in their original order.
+ * @internal
+ */
+static void Requeue_Pending_Tx(RUP_FDCAN_HandleTypeDef *hWrapper, const Pending_Tx_TypeDef *pending) {
+    FDCAN_GlobalTypeDef *Instance = hWrapper->hfdcan.Instance;
+
+    for (uint32_t i = 0; i < pending->count; i++) {
+        uint32_t put = (Instance->TXFQS & FDCAN_TXFQS_TFQPI) >> FDCAN_TXFQS_TFQPI_Pos;
+        volatile uint32_t *element = (volatile uint32_t *)
+            (hWrapper->hfdcan.msgRam.TxFIFOQSA + (put * TX_ELEMENT_WORDS * 4U));
+        for (uint32_t w = 0; w < TX_SAVED_WORDS; w++) {
+            element[w] = pending->words[i][w];
+        }
+        Instance->TXBAR = 1UL << put;
+    }
+}
+
+/**
+ * @brief  Enters INIT with CCE set so protected registers and message RAM can be written.
+ * @internal
+ * @details Setting CCE resets the Rx FIFO status (RXF0S/RXF1S), the Tx FIFO status and
+ * pending requests (TXFQS/TXBRP) and the High Priority Message Status. So, once INIT has
+ * stopped the bus and before CCE is set, the pending Rx elements are copied raw to SavedRx
+ * (dispatched by the Rx interrupt once the window is over, see @ref Dispatch_Saved_Rx)
+ * and the pending Tx elements are saved for @ref Leave_Config_Mode to queue again. No
+ * callback runs in the window, so its length does not depend on user code.
+ * @note   Call with interrupts masked and always pair with @ref Leave_Config_Mode.
+ * @return RUP_FDCAN_OK, or RUP_FDCAN_TIMEOUT if the peripheral did not acknowledge INIT;
+ * the INIT request is then withdrawn, so the node stays on the bus with its old settings.
+ */
+static RUP_FDCAN_StatusTypeDef Enter_Config_Mode(RUP_FDCAN_HandleTypeDef *hWrapper, Pending_Tx_TypeDef *pending) {
+    FDCAN_GlobalTypeDef *Instance = hWrapper->hfdcan.Instance;
+
+    pending->count = 0;
+    Instance->CCCR |= FDCAN_CCCR_INIT;
+
+    uint32_t spins = RUP_FDCAN_IDLE_WAIT_SPINS;
+    while (((Instance->CCCR & FDCAN_CCCR_INIT) == 0U) && (--spins != 0U)) {
+    }
+
+    if ((Instance->CCCR & FDCAN_CCCR_INIT) == 0U) {
+        // Otherwise it would enter INIT on its own later and stay off the bus
+        Instance->CCCR &= ~FDCAN_CCCR_INIT;
+        return RUP_FDCAN_TIMEOUT;
+    }
+
+    Save_Rx_Fifo(hWrapper, RUP_FDCAN_RX_FIFO0);
+    Save_Rx_Fifo(hWrapper, RUP_FDCAN_RX_FIFO1);
+    Save_Pending_Tx(hWrapper, pending);
+
+    Instance->CCCR |= FDCAN_CCCR_CCE;
+
+    // The FIFO indexes the fast lane tracked are gone with the reset status
+    hWrapper->HpDelivered[0] = 0;
+    hWrapper->HpDelivered[1] = 0;
+    return RUP_FDCAN_OK;
+}
+
+/**
+ * @brief  Leaves INIT (CCE is cleared by hardware with it) and queues the saved Tx again.
+ * @internal
+ * @return RUP_FDCAN_OK, or RUP_FDCAN_TIMEOUT if the peripheral is still in INIT after
+ * @ref RUP_FDCAN_IDLE_WAIT_SPINS polls; the requests then go out once it leaves.
+ */
+static RUP_FDCAN_StatusTypeDef Leave_Config_Mode(RUP_FDCAN_HandleTypeDef *hWrapper, const Pending_Tx_TypeDef *pending) {
+    FDCAN_GlobalTypeDef *Instance = hWrapper->hfdcan.Instance;
+
+    Instance->CCCR &= ~FDCAN_CCCR_INIT;
+
+    uint32_t spins = RUP_FDCAN_IDLE_WAIT_SPINS;
+    while (((Instance->CCCR & FDCAN_CCCR_INIT) != 0U) && (--spins != 0U)) {
+    }
+
+    Requeue_Pending_Tx(hWrapper, pending);
+    return ((Instance->CCCR & FDCAN_CCCR_INIT) != 0U) ? RUP_FDCAN_TIMEOUT : RUP_FDCAN_OK;
+}
+
 /* Public Function Implementation --------------------------------------------*/
 
 RUP_FDCAN_StatusTypeDef RUP_FDCAN_Init(FDCAN_GlobalTypeDef *Instance, 
@@ -144,7 +693,7 @@ RUP_FDCAN_StatusTypeDef RUP_FDCAN_Init(FDCAN_GlobalTypeDef *Instance,
   hWrapper->hfdcan.Init.DataTimeSeg2 = bt.ts2;
 
   // 3. Configure Message RAM Limits
-  hWrapper->hfdcan.Init.StdFiltersNbr = 28; // Max standard filters
+  hWrapper->hfdcan.Init.StdFiltersNbr = RUP_FDCAN_STD_FILTER_NBR; // Max standard filters
   hWrapper->hfdcan.Init.ExtFiltersNbr = 0;
   hWrapper->hfdcan.Init.TxFifoQueueMode = FDCAN_TX_FIFO_OPERATION;
 
@@ -212,6 +761,28 @@ RUP_FDCAN_StatusTypeDef RUP_FDCAN_Init(FDCAN_GlobalTypeDef *Instance,
       return RUP_FDCAN_ERROR;
   }
   
+  // 7. Software acceptance starts disabled, installed later by config_FDCAN if generated
+  hWrapper->AcceptBitmap = NULL;
+  hWrapper->BitmapRejected = 0;
+
+  // 8. Filter bookkeeping: HAL_FDCAN_Init cleared the message RAM
+  hWrapper->StdFilterCount = 0;
+  hWrapper->ActiveFilterSet = NULL;
+  hWrapper->FilterSwitches = 0;
+  hWrapper->LastBlackoutCycles = 0;
+  hWrapper->MaxBlackoutCycles = 0;
+  RUP_CycleCounter_Start();
+
+  // 9. Fast lane state (handler and HP subscriber survive re-initialization)
+  hWrapper->HpFilterMask = 0;
+  hWrapper->HpDelivered[0] = 0;
+  hWrapper->HpDelivered[1] = 0;
+  hWrapper->HpFrames = 0;
+  hWrapper->HpLost = 0;
+  hWrapper->HpCyclesPerUs = (SystemCoreClock >= 1000000U) ? (SystemCoreClock / 1000000U) : 1U;
+  memset(&hWrapper->HpHandlerLatency, 0, sizeof(hWrapper->HpHandlerLatency));
+  memset(&hWrapper->HpTaskLatency, 0, sizeof(hWrapper->HpTaskLatency));
+
   hWrapper->Initialized = 1;
   return RUP_FDCAN_OK;
 }
@@ -247,28 +818,115 @@ RUP_FDCAN_StatusTypeDef RUP_FDCAN_ReadRxMessage(FDCAN_GlobalTypeDef *Instance, R
 
     FDCAN_RxHeaderTypeDef RxHeader;
     uint8_t RxData[8];
+    uint32_t index = (Get_Rx_Fifo_Status(hWrapper, RxFifo) & FDCAN_RXF0S_F0GI) >> FDCAN_RXF0S_F0GI_Pos;
     
     // 1. Retrieve the message from hardware FIFO
     if (HAL_FDCAN_GetRxMessage(&hWrapper->hfdcan, RxFifo, &RxHeader, RxData) != HAL_OK) {
         return RUP_FDCAN_ERROR;
     }
 
-    // 2. Dispatch to the appropriate callback
-    // This allows manual polling loops to still trigger the registered logic
-    if (RxFifo == RUP_FDCAN_RX_FIFO0) {
-        if (hWrapper->RxFIFO0Callback != NULL) {
-            hWrapper->RxFIFO0Callback((uint16_t)RxHeader.Identifier, RxData, Get_Len_From_DLC(RxHeader.DataLength));
-        }
-    } 
-    else if (RxFifo == RUP_FDCAN_RX_FIFO1) {
-        if (hWrapper->RxFIFO1Callback != NULL) {
-            hWrapper->RxFIFO1Callback((uint16_t)RxHeader.Identifier, RxData, Get_Len_From_DLC(RxHeader.DataLength));
+    // 2. Fast lane, or acceptance bitmap then subscribers and the registered callback
+    // This allows manual polling loops to still trigger the registered logic. Polled frames
+    // count as received now: the time they waited for the poll is not known
+    Handle_Rx_Frame(hWrapper, RxFifo, index, &RxHeader, RxData, DWT->CYCCNT);
+
+    return RUP_FDCAN_OK;
+}
+
+RUP_FDCAN_StatusTypeDef RUP_FDCAN_SubscriberInit(RUP_FDCAN_SubscriberTypeDef *sub, RUP_FDCAN_FrameTypeDef *storage, uint16_t capacity, void (*Notify)(void* ctx), void *ctx) {
+    if (!sub || !storage || capacity < 2U || (capacity & (capacity - 1U)) != 0U) {
+        return RUP_FDCAN_ERROR;
+    }
+
+    sub->Ring = storage;
+    sub->RingMask = (uint16_t)(capacity - 1U);
+    sub->Head = 0;
+    sub->Tail = 0;
+    sub->Dropped = 0;
+    sub->Notify = Notify;
+    sub->NotifyCtx = ctx;
+    sub->Instance = NULL;
+    sub->Slot = 0;
+    return RUP_FDCAN_OK;
+}
+
+/**
+ * @brief  Registers a subscriber on an instance if not already done.
+ * @internal
+ */
+static RUP_FDCAN_StatusTypeDef Attach_Subscriber(RUP_FDCAN_HandleTypeDef *hWrapper, FDCAN_GlobalTypeDef *Instance, RUP_FDCAN_SubscriberTypeDef *sub) {
+    if (sub->Instance == Instance) return RUP_FDCAN_OK;
+    if (sub->Instance != NULL || sub->Ring == NULL) return RUP_FDCAN_ERROR;
+    if (hWrapper->SubscriberCount >= RUP_FDCAN_MAX_SUBSCRIBERS) return RUP_FDCAN_ERROR;
+
+    sub->Slot = hWrapper->SubscriberCount;
+    sub->Instance = Instance;
+    hWrapper->Subscribers[sub->Slot] = sub;
+    hWrapper->SubscriberCount++;
+    return RUP_FDCAN_OK;
+}
+
+RUP_FDCAN_StatusTypeDef RUP_FDCAN_Subscribe(FDCAN_GlobalTypeDef *Instance, RUP_FDCAN_SubscriberTypeDef *sub, uint16_t id_lo, uint16_t id_hi) {
+    RUP_FDCAN_HandleTypeDef *hWrapper = GetHandle(Instance);
+    if (!hWrapper || !sub || id_lo > id_hi || id_hi >= RUP_FDCAN_STD_ID_COUNT) return RUP_FDCAN_ERROR;
+
+    RUP_FDCAN_StatusTypeDef status = Attach_Subscriber(hWrapper, Instance, sub);
+    if (status != RUP_FDCAN_OK) return status;
+
+    // Single byte stores: the ISR sees each ID either before or after the update
+    RUP_FDCAN_SubscriberMaskTypeDef bit = (RUP_FDCAN_SubscriberMaskTypeDef)(1U << sub->Slot);
+    for (uint32_t id = id_lo; id <= id_hi; id++) {
+        hWrapper->SubscriberMask[id] |= bit;
+    }
+    return RUP_FDCAN_OK;
+}
+
+RUP_FDCAN_StatusTypeDef RUP_FDCAN_SubscribeBitmap(FDCAN_GlobalTypeDef *Instance, RUP_FDCAN_SubscriberTypeDef *sub, const RUP_FDCAN_AcceptBitmapTypeDef *ids) {
+    RUP_FDCAN_HandleTypeDef *hWrapper = GetHandle(Instance);
+    if (!hWrapper || !sub || !ids) return RUP_FDCAN_ERROR;
+
+    RUP_FDCAN_StatusTypeDef status = Attach_Subscriber(hWrapper, Instance, sub);
+    if (status != RUP_FDCAN_OK) return status;
+
+    RUP_FDCAN_SubscriberMaskTypeDef bit = (RUP_FDCAN_SubscriberMaskTypeDef)(1U << sub->Slot);
+    for (uint32_t id = 0; id < RUP_FDCAN_STD_ID_COUNT; id++) {
+        if (RUP_FDCAN_BitmapTest(ids, (uint16_t)id)) {
+            hWrapper->SubscriberMask[id] |= bit;
         }
     }
+    return RUP_FDCAN_OK;
+}
+
+RUP_FDCAN_StatusTypeDef RUP_FDCAN_Unsubscribe(FDCAN_GlobalTypeDef *Instance, RUP_FDCAN_SubscriberTypeDef *sub, uint16_t id_lo, uint16_t id_hi) {
+    RUP_FDCAN_HandleTypeDef *hWrapper = GetHandle(Instance);
+    if (!hWrapper || !sub || sub->Instance != Instance || id_lo > id_hi || id_hi >= RUP_FDCAN_STD_ID_COUNT) return RUP_FDCAN_ERROR;
 
+    // Single byte stores, as in RUP_FDCAN_Subscribe
+    RUP_FDCAN_SubscriberMaskTypeDef keep = (RUP_FDCAN_SubscriberMaskTypeDef)~(1U << sub->Slot);
+    for (uint32_t id = id_lo; id <= id_hi; id++) {
+        hWrapper->SubscriberMask[id] &= keep;
+    }
     return RUP_FDCAN_OK;
 }
 
+uint8_t RUP_FDCAN_SubscriberPop(RUP_FDCAN_SubscriberTypeDef *sub, RUP_FDCAN_FrameTypeDef *frame) {
+    uint16_t tail = sub->Tail;
+    if (tail == sub->Head) {
+        return 0;
+    }
+
+    // Read the slot only after observing the head that published it
+    __DMB();
+    *frame = sub->Ring[tail];
+    __DMB();
+    sub->Tail = (uint16_t)((tail + 1U) & sub->RingMask);
+    return 1;
+}
+
+uint32_t RUP_FDCAN_SubscriberGetDropped(const RUP_FDCAN_SubscriberTypeDef *sub) {
+    return sub->Dropped;
+}
+
 void RUP_FDCAN_RegisterRxFIFO0Callback(FDCAN_GlobalTypeDef *Instance, void (*Callback)(uint16_t id, uint8_t* data, uint8_t len)) {
     RUP_FDCAN_HandleTypeDef *hWrapper = GetHandle(Instance);
     if (hWrapper) {
@@ -297,15 +955,68 @@ void RUP_FDCAN_RegisterHpCallback(FDCAN_GlobalTypeDef *Instance, void (*Callback
   }
 }
 
+void RUP_FDCAN_RegisterHpFrameCallback(FDCAN_GlobalTypeDef *Instance, void (*Callback)(const RUP_FDCAN_FrameTypeDef* frame)) {
+  RUP_FDCAN_HandleTypeDef *hWrapper = GetHandle(Instance);
+  if (hWrapper) {
+    hWrapper->HpFrameCallback = Callback;
+  }
+}
+
+RUP_FDCAN_StatusTypeDef RUP_FDCAN_SetHpSubscriber(FDCAN_GlobalTypeDef *Instance, RUP_FDCAN_SubscriberTypeDef *sub) {
+    RUP_FDCAN_HandleTypeDef *hWrapper = GetHandle(Instance);
+    if (!hWrapper) return RUP_FDCAN_ERROR;
+    if (sub != NULL && (sub->Ring == NULL || sub->Instance != NULL)) return RUP_FDCAN_ERROR;
+
+    hWrapper->HpSubscriber = sub;
+    return RUP_FDCAN_OK;
+}
+
+uint8_t RUP_FDCAN_HpPop(FDCAN_GlobalTypeDef *Instance, RUP_FDCAN_FrameTypeDef *frame) {
+    RUP_FDCAN_HandleTypeDef *hWrapper = GetHandle(Instance);
+    if (!hWrapper || !hWrapper->HpSubscriber) return 0;
+
+    if (!RUP_FDCAN_SubscriberPop(hWrapper->HpSubscriber, frame)) {
+        return 0;
+    }
+    Record_Hp_Latency(hWrapper, &hWrapper->HpTaskLatency, frame);
+    return 1;
+}
+
+void RUP_FDCAN_GetHpStats(FDCAN_GlobalTypeDef *Instance, RUP_FDCAN_HpStatsTypeDef *stats) {
+    RUP_FDCAN_HandleTypeDef *hWrapper = GetHandle(Instance);
+    if (!hWrapper || !stats) return;
+
+    stats->frames = hWrapper->HpFrames;
+    stats->lost = hWrapper->HpLost;
+    stats->dropped = (hWrapper->HpSubscriber != NULL) ? hWrapper->HpSubscriber->Dropped : 0U;
+    stats->cycles_per_us = hWrapper->HpCyclesPerUs;
+    // Plain copies: a frame recorded meanwhile may show in some fields and not in others
+    stats->handler = hWrapper->HpHandlerLatency;
+    stats->task = hWrapper->HpTaskLatency;
+}
+
+const RUP_FDCAN_AcceptBitmapTypeDef* RUP_FDCAN_SetAcceptBitmap(FDCAN_GlobalTypeDef *Instance, const RUP_FDCAN_AcceptBitmapTypeDef* bitmap) {
+    RUP_FDCAN_HandleTypeDef *hWrapper = GetHandle(Instance);
+    if (!hWrapper) return NULL;
+
+    // Single pointer store: the ISR sees either the old or the new bitmap, never a mix
+    return __atomic_exchange_n(&hWrapper->AcceptBitmap, bitmap, __ATOMIC_SEQ_CST);
+}
+
+uint32_t RUP_FDCAN_GetBitmapRejectedCount(FDCAN_GlobalTypeDef *Instance) {
+    RUP_FDCAN_HandleTypeDef *hWrapper = GetHandle(Instance);
+    if (!hWrapper) return 0;
+
+    return hWrapper->BitmapRejected;
+}
+
 RUP_FDCAN_StatusTypeDef RUP_FDCAN_AddFilter(FDCAN_GlobalTypeDef *Instance, RUP_FDCAN_FilterTypeTypeDef type, RUP_FDCAN_FilterConfigTypeDef config, uint16_t id1, uint16_t id2) {
     RUP_FDCAN_HandleTypeDef *hWrapper = GetHandle(Instance);
     if (!hWrapper) return RUP_FDCAN_ERROR;
 
+    if (hWrapper->StdFilterCount >= RUP_FDCAN_STD_FILTER_NBR) return RUP_FDCAN_ERROR;
+
     FDCAN_FilterTypeDef sFilterConfig;
-    static uint32_t filterIdx1 = 0; // Filter bank index for CAN1
-#ifdef FDCAN2
-    static uint32_t filterIdx2 = 0; // Filter bank index for CAN2
-#endif //FDCAN2
 
     sFilterConfig.IdType = FDCAN_STANDARD_ID;
     sFilterConfig.FilterType = type;
@@ -313,17 +1024,133 @@ RUP_FDCAN_StatusTypeDef RUP_FDCAN_AddFilter(FDCAN_GlobalTypeDef *Instance, RUP_F
     sFilterConfig.FilterID1 = id1;
     sFilterConfig.FilterID2 = id2;
     
-    // Automatically increment filter index to prevent overwrites
-    if(Instance == FDCAN1) {
-        sFilterConfig.FilterIndex = filterIdx1++;
-    } 
-#ifdef FDCAN2
-    else if(Instance == FDCAN2) {
-        sFilterConfig.FilterIndex = filterIdx2++;
+    // Next free element of this instance (reset by RUP_FDCAN_Init / RUP_FDCAN_ApplyFilterSet)
+    sFilterConfig.FilterIndex = hWrapper->StdFilterCount;
+
+    RUP_FDCAN_StatusTypeDef status = Map_HAL_Status(HAL_FDCAN_ConfigFilter(&hWrapper->hfdcan, &sFilterConfig));
+    if (status == RUP_FDCAN_OK) {
+        if (config == RUP_FDCAN_FILTER_RXFIFO0_HP || config == RUP_FDCAN_FILTER_RXFIFO1_HP) {
+            hWrapper->HpFilterMask |= (1UL << hWrapper->StdFilterCount);
+        }
+        hWrapper->StdFilterCount++;
     }
-#endif
+    return status;
+}
+
+RUP_FDCAN_StatusTypeDef RUP_FDCAN_ApplyFilterSet(FDCAN_GlobalTypeDef *Instance, const RUP_FDCAN_FilterSetTypeDef *set) {
+    RUP_FDCAN_HandleTypeDef *hWrapper = GetHandle(Instance);
+    if (!hWrapper || !set || !hWrapper->Initialized) return RUP_FDCAN_ERROR;
+
+    volatile uint32_t *filterRam = (volatile uint32_t *)hWrapper->hfdcan.msgRam.StandardFilterSA;
+    uint32_t rxgfc = (Instance->RXGFC & ~(FDCAN_RXGFC_ANFS | FDCAN_RXGFC_ANFE)) |
+                     ((uint32_t)set->global_filter << FDCAN_RXGFC_ANFS_Pos) |
+                     ((uint32_t)set->global_filter << FDCAN_RXGFC_ANFE_Pos);
+    RUP_FDCAN_StatusTypeDef status = RUP_FDCAN_OK;
+    Pending_Tx_TypeDef pending;
+    uint8_t applied = 0;
+
+    // High Priority elements of the new image, precomputed outside the critical window
+    uint32_t hpMask = 0;
+    for (uint32_t i = 0; i < RUP_FDCAN_STD_FILTER_NBR; i++) {
+        uint32_t sfec = (set->elements[i] >> 27U) & 0x7U;
+        if (sfec == RUP_FDCAN_FILTER_RXFIFO0_HP || sfec == RUP_FDCAN_FILTER_RXFIFO1_HP) {
+            hpMask |= (1UL << i);
+        }
+    }
+
+    // 1. Let the frame on the wire complete: INIT would abort it
+    Wait_Bus_Idle(Instance);
+
+    // 2. Critical window: nothing else may touch the peripheral while it is in INIT
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t start = DWT->CYCCNT;
+
+    status = Enter_Config_Mode(hWrapper, &pending);
+    if (status == RUP_FDCAN_OK) {
+        // 3. Copy the precompiled image (unused elements are 0 = disabled)
+        for (uint32_t i = 0; i < RUP_FDCAN_STD_FILTER_NBR; i++) {
+            filterRam[i] = set->elements[i];
+        }
+        Instance->RXGFC = rxgfc;
+        (void)__atomic_exchange_n(&hWrapper->AcceptBitmap, set->accept_bitmap, __ATOMIC_SEQ_CST);
+        hWrapper->HpFilterMask = hpMask;
+        applied = 1;
+
+        // 4. Back to Normal Operation, the interrupted Tx requests queued again
+        status = Leave_Config_Mode(hWrapper, &pending);
+    }
+
+    uint32_t cycles = DWT->CYCCNT - start;
+    __set_PRIMASK(primask);
+    if (hWrapper->SavedRxCount != 0U) {
+        NVIC_SetPendingIRQ(Get_Rx_Line_IRQn(Instance));
+    }
+
+    if (!applied) {
+        // INIT was never acknowledged: the old set is still in place
+        return status;
+    }
+
+    hWrapper->StdFilterCount = set->count;
+    hWrapper->ActiveFilterSet = set;
+    hWrapper->FilterSwitches++;
+    hWrapper->LastBlackoutCycles = cycles;
+    if (cycles > hWrapper->MaxBlackoutCycles) {
+        hWrapper->MaxBlackoutCycles = cycles;
+    }
+    return status;
+}
+
+RUP_FDCAN_StatusTypeDef RUP_FDCAN_SetLoopback(FDCAN_GlobalTypeDef *Instance, uint8_t enable) {
+    RUP_FDCAN_HandleTypeDef *hWrapper = GetHandle(Instance);
+    if (!hWrapper || !hWrapper->Initialized) return RUP_FDCAN_ERROR;
+
+    Wait_Bus_Idle(Instance);
 
-  return Map_HAL_Status(HAL_FDCAN_ConfigFilter(&hWrapper->hfdcan, &sFilterConfig));
+    Pending_Tx_TypeDef pending;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    RUP_FDCAN_StatusTypeDef status = Enter_Config_Mode(hWrapper, &pending);
+    if (status == RUP_FDCAN_OK) {
+        if (enable) {
+            // Internal loopback: TEST unlocks the TEST register, MON detaches Tx from the pin
+            Instance->CCCR |= FDCAN_CCCR_TEST | FDCAN_CCCR_MON;
+            Instance->TEST |= FDCAN_TEST_LBCK;
+        } else {
+            // Clearing CCCR.TEST also resets the TEST register
+            Instance->CCCR &= ~(FDCAN_CCCR_TEST | FDCAN_CCCR_MON);
+        }
+        status = Leave_Config_Mode(hWrapper, &pending);
+    }
+
+    __set_PRIMASK(primask);
+    if (hWrapper->SavedRxCount != 0U) {
+        NVIC_SetPendingIRQ(Get_Rx_Line_IRQn(Instance));
+    }
+    return status;
+}
+
+uint32_t RUP_FDCAN_GetIsrCycles(FDCAN_GlobalTypeDef *Instance) {
+    RUP_FDCAN_HandleTypeDef *hWrapper = GetHandle(Instance);
+    if (!hWrapper) return 0;
+
+    return hWrapper->IsrCycles;
+}
+
+void RUP_FDCAN_GetFilterSwitchStats(FDCAN_GlobalTypeDef *Instance, RUP_FDCAN_FilterSwitchStatsTypeDef *stats) {
+    RUP_FDCAN_HandleTypeDef *hWrapper = GetHandle(Instance);
+    if (!hWrapper || !stats) return;
+
+    uint32_t cyclesPerUs = SystemCoreClock / 1000000U;
+    if (cyclesPerUs == 0U) cyclesPerUs = 1U;
+
+    stats->switches = hWrapper->FilterSwitches;
+    stats->last_cycles = hWrapper->LastBlackoutCycles;
+    stats->max_cycles = hWrapper->MaxBlackoutCycles;
+    stats->last_us = stats->last_cycles / cyclesPerUs;
+    stats->max_us = stats->max_cycles / cyclesPerUs;
 }
 
 RUP_FDCAN_StatusTypeDef RUP_FDCAN_Send(FDCAN_GlobalTypeDef *Instance, uint16_t id, uint8_t* data, uint8_t len) {
@@ -346,13 +1173,27 @@ RUP_FDCAN_StatusTypeDef RUP_FDCAN_Send(FDCAN_GlobalTypeDef *Instance, uint16_t i
     return Map_HAL_Status(HAL_FDCAN_AddMessageToTxFifoQ(&hWrapper->hfdcan, &TxHeader, data));
 }
 
+/**
+ * @brief  Runs the HAL interrupt handler of an instance.
+ * @internal
+ * @param  entry DWT cycle count at the interrupt entry, the receipt stamp of the fast lane.
+ */
+static void Handle_Irq(RUP_FDCAN_HandleTypeDef *hWrapper, uint32_t entry) {
+    uint32_t start = DWT->CYCCNT;
+
+    hWrapper->RxIrqEntry = entry;
+    // Delegates to the generic HAL handler, which then calls
+    // the weak callbacks we have overridden below.
+    HAL_FDCAN_IRQHandler(&hWrapper->hfdcan);
+
+    hWrapper->IsrCycles += DWT->CYCCNT - start;
+}
+
 void RUP_FDCAN_IRQHandler(FDCAN_GlobalTypeDef *Instance) {
     RUP_FDCAN_HandleTypeDef *hWrapper = GetHandle(Instance);
-    
+
     if (hWrapper != NULL) {
-        // Delegates to the generic HAL handler, which then calls 
-        // the weak callbacks we have overridden below.
-        HAL_FDCAN_IRQHandler(&hWrapper->hfdcan);
+        Handle_Irq(hWrapper, DWT->CYCCNT);
     }
 }
 
@@ -365,17 +1206,9 @@ void RUP_FDCAN_IRQHandler(FDCAN_GlobalTypeDef *Instance) {
 void HAL_FDCAN_RxFifo0Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs) {
     RUP_FDCAN_HandleTypeDef *targetWrapper = GetHandle(hfdcan->Instance);
 
-    // Verify wrapper exists and user has registered a callback
-    if (targetWrapper && targetWrapper->RxFIFO0Callback) {
-        if ((RxFifo0ITs & FDCAN_IT_RX_FIFO0_NEW_MESSAGE) != 0) {
-            FDCAN_RxHeaderTypeDef RxHeader;
-            uint8_t RxData[8];
-
-            // Fetch data and invoke user callback
-            if (HAL_FDCAN_GetRxMessage(hfdcan, FDCAN_RX_FIFO0, &RxHeader, RxData) == HAL_OK) {
-                targetWrapper->RxFIFO0Callback((uint16_t)RxHeader.Identifier, RxData, Get_Len_From_DLC(RxHeader.DataLength));
-            }
-        }
+    // Empty the FIFO, fanning each accepted frame out to subscribers and the user callback
+    if (targetWrapper && (RxFifo0ITs & FDCAN_IT_RX_FIFO0_NEW_MESSAGE) != 0) {
+        Drain_Rx_Fifo(targetWrapper, RUP_FDCAN_RX_FIFO0);
     }
 }
 
@@ -386,15 +1219,8 @@ void HAL_FDCAN_RxFifo0Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs)
 void HAL_FDCAN_RxFifo1Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo1ITs) {
     RUP_FDCAN_HandleTypeDef *targetWrapper = GetHandle(hfdcan->Instance);
 
-    if (targetWrapper && targetWrapper->RxFIFO1Callback) {
-        if ((RxFifo1ITs & FDCAN_IT_RX_FIFO1_NEW_MESSAGE) != 0) {
-            FDCAN_RxHeaderTypeDef RxHeader;
-            uint8_t RxData[8];
-
-            if (HAL_FDCAN_GetRxMessage(hfdcan, FDCAN_RX_FIFO1, &RxHeader, RxData) == HAL_OK) {
-                targetWrapper->RxFIFO1Callback((uint16_t)RxHeader.Identifier, RxData, Get_Len_From_DLC(RxHeader.DataLength));
-            }
-        }
+    if (targetWrapper && (RxFifo1ITs & FDCAN_IT_RX_FIFO1_NEW_MESSAGE) != 0) {
+        Drain_Rx_Fifo(targetWrapper, RUP_FDCAN_RX_FIFO1);
     }
 }
 
@@ -411,27 +1237,56 @@ void HAL_FDCAN_ErrorStatusCallback(FDCAN_HandleTypeDef *hfdcan, uint32_t ErrorSt
 
 /**
  * @brief  HAL Callback for High Priority Messages.
+ * @note   Fetches the flagged frame by index for the fast lane, then reports the raw
+ * status to the optional user hook.
  */
 void HAL_FDCAN_HighPriorityMessageCallback(FDCAN_HandleTypeDef *hfdcan) {
     RUP_FDCAN_HandleTypeDef *targetWrapper = GetHandle(hfdcan->Instance);
+    FDCAN_HpMsgStatusTypeDef hpStatus;
 
-    if (targetWrapper && targetWrapper->HpCallback) {
-        FDCAN_HpMsgStatusTypeDef hpStatus;
+    if (!targetWrapper || HAL_FDCAN_GetHighPriorityMessageStatus(hfdcan, &hpStatus) != HAL_OK) {
+        return;
+    }
 
-        if (HAL_FDCAN_GetHighPriorityMessageStatus(hfdcan, &hpStatus) == HAL_OK) {
-            targetWrapper->HpCallback(&hpStatus);
-        }
+    if (hpStatus.MessageLocation == FDCAN_HP_STORAGE_MSG_LOST) {
+        targetWrapper->HpLost++;
+    } else if (Is_Hp_Lane_Active(targetWrapper)) {
+        Service_Hp_Message(targetWrapper, &hpStatus, targetWrapper->RxIrqEntry);
+    }
+
+    if (targetWrapper->HpCallback) {
+        targetWrapper->HpCallback(&hpStatus);
     }
 }
 
 /* Interrupt Service Routines ------------------------------------------------*/
 
+/**
+ * @brief  Rx line handler: the frames saved by a configuration window, then the HAL events.
+ * @internal
+ * @note   Only the Rx line dispatches SavedRx, so subscriber rings keep a single producer.
+ */
+static void Rx_Line_IRQHandler(FDCAN_GlobalTypeDef *Instance) {
+    // First thing, so a High Priority frame is not charged the SavedRx dispatch
+    uint32_t entry = DWT->CYCCNT;
+    RUP_FDCAN_HandleTypeDef *hWrapper = GetHandle(Instance);
+
+    if (hWrapper == NULL) {
+        return;
+    }
+    if (hWrapper->SavedRxCount != 0U) {
+        Dispatch_Saved_Rx(hWrapper);
+        hWrapper->IsrCycles += DWT->CYCCNT - entry;
+    }
+    Handle_Irq(hWrapper, entry);
+}
+
 /**
  * @brief  FDCAN1 Interrupt Line 0 Handler (Rx Events).
  */
 void FDCAN1_IT0_IRQHandler(void)
 {
-  RUP_FDCAN_IRQHandler(FDCAN1);
+  Rx_Line_IRQHandler(FDCAN1);
 }
 
 /**
@@ -448,7 +1303,7 @@ void FDCAN1_IT1_IRQHandler(void)
  */
 void FDCAN2_IT0_IRQHandler(void)
 {
-  RUP_FDCAN_IRQHandler(FDCAN2);
+  Rx_Line_IRQHandler(FDCAN2);
 }
 
 /**
@@ -1,5 +1,6 @@
 #include "main.h"
 #include "raceup_fdcan.h"
+#include "raceup_can_loadgen.h"
 
 void SystemClock_Config(void)
 {
@@ -68,6 +69,74 @@ void SystemClock_Config(void)
   __HAL_FLASH_SET_PROGRAM_DELAY(FLASH_PROGRAMMING_DELAY_2);
 }
 
+/* Software acceptance bitmap for FDCAN1 (one bit per Standard ID) */
+static const RUP_FDCAN_AcceptBitmapTypeDef accept_bitmap_fdcan1 = {{
+  0x00030000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U,
+  0x0001FFFFU, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U,
+  0x0000FFFFU, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U,
+  0xFFFF0025U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U,
+  0x00000011U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U,
+  0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U,
+  0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U,
+  0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000001U, 0x00000000U, 0x00000000U
+}};
+
+/* Filter set 'default' for FDCAN1 (message RAM image, 6/28 elements used) */
+const RUP_FDCAN_FilterSetTypeDef FDCAN1_FILTER_SET_DEFAULT = {
+  .name = "default",
+  .global_filter = RUP_FDCAN_REJECT,
+  .count = 6,
+  .accept_bitmap = &accept_bitmap_fdcan1,
+  .elements = {
+    RUP_FDCAN_STD_FILTER_ELEMENT(RUP_FDCAN_FILTER_RANGE, RUP_FDCAN_FILTER_TO_RXFIFO0, 0x100, 0x110),
+    RUP_FDCAN_STD_FILTER_ELEMENT(RUP_FDCAN_FILTER_MASK, RUP_FDCAN_FILTER_TO_RXFIFO1, 0x200, 0x7F0),
+    RUP_FDCAN_STD_FILTER_ELEMENT(RUP_FDCAN_FILTER_DUAL, RUP_FDCAN_FILTER_RXFIFO0_HP, 0x10, 0x11),
+    RUP_FDCAN_STD_FILTER_ELEMENT(RUP_FDCAN_FILTER_RANGE, RUP_FDCAN_FILTER_TO_RXFIFO0, 0x300, 0x31F),
+    RUP_FDCAN_STD_FILTER_ELEMENT(RUP_FDCAN_FILTER_RANGE, RUP_FDCAN_FILTER_TO_RXFIFO0, 0x400, 0x404),
+    RUP_FDCAN_STD_FILTER_ELEMENT(RUP_FDCAN_FILTER_DUAL, RUP_FDCAN_FILTER_TO_RXFIFO0, 0x7A0, 0x7A0)
+  }
+};
+
+/* Filter set 'pits' for FDCAN1 (message RAM image, 1/28 elements used) */
+const RUP_FDCAN_FilterSetTypeDef FDCAN1_FILTER_SET_PITS = {
+  .name = "pits",
+  .global_filter = RUP_FDCAN_ACCEPT_IN_RX_FIFO0,
+  .count = 1,
+  .accept_bitmap = NULL,
+  .elements = {
+    RUP_FDCAN_STD_FILTER_ELEMENT(RUP_FDCAN_FILTER_DUAL, RUP_FDCAN_FILTER_RXFIFO0_HP, 0x10, 0x11)
+  }
+};
+
+/* Filter set 'charging' for FDCAN1 (message RAM image, 2/28 elements used) */
+const RUP_FDCAN_FilterSetTypeDef FDCAN1_FILTER_SET_CHARGING = {
+  .name = "charging",
+  .global_filter = RUP_FDCAN_REJECT,
+  .count = 2,
+  .accept_bitmap = NULL,
+  .elements = {
+    RUP_FDCAN_STD_FILTER_ELEMENT(RUP_FDCAN_FILTER_DUAL, RUP_FDCAN_FILTER_RXFIFO0_HP, 0x10, 0x11),
+    RUP_FDCAN_STD_FILTER_ELEMENT(RUP_FDCAN_FILTER_RANGE, RUP_FDCAN_FILTER_TO_RXFIFO0, 0x600, 0x61F)
+  }
+};
+
+/* Load test traffic profile 'full_load' for FDCAN1 (profiles/can_full_load.yaml) */
+static const RUP_CANLOAD_StreamTypeDef load_streams_fdcan1[] = {
+  { .id = 0x100, .dlc = { 8 }, .dlc_count = 1, .burst = 4, .period_us = 1000, .offset_us = 0 },
+  { .id = 0x205, .dlc = { 2, 4, 8 }, .dlc_count = 3, .burst = 1, .period_us = 1000, .offset_us = 500 },
+  { .id = 0x310, .dlc = { 1, 8 }, .dlc_count = 2, .burst = 2, .period_us = 2000, .offset_us = 250 },
+  { .id = 0x7A0, .dlc = { 8 }, .dlc_count = 1, .burst = 1, .period_us = 0, .offset_us = 0 }
+};
+
+const RUP_CANLOAD_ProfileTypeDef FDCAN1_LOAD_PROFILE = {
+  .name = "full_load",
+  .bitrate = 1000000,
+  .duration_ms = 10000,
+  .loopback = 1,
+  .count = 4,
+  .streams = load_streams_fdcan1
+};
+
 void config_FDCAN(void) {
   GPIO_InitTypeDef GPIO_InitStruct = {0};
   /* Enable global FDCAN clock */
@@ -118,18 +187,75 @@ void config_FDCAN(void) {
   /* 3. RX Interrupt Mode Configuration */
 
   /* 4. Peripheral Initialization */
-  RUP_FDCAN_Init(FDCAN1, timing_fdcan1, RUP_FDCAN_REJECT, RUP_FDCAN_IT_NONE);
+  RUP_FDCAN_Init(FDCAN1, timing_fdcan1, RUP_FDCAN_REJECT, RUP_FDCAN_IT_ALL);
   
   /* 5. Reception Filters */
-    
   RUP_FDCAN_AddFilter(FDCAN1, RUP_FDCAN_FILTER_RANGE, RUP_FDCAN_FILTER_TO_RXFIFO0, 0x100, 0x110);
-    
   RUP_FDCAN_AddFilter(FDCAN1, RUP_FDCAN_FILTER_MASK, RUP_FDCAN_FILTER_TO_RXFIFO1, 0x200, 0x7F0);
+  RUP_FDCAN_AddFilter(FDCAN1, RUP_FDCAN_FILTER_DUAL, RUP_FDCAN_FILTER_RXFIFO0_HP, 0x10, 0x11);
+
+  /* 5b. Accept list: 22 IDs on 3 filter elements
+   *     (16 extra IDs accepted by hardware and dropped by the bitmap) */
+  RUP_FDCAN_AddFilter(FDCAN1, RUP_FDCAN_FILTER_RANGE, RUP_FDCAN_FILTER_TO_RXFIFO0, 0x300, 0x31F);
+  RUP_FDCAN_AddFilter(FDCAN1, RUP_FDCAN_FILTER_RANGE, RUP_FDCAN_FILTER_TO_RXFIFO0, 0x400, 0x404);
+  RUP_FDCAN_AddFilter(FDCAN1, RUP_FDCAN_FILTER_DUAL, RUP_FDCAN_FILTER_TO_RXFIFO0, 0x7A0, 0x7A0);
+  RUP_FDCAN_SetAcceptBitmap(FDCAN1, &accept_bitmap_fdcan1);
 
   /* 6. Start Peripheral */
   RUP_FDCAN_Start(FDCAN1);
 }
 
+void config_USART(void) {
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+  RCC_PeriphCLKInitTypeDef PeriphClkInitStruct = {0};
+
+  /* Loop through all USART/LPUART instances (e.g., usart1, lpuart1) defined in YAML.
+   * Baud rate, format and FIFOs are set by ru::driver::Serial::init */
+
+  /* ==============================================================================
+   * USART1 Hardware Setup (SerialId::serial_debug)
+   * ============================================================================== */
+
+  /* Kernel clock (the baud rate divider is computed from its actual frequency) */
+  PeriphClkInitStruct.PeriphClockSelection = RCC_PERIPHCLK_USART1;
+  PeriphClkInitStruct.Usart1ClockSelection = RCC_USART1CLKSOURCE_PCLK2;
+  if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInitStruct) != HAL_OK) {
+    Error_Handler();
+  }
+  __HAL_RCC_USART1_CLK_ENABLE();
+
+  /* Configure RX/TX/CTS/RTS pins (Rx and CTS pulled up so a
+   * disconnected line stays idle) */
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  GPIO_InitStruct.Pin = GPIO_PIN_10;
+  GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct.Pull = GPIO_PULLUP;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+  GPIO_InitStruct.Alternate = GPIO_AF7_USART1;
+  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  GPIO_InitStruct.Pin = GPIO_PIN_9;
+  GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+  GPIO_InitStruct.Alternate = GPIO_AF7_USART1;
+  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  GPIO_InitStruct.Pin = GPIO_PIN_11;
+  GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct.Pull = GPIO_PULLUP;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+  GPIO_InitStruct.Alternate = GPIO_AF7_USART1;
+  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  GPIO_InitStruct.Pin = GPIO_PIN_12;
+  GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+  GPIO_InitStruct.Alternate = GPIO_AF7_USART1;
+  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+}
+
 void config_GPIO(void) {
   GPIO_InitTypeDef GPIO_InitStruct_E3 = {0};
   __HAL_RCC_GPIOE_CLK_ENABLE();
@@ -138,4 +264,128 @@ void config_GPIO(void) {
   GPIO_InitStruct_E3.Pull = GPIO_NOPULL;
   GPIO_InitStruct_E3.Speed = GPIO_SPEED_FREQ_LOW;
   HAL_GPIO_Init(GPIOE, &GPIO_InitStruct_E3);
+  GPIO_InitTypeDef GPIO_InitStruct_B2 = {0};
+  __HAL_RCC_GPIOB_CLK_ENABLE();
+  GPIO_InitStruct_B2.Pin = GPIO_PIN_2;
+  GPIO_InitStruct_B2.Mode = GPIO_MODE_OUTPUT_PP;
+  GPIO_InitStruct_B2.Pull = GPIO_NOPULL;
+  GPIO_InitStruct_B2.Speed = GPIO_SPEED_FREQ_LOW;
+  HAL_GPIO_Init(GPIOB, &GPIO_InitStruct_B2);
+  GPIO_InitTypeDef GPIO_InitStruct_E9 = {0};
+  __HAL_RCC_GPIOE_CLK_ENABLE();
+  GPIO_InitStruct_E9.Pin = GPIO_PIN_9;
+  GPIO_InitStruct_E9.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct_E9.Pull = GPIO_NOPULL;
+  GPIO_InitStruct_E9.Speed = GPIO_SPEED_FREQ_HIGH;
+  GPIO_InitStruct_E9.Alternate = 1;
+  HAL_GPIO_Init(GPIOE, &GPIO_InitStruct_E9);
+  GPIO_InitTypeDef GPIO_InitStruct_C7 = {0};
+  __HAL_RCC_GPIOC_CLK_ENABLE();
+  GPIO_InitStruct_C7.Pin = GPIO_PIN_7;
+  GPIO_InitStruct_C7.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct_C7.Pull = GPIO_NOPULL;
+  GPIO_InitStruct_C7.Speed = GPIO_SPEED_FREQ_HIGH;
+  GPIO_InitStruct_C7.Alternate = 3;
+  HAL_GPIO_Init(GPIOC, &GPIO_InitStruct_C7);
+  GPIO_InitTypeDef GPIO_InitStruct_B14 = {0};
+  __HAL_RCC_GPIOB_CLK_ENABLE();
+  GPIO_InitStruct_B14.Pin = GPIO_PIN_14;
+  GPIO_InitStruct_B14.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct_B14.Pull = GPIO_NOPULL;
+  GPIO_InitStruct_B14.Speed = GPIO_SPEED_FREQ_HIGH;
+  GPIO_InitStruct_B14.Alternate = 3;
+  HAL_GPIO_Init(GPIOB, &GPIO_InitStruct_B14);
+  GPIO_InitTypeDef GPIO_InitStruct_C8 = {0};
+  __HAL_RCC_GPIOC_CLK_ENABLE();
+  GPIO_InitStruct_C8.Pin = GPIO_PIN_8;
+  GPIO_InitStruct_C8.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct_C8.Pull = GPIO_NOPULL;
+  GPIO_InitStruct_C8.Speed = GPIO_SPEED_FREQ_HIGH;
+  GPIO_InitStruct_C8.Alternate = 3;
+  HAL_GPIO_Init(GPIOC, &GPIO_InitStruct_C8);
+  GPIO_InitTypeDef GPIO_InitStruct_B15 = {0};
+  __HAL_RCC_GPIOB_CLK_ENABLE();
+  GPIO_InitStruct_B15.Pin = GPIO_PIN_15;
+  GPIO_InitStruct_B15.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct_B15.Pull = GPIO_NOPULL;
+  GPIO_InitStruct_B15.Speed = GPIO_SPEED_FREQ_HIGH;
+  GPIO_InitStruct_B15.Alternate = 3;
+  HAL_GPIO_Init(GPIOB, &GPIO_InitStruct_B15);
+  GPIO_InitTypeDef GPIO_InitStruct_D8 = {0};
+  __HAL_RCC_GPIOD_CLK_ENABLE();
+  GPIO_InitStruct_D8.Pin = GPIO_PIN_8;
+  GPIO_InitStruct_D8.Mode = GPIO_MODE_INPUT;
+  GPIO_InitStruct_D8.Pull = GPIO_PULLUP;
+  GPIO_InitStruct_D8.Speed = GPIO_SPEED_FREQ_LOW;
+  HAL_GPIO_Init(GPIOD, &GPIO_InitStruct_D8);
+  GPIO_InitTypeDef GPIO_InitStruct_A5 = {0};
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  GPIO_InitStruct_A5.Pin = GPIO_PIN_5;
+  GPIO_InitStruct_A5.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct_A5.Pull = GPIO_NOPULL;
+  GPIO_InitStruct_A5.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+  GPIO_InitStruct_A5.Alternate = 5;
+  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct_A5);
+  GPIO_InitTypeDef GPIO_InitStruct_A6 = {0};
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  GPIO_InitStruct_A6.Pin = GPIO_PIN_6;
+  GPIO_InitStruct_A6.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct_A6.Pull = GPIO_NOPULL;
+  GPIO_InitStruct_A6.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+  GPIO_InitStruct_A6.Alternate = 5;
+  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct_A6);
+  GPIO_InitTypeDef GPIO_InitStruct_A7 = {0};
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  GPIO_InitStruct_A7.Pin = GPIO_PIN_7;
+  GPIO_InitStruct_A7.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct_A7.Pull = GPIO_NOPULL;
+  GPIO_InitStruct_A7.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+  GPIO_InitStruct_A7.Alternate = 5;
+  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct_A7);
+  GPIO_InitTypeDef GPIO_InitStruct_A4 = {0};
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  GPIO_InitStruct_A4.Pin = GPIO_PIN_4;
+  GPIO_InitStruct_A4.Mode = GPIO_MODE_OUTPUT_PP;
+  GPIO_InitStruct_A4.Pull = GPIO_PULLUP;
+  GPIO_InitStruct_A4.Speed = GPIO_SPEED_FREQ_HIGH;
+  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct_A4);
+  GPIO_InitTypeDef GPIO_InitStruct_B0 = {0};
+  __HAL_RCC_GPIOB_CLK_ENABLE();
+  GPIO_InitStruct_B0.Pin = GPIO_PIN_0;
+  GPIO_InitStruct_B0.Mode = GPIO_MODE_INPUT;
+  GPIO_InitStruct_B0.Pull = GPIO_NOPULL;
+  GPIO_InitStruct_B0.Speed = GPIO_SPEED_FREQ_LOW;
+  HAL_GPIO_Init(GPIOB, &GPIO_InitStruct_B0);
+  GPIO_InitTypeDef GPIO_InitStruct_B6 = {0};
+  __HAL_RCC_GPIOB_CLK_ENABLE();
+  GPIO_InitStruct_B6.Pin = GPIO_PIN_6;
+  GPIO_InitStruct_B6.Mode = GPIO_MODE_AF_OD;
+  GPIO_InitStruct_B6.Pull = GPIO_PULLUP;
+  GPIO_InitStruct_B6.Speed = GPIO_SPEED_FREQ_LOW;
+  GPIO_InitStruct_B6.Alternate = 4;
+  HAL_GPIO_Init(GPIOB, &GPIO_InitStruct_B6);
+  GPIO_InitTypeDef GPIO_InitStruct_B7 = {0};
+  __HAL_RCC_GPIOB_CLK_ENABLE();
+  GPIO_InitStruct_B7.Pin = GPIO_PIN_7;
+  GPIO_InitStruct_B7.Mode = GPIO_MODE_AF_OD;
+  GPIO_InitStruct_B7.Pull = GPIO_PULLUP;
+  GPIO_InitStruct_B7.Speed = GPIO_SPEED_FREQ_LOW;
+  GPIO_InitStruct_B7.Alternate = 4;
+  HAL_GPIO_Init(GPIOB, &GPIO_InitStruct_B7);
+  GPIO_InitTypeDef GPIO_InitStruct_B8 = {0};
+  __HAL_RCC_GPIOB_CLK_ENABLE();
+  GPIO_InitStruct_B8.Pin = GPIO_PIN_8;
+  GPIO_InitStruct_B8.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct_B8.Pull = GPIO_NOPULL;
+  GPIO_InitStruct_B8.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+  GPIO_InitStruct_B8.Alternate = 3;
+  HAL_GPIO_Init(GPIOB, &GPIO_InitStruct_B8);
+  GPIO_InitTypeDef GPIO_InitStruct_B9 = {0};
+  __HAL_RCC_GPIOB_CLK_ENABLE();
+  GPIO_InitStruct_B9.Pin = GPIO_PIN_9;
+  GPIO_InitStruct_B9.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct_B9.Pull = GPIO_NOPULL;
+  GPIO_InitStruct_B9.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+  GPIO_InitStruct_B9.Alternate = 3;
+  HAL_GPIO_Init(GPIOB, &GPIO_InitStruct_B9);
 }
\ No newline at end of file
@@ -1,23 +1,410 @@
 #include <cstring>
 
-#include "stm32h5xx.h"
+#include "FreeRTOS.h"
+#include "stm32h5xx_hal.h"
+#include "task.h"
 
+#include "dma_helpers.hpp"
 #include "serial.hpp"
 
 namespace ru::driver {
 
+namespace {
+// Task notification slot used to wake a task blocked in Serial::read (slot 0
+// is left to the application)
+const UBaseType_t serial_notify_index = 1;
+
+const size_t max_rx_ring_size = 32768;
+const size_t max_tx_buffer_size = 2 * DMA_CBR1_BNDT;
+
+// USART limit with oversampling by 8 (the kernel clock may allow more)
+const uint32_t max_baud_rate = 12500000;
+// Largest relative baud rate error accepted (1/50 = 2%)
+const uint32_t max_baud_error_div = 50;
+
+const uint16_t kernel_prescalers[] = {1, 2, 4, 6, 8, 10, 12, 16, 32, 64, 128, 256};
+
+struct SerialHw {
+  SerialId id;
+  USART_TypeDef* usart;
+  IRQn_Type usart_irq;
+  uint64_t kernel_clock;
+  bool lpuart;
+  bool rts_cts;
+  DMA_Channel_TypeDef* rx_dma;
+  IRQn_Type rx_dma_irq;
+  uint32_t rx_request;
+  DMA_Channel_TypeDef* tx_dma;
+  IRQn_Type tx_dma_irq;
+  uint32_t tx_request;
+  uint32_t irq_priority;
+};
+
+// Ports generated from config.yaml, closed by an invalid entry so the table
+// is never empty
+#define X_serial_instance(index, id, periph, lpuart, rts_cts, rx_channel, tx_channel,           \
+                          irq_priority)                                                        \
+  {SerialId::id, periph, periph##_IRQn, RCC_PERIPHCLK_##periph, lpuart, rts_cts,               \
+   GPDMA1_Channel##rx_channel, GPDMA1_Channel##rx_channel##_IRQn, GPDMA1_REQUEST_##periph##_RX, \
+   GPDMA1_Channel##tx_channel, GPDMA1_Channel##tx_channel##_IRQn, GPDMA1_REQUEST_##periph##_TX, \
+   irq_priority},
+const SerialHw serial_hw[] = {
+#include "serial_instances.hpp"
+  {},  // SerialId::invalid
+};
+#undef X_serial_instance
+
+const size_t serial_hw_count = sizeof(serial_hw) / sizeof(serial_hw[0]) - 1;
+
+const SerialHw* find_hw(SerialId id) {
+  for (size_t i = 0; i < serial_hw_count; ++i) {
+    if (serial_hw[i].id == id) {
+      return &serial_hw[i];
+    }
+  }
+  return nullptr;
+}
+
+struct SerialDivider {
+  uint32_t presc;
+  uint32_t brr;
+  bool over8;
+};
+
+bool baud_within_tolerance(uint64_t actual, uint32_t baud_rate) {
+  const uint64_t error = actual > baud_rate ? actual - baud_rate : baud_rate - actual;
+  return error * max_baud_error_div <= baud_rate;
+}
+
+// Picks the smallest kernel clock prescaler giving a valid divider. USARTs
+// oversample by 16 while the divider allows it (better noise tolerance) and
+// by 8 above, up to kernel_hz / 8.
+bool compute_divider(const SerialHw* hw, uint32_t kernel_hz, uint32_t baud_rate,
+                     SerialDivider& div) {
+  if (!baud_rate || !kernel_hz || (!hw->lpuart && baud_rate > max_baud_rate)) {
+    return false;
+  }
+
+  const size_t prescaler_count = sizeof(kernel_prescalers) / sizeof(kernel_prescalers[0]);
+  for (uint32_t presc = 0; presc < prescaler_count; ++presc) {
+    const uint64_t clk = kernel_hz / kernel_prescalers[presc];
+
+    if (hw->lpuart) {
+      // BRR = 256 * clk / baud, valid from 0x300 to 0xFFFFF
+      const uint64_t brr = (256 * clk + baud_rate / 2) / baud_rate;
+      if (brr < 0x300) {
+        return false;
+      }
+      if (brr <= 0xFFFFF) {
+        div = {presc, static_cast<uint32_t>(brr), false};
+        return baud_within_tolerance(256 * clk / brr, baud_rate);
+      }
+      continue;
+    }
+
+    const uint64_t div16 = (clk + baud_rate / 2) / baud_rate;
+    if (div16 >= 16) {
+      if (div16 <= 0xFFFF) {
+        div = {presc, static_cast<uint32_t>(div16), false};
+        return baud_within_tolerance(clk / div16, baud_rate);
+      }
+      continue;
+    }
+
+    // BRR[3:0] holds USARTDIV[3:0] shifted right by one
+    const uint64_t div8 = (2 * clk + baud_rate / 2) / baud_rate;
+    if (div8 < 16) {
+      return false;
+    }
+    div = {presc, static_cast<uint32_t>((div8 & 0xFFF0) | ((div8 & 0xF) >> 1)), true};
+    return baud_within_tolerance(2 * clk / div8, baud_rate);
+  }
+  return false;
+}
+} // namespace
+
+// GPDMA linked-list item reloading the block size and the destination address
+// at the end of each block: the channel loops on itself over the ring
+struct SerialRxDmaNode {
+  uint32_t cbr1;
+  uint32_t cdar;
+  uint32_t cllr;
+};
+
+// One half of the Tx buffer, or a caller's buffer queued by write_async
+struct SerialTxSlot {
+  const uint8_t* data;
+  size_t len;
+  bool external;
+  SerialTxCallback callback;
+  void* ctx;
+};
+
 class SerialInstanceSpecific {
 public:
   USART_TypeDef* usart;
+  const SerialHw* hw;
+  uint8_t* rx_ring;
+  size_t rx_ring_size;
+  bool rx_ring_owned;
+  alignas(4) SerialRxDmaNode rx_node;
+
+  // Monotonic byte counters: the ring holds [rx_tail, rx_head)
+  volatile uint32_t rx_head;
+  volatile uint32_t rx_tail;
+  uint32_t rx_dma_pos;
+  volatile bool rx_overflow;
+  volatile bool rx_dma_error;
+
+  // Reader blocked until rx_head reaches rx_wake_at
+  volatile TaskHandle_t rx_waiter;
+  uint32_t rx_wake_at;
+
+  // tx_slot[tx_next] collects the writes, the other one is on the wire while
+  // tx_busy is set
+  uint8_t* tx_buffer;
+  size_t tx_half;
+  bool tx_buffer_owned;
+  SerialTxSlot tx_slot[2];
+  uint8_t tx_next;
+  volatile bool tx_busy;
+  volatile bool tx_dma_error;
+  volatile TaskHandle_t tx_waiter;
+  SerialTxStats tx_stats;
 };
 
+namespace {
+SerialInstanceSpecific* serial_owner[serial_hw_count];
+
+// Publishes the bytes written by the DMA since the last call. Called from
+// the handlers and, with interrupts masked, from the reader. Every half
+// ring raises an interrupt, so the DMA can never lap the last position.
+void update_rx_head(SerialInstanceSpecific* hw) {
+  const uint32_t remaining = hw->hw->rx_dma->CBR1 & DMA_CBR1_BNDT;
+  const uint32_t pos = (hw->rx_ring_size - remaining) & (hw->rx_ring_size - 1);
+  const uint32_t delta = (pos - hw->rx_dma_pos) & (hw->rx_ring_size - 1);
+  hw->rx_dma_pos = pos;
+  hw->rx_head = hw->rx_head + delta;
+  if (hw->rx_head - hw->rx_tail > hw->rx_ring_size) {
+    hw->rx_overflow = true;
+  }
+}
+
+void wake_reader_from_isr(SerialInstanceSpecific* hw) {
+  BaseType_t woken = pdFALSE;
+  TaskHandle_t waiter = hw->rx_waiter;
+  if (waiter && (static_cast<int32_t>(hw->rx_head - hw->rx_wake_at) >= 0 ||
+                 hw->rx_overflow || hw->rx_dma_error)) {
+    hw->rx_waiter = nullptr;
+    vTaskNotifyGiveIndexedFromISR(waiter, serial_notify_index, &woken);
+  }
+  portYIELD_FROM_ISR(woken);
+}
+
+void handle_usart_irq(size_t index) {
+  SerialInstanceSpecific* hw = serial_owner[index];
+  USART_TypeDef* usart = serial_hw[index].usart;
+  const uint32_t isr = usart->ISR;
+  usart->ICR = isr & (USART_ICR_IDLECF | USART_ICR_ORECF | USART_ICR_NECF |
+                      USART_ICR_FECF | USART_ICR_PECF);
+  if (hw) {
+    update_rx_head(hw);
+    wake_reader_from_isr(hw);
+  }
+}
+
+void handle_rx_dma_irq(size_t index) {
+  SerialInstanceSpecific* hw = serial_owner[index];
+  DMA_Channel_TypeDef* dma = serial_hw[index].rx_dma;
+  const uint32_t csr = dma->CSR;
+  dma->CFCR = dma_clear_flags;
+  if (hw) {
+    if (csr & dma_error_flags) {
+      hw->rx_dma_error = true;
+    }
+    update_rx_head(hw);
+    wake_reader_from_isr(hw);
+  }
+}
+
+void start_rx_dma(SerialInstanceSpecific* hw) {
+  DMA_Channel_TypeDef* dma = hw->hw->rx_dma;
+  const uint32_t node = reinterpret_cast<uint32_t>(&hw->rx_node);
+
+  RCC->AHB1ENR |= RCC_AHB1ENR_GPDMA1EN;
+  (void)RCC->AHB1ENR;
+
+  dma->CCR = DMA_CCR_RESET;
+  dma->CFCR = dma_clear_flags;
+
+  hw->rx_node.cbr1 = hw->rx_ring_size;
+  hw->rx_node.cdar = reinterpret_cast<uint32_t>(hw->rx_ring);
+  hw->rx_node.cllr = DMA_CLLR_UB1 | DMA_CLLR_UDA | DMA_CLLR_ULL | (node & DMA_CLLR_LA);
+
+  // Byte to byte, peripheral to incrementing memory
+  dma->CTR1 = DMA_CTR1_DINC;
+  dma->CTR2 = (hw->hw->rx_request << DMA_CTR2_REQSEL_Pos) & DMA_CTR2_REQSEL;
+  dma->CBR1 = hw->rx_ring_size;
+  dma->CSAR = reinterpret_cast<uint32_t>(&hw->usart->RDR);
+  dma->CDAR = reinterpret_cast<uint32_t>(hw->rx_ring);
+  dma->CLBAR = node & DMA_CLBAR_LBA;
+  dma->CLLR = hw->rx_node.cllr;
+
+  hw->rx_head = 0;
+  hw->rx_tail = 0;
+  hw->rx_dma_pos = 0;
+  hw->rx_overflow = false;
+  hw->rx_dma_error = false;
+  hw->rx_waiter = nullptr;
+
+  dma->CCR = DMA_CCR_TCIE | DMA_CCR_HTIE | DMA_CCR_DTEIE | DMA_CCR_ULEIE | DMA_CCR_USEIE;
+  dma->CCR |= DMA_CCR_EN;
+}
+
+void stop_rx_dma(SerialInstanceSpecific* hw) {
+  DMA_Channel_TypeDef* dma = hw->hw->rx_dma;
+  NVIC_DisableIRQ(hw->hw->rx_dma_irq);
+  NVIC_DisableIRQ(hw->hw->usart_irq);
+  hw->usart->CR1 &= ~USART_CR1_IDLEIE;
+  hw->usart->CR3 &= ~(USART_CR3_DMAR | USART_CR3_EIE);
+  dma->CCR = DMA_CCR_RESET;
+  NVIC_ClearPendingIRQ(hw->hw->rx_dma_irq);
+  NVIC_ClearPendingIRQ(hw->hw->usart_irq);
+}
+
+void release_tx_slot(SerialInstanceSpecific* hw, uint8_t index) {
+  SerialTxSlot& slot = hw->tx_slot[index];
+  slot.data = hw->tx_buffer + index * hw->tx_half;
+  slot.len = 0;
+  slot.external = false;
+  slot.callback = nullptr;
+  slot.ctx = nullptr;
+}
+
+// Puts tx_slot[tx_next] on the wire. Called with the Tx interrupt masked
+// (critical section or the handler itself) and the channel idle.
+void start_tx_dma(SerialInstanceSpecific* hw) {
+  DMA_Channel_TypeDef* dma = hw->hw->tx_dma;
+  const SerialTxSlot& slot = hw->tx_slot[hw->tx_next];
+
+  dma->CFCR = dma_clear_flags;
+  // Byte to byte, incrementing memory to peripheral, request on the destination
+  dma->CTR1 = DMA_CTR1_SINC;
+  dma->CTR2 = ((hw->hw->tx_request << DMA_CTR2_REQSEL_Pos) & DMA_CTR2_REQSEL) | DMA_CTR2_DREQ;
+  dma->CBR1 = slot.len;
+  dma->CSAR = reinterpret_cast<uint32_t>(slot.data);
+  dma->CDAR = reinterpret_cast<uint32_t>(&hw->usart->TDR);
+  dma->CLLR = 0;
+  dma->CCR = DMA_CCR_TCIE | DMA_CCR_DTEIE | DMA_CCR_ULEIE | DMA_CCR_USEIE | DMA_CCR_EN;
+
+  hw->tx_busy = true;
+  hw->tx_next ^= 1;
+}
+
+void stop_tx_dma(SerialInstanceSpecific* hw) {
+  NVIC_DisableIRQ(hw->hw->tx_dma_irq);
+  hw->usart->CR3 &= ~USART_CR3_DMAT;
+  hw->hw->tx_dma->CCR = DMA_CCR_RESET;
+  NVIC_ClearPendingIRQ(hw->hw->tx_dma_irq);
+}
+
+void handle_tx_dma_irq(size_t index) {
+  const uint32_t start = DWT->CYCCNT;
+  SerialInstanceSpecific* hw = serial_owner[index];
+  DMA_Channel_TypeDef* dma = serial_hw[index].tx_dma;
+  const uint32_t csr = dma->CSR;
+  dma->CFCR = dma_clear_flags;
+  if (!hw) {
+    return;
+  }
+
+  if (csr & dma_error_flags) {
+    hw->tx_dma_error = true;
+  }
+
+  const uint8_t done = hw->tx_next ^ 1;
+  const SerialTxCallback callback = hw->tx_slot[done].callback;
+  void* ctx = hw->tx_slot[done].ctx;
+  release_tx_slot(hw, done);
+  if (callback) {
+    callback(ctx);
+  }
+
+  if (hw->tx_slot[hw->tx_next].len) {
+    start_tx_dma(hw);
+  } else {
+    hw->tx_busy = false;
+  }
+
+  BaseType_t woken = pdFALSE;
+  TaskHandle_t waiter = hw->tx_waiter;
+  if (waiter) {
+    hw->tx_waiter = nullptr;
+    vTaskNotifyGiveIndexedFromISR(waiter, serial_notify_index, &woken);
+  }
+  ++hw->tx_stats.irqs;
+  hw->tx_stats.irq_cycles += DWT->CYCCNT - start;
+  portYIELD_FROM_ISR(woken);
+}
+
+// Only one task at a time can wait for the Tx interrupt; the others poll
+// the slots every tick. Called inside a critical section.
+bool register_tx_waiter(SerialInstanceSpecific* hw) {
+  if (hw->tx_waiter) {
+    return false;
+  }
+  hw->tx_waiter = xTaskGetCurrentTaskHandle();
+  return true;
+}
+
+void wait_tx(bool registered, TickType_t ticks) {
+  if (registered) {
+    ulTaskNotifyTakeIndexed(serial_notify_index, pdTRUE, ticks);
+  } else {
+    vTaskDelay(1);
+  }
+}
+
+// Copies up to len bytes out of the ring and releases them to the DMA
+size_t copy_from_ring(SerialInstanceSpecific* hw, uint8_t* data, size_t len) {
+  const uint32_t tail = hw->rx_tail;
+  const size_t available = hw->rx_head - tail;
+  const size_t count = available < len ? available : len;
+  const size_t offset = tail & (hw->rx_ring_size - 1);
+  const size_t first = count < hw->rx_ring_size - offset ? count : hw->rx_ring_size - offset;
+
+  std::memcpy(data, hw->rx_ring + offset, first);
+  std::memcpy(data + first, hw->rx_ring, count - first);
+  hw->rx_tail = tail + count;
+  return count;
+}
+
+expected::expected<void, Error> check_rx_state(SerialInstanceSpecific* hw) {
+  if (hw->rx_dma_error) {
+    return expected::unexpected(RU_ERROR(CommonError::general_error, "serial rx dma error"));
+  }
+  if (hw->rx_overflow) {
+    hw->rx_tail = hw->rx_head;
+    hw->rx_overflow = false;
+    return expected::unexpected(RU_ERROR(SerialError::overrun, "serial rx ring overflow"));
+  }
+  return {};
+}
+} // namespace
+
 SerialConfig::SerialConfig(SerialId id, uint32_t baud_rate, SerialParity parity,
-                           SerialStopBits stop_bits, SerialFlowControl flow_control)
+                           SerialStopBits stop_bits, SerialFlowControl flow_control,
+                           uint8_t* rx_ring, size_t rx_ring_size, uint8_t* tx_buffer,
+                           size_t tx_buffer_size)
     : m_id(id),
       m_baud_rate(baud_rate),
       m_parity(parity),
       m_stop_bits(stop_bits),
-      m_flow_control(flow_control) {}
+      m_flow_control(flow_control),
+      m_rx_ring(rx_ring),
+      m_rx_ring_size(rx_ring_size),
+      m_tx_buffer(tx_buffer),
+      m_tx_buffer_size(tx_buffer_size) {}
 
 Serial::Serial() : p_instance_specific(nullptr) {}
 
@@ -27,20 +414,119 @@ expected::expected<void, Error> Serial::start() {
 
 expected::expected<void, Error> Serial::init(const Config& config) {
   const auto* cfg = dynamic_cast<const SerialConfig*>(&config);
-  if (cfg) {
-    if (!p_instance_specific) {
-      p_instance_specific = new SerialInstanceSpecific();
-    }
-    auto* hw = static_cast<SerialInstanceSpecific*>(p_instance_specific);
-    hw->usart = USART1;
-  } else {
+  if (!cfg) {
     return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid serial config"));
   }
+
+  const SerialHw* serial = find_hw(cfg->m_id);
+  if (!serial) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "unsupported serial id"));
+  }
+
+  const size_t size = cfg->m_rx_ring_size;
+  if (size < 2 || size > max_rx_ring_size || (size & (size - 1))) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid rx ring size"));
+  }
+
+  const size_t tx_size = cfg->m_tx_buffer_size;
+  if (tx_size < 2 || tx_size > max_tx_buffer_size || (tx_size & 1)) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid tx buffer size"));
+  }
+
+  if (cfg->m_flow_control == SerialFlowControl::rts_cts && !serial->rts_cts) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "rts/cts pins not wired"));
+  }
+
+  SerialDivider div{};
+  const uint32_t kernel_hz = HAL_RCCEx_GetPeriphCLKFreq(serial->kernel_clock);
+  if (!compute_divider(serial, kernel_hz, cfg->m_baud_rate, div)) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "unsupported baud rate"));
+  }
+
+  const size_t index = static_cast<size_t>(serial - serial_hw);
+  if (serial_owner[index] && serial_owner[index] != p_instance_specific) {
+    return expected::unexpected(RU_ERROR(CommonError::busy, "serial already in use"));
+  }
+
+  if (p_instance_specific) {
+    (void)stop();
+  }
+  p_instance_specific = new SerialInstanceSpecific();
+
+  auto* hw = static_cast<SerialInstanceSpecific*>(p_instance_specific);
+  hw->usart = serial->usart;
+  hw->hw = serial;
+  hw->rx_ring_size = size;
+  hw->rx_ring_owned = !cfg->m_rx_ring;
+  hw->rx_ring = hw->rx_ring_owned ? new uint8_t[size] : cfg->m_rx_ring;
+  hw->tx_half = tx_size / 2;
+  hw->tx_buffer_owned = !cfg->m_tx_buffer;
+  hw->tx_buffer = hw->tx_buffer_owned ? new uint8_t[tx_size] : cfg->m_tx_buffer;
+  release_tx_slot(hw, 0);
+  release_tx_slot(hw, 1);
+  hw->tx_next = 0;
+  hw->tx_busy = false;
+  hw->tx_dma_error = false;
+  hw->tx_waiter = nullptr;
+  hw->tx_stats = {};
+
+  // Frame format and baud rate are writable only while the USART is disabled
+  USART_TypeDef* usart = hw->usart;
+  usart->CR1 = 0;
+  usart->CR2 = cfg->m_stop_bits == SerialStopBits::two ? USART_CR2_STOP_1 : 0;
+  usart->CR3 = USART_CR3_DMAR | USART_CR3_DMAT | USART_CR3_EIE;
+  if (cfg->m_flow_control == SerialFlowControl::rts_cts) {
+    usart->CR3 |= USART_CR3_RTSE | USART_CR3_CTSE;
+  }
+  usart->PRESC = div.presc;
+  usart->BRR = div.brr;
+
+  // The 8-deep FIFOs give the DMA channels 8 characters of slack before an
+  // overrun. They are drained on RXFNE/TXFNF, so no threshold interrupt.
+  uint32_t cr1 = USART_CR1_FIFOEN | USART_CR1_IDLEIE | USART_CR1_RE | USART_CR1_TE;
+  if (div.over8) {
+    cr1 |= USART_CR1_OVER8;
+  }
+  if (cfg->m_parity != SerialParity::none) {
+    // 8 data bits plus the parity bit
+    cr1 |= USART_CR1_M0 | USART_CR1_PCE;
+    if (cfg->m_parity == SerialParity::odd) {
+      cr1 |= USART_CR1_PS;
+    }
+  }
+  usart->CR1 = cr1;
+  usart->ICR = USART_ICR_IDLECF | USART_ICR_ORECF | USART_ICR_NECF | USART_ICR_FECF |
+               USART_ICR_PECF;
+
+  start_rx_dma(hw);
+  serial_owner[index] = hw;
+  usart->CR1 |= USART_CR1_UE;
+
+  NVIC_SetPriority(serial->usart_irq, serial->irq_priority);
+  NVIC_SetPriority(serial->rx_dma_irq, serial->irq_priority);
+  NVIC_SetPriority(serial->tx_dma_irq, serial->irq_priority);
+  NVIC_EnableIRQ(serial->usart_irq);
+  NVIC_EnableIRQ(serial->rx_dma_irq);
+  NVIC_EnableIRQ(serial->tx_dma_irq);
+
   return {};
 }
 
 expected::expected<void, Error> Serial::stop() {
-  delete static_cast<SerialInstanceSpecific*>(p_instance_specific);
+  auto* hw = static_cast<SerialInstanceSpecific*>(p_instance_specific);
+  if (hw) {
+    stop_rx_dma(hw);
+    stop_tx_dma(hw);
+    hw->usart->CR1 = 0;
+    serial_owner[hw->hw - serial_hw] = nullptr;
+    if (hw->rx_ring_owned) {
+      delete[] hw->rx_ring;
+    }
+    if (hw->tx_buffer_owned) {
+      delete[] hw->tx_buffer;
+    }
+  }
+  delete hw;
   p_instance_specific = nullptr;
   return {};
 }
@@ -51,30 +537,172 @@ expected::expected<size_t, Error> Serial::write(const uint8_t* data, size_t len)
     return expected::unexpected(RU_ERROR(CommonError::not_inited, "serial not initialized"));
   }
 
-  for (size_t i = 0; i < len; ++i) {
-    while (!(hw->usart->ISR & USART_ISR_TXE_TXFNF)) {}
-    hw->usart->TDR = data[i];
+  uint32_t mark = DWT->CYCCNT;
+  uint32_t cycles = 0;
+  size_t queued = 0;
+  while (queued < len) {
+    if (hw->tx_dma_error) {
+      hw->tx_dma_error = false;
+      return expected::unexpected(RU_ERROR(CommonError::general_error, "serial tx dma error"));
+    }
+
+    size_t count = 0;
+    bool registered = false;
+    taskENTER_CRITICAL();
+    SerialTxSlot& slot = hw->tx_slot[hw->tx_next];
+    if (!slot.external) {
+      // Copied with the Tx interrupt masked, so the half is never sent partially
+      // filled and concurrent writers do not interleave within a chunk
+      count = len - queued < hw->tx_half - slot.len ? len - queued : hw->tx_half - slot.len;
+      std::memcpy(hw->tx_buffer + hw->tx_next * hw->tx_half + slot.len, data + queued, count);
+      slot.len += count;
+      if (count && !hw->tx_busy) {
+        start_tx_dma(hw);
+      }
+    }
+    if (!count) {
+      registered = register_tx_waiter(hw);
+    }
+    taskEXIT_CRITICAL();
+
+    queued += count;
+    if (!count) {
+      cycles += DWT->CYCCNT - mark;
+      wait_tx(registered, portMAX_DELAY);
+      mark = DWT->CYCCNT;
+    }
   }
 
+  taskENTER_CRITICAL();
+  hw->tx_stats.bytes += static_cast<uint32_t>(len);
+  hw->tx_stats.write_cycles += cycles + (DWT->CYCCNT - mark);
+  taskEXIT_CRITICAL();
   return len;
 }
 
-expected::expected<size_t, Error> Serial::read(uint8_t* data, size_t len) {
+expected::expected<void, Error> Serial::write_async(const uint8_t* data, size_t len,
+                                                    SerialTxCallback callback, void* ctx) {
+  auto* hw = static_cast<SerialInstanceSpecific*>(p_instance_specific);
+  if (!hw || !hw->usart) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "serial not initialized"));
+  }
+  if (!data || !len || len > DMA_CBR1_BNDT) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid tx length"));
+  }
+
+  for (;;) {
+    bool queued = false;
+    bool registered = false;
+    taskENTER_CRITICAL();
+    SerialTxSlot& slot = hw->tx_slot[hw->tx_next];
+    if (!slot.len) {
+      slot.data = data;
+      slot.len = len;
+      slot.external = true;
+      slot.callback = callback;
+      slot.ctx = ctx;
+      if (!hw->tx_busy) {
+        start_tx_dma(hw);
+      }
+      queued = true;
+    } else {
+      registered = register_tx_waiter(hw);
+    }
+    taskEXIT_CRITICAL();
+
+    if (queued) {
+      return {};
+    }
+    wait_tx(registered, portMAX_DELAY);
+  }
+}
+
+expected::expected<void, Error> Serial::flush(uint32_t timeout_ms) {
   auto* hw = static_cast<SerialInstanceSpecific*>(p_instance_specific);
   if (!hw || !hw->usart) {
     return expected::unexpected(RU_ERROR(CommonError::not_inited, "serial not initialized"));
   }
 
+  const TickType_t start = xTaskGetTickCount();
+  const TickType_t timeout = to_ticks(timeout_ms);
+  for (;;) {
+    bool idle = false;
+    bool registered = false;
+    taskENTER_CRITICAL();
+    idle = !hw->tx_busy && !hw->tx_slot[hw->tx_next].len;
+    if (!idle) {
+      registered = register_tx_waiter(hw);
+    }
+    taskEXIT_CRITICAL();
+    if (idle) {
+      break;
+    }
+
+    const TickType_t left = ticks_left(start, timeout);
+    if (!left) {
+      taskENTER_CRITICAL();
+      if (registered && hw->tx_waiter == xTaskGetCurrentTaskHandle()) {
+        hw->tx_waiter = nullptr;
+      }
+      taskEXIT_CRITICAL();
+      return expected::unexpected(RU_ERROR(SerialError::timeout, "serial flush timeout"));
+    }
+    wait_tx(registered, left);
+  }
+
+  // The DMA is done once the last byte reached TDR: wait for it to leave
+  // the shift register (one character time, unless the transmitter stalls)
+  while (!(hw->usart->ISR & USART_ISR_TC)) {
+    if (!ticks_left(start, timeout)) {
+      return expected::unexpected(RU_ERROR(SerialError::timeout, "serial flush timeout"));
+    }
+  }
+  return {};
+}
+
+expected::expected<size_t, Error> Serial::read(uint8_t* data, size_t len, uint32_t timeout_ms) {
+  auto* hw = static_cast<SerialInstanceSpecific*>(p_instance_specific);
+  if (!hw || !hw->usart) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "serial not initialized"));
+  }
+  if (!data || !len) {
+    return 0;
+  }
+
+  const TickType_t start = xTaskGetTickCount();
+  const TickType_t timeout = to_ticks(timeout_ms);
   size_t count = 0;
-  for (; count < len; ++count) {
-    if (!(hw->usart->ISR & USART_ISR_RXNE_RXFNE)) {
+
+  for (;;) {
+    taskENTER_CRITICAL();
+    update_rx_head(hw);
+    auto state = check_rx_state(hw);
+    if (state && hw->rx_head - hw->rx_tail < len - count) {
+      // Register before copying, so bytes landing meanwhile still wake us
+      hw->rx_wake_at = hw->rx_tail + (len - count);
+      hw->rx_waiter = xTaskGetCurrentTaskHandle();
+    }
+    taskEXIT_CRITICAL();
+    if (!state) {
+      hw->rx_waiter = nullptr;
+      return expected::unexpected(state.error());
+    }
+
+    count += copy_from_ring(hw, data + count, len - count);
+    if (count == len) {
+      break;
+    }
+
+    const TickType_t left = ticks_left(start, timeout);
+    if (!left) {
       break;
     }
-    data[count] = static_cast<uint8_t>(hw->usart->RDR);
+    ulTaskNotifyTakeIndexed(serial_notify_index, pdTRUE, left);
   }
 
-  if (data && count < len) {
-    std::memset(data + count, 0, len - count);
+  hw->rx_waiter = nullptr;
+  if (!count) {
+    return expected::unexpected(RU_ERROR(SerialError::timeout, "serial read timeout"));
   }
   return count;
 }
@@ -89,18 +717,44 @@ expected::expected<std::optional<size_t>, Error> Serial::try_read(uint8_t* data,
     return expected::unexpected(RU_ERROR(CommonError::not_inited, "serial not initialized"));
   }
 
-  size_t count = 0;
-  for (; count < len; ++count) {
-    if (!(hw->usart->ISR & USART_ISR_RXNE_RXFNE)) {
-      break;
-    }
-    data[count] = static_cast<uint8_t>(hw->usart->RDR);
+  taskENTER_CRITICAL();
+  update_rx_head(hw);
+  auto state = check_rx_state(hw);
+  taskEXIT_CRITICAL();
+  if (!state) {
+    return expected::unexpected(state.error());
   }
 
+  const size_t count = copy_from_ring(hw, data, len);
   if (!count) {
     return std::optional<size_t>{};
   }
   return count;
 }
 
+expected::expected<SerialTxStats, Error> Serial::tx_stats() const {
+  const auto* hw = p_instance_specific;
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "serial not initialized"));
+  }
+  taskENTER_CRITICAL();
+  const SerialTxStats stats = hw->tx_stats;
+  taskEXIT_CRITICAL();
+  return stats;
+}
+
 } // namespace ru::driver
+
+#define X_serial_instance(index, id, periph, lpuart, rts_cts, rx_channel, tx_channel, \
+                          irq_priority)                                               \
+  extern "C" void periph##_IRQHandler(void) {                                         \
+    ru::driver::handle_usart_irq(index);                                              \
+  }                                                                                   \
+  extern "C" void GPDMA1_Channel##rx_channel##_IRQHandler(void) {                     \
+    ru::driver::handle_rx_dma_irq(index);                                             \
+  }                                                                                   \
+  extern "C" void GPDMA1_Channel##tx_channel##_IRQHandler(void) {                     \
+    ru::driver::handle_tx_dma_irq(index);                                             \
+  }
+#include "serial_instances.hpp"
+#undef X_serial_instance
@@ -0,0 +1,65 @@
+#include "FreeRTOS.h"
+#include "stm32h5xx_hal.h"
+#include "task.h"
+
+#include "debug_log.hpp"
+#include "serial.hpp"
+#include "timer.hpp"
+
+namespace ru::driver {
+
+namespace {
+const size_t write_chunk = 64;
+
+uint32_t per_kib(uint32_t cycles, size_t bytes) {
+  return static_cast<uint32_t>(static_cast<uint64_t>(cycles) * 1024 / bytes);
+}
+} // namespace
+
+void report_serial_cycles(SerialId id, uint32_t baud_rate, size_t bytes) {
+  if (!bytes) {
+    return;
+  }
+  (void)Timer::start();
+
+  Serial serial;
+  if (!serial.init(SerialConfig(id, baud_rate))) {
+    RU_LOG_WARN("serial %u: port unavailable", static_cast<unsigned>(id));
+    return;
+  }
+
+  uint8_t chunk[write_chunk];
+  for (size_t i = 0; i < write_chunk; ++i) {
+    chunk[i] = static_cast<uint8_t>('0' + i % 64);
+  }
+
+  // write() returns as soon as the bytes are queued: the wall time up to the
+  // end of flush() is the wire time, the stats are what the CPU paid for it
+  const uint32_t wall_start = DWT->CYCCNT;
+  bool failed = false;
+  for (size_t sent = 0; sent < bytes && !failed;) {
+    const size_t count = bytes - sent < write_chunk ? bytes - sent : write_chunk;
+    failed = !serial.write(chunk, count);
+    sent += count;
+  }
+  failed = failed || !serial.flush();
+  const uint32_t wall_cycles = DWT->CYCCNT - wall_start;
+  const auto stats = serial.tx_stats();
+
+  if (failed || !stats) {
+    RU_LOG_WARN("serial %u: tx failed", static_cast<unsigned>(id));
+  } else {
+    const uint32_t write_kib = per_kib(stats->write_cycles, bytes);
+    const uint32_t irq_kib = per_kib(stats->irq_cycles, bytes);
+    RU_LOG_INFO("serial %u: %u cycles/KiB in write(), %u in %u tx interrupts (%u wall)",
+                static_cast<unsigned>(id), write_kib, irq_kib,
+                static_cast<unsigned>(stats->irqs), per_kib(wall_cycles, bytes));
+    RU_LOG_INFO("serial %u: %u%% of the wire time spent by the cpu", static_cast<unsigned>(id),
+                static_cast<unsigned>(static_cast<uint64_t>(write_kib + irq_kib) * 100 /
+                                      per_kib(wall_cycles, bytes)));
+  }
+
+  (void)serial.stop();
+}
+
+} // namespace ru::driver
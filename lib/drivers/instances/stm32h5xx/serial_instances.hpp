@@ -0,0 +1,17 @@
+// Serial ports of the board, generated by generate.py from the 'usart' module of
+// config.yaml. Do not edit, regenerate instead.
+//
+// X_serial_instance(index, id, periph, lpuart, rts_cts, rx_channel, tx_channel, irq_priority)
+// - id:          SerialId bound to the port
+// - periph:      USART/UART/LPUART instance
+// - lpuart:      1 for a low power UART (different baud rate generator)
+// - rts_cts:     1 if the RTS/CTS pins are wired
+// - rx_channel:  GPDMA1 channel filling the Rx ring
+// - tx_channel:  GPDMA1 channel sending the Tx buffer
+// - irq_priority: NVIC priority of the USART and DMA handlers
+
+#ifndef X_serial_instance
+#define X_serial_instance(index, id, periph, lpuart, rts_cts, rx_channel, tx_channel, irq_priority)
+#endif
+
+X_serial_instance(0, serial_debug, USART1, 0, 1, 0, 1, 6)
\ No newline at end of file
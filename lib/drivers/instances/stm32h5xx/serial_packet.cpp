@@ -0,0 +1,242 @@
+#include <cstring>
+
+#include "serial_packet.hpp"
+
+namespace ru::driver {
+
+namespace {
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), one table lookup per byte
+struct Crc16Table {
+  uint16_t entry[256];
+  constexpr Crc16Table() : entry() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint16_t crc = static_cast<uint16_t>(i << 8);
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = static_cast<uint16_t>(crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1);
+      }
+      entry[i] = crc;
+    }
+  }
+};
+
+constexpr Crc16Table crc16_table;
+
+uint16_t crc16(const uint8_t* data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; ++i) {
+    crc = static_cast<uint16_t>((crc << 8) ^ crc16_table.entry[(crc >> 8) ^ data[i]]);
+  }
+  return crc;
+}
+
+// Encodes buf[1..len] in place, buf[0] being free for the first code byte.
+// len <= 254 keeps the whole packet in one COBS block. Returns the encoded
+// size including the delimiter written at buf[len + 1].
+size_t cobs_encode_in_place(uint8_t* buf, size_t len) {
+  size_t code_pos = 0;
+  uint8_t code = 1;
+  for (size_t i = 1; i <= len; ++i) {
+    if (buf[i] == 0) {
+      buf[code_pos] = code;
+      code_pos = i;
+      code = 1;
+    } else {
+      ++code;
+    }
+  }
+  buf[code_pos] = code;
+  buf[len + 1] = 0;
+  return len + 2;
+}
+
+// Decodes buf[0..len) (no delimiter) in place; the output never overtakes
+// the input. Returns the decoded size, or -1 on an invalid code byte.
+int cobs_decode_in_place(uint8_t* buf, size_t len) {
+  size_t in = 0;
+  size_t out = 0;
+  while (in < len) {
+    const uint8_t code = buf[in++];
+    if (in + code - 1 > len) {
+      return -1;
+    }
+    std::memmove(buf + out, buf + in, code - 1);
+    in += code - 1;
+    out += code - 1;
+    if (code != 0xFF && in < len) {
+      buf[out++] = 0;
+    }
+  }
+  return static_cast<int>(out);
+}
+
+void tx_done(void* ctx) {
+  *static_cast<volatile bool*>(ctx) = false;
+}
+} // namespace
+
+SerialPacket::SerialPacket(Serial& serial)
+    : m_serial(serial),
+      m_handlers(),
+      m_handler_count(0),
+      m_tx(),
+      m_tx_busy(),
+      m_tx_next(0),
+      m_tx_prepared(false),
+      m_rx(),
+      m_rx_start(0),
+      m_rx_len(0),
+      m_rx_discard(false),
+      m_stats() {}
+
+expected::expected<void, Error> SerialPacket::on(uint8_t type, Handler handler, void* ctx) {
+  for (size_t i = 0; i < m_handler_count; ++i) {
+    if (m_handlers[i].type == type) {
+      m_handlers[i].handler = handler;
+      m_handlers[i].ctx = ctx;
+      return {};
+    }
+  }
+  if (m_handler_count == max_handlers) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "too many packet handlers"));
+  }
+  m_handlers[m_handler_count++] = {handler, ctx, type};
+  return {};
+}
+
+expected::expected<std::span<uint8_t>, Error> SerialPacket::prepare() {
+  if (m_tx_busy[m_tx_next]) {
+    // Both buffers queued: the link is slower than the sender
+    auto flushed = m_serial.flush();
+    if (!flushed) {
+      return expected::unexpected(flushed.error());
+    }
+  }
+  m_tx_prepared = true;
+  // Code byte and type come first
+  return std::span<uint8_t>(m_tx[m_tx_next] + 2, max_payload);
+}
+
+expected::expected<void, Error> SerialPacket::send(uint8_t type, size_t len) {
+  if (!m_tx_prepared) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "packet not prepared"));
+  }
+  if (len > max_payload) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "packet too long"));
+  }
+
+  uint8_t* buf = m_tx[m_tx_next];
+  buf[1] = type;
+  const uint16_t crc = crc16(buf + 1, len + 1);
+  buf[len + 2] = static_cast<uint8_t>(crc);
+  buf[len + 3] = static_cast<uint8_t>(crc >> 8);
+  const size_t size = cobs_encode_in_place(buf, len + 3);
+
+  m_tx_prepared = false;
+  m_tx_busy[m_tx_next] = true;
+  auto queued = m_serial.write_async(buf, size, tx_done,
+                                     const_cast<bool*>(&m_tx_busy[m_tx_next]));
+  if (!queued) {
+    m_tx_busy[m_tx_next] = false;
+    return expected::unexpected(queued.error());
+  }
+  m_tx_next ^= 1;
+  return {};
+}
+
+expected::expected<void, Error> SerialPacket::send(uint8_t type, std::span<const uint8_t> payload) {
+  if (payload.size() > max_payload) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "packet too long"));
+  }
+  auto area = prepare();
+  if (!area) {
+    return expected::unexpected(area.error());
+  }
+  std::memcpy(area->data(), payload.data(), payload.size());
+  return send(type, payload.size());
+}
+
+expected::expected<size_t, Error> SerialPacket::poll(uint32_t timeout_ms) {
+  // Keep room for a whole encoded packet after the frame being received
+  if (m_rx_start && sizeof(m_rx) - m_rx_len < max_encoded) {
+    m_rx_len -= m_rx_start;
+    std::memmove(m_rx, m_rx + m_rx_start, m_rx_len);
+    m_rx_start = 0;
+  }
+
+  size_t received = 0;
+  auto got = m_serial.try_read(m_rx + m_rx_len, sizeof(m_rx) - m_rx_len);
+  if (!got) {
+    return expected::unexpected(got.error());
+  }
+  if (*got) {
+    received = **got;
+  } else if (timeout_ms) {
+    auto first = m_serial.read(m_rx + m_rx_len, 1, timeout_ms);
+    if (!first) {
+      if (std::holds_alternative<SerialError>(first.error().code) &&
+          std::get<SerialError>(first.error().code) == SerialError::timeout) {
+        return 0;
+      }
+      return expected::unexpected(first.error());
+    }
+    received = *first;
+  }
+
+  const uint32_t dispatched = m_stats.packets;
+  const size_t end = m_rx_len + received;
+  for (size_t i = m_rx_len; i < end; ++i) {
+    if (m_rx[i]) {
+      continue;
+    }
+    if (m_rx_discard) {
+      m_rx_discard = false;
+    } else if (i > m_rx_start) {
+      process(m_rx + m_rx_start, i - m_rx_start);
+    }
+    m_rx_start = i + 1;
+  }
+  m_rx_len = end;
+
+  // No delimiter within the largest packet: resync on the next one
+  if (m_rx_len - m_rx_start >= max_encoded) {
+    if (!m_rx_discard) {
+      ++m_stats.overflows;
+    }
+    m_rx_discard = true;
+    m_rx_start = m_rx_len;
+  }
+  if (m_rx_start == m_rx_len) {
+    m_rx_start = 0;
+    m_rx_len = 0;
+  }
+
+  return m_stats.packets - dispatched;
+}
+
+void SerialPacket::process(uint8_t* frame, size_t len) {
+  const int decoded = cobs_decode_in_place(frame, len);
+  if (decoded < 3) {
+    ++m_stats.framing_errors;
+    return;
+  }
+
+  const size_t size = static_cast<size_t>(decoded);
+  const uint16_t crc = static_cast<uint16_t>(frame[size - 2] | (frame[size - 1] << 8));
+  if (crc16(frame, size - 2) != crc) {
+    ++m_stats.crc_errors;
+    return;
+  }
+
+  const uint8_t type = frame[0];
+  for (size_t i = 0; i < m_handler_count; ++i) {
+    if (m_handlers[i].type == type && m_handlers[i].handler) {
+      ++m_stats.packets;
+      m_handlers[i].handler(type, std::span<const uint8_t>(frame + 1, size - 3),
+                            m_handlers[i].ctx);
+      return;
+    }
+  }
+  ++m_stats.unhandled;
+}
+
+} // namespace ru::driver
@@ -1,17 +1,288 @@
+#include "FreeRTOS.h"
+#include "stm32h5xx_hal.h"
+#include "task.h"
+
+#include "cycle_counter.h"
+#include "dma_helpers.hpp"
 #include "spi.hpp"
+#include "static_gpio.hpp"
 
 namespace ru::driver {
 
-SpiConfig::SpiConfig(SpiId id, uint32_t frequency_hz, SpiMode mode,
-                     SpiClockPolarity clock_polarity, SpiBitOrder bit_order,
-                     SpiDirection direction, bool chip_select_active_low)
-    : m_id(id),
-      m_frequency_hz(frequency_hz),
+namespace {
+// Task notification slot used to wake a task blocked in Spi::wait (slot 0 is
+// left to the application)
+const UBaseType_t spi_notify_index = 1;
+
+const uint32_t spi_clear_flags = SPI_IFCR_EOTC | SPI_IFCR_TXTFC | SPI_IFCR_UDRC | SPI_IFCR_OVRC |
+                                 SPI_IFCR_MODFC | SPI_IFCR_SUSPC;
+
+// 8-bit frames (DSIZE = frame bits - 1), FIFO threshold of one frame
+const uint32_t spi_cfg1_frame = 7 << SPI_CFG1_DSIZE_Pos;
+// Master with software slave select, keeping the pins while disabled so SCK
+// holds its idle level between transfers
+const uint32_t spi_cfg2_base = SPI_CFG2_MASTER | SPI_CFG2_SSM | SPI_CFG2_AFCNTR;
+// Baud rate prescaler MBR: kernel clock / 2^(MBR + 1)
+const uint32_t max_mbr = 7;
+// The DMA interrupt busy-waits the chip select inactive time between segments
+const uint32_t max_min_deselect_ns = 10000;
+
+struct SpiHw {
+  SpiId id;
+  SPI_TypeDef* spi;
+  volatile uint32_t* enable_reg;
+  uint32_t enable_bit;
+  uint64_t kernel_clock;
+  DMA_Channel_TypeDef* rx_dma;
+  IRQn_Type rx_dma_irq;
+  uint32_t rx_request;
+  DMA_Channel_TypeDef* tx_dma;
+  IRQn_Type tx_dma_irq;
+  uint32_t tx_request;
+  uint32_t irq_priority;
+};
+
+// Controllers generated from config.yaml, closed by an invalid entry so the
+// table is never empty
+#define X_spi_instance(index, id, periph, bus, rx_channel, tx_channel, irq_priority)            \
+  {SpiId::id, periph, &RCC->bus##ENR, RCC_##bus##ENR_##periph##EN, RCC_PERIPHCLK_##periph,     \
+   GPDMA1_Channel##rx_channel, GPDMA1_Channel##rx_channel##_IRQn, GPDMA1_REQUEST_##periph##_RX, \
+   GPDMA1_Channel##tx_channel, GPDMA1_Channel##tx_channel##_IRQn, GPDMA1_REQUEST_##periph##_TX, \
+   irq_priority},
+const SpiHw spi_hw[] = {
+#include "spi_instances.hpp"
+  {},  // SpiId::invalid
+};
+#undef X_spi_instance
+
+const size_t spi_hw_count = sizeof(spi_hw) / sizeof(spi_hw[0]) - 1;
+
+const SpiHw* find_hw(SpiId id) {
+  for (size_t i = 0; i < spi_hw_count; ++i) {
+    if (spi_hw[i].id == id) {
+      return &spi_hw[i];
+    }
+  }
+  return nullptr;
+}
+} // namespace
+
+// Settings of a device, in register form
+struct SpiDeviceSlot {
+  Gpio chip_select;  // owns the pin; select() drives it through BSRR
+  volatile uint32_t* cs_bsrr;
+  uint32_t cs_select;        // BSRR words setting chip select active and inactive
+  uint32_t cs_deselect;
+  uint32_t deselect_cycles;  // minimum inactive time, in SystemCoreClock cycles
+  uint32_t deselected_at;    // DWT cycle counter when chip select last went inactive
+  uint32_t cfg1;  // prescaler and frame size, without the DMA enables
+  uint32_t cfg2;  // mode and bit order
+  uint32_t frequency_hz;
+};
+
+class SpiInstanceSpecific {
+public:
+  const SpiHw* hw;
+  SpiDeviceSlot devices[Spi::max_devices];
+  size_t device_count;
+
+  // Transactions waiting for the bus, oldest first, and the one on it
+  SpiTransaction* head;
+  SpiTransaction* tail;
+  SpiTransaction* current;
+  size_t segment;
+  // CFG2 as last written: settings of the previous transaction
+  uint32_t cfg2;
+
+  // Source of the bytes sent for a read, sink of those received by a write
+  uint8_t tx_dummy;
+  uint8_t rx_dummy;
+  SpiStats stats;
+};
+
+namespace {
+SpiInstanceSpecific* spi_owner[spi_hw_count];
+
+// Chip select with a single store, from the DMA interrupt too. Going active
+// first waits out the minimum inactive time since the last deselect (or a
+// little more, once every 2^32 cycles, when the counter wrapped meanwhile).
+void select(SpiDeviceSlot& device, bool active) {
+  if (active) {
+    while (DWT->CYCCNT - device.deselected_at < device.deselect_cycles) {
+    }
+    *device.cs_bsrr = device.cs_select;
+  } else {
+    *device.cs_bsrr = device.cs_deselect;
+    device.deselected_at = DWT->CYCCNT;
+  }
+}
+
+// Runs the segment of the current transaction on the bus: the receive
+// channel is armed first, then the transmit one, whose first request starts
+// the clock. Called with the SPI disabled.
+void start_segment(SpiInstanceSpecific* hw) {
+  const SpiHw* spi_hw = hw->hw;
+  SPI_TypeDef* spi = spi_hw->spi;
+  const SpiSegment& segment = hw->current->segments[hw->segment];
+  const uint32_t cfg1 = hw->devices[hw->current->device].cfg1;
+
+  DMA_Channel_TypeDef* rx = spi_hw->rx_dma;
+  rx->CFCR = dma_clear_flags;
+  // Byte to byte, peripheral to memory, incrementing unless the bytes are dropped
+  rx->CTR1 = segment.rx ? DMA_CTR1_DINC : 0;
+  rx->CTR2 = (spi_hw->rx_request << DMA_CTR2_REQSEL_Pos) & DMA_CTR2_REQSEL;
+  rx->CBR1 = segment.len;
+  rx->CSAR = reinterpret_cast<uint32_t>(&spi->RXDR);
+  rx->CDAR = reinterpret_cast<uint32_t>(segment.rx ? segment.rx : &hw->rx_dummy);
+  rx->CLLR = 0;
+  rx->CCR = DMA_CCR_TCIE | DMA_CCR_DTEIE | DMA_CCR_ULEIE | DMA_CCR_USEIE | DMA_CCR_EN;
+
+  spi->CR2 = segment.len;
+  spi->CFG1 = cfg1 | SPI_CFG1_RXDMAEN;
+
+  DMA_Channel_TypeDef* tx = spi_hw->tx_dma;
+  tx->CFCR = dma_clear_flags;
+  // Byte to byte, memory to peripheral, request on the destination
+  tx->CTR1 = segment.tx ? DMA_CTR1_SINC : 0;
+  tx->CTR2 = ((spi_hw->tx_request << DMA_CTR2_REQSEL_Pos) & DMA_CTR2_REQSEL) | DMA_CTR2_DREQ;
+  tx->CBR1 = segment.len;
+  tx->CSAR = reinterpret_cast<uint32_t>(segment.tx ? segment.tx : &hw->tx_dummy);
+  tx->CDAR = reinterpret_cast<uint32_t>(&spi->TXDR);
+  tx->CLLR = 0;
+  tx->CCR = DMA_CCR_DTEIE | DMA_CCR_ULEIE | DMA_CCR_USEIE | DMA_CCR_EN;
+
+  spi->CFG1 = cfg1 | SPI_CFG1_RXDMAEN | SPI_CFG1_TXDMAEN;
+  spi->CR1 = SPI_CR1_SSI | SPI_CR1_SPE;
+  spi->CR1 = SPI_CR1_SSI | SPI_CR1_SPE | SPI_CR1_CSTART;
+  ++hw->stats.segments;
+}
+
+// Disables the SPI and both channels after a segment, complete or not
+void end_segment(SpiInstanceSpecific* hw) {
+  SPI_TypeDef* spi = hw->hw->spi;
+  hw->hw->rx_dma->CCR = DMA_CCR_RESET;
+  hw->hw->tx_dma->CCR = DMA_CCR_RESET;
+  spi->IFCR = spi_clear_flags;
+  spi->CR1 = SPI_CR1_SSI;
+  spi->CFG1 = hw->devices[hw->current->device].cfg1;
+}
+
+// Puts the oldest queued transaction on the bus. Called with the DMA
+// interrupts masked (critical section or the handlers) and the bus idle.
+void start_next(SpiInstanceSpecific* hw) {
+  SpiTransaction* t = hw->head;
+  hw->current = t;
+  if (!t) {
+    return;
+  }
+  hw->head = t->next;
+  if (!hw->head) {
+    hw->tail = nullptr;
+  }
+  t->next = nullptr;
+  t->status = SpiStatus::active;
+
+  SpiDeviceSlot& device = hw->devices[t->device];
+  if (device.cfg2 != hw->cfg2) {
+    // Only while disabled; AFCNTR moves SCK to the new idle level at once,
+    // before chip select goes active below
+    hw->hw->spi->CFG2 = device.cfg2;
+    hw->cfg2 = device.cfg2;
+    ++hw->stats.reconfigurations;
+  }
+  select(device, true);
+  hw->segment = 0;
+  start_segment(hw);
+}
+
+void wake_waiter(SpiTransaction* t, BaseType_t* woken) {
+  auto waiter = static_cast<TaskHandle_t>(t->waiter);
+  if (waiter) {
+    t->waiter = nullptr;
+    vTaskNotifyGiveIndexedFromISR(waiter, spi_notify_index, woken);
+  }
+}
+
+// End of the current segment, from the DMA handlers: the next segment, or the
+// next transaction once the last one is done or a channel failed
+void segment_done(size_t index, bool failed) {
+  SpiInstanceSpecific* hw = spi_owner[index];
+  if (!hw) {
+    return;
+  }
+
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  SpiTransaction* t = hw->current;
+  if (!t) {
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    return;
+  }
+  end_segment(hw);
+  SpiDeviceSlot& device = hw->devices[t->device];
+  if (failed) {
+    ++hw->stats.dma_errors;
+  } else if (++hw->segment < t->segment_count) {
+    if (t->segments[hw->segment - 1].deselect_after) {
+      select(device, false);
+      select(device, true);
+    }
+    start_segment(hw);
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    return;
+  }
+
+  select(device, false);
+  ++hw->stats.transactions;
+  t->status = failed ? SpiStatus::failed : SpiStatus::done;
+  start_next(hw);
+  BaseType_t woken = pdFALSE;
+  wake_waiter(t, &woken);
+  const SpiCallback callback = t->callback;
+  void* ctx = t->ctx;
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+
+  // Outside the critical section, so it can submit again
+  if (callback) {
+    callback(*t, ctx);
+  }
+  portYIELD_FROM_ISR(woken);
+}
+
+// The receive channel completes each segment: its last byte in memory means
+// the last one left the transmit FIFO
+void handle_rx_dma_irq(size_t index) {
+  DMA_Channel_TypeDef* dma = spi_hw[index].rx_dma;
+  const uint32_t csr = dma->CSR;
+  dma->CFCR = dma_clear_flags;
+  segment_done(index, csr & dma_error_flags);
+}
+
+// The transmit channel only reports errors
+void handle_tx_dma_irq(size_t index) {
+  DMA_Channel_TypeDef* dma = spi_hw[index].tx_dma;
+  const uint32_t csr = dma->CSR;
+  dma->CFCR = dma_clear_flags;
+  if (csr & dma_error_flags) {
+    segment_done(index, true);
+  }
+}
+
+bool is_pending(SpiStatus status) {
+  return status == SpiStatus::queued || status == SpiStatus::active;
+}
+} // namespace
+
+SpiConfig::SpiConfig(SpiId id) : m_id(id) {}
+
+SpiDeviceConfig::SpiDeviceConfig(GpioId chip_select, uint32_t max_frequency_hz, SpiMode mode,
+                                 SpiBitOrder bit_order, bool chip_select_active_low,
+                                 uint32_t min_deselect_ns)
+    : m_chip_select(chip_select),
+      m_max_frequency_hz(max_frequency_hz),
       m_mode(mode),
-      m_clock_polarity(clock_polarity),
       m_bit_order(bit_order),
-      m_direction(direction),
-      m_chip_select_active_low(chip_select_active_low) {}
+      m_chip_select_active_low(chip_select_active_low),
+      m_min_deselect_ns(min_deselect_ns) {}
 
 Spi::Spi() : p_instance_specific(nullptr) {}
 
@@ -19,24 +290,286 @@ expected::expected<void, Error> Spi::start() {
   return {};
 }
 
-expected::expected<void, Error> Spi::init(const Config&) {
+expected::expected<void, Error> Spi::init(const Config& config) {
+  const auto* cfg = dynamic_cast<const SpiConfig*>(&config);
+  if (!cfg) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid spi config"));
+  }
+
+  const SpiHw* spi = find_hw(cfg->m_id);
+  if (!spi) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "unsupported spi id"));
+  }
+
+  const size_t index = static_cast<size_t>(spi - spi_hw);
+  if (spi_owner[index] && spi_owner[index] != p_instance_specific) {
+    return expected::unexpected(RU_ERROR(CommonError::busy, "spi already in use"));
+  }
+
+  if (p_instance_specific) {
+    (void)stop();
+  }
+  p_instance_specific = new SpiInstanceSpecific();
+
+  auto* hw = static_cast<SpiInstanceSpecific*>(p_instance_specific);
+  hw->hw = spi;
+  hw->device_count = 0;
+  hw->head = nullptr;
+  hw->tail = nullptr;
+  hw->current = nullptr;
+  hw->segment = 0;
+  hw->tx_dummy = 0xFF;
+  hw->stats = {};
+
+  // Times the chip select inactive time
+  RUP_CycleCounter_Start();
+  RCC->AHB1ENR |= RCC_AHB1ENR_GPDMA1EN;
+  *spi->enable_reg |= spi->enable_bit;
+  (void)*spi->enable_reg;
+
+  // Mode 0, MSB first until the first transaction sets its device's
+  hw->cfg2 = spi_cfg2_base;
+  spi->spi->CR1 = SPI_CR1_SSI;
+  spi->spi->IFCR = spi_clear_flags;
+  spi->spi->CFG1 = (max_mbr << SPI_CFG1_MBR_Pos) | spi_cfg1_frame;
+  spi->spi->CFG2 = hw->cfg2;
+
+  spi->rx_dma->CCR = DMA_CCR_RESET;
+  spi->tx_dma->CCR = DMA_CCR_RESET;
+  spi_owner[index] = hw;
+
+  NVIC_SetPriority(spi->rx_dma_irq, spi->irq_priority);
+  NVIC_SetPriority(spi->tx_dma_irq, spi->irq_priority);
+  NVIC_EnableIRQ(spi->rx_dma_irq);
+  NVIC_EnableIRQ(spi->tx_dma_irq);
+
   return {};
 }
 
 expected::expected<void, Error> Spi::stop() {
+  auto* hw = static_cast<SpiInstanceSpecific*>(p_instance_specific);
+  if (hw) {
+    NVIC_DisableIRQ(hw->hw->rx_dma_irq);
+    NVIC_DisableIRQ(hw->hw->tx_dma_irq);
+    taskENTER_CRITICAL();
+    if (hw->current) {
+      end_segment(hw);
+      select(hw->devices[hw->current->device], false);
+      hw->current->next = hw->head;
+      hw->head = hw->current;
+      hw->current = nullptr;
+    }
+    spi_owner[hw->hw - spi_hw] = nullptr;
+    taskEXIT_CRITICAL();
+    NVIC_ClearPendingIRQ(hw->hw->rx_dma_irq);
+    NVIC_ClearPendingIRQ(hw->hw->tx_dma_irq);
+    hw->hw->spi->CR1 = 0;
+
+    for (SpiTransaction* t = hw->head; t;) {
+      SpiTransaction* next = t->next;
+      t->next = nullptr;
+      t->status = SpiStatus::failed;
+      if (t->waiter) {
+        xTaskNotifyGiveIndexed(static_cast<TaskHandle_t>(t->waiter), spi_notify_index);
+        t->waiter = nullptr;
+      }
+      t = next;
+    }
+    for (size_t i = 0; i < hw->device_count; ++i) {
+      (void)hw->devices[i].chip_select.stop();
+    }
+  }
+  delete hw;
+  p_instance_specific = nullptr;
   return {};
 }
 
-expected::expected<void, Error> Spi::write(const uint8_t*, size_t) {
-  return {};
+expected::expected<SpiDevice, Error> Spi::add_device(const SpiDeviceConfig& config) {
+  auto* hw = static_cast<SpiInstanceSpecific*>(p_instance_specific);
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "spi not initialized"));
+  }
+  if (hw->device_count == max_devices) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "too many spi devices"));
+  }
+
+  const uint32_t kernel_hz = HAL_RCCEx_GetPeriphCLKFreq(hw->hw->kernel_clock);
+  uint32_t mbr = 0;
+  while (mbr <= max_mbr && (kernel_hz >> (mbr + 1)) > config.m_max_frequency_hz) {
+    ++mbr;
+  }
+  if (!kernel_hz || mbr > max_mbr) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "unsupported spi frequency"));
+  }
+  if (config.m_min_deselect_ns > max_min_deselect_ns) {
+    return expected::unexpected(
+        RU_ERROR(CommonError::out_of_range, "spi chip select inactive time too long"));
+  }
+
+  SpiDeviceSlot& device = hw->devices[hw->device_count];
+  const GpioConfig cs_config(config.m_chip_select, GpioFunction::output_pushpull_pullup,
+                             !config.m_chip_select_active_low, GpioSpeed::high);
+  auto cs = device.chip_select.init(cs_config);
+  if (!cs) {
+    return expected::unexpected(cs.error());
+  }
+  uintptr_t cs_port = 0;
+  uint16_t cs_mask = 0;
+  (void)find_gpio_pin(config.m_chip_select, cs_port, cs_mask);  // init() checked it exists
+  device.cs_bsrr = &reinterpret_cast<GPIO_TypeDef*>(cs_port)->BSRR;
+  const uint32_t cs_high = cs_mask;
+  const uint32_t cs_low = static_cast<uint32_t>(cs_mask) << 16;
+  device.cs_select = config.m_chip_select_active_low ? cs_low : cs_high;
+  device.cs_deselect = config.m_chip_select_active_low ? cs_high : cs_low;
+  // Rounded up, so the GPIO edges (a few ns at high speed) only add to it
+  device.deselect_cycles = static_cast<uint32_t>(
+      (static_cast<uint64_t>(config.m_min_deselect_ns) * SystemCoreClock + 999999999) /
+      1000000000);
+  select(device, false);
+
+  const auto mode = static_cast<uint32_t>(config.m_mode);
+  device.cfg1 = (mbr << SPI_CFG1_MBR_Pos) | spi_cfg1_frame;
+  device.cfg2 = spi_cfg2_base | (mode & 2 ? SPI_CFG2_CPOL : 0) | (mode & 1 ? SPI_CFG2_CPHA : 0) |
+                (config.m_bit_order == SpiBitOrder::lsb_first ? SPI_CFG2_LSBFRST : 0);
+  device.frequency_hz = kernel_hz >> (mbr + 1);
+
+  // Published last: submit() only accepts devices below device_count
+  taskENTER_CRITICAL();
+  const auto handle = static_cast<SpiDevice>(hw->device_count++);
+  taskEXIT_CRITICAL();
+  return handle;
 }
 
-expected::expected<void, Error> Spi::read(uint8_t*, size_t) {
+expected::expected<uint32_t, Error> Spi::frequency(SpiDevice device) const {
+  auto* hw = static_cast<SpiInstanceSpecific*>(p_instance_specific);
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "spi not initialized"));
+  }
+  if (device >= hw->device_count) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "unknown spi device"));
+  }
+  return hw->devices[device].frequency_hz;
+}
+
+expected::expected<void, Error> Spi::submit(SpiTransaction& transaction) {
+  auto* hw = static_cast<SpiInstanceSpecific*>(p_instance_specific);
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "spi not initialized"));
+  }
+  if (transaction.device >= hw->device_count) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "unknown spi device"));
+  }
+  if (!transaction.segments || !transaction.segment_count) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "empty spi transaction"));
+  }
+  for (size_t i = 0; i < transaction.segment_count; ++i) {
+    if (!transaction.segments[i].len) {
+      return expected::unexpected(RU_ERROR(CommonError::out_of_range, "empty spi segment"));
+    }
+  }
+
+  // Masks the DMA handlers, and is valid in an interrupt as well as in a task
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  if (is_pending(transaction.status)) {
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    return expected::unexpected(RU_ERROR(CommonError::busy, "spi transaction pending"));
+  }
+  transaction.status = SpiStatus::queued;
+  transaction.next = nullptr;
+  transaction.waiter = nullptr;
+  if (hw->tail) {
+    hw->tail->next = &transaction;
+  } else {
+    hw->head = &transaction;
+  }
+  hw->tail = &transaction;
+  if (!hw->current) {
+    start_next(hw);
+  }
+  taskEXIT_CRITICAL_FROM_ISR(mask);
   return {};
 }
 
-expected::expected<void, Error> Spi::transfer(const uint8_t*, uint8_t*, size_t) {
+expected::expected<void, Error> Spi::wait(SpiTransaction& transaction, uint32_t timeout_ms) {
+  auto* hw = static_cast<SpiInstanceSpecific*>(p_instance_specific);
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "spi not initialized"));
+  }
+
+  const TickType_t start = xTaskGetTickCount();
+  const TickType_t timeout = to_ticks(timeout_ms);
+  for (;;) {
+    taskENTER_CRITICAL();
+    const bool pending = is_pending(transaction.status);
+    if (pending) {
+      transaction.waiter = xTaskGetCurrentTaskHandle();
+    }
+    taskEXIT_CRITICAL();
+    if (!pending) {
+      break;
+    }
+
+    const TickType_t left = ticks_left(start, timeout);
+    if (!left) {
+      taskENTER_CRITICAL();
+      transaction.waiter = nullptr;
+      taskEXIT_CRITICAL();
+      return expected::unexpected(RU_ERROR(SpiError::timeout, "spi transaction timeout"));
+    }
+    ulTaskNotifyTakeIndexed(spi_notify_index, pdTRUE, left);
+  }
+
+  if (transaction.status == SpiStatus::failed) {
+    return expected::unexpected(RU_ERROR(SpiError::dma_error, "spi transaction failed"));
+  }
   return {};
 }
 
+expected::expected<void, Error> Spi::write(SpiDevice device, const uint8_t* data, size_t len) {
+  return transfer(device, data, nullptr, len);
+}
+
+expected::expected<void, Error> Spi::read(SpiDevice device, uint8_t* data, size_t len) {
+  return transfer(device, nullptr, data, len);
+}
+
+expected::expected<void, Error> Spi::transfer(SpiDevice device, const uint8_t* tx, uint8_t* rx,
+                                              size_t len) {
+  if (!len || len > SPI_CR2_TSIZE) {
+    return expected::unexpected(RU_ERROR(CommonError::out_of_range, "invalid spi length"));
+  }
+  const SpiSegment segment{tx, rx, static_cast<uint16_t>(len), false};
+  SpiTransaction transaction{};
+  transaction.device = device;
+  transaction.segments = &segment;
+  transaction.segment_count = 1;
+  auto queued = submit(transaction);
+  if (!queued) {
+    return queued;
+  }
+  // Never completes late: the buffers are on this stack
+  return wait(transaction, wait_forever);
+}
+
+expected::expected<SpiStats, Error> Spi::stats() const {
+  auto* hw = static_cast<SpiInstanceSpecific*>(p_instance_specific);
+  if (!hw) {
+    return expected::unexpected(RU_ERROR(CommonError::not_inited, "spi not initialized"));
+  }
+  taskENTER_CRITICAL();
+  const SpiStats stats = hw->stats;
+  taskEXIT_CRITICAL();
+  return stats;
+}
+
 } // namespace ru::driver
+
+#define X_spi_instance(index, id, periph, bus, rx_channel, tx_channel, irq_priority) \
+  extern "C" void GPDMA1_Channel##rx_channel##_IRQHandler(void) {                    \
+    ru::driver::handle_rx_dma_irq(index);                                           \
+  }                                                                                  \
+  extern "C" void GPDMA1_Channel##tx_channel##_IRQHandler(void) {                    \
+    ru::driver::handle_tx_dma_irq(index);                                           \
+  }
+#include "spi_instances.hpp"
+#undef X_spi_instance
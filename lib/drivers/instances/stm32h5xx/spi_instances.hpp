@@ -0,0 +1,16 @@
+// SPI controllers of the board, generated by generate.py from the 'spi' module of
+// config.yaml. Do not edit, regenerate instead.
+//
+// X_spi_instance(index, id, periph, bus, rx_channel, tx_channel, irq_priority)
+// - id:           SpiId bound to the controller
+// - periph:       SPI instance
+// - bus:          peripheral bus of the SPI clock enable (APB1L, APB2 or APB3)
+// - rx_channel:   GPDMA1 channel reading the received bytes
+// - tx_channel:   GPDMA1 channel feeding the bytes to send
+// - irq_priority: NVIC priority of the DMA handlers
+
+#ifndef X_spi_instance
+#define X_spi_instance(index, id, periph, bus, rx_channel, tx_channel, irq_priority)
+#endif
+
+X_spi_instance(0, imu_spi, SPI1, APB2, 5, 6, 6)
\ No newline at end of file
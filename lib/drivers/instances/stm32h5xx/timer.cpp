@@ -1,15 +1,47 @@
+#include "FreeRTOS.h"
+#include "stm32h5xx_hal.h"
+#include "task.h"
+
+#include "cycle_counter.h"
+#include "raceup_timer.h"
 #include "timer.hpp"
 
 namespace ru::driver {
 
+namespace {
+// Upper 32 bits of the time and the counter value they were read with
+uint32_t timer_wraps;
+uint32_t timer_last_count;
+
+bool cycle_counter_running() {
+  return DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk;
+}
+
+// Reads the counter and counts a wrap since the last read. The FROM_ISR
+// critical section masks the interrupts up to configMAX_SYSCALL_INTERRUPT_PRIORITY
+// only: one of higher priority reading the time could miss a wrap or count it twice.
+TimerInstant read_time() {
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  const uint32_t count = DWT->CYCCNT;
+  if (count < timer_last_count) {
+    ++timer_wraps;
+  }
+  timer_last_count = count;
+  const TimerInstant now = (static_cast<uint64_t>(timer_wraps) << 32) | count;
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+  return now;
+}
+} // namespace
+
 Timer::Timer() = default;
 
 expected::expected<void, Error> Timer::start() {
+  RUP_CycleCounter_Start();
   return {};
 }
 
 expected::expected<void, Error> Timer::init(const Config&) {
-  return {};
+  return start();
 }
 
 expected::expected<void, Error> Timer::stop() {
@@ -17,7 +49,24 @@ expected::expected<void, Error> Timer::stop() {
 }
 
 expected::expected<TimerInstant, Error> Timer::time_now() const {
-  return 0;
+  if (!cycle_counter_running()) {
+    return expected::unexpected(RU_ERROR(CommonError::not_started, "cycle counter stopped"));
+  }
+  return read_time();
+}
+
+expected::expected<TimerInstant, Error> Timer::instant_of(uint32_t cycles) const {
+  auto now = time_now();
+  if (!now) {
+    return now;
+  }
+  return *now - static_cast<uint32_t>(static_cast<uint32_t>(*now) - cycles);
 }
 
 } // namespace ru::driver
+
+extern "C" void RUP_Timer_TickHook(void) {
+  if (ru::driver::cycle_counter_running()) {
+    (void)ru::driver::read_time();
+  }
+}
@@ -0,0 +1,108 @@
+// Host cross-check of the ADC filter kernels (lib/drivers/include/adc_filter.hpp):
+// the packed DSP versions, emulated here, against the portable references on
+// random signals split into random chunks. Built and run by
+// scripts/check_adc_filters.py.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "adc_filter.hpp"
+
+using namespace ru::driver::dsp;
+
+namespace {
+std::mt19937 rng(12345);
+
+int random_int(int lo, int hi) {
+  return std::uniform_int_distribution<int>(lo, hi)(rng);
+}
+
+std::vector<int16_t> random_signal(size_t count) {
+  // Full scale noise or a slow random walk, both within +-8191
+  std::vector<int16_t> signal(count);
+  const bool walk = random_int(0, 1);
+  int value = random_int(-8191, 8191);
+  for (auto& sample : signal) {
+    value = walk ? std::min(8191, std::max(-8191, value + random_int(-64, 64)))
+                 : random_int(-8191, 8191);
+    sample = static_cast<int16_t>(value);
+  }
+  return signal;
+}
+
+// Feeds both versions the same signal in the same random chunks
+template <typename Filter, typename Run, typename RunReference>
+bool compare(const char* name, Filter simd, Filter reference, Run run, RunReference run_reference) {
+  const auto signal = random_signal(static_cast<size_t>(random_int(1, 4000)));
+  std::vector<int16_t> out(signal.size() + 1), out_reference(signal.size() + 1);
+  size_t done = 0, produced = 0, produced_reference = 0;
+  while (done < signal.size()) {
+    const size_t chunk = std::min(signal.size() - done, static_cast<size_t>(random_int(1, 97)));
+    produced += run(simd, signal.data() + done, out.data() + produced, chunk);
+    produced_reference +=
+        run_reference(reference, signal.data() + done, out_reference.data() + produced_reference,
+                      chunk);
+    done += chunk;
+  }
+  if (produced != produced_reference ||
+      std::memcmp(out.data(), out_reference.data(), produced * sizeof(int16_t))) {
+    std::printf("%s: mismatch (%zu samples)\n", name, signal.size());
+    return false;
+  }
+  return true;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  const int rounds = argc > 1 ? std::atoi(argv[1]) : 200;
+  int failures = 0;
+
+  for (int round = 0; round < rounds; ++round) {
+    const auto window = static_cast<uint8_t>(random_int(1, MovingAverage::max_log2_window));
+    failures += !compare(
+        "moving_average", MovingAverage(window), MovingAverage(window),
+        [](MovingAverage& f, const int16_t* in, int16_t* out, size_t n) {
+          f.process(in, out, n);
+          return n;
+        },
+        [](MovingAverage& f, const int16_t* in, int16_t* out, size_t n) {
+          f.process_reference(in, out, n);
+          return n;
+        });
+
+    const Biquad lowpass = Biquad::lowpass(static_cast<float>(random_int(1, 4900)), 10000.0f);
+    failures += !compare(
+        "biquad", lowpass, lowpass,
+        [](Biquad& f, const int16_t* in, int16_t* out, size_t n) {
+          f.process(in, out, n);
+          return n;
+        },
+        [](Biquad& f, const int16_t* in, int16_t* out, size_t n) {
+          f.process_reference(in, out, n);
+          return n;
+        });
+
+    const auto factor = static_cast<uint8_t>(random_int(1, Decimator::max_log2_factor));
+    failures += !compare(
+        "decimator", Decimator(factor), Decimator(factor),
+        [](Decimator& f, const int16_t* in, int16_t* out, size_t n) {
+          return f.process(in, out, n);
+        },
+        [](Decimator& f, const int16_t* in, int16_t* out, size_t n) {
+          return f.process_reference(in, out, n);
+        });
+
+    const auto signal = random_signal(static_cast<size_t>(random_int(1, 4000)));
+    const SampleStats a = stats(signal.data(), signal.size());
+    const SampleStats b = stats_reference(signal.data(), signal.size());
+    if (a.min != b.min || a.max != b.max || a.mean != b.mean || a.rms != b.rms) {
+      std::printf("stats: mismatch (%zu samples)\n", signal.size());
+      ++failures;
+    }
+  }
+
+  std::printf("%d rounds, %d mismatches\n", rounds, failures);
+  return failures ? 1 : 0;
+}
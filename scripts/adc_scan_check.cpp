@@ -0,0 +1,215 @@
+// Host check of the ADC block bookkeeping (AdcBlockRing, lib/drivers/include/adc.hpp):
+// a synthetic DMA writes one sample at a time into the two-block circular
+// buffer, wrapping at its end, and raises the half/full transfer interrupt at
+// every block boundary. The interrupt runs after a random latency below one
+// block (the driver's limit) and reports the half being filled, the way
+// AdcScan's handler reads it from the DMA. Every sample encodes its scan and
+// channel, so the checks see exactly which block a half holds:
+//
+// - handover: the callback gets every block once, in order, intact;
+// - overrun: a slow consumer's take() returns the newest block and counts the
+//   others as missed;
+// - wrap: the sequence numbers go on across thousands of buffer wraps and
+//   restart() goes back to block 0;
+// - is_intact() is false once a block's half is reused. It is checked when
+//   the interrupt has run: between a boundary and its late interrupt it lags
+//   by the latency.
+//
+// Built and run by scripts/check_adc_scan.py.
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "adc.hpp"
+
+using namespace ru::driver;
+
+namespace {
+std::mt19937 rng(12345);
+
+int random_int(int lo, int hi) {
+  return std::uniform_int_distribution<int>(lo, hi)(rng);
+}
+
+// 12-bit sample of a channel in a scan, different for neighbouring scans
+uint16_t sample_value(uint64_t scan, size_t channel) {
+  return static_cast<uint16_t>((scan * 37 + channel * 1031 + (scan >> 7)) & 0xFFF);
+}
+
+int failures = 0;
+
+void expect(bool ok, const char* what, uint32_t sequence) {
+  if (!ok && failures++ < 20) {
+    std::printf("FAIL: %s (block %u)\n", what, sequence);
+  }
+}
+
+// Block `sequence` since the last restart, as the DMA wrote it
+bool holds(const AdcBlock& block, uint32_t sequence, uint64_t first_scan) {
+  for (size_t scan = 0; scan < block.scans; ++scan) {
+    for (size_t channel = 0; channel < block.channels; ++channel) {
+      const uint64_t global = first_scan + static_cast<uint64_t>(sequence) * block.scans + scan;
+      if (block.sample(scan, channel) != sample_value(global, channel)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+struct Callbacks {
+  uint32_t next = 0;
+  uint64_t first_scan = 0;
+  size_t bad = 0;
+};
+
+void on_block(const AdcBlock& block, void* ctx) {
+  auto& seen = *static_cast<Callbacks*>(ctx);
+  if (block.sequence != seen.next || !holds(block, block.sequence, seen.first_scan)) {
+    ++seen.bad;
+  }
+  seen.next = block.sequence + 1;
+}
+
+// Circular DMA over two blocks, with the interrupt of each boundary delayed
+class SyntheticDma {
+public:
+  SyntheticDma(AdcBlockRing& ring, uint16_t* buffer, size_t channels, size_t scans)
+      : m_ring(ring), m_buffer(buffer), m_channels(channels), m_block(channels * scans) {}
+
+  // Writes one sample; returns true when the interrupt ran during the step
+  bool step(size_t max_latency) {
+    const uint64_t scan = m_written / m_channels;
+    m_buffer[m_written % (2 * m_block)] = sample_value(m_scan_base + scan, m_written % m_channels);
+    ++m_written;
+    if (m_written % m_block == 0 && !m_irq_pending) {
+      m_irq_pending = true;
+      m_irq_at = m_written + static_cast<uint64_t>(random_int(0, static_cast<int>(max_latency)));
+    }
+    if (m_irq_pending && m_written >= m_irq_at) {
+      m_irq_pending = false;
+      // The half the next sample goes to
+      const auto half = static_cast<uint32_t>((m_written / m_block) & 1);
+      m_completed += m_ring.advance_to(half);
+      return true;
+    }
+    return false;
+  }
+
+  // Stops on a block boundary and starts over from block 0 of the buffer
+  void restart() {
+    m_scan_base += m_written / m_channels;
+    m_written = 0;
+    m_irq_pending = false;
+    m_completed = 0;
+    m_ring.restart();
+  }
+
+  uint64_t written() const { return m_written; }
+  uint64_t scan_base() const { return m_scan_base; }
+  uint32_t completed() const { return m_completed; }
+
+private:
+  AdcBlockRing& m_ring;
+  uint16_t* m_buffer;
+  size_t m_channels;
+  size_t m_block;
+  uint64_t m_written = 0;
+  uint64_t m_scan_base = 0;
+  bool m_irq_pending = false;
+  uint64_t m_irq_at = 0;
+  uint32_t m_completed = 0;
+};
+
+// One scan group, blocks consumed through take() every `take_every` blocks
+void run(size_t channels, size_t scans, uint32_t blocks, size_t max_latency, int take_every) {
+  std::vector<uint16_t> buffer(2 * channels * scans);
+  Callbacks seen;
+  AdcBlockRing ring;
+  ring.reset(buffer.data(), channels, scans, on_block, &seen);
+  SyntheticDma dma(ring, buffer.data(), channels, scans);
+  const size_t block = channels * scans;
+
+  uint32_t expected_missed = 0;
+  uint32_t last_taken = 0;
+  bool have_taken = false;
+  AdcBlock held{};
+  bool holding = false;
+  while (dma.completed() < blocks) {
+    if (!dma.step(max_latency)) {
+      continue;
+    }
+    const uint32_t completed = ring.completed();
+    expect(completed == dma.completed(), "advance_to count", completed);
+
+    // The block held by the consumer stays intact until its half is reused
+    if (holding) {
+      const bool reused = completed > held.sequence + 1;
+      expect(ring.is_intact(held) == !reused, "is_intact", held.sequence);
+      if (!reused) {
+        expect(holds(held, held.sequence, seen.first_scan), "held block overwritten",
+               held.sequence);
+      }
+    }
+
+    if (completed % static_cast<uint32_t>(take_every) == 0) {
+      AdcBlock got{};
+      const bool ok = ring.take(got);
+      expect(ok && got.sequence == completed - 1, "take() not the newest block", completed);
+      if (ok) {
+        expect(got.scans == scans && got.channels == channels, "block shape", got.sequence);
+        expect(holds(got, got.sequence, seen.first_scan), "taken block content", got.sequence);
+        expect(ring.is_intact(got), "fresh block not intact", got.sequence);
+        expected_missed += got.sequence - (have_taken ? last_taken + 1 : 0);
+        last_taken = got.sequence;
+        have_taken = true;
+        held = got;
+        holding = true;
+        AdcBlock again{};
+        expect(!ring.take(again), "take() twice", got.sequence);
+      }
+    }
+  }
+
+  expect(seen.bad == 0, "callback order or content", seen.next);
+  expect(seen.next == ring.completed(), "callback count", seen.next);
+  expect(ring.missed() == expected_missed, "missed count", ring.missed());
+  expect(dma.written() / block >= blocks, "blocks written", blocks);
+
+  // Back to block 0 in half 0, with fresh counters
+  dma.restart();
+  seen.next = 0;
+  seen.first_scan = dma.scan_base();
+  while (dma.completed() < 4) {
+    dma.step(max_latency);
+  }
+  AdcBlock first{};
+  expect(ring.missed() == 0 && ring.take(first) && first.sequence == 3 &&
+             first.samples == buffer.data() + block && holds(first, 3, seen.first_scan),
+         "restart", first.sequence);
+  expect(seen.bad == 0 && seen.next == ring.completed(), "callbacks after restart", seen.next);
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  const int rounds = argc > 1 ? std::atoi(argv[1]) : 200;
+
+  for (int round = 0; round < rounds; ++round) {
+    const auto channels = static_cast<size_t>(random_int(1, AdcScanConfig::max_channels));
+    const auto scans = static_cast<size_t>(random_int(1, 32));
+    const size_t block = channels * scans;
+    const auto blocks = static_cast<uint32_t>(random_int(50, 400));
+    // On time, or late by up to one sample less than a block
+    const size_t latency = random_int(0, 1) ? 0 : block - 1;
+    // Every block, or a consumer too slow for the rate
+    const int take_every = random_int(0, 1) ? 1 : random_int(2, 7);
+    run(channels, scans, blocks, latency, take_every);
+  }
+
+  // Long run: thousands of buffer wraps
+  run(4, 8, 100000, 31, 3);
+
+  std::printf("%d rounds, %d failures\n", rounds, failures);
+  return failures ? 1 : 0;
+}
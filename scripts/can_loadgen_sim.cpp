@@ -0,0 +1,511 @@
+// Host check of the CAN load generator (lib/drivers/include/raceup_can_loadgen.h):
+// the real raceup_can_loadgen.c, built for the host, runs against stand-ins of
+// the FDCAN wrapper calls it makes, backed by a model of one node on the bus:
+//
+// - Tx: RUP_FDCAN_Send() queues into the 3-element Tx FIFO and fails when it
+//   is full (the frame on the wire keeps its element). The bus sends the
+//   frames in FIFO order, each one taking 47 + 8 * DLC bit times, or the
+//   worst-case stuffed length.
+// - Rx: in loopback every frame sent comes back into a 3-element Rx FIFO,
+//   read by an interrupt that needs isr_us per frame and pushes it into the
+//   subscriber rings. A frame completing while the FIFO is full is lost.
+// - Time: DWT->CYCCNT, started shortly before its wrap, advances by the poll
+//   interval between two RUP_CANLOAD_Poll() calls.
+//
+// Each built-in scenario checks the report against the model (frames sent,
+// received back and lost, elapsed time, ISR load, stream IDs released,
+// loopback restored) and against its expected bus load, Rx loss or burst
+// overruns. "replay" runs the profile given on stdin instead and prints its
+// report. Built and run by scripts/check_can_loadgen.py.
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "raceup_can_loadgen.h"
+
+// Target globals read by the generator
+DWT_Type host_dwt;
+uint32_t SystemCoreClock = 250000000U;
+
+namespace {
+const uint64_t cpu_hz = 250000000U;
+const size_t fifo_elements = 3;
+// 50 ms into every run, so the generator's 64-bit time base goes through a wrap
+const uint32_t dwt_start = 0U - static_cast<uint32_t>(cpu_hz / 20);
+
+FDCAN_GlobalTypeDef host_fdcan;
+
+struct Frame {
+  uint16_t id;
+  uint8_t len;
+  uint8_t data[8];
+};
+
+// Bus, FIFOs and Rx interrupt of the node
+struct BusModel {
+  uint32_t bitrate = 1000000;
+  uint64_t isr_cycles_per_frame = 0;
+  bool stuffing = false;
+  bool loopback = false;
+  int loopback_calls = 0;
+
+  uint64_t now = 0;
+  std::deque<Frame> tx_fifo;
+  bool sending = false;
+  Frame on_wire{};
+  uint64_t wire_end = 0;
+  std::deque<std::pair<Frame, uint64_t>> rx_fifo;  // frame, completion time
+  uint64_t isr_free = 0;                           // end of the frame the ISR is busy with
+  std::array<RUP_FDCAN_SubscriberTypeDef*, RUP_FDCAN_STD_ID_COUNT> subscriber{};
+
+  uint64_t accepted = 0;   // by RUP_FDCAN_Send
+  uint64_t sent = 0;       // off the wire
+  uint64_t isr_cycles = 0;
+  uint64_t rx_fifo_lost = 0;
+  uint64_t delivered = 0;  // pushed into a subscriber ring
+
+  uint64_t frame_cycles(uint8_t len) const {
+    uint64_t bits = 47 + 8 * len;
+    if (stuffing) {
+      // One stuff bit every 4 bits of the 34 + 8 * DLC stuffed bits
+      bits += (34 + 8 * len - 1) / 4;
+    }
+    return bits * cpu_hz / bitrate;
+  }
+
+  void start_frame(uint64_t at) {
+    on_wire = tx_fifo.front();
+    tx_fifo.pop_front();
+    wire_end = at + frame_cycles(on_wire.len);
+    sending = true;
+  }
+
+  void complete_frame() {
+    sending = false;
+    ++sent;
+    if (loopback) {
+      if (rx_fifo.size() >= fifo_elements) {
+        ++rx_fifo_lost;
+      } else {
+        rx_fifo.emplace_back(on_wire, wire_end);
+      }
+    }
+    if (!tx_fifo.empty()) {
+      start_frame(wire_end);
+    }
+  }
+
+  void read_frame(uint64_t at) {
+    const Frame frame = rx_fifo.front().first;
+    rx_fifo.pop_front();
+    isr_free = at + isr_cycles_per_frame;
+    isr_cycles += isr_cycles_per_frame;
+    RUP_FDCAN_SubscriberTypeDef* sub = subscriber[frame.id];
+    if (!sub) {
+      return;
+    }
+    if (static_cast<uint16_t>(sub->Head - sub->Tail) > sub->RingMask) {
+      sub->Dropped = sub->Dropped + 1;
+      return;
+    }
+    RUP_FDCAN_FrameTypeDef& slot = sub->Ring[sub->Head & sub->RingMask];
+    slot.id = frame.id;
+    slot.len = frame.len;
+    std::memcpy(slot.data, frame.data, sizeof(slot.data));
+    slot.timestamp = static_cast<uint32_t>(at);
+    sub->Head = static_cast<uint16_t>(sub->Head + 1);
+    ++delivered;
+  }
+
+  // Runs the bus and the Rx interrupt up to `to`, in time order
+  void advance(uint64_t to) {
+    for (;;) {
+      const uint64_t next_read =
+          rx_fifo.empty() ? UINT64_MAX : std::max(rx_fifo.front().second, isr_free);
+      const uint64_t next_done = sending ? wire_end : UINT64_MAX;
+      if (std::min(next_read, next_done) > to) {
+        break;
+      }
+      // A read due at the same time frees its element first
+      if (next_read <= next_done) {
+        read_frame(next_read);
+      } else {
+        complete_frame();
+      }
+    }
+    now = to;
+  }
+};
+
+BusModel bus;
+} // namespace
+
+// The FDCAN wrapper calls of the generator (C linkage from raceup_fdcan.h)
+RUP_FDCAN_StatusTypeDef RUP_FDCAN_Send(FDCAN_GlobalTypeDef* Instance, uint16_t id, uint8_t* data,
+                                       uint8_t len) {
+  if (Instance != &host_fdcan || len > 8) {
+    return RUP_FDCAN_ERROR;
+  }
+  if (bus.tx_fifo.size() + (bus.sending ? 1 : 0) >= fifo_elements) {
+    return RUP_FDCAN_ERROR;
+  }
+  Frame frame{id, len, {}};
+  std::memcpy(frame.data, data, len);
+  bus.tx_fifo.push_back(frame);
+  ++bus.accepted;
+  if (!bus.sending) {
+    bus.start_frame(bus.now);
+  }
+  return RUP_FDCAN_OK;
+}
+
+RUP_FDCAN_StatusTypeDef RUP_FDCAN_SetLoopback(FDCAN_GlobalTypeDef* Instance, uint8_t enable) {
+  if (Instance != &host_fdcan) {
+    return RUP_FDCAN_ERROR;
+  }
+  bus.loopback = enable != 0;
+  ++bus.loopback_calls;
+  return RUP_FDCAN_OK;
+}
+
+uint32_t RUP_FDCAN_GetIsrCycles(FDCAN_GlobalTypeDef* Instance) {
+  return Instance == &host_fdcan ? static_cast<uint32_t>(bus.isr_cycles) : 0U;
+}
+
+RUP_FDCAN_StatusTypeDef RUP_FDCAN_SubscriberInit(RUP_FDCAN_SubscriberTypeDef* sub,
+                                                 RUP_FDCAN_FrameTypeDef* storage,
+                                                 uint16_t capacity, void (*Notify)(void* ctx),
+                                                 void* ctx) {
+  if (!sub || !storage || capacity < 2U || (capacity & (capacity - 1U)) != 0U) {
+    return RUP_FDCAN_ERROR;
+  }
+  std::memset(sub, 0, sizeof(*sub));
+  sub->Ring = storage;
+  sub->RingMask = static_cast<uint16_t>(capacity - 1U);
+  sub->Notify = Notify;
+  sub->NotifyCtx = ctx;
+  return RUP_FDCAN_OK;
+}
+
+RUP_FDCAN_StatusTypeDef RUP_FDCAN_Subscribe(FDCAN_GlobalTypeDef* Instance,
+                                            RUP_FDCAN_SubscriberTypeDef* sub, uint16_t id1,
+                                            uint16_t id2) {
+  if (Instance != &host_fdcan || !sub || id1 > id2 || id2 >= RUP_FDCAN_STD_ID_COUNT) {
+    return RUP_FDCAN_ERROR;
+  }
+  for (uint32_t id = id1; id <= id2; ++id) {
+    bus.subscriber[id] = sub;
+  }
+  return RUP_FDCAN_OK;
+}
+
+RUP_FDCAN_StatusTypeDef RUP_FDCAN_Unsubscribe(FDCAN_GlobalTypeDef* Instance,
+                                              RUP_FDCAN_SubscriberTypeDef* sub, uint16_t id1,
+                                              uint16_t id2) {
+  if (Instance != &host_fdcan || !sub || id1 > id2 || id2 >= RUP_FDCAN_STD_ID_COUNT) {
+    return RUP_FDCAN_ERROR;
+  }
+  for (uint32_t id = id1; id <= id2; ++id) {
+    if (bus.subscriber[id] == sub) {
+      bus.subscriber[id] = nullptr;
+    }
+  }
+  return RUP_FDCAN_OK;
+}
+
+uint8_t RUP_FDCAN_SubscriberPop(RUP_FDCAN_SubscriberTypeDef* sub, RUP_FDCAN_FrameTypeDef* frame) {
+  if (sub->Head == sub->Tail) {
+    return 0;
+  }
+  *frame = sub->Ring[sub->Tail & sub->RingMask];
+  sub->Tail = static_cast<uint16_t>(sub->Tail + 1);
+  return 1;
+}
+
+namespace {
+int failures = 0;
+
+void expect(bool ok, const char* scenario, const char* what) {
+  if (!ok && failures++ < 20) {
+    std::printf("FAIL: %s: %s\n", scenario, what);
+  }
+}
+
+RUP_CANLOAD_StreamTypeDef stream(uint16_t id, uint32_t period_us, uint8_t burst,
+                                 uint32_t offset_us, std::vector<uint8_t> dlc) {
+  RUP_CANLOAD_StreamTypeDef s{};
+  s.id = id;
+  s.period_us = period_us;
+  s.burst = burst;
+  s.offset_us = offset_us;
+  s.dlc_count = static_cast<uint8_t>(dlc.size());
+  std::copy(dlc.begin(), dlc.end(), s.dlc);
+  return s;
+}
+
+struct Scenario {
+  std::string name;
+  uint32_t bitrate = 1000000;
+  uint32_t duration_ms = 200;
+  bool loopback = true;
+  double isr_us = 4;
+  bool stuffing = false;
+  std::vector<RUP_CANLOAD_StreamTypeDef> streams;
+  uint32_t stop_ms = 0;  // RUP_CANLOAD_Stop() then, 0 = run to the end
+
+  // Expected figures: bus load range in permille, and whether the scenario
+  // must lose nothing, must lose Rx frames or must overrun bursts
+  uint32_t min_bus_load = 0;
+  uint32_t max_bus_load = 2000;
+  bool lossless = false;
+  bool rx_loss = false;
+  bool overruns = false;
+};
+
+const double poll_us = 2;
+
+RUP_CANLOAD_ReportTypeDef run(const Scenario& s) {
+  const char* name = s.name.c_str();
+  bus = BusModel{};
+  bus.bitrate = s.bitrate;
+  bus.isr_cycles_per_frame = static_cast<uint64_t>(s.isr_us * cpu_hz / 1e6);
+  bus.stuffing = s.stuffing;
+  host_dwt.CYCCNT = dwt_start;
+
+  RUP_CANLOAD_ProfileTypeDef profile{};
+  profile.name = name;
+  profile.bitrate = s.bitrate;
+  profile.duration_ms = s.duration_ms;
+  profile.loopback = s.loopback ? 1 : 0;
+  profile.count = static_cast<uint8_t>(s.streams.size());
+  profile.streams = s.streams.data();
+
+  RUP_CANLOAD_ReportTypeDef report{};
+  expect(RUP_CANLOAD_Start(&host_fdcan, &profile) == RUP_FDCAN_OK, name, "start");
+  expect(RUP_CANLOAD_Start(&host_fdcan, &profile) == RUP_FDCAN_BUSY, name, "second start");
+  expect(RUP_CANLOAD_GetReport(&report) == RUP_FDCAN_BUSY, name, "report while running");
+  const uint64_t isr_at_start = bus.isr_cycles;
+
+  const auto step = static_cast<uint64_t>(poll_us * cpu_hz / 1e6);
+  const uint64_t stop_at = s.stop_ms * cpu_hz / 1000;
+  const uint64_t give_up = (s.duration_ms + 1000ULL) * cpu_hz / 1000;
+  uint64_t isr_at_end = 0;
+  bool generating = true;
+  while (RUP_CANLOAD_Poll() == RUP_CANLOAD_RUNNING) {
+    if (generating && bus.now >= s.duration_ms * cpu_hz / 1000) {
+      // The poll that ended the generation read the ISR cycles of now
+      generating = false;
+      isr_at_end = bus.isr_cycles;
+    }
+    if (stop_at && bus.now >= stop_at) {
+      isr_at_end = bus.isr_cycles;
+      RUP_CANLOAD_Stop();
+      break;
+    }
+    if (bus.now > give_up) {
+      expect(false, name, "test never finished");
+      RUP_CANLOAD_Stop();
+      break;
+    }
+    bus.advance(bus.now + step);
+    host_dwt.CYCCNT = dwt_start + static_cast<uint32_t>(bus.now);
+  }
+  if (generating && !stop_at) {
+    isr_at_end = bus.isr_cycles;
+  }
+  expect(RUP_CANLOAD_GetReport(&report) == RUP_FDCAN_OK, name, "report");
+  expect(RUP_CANLOAD_GetReport(&report) == RUP_FDCAN_ERROR, name, "report collected twice");
+
+  // Against the model
+  const uint64_t elapsed_us = stop_at ? s.stop_ms * 1000ULL : s.duration_ms * 1000ULL;
+  expect(report.elapsed_us >= elapsed_us && report.elapsed_us <= elapsed_us + poll_us + 1, name,
+         "elapsed time");
+  expect(report.tx_frames == bus.accepted, name, "tx_frames differs from the frames queued");
+  expect(bus.accepted - bus.sent <= fifo_elements, name, "more frames pending than the Tx FIFO holds");
+  expect(report.rx_frames == bus.delivered, name, "rx_frames differs from the frames delivered");
+  expect(report.rx_frames + report.rx_lost == report.tx_frames, name, "rx_frames + rx_lost");
+  expect(report.frame_rate == static_cast<uint32_t>(
+                                  static_cast<uint64_t>(report.tx_frames) * 1000000 /
+                                  report.elapsed_us),
+         name, "frame_rate");
+  const uint64_t isr_permille = (isr_at_end - isr_at_start) * 1000 /
+                                (static_cast<uint64_t>(report.elapsed_us) * cpu_hz / 1000000);
+  expect(report.isr_load_permille + 1 >= isr_permille && report.isr_load_permille <= isr_permille + 1,
+         name, "isr_load_permille");
+  expect(std::all_of(bus.subscriber.begin(), bus.subscriber.end(),
+                     [](const RUP_FDCAN_SubscriberTypeDef* sub) { return sub == nullptr; }),
+         name, "stream IDs still subscribed");
+  expect(!bus.loopback && bus.loopback_calls == (s.loopback ? 2 : 0), name,
+         "loopback not entered and left once");
+
+  // Scenario figures
+  expect(report.bus_load_permille >= s.min_bus_load && report.bus_load_permille <= s.max_bus_load,
+         name, "bus load out of the expected range");
+  if (s.lossless) {
+    expect(report.rx_lost == 0 && report.tx_overruns == 0, name, "frames lost or bursts overrun");
+  }
+  if (s.rx_loss) {
+    expect(bus.rx_fifo_lost > 0 && report.rx_lost >= bus.rx_fifo_lost, name,
+           "no Rx FIFO overflow reported");
+  }
+  if (s.overruns) {
+    expect(report.tx_overruns > 0 && report.tx_deferred > 0, name, "no burst overrun reported");
+  }
+  if (s.stop_ms) {
+    expect(report.tx_overruns == 0 && report.rx_lost <= fifo_elements, name,
+           "more lost than the frames in flight at the stop");
+  }
+  if (!s.loopback) {
+    expect(report.rx_frames == 0 && report.rx_lost == report.tx_frames, name,
+           "frames received without loopback");
+  }
+  return report;
+}
+
+void print(const Scenario& s, const RUP_CANLOAD_ReportTypeDef& r) {
+  std::printf("%s @ %u bit/s, %u ms, ISR %.1f us/frame\n", s.name.c_str(), s.bitrate,
+              s.duration_ms, s.isr_us);
+  std::printf("  elapsed_us %u, tx_frames %u, tx_deferred %u, tx_overruns %u\n", r.elapsed_us,
+              r.tx_frames, r.tx_deferred, r.tx_overruns);
+  std::printf("  rx_frames %u, rx_lost %u, frame_rate %u\n", r.rx_frames, r.rx_lost,
+              r.frame_rate);
+  std::printf("  bus_load_permille %u, isr_load_permille %u\n", r.bus_load_permille,
+              r.isr_load_permille);
+}
+
+std::vector<Scenario> scenarios() {
+  std::vector<Scenario> list;
+
+  // 2 x 111 bits every 1 ms at 500 kbit/s
+  Scenario periodic;
+  periodic.name = "periodic";
+  periodic.bitrate = 500000;
+  periodic.streams = {stream(0x100, 1000, 2, 0, {8})};
+  periodic.min_bus_load = 440;
+  periodic.max_bus_load = 448;
+  periodic.lossless = true;
+  list.push_back(periodic);
+
+  // (63 + 79 + 111) / 3 bits per ms, then 55 + 111 bits every 2 ms
+  Scenario mixed;
+  mixed.name = "mixed DLC and offsets";
+  mixed.streams = {stream(0x205, 1000, 1, 500, {2, 4, 8}), stream(0x310, 2000, 2, 250, {1, 8})};
+  mixed.min_bus_load = 162;
+  mixed.max_bus_load = 172;
+  mixed.lossless = true;
+  list.push_back(mixed);
+
+  // Background load fills the bus around the bursts, which still go first
+  Scenario saturated;
+  saturated.name = "saturated";
+  saturated.streams = {stream(0x100, 1000, 4, 0, {8}), stream(0x7A0, 0, 1, 0, {8})};
+  saturated.min_bus_load = 990;
+  saturated.max_bus_load = 1010;
+  saturated.lossless = true;
+  list.push_back(saturated);
+
+  // 47-bit frames back to back, read by an ISR slower than one frame time
+  Scenario slow_isr;
+  slow_isr.name = "slow Rx interrupt";
+  slow_isr.duration_ms = 100;
+  slow_isr.isr_us = 80;
+  slow_isr.streams = {stream(0x7A0, 0, 1, 0, {0})};
+  slow_isr.min_bus_load = 990;
+  slow_isr.rx_loss = true;
+  list.push_back(slow_isr);
+
+  // 10 x 222 us of frames released every 1 ms
+  Scenario overload;
+  overload.name = "overloaded bursts";
+  overload.bitrate = 500000;
+  overload.duration_ms = 100;
+  overload.streams = {stream(0x100, 1000, 10, 0, {8})};
+  overload.min_bus_load = 990;
+  overload.overruns = true;
+  list.push_back(overload);
+
+  // The burst released at the last instant adds 2 frames to the 100
+  Scenario no_loopback;
+  no_loopback.name = "no loopback";
+  no_loopback.duration_ms = 50;
+  no_loopback.loopback = false;
+  no_loopback.streams = {stream(0x100, 1000, 2, 0, {8})};
+  no_loopback.min_bus_load = 220;
+  no_loopback.max_bus_load = 228;
+  list.push_back(no_loopback);
+
+  // No settling after a stop: the frames still in flight count as lost
+  Scenario stopped;
+  stopped.name = "stopped early";
+  stopped.duration_ms = 1000;
+  stopped.stop_ms = 100;
+  stopped.streams = {stream(0x100, 1000, 2, 0, {8})};
+  stopped.min_bus_load = 220;
+  stopped.max_bus_load = 228;
+  list.push_back(stopped);
+
+  return list;
+}
+
+// Profile on stdin, one line per item:
+//   profile <name> <bitrate> <duration_ms> <loopback>
+//   stream <id> <period_us> <burst> <offset_us> <dlc> [<dlc>...]
+bool read_profile(Scenario& s) {
+  std::string line;
+  bool have_profile = false;
+  while (std::getline(std::cin, line)) {
+    std::istringstream in(line);
+    std::string kind;
+    in >> kind;
+    if (kind == "profile") {
+      int loopback = 1;
+      in >> s.name >> s.bitrate >> s.duration_ms >> loopback;
+      s.loopback = loopback != 0;
+      have_profile = !in.fail();
+    } else if (kind == "stream") {
+      uint32_t id = 0, period = 0, burst = 0, offset = 0, dlc = 0;
+      in >> id >> period >> burst >> offset;
+      std::vector<uint8_t> mix;
+      while (in >> dlc) {
+        mix.push_back(static_cast<uint8_t>(dlc));
+      }
+      if (mix.empty() || mix.size() > RUP_CANLOAD_MAX_DLC_MIX) {
+        return false;
+      }
+      s.streams.push_back(stream(static_cast<uint16_t>(id), period,
+                                 static_cast<uint8_t>(burst), offset, mix));
+    }
+  }
+  return have_profile && !s.streams.empty();
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc > 1 && std::strcmp(argv[1], "replay") == 0) {
+    Scenario s;
+    s.isr_us = argc > 2 ? std::atof(argv[2]) : 4;
+    s.stuffing = argc > 3 && std::atoi(argv[3]) != 0;
+    if (!read_profile(s)) {
+      std::printf("FAIL: invalid profile on stdin\n");
+      return 1;
+    }
+    print(s, run(s));
+  } else {
+    for (const Scenario& s : scenarios()) {
+      const RUP_CANLOAD_ReportTypeDef report = run(s);
+      std::printf("%-24s tx %6u  rx %6u  lost %5u  overruns %4u  bus %4u  isr %3u\n",
+                  s.name.c_str(), report.tx_frames, report.rx_frames, report.rx_lost,
+                  report.tx_overruns, report.bus_load_permille, report.isr_load_permille);
+    }
+  }
+  std::printf("%d failures\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,30 @@
+#!/usr/bin/env python3
+"""Host cross-check of the ADC filter kernels (lib/drivers/include/adc_filter.hpp).
+
+Builds the kernels with the host compiler, where the DSP instructions of the
+packed versions are emulated, together with scripts/adc_filter_check.cpp, and
+compares them with the portable references on random signals. Cycles per
+sample are measured on target instead, by ru::driver::dsp::report_filter_cycles().
+
+Usage:
+
+    python3 scripts/check_adc_filters.py [--cxx g++] [--rounds 200]
+"""
+from host_check import DRIVERS, ROOT, argument_parser, build_and_run
+
+SOURCES = [
+    ROOT / "scripts" / "adc_filter_check.cpp",
+    DRIVERS / "adc_filter.cpp",
+]
+
+
+def main():
+    parser = argument_parser(__doc__)
+    parser.add_argument("--rounds", type=int, default=200)
+    args = parser.parse_args()
+
+    build_and_run("adc_filter_check", SOURCES, args.cxx, [args.rounds])
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,29 @@
+#!/usr/bin/env python3
+"""Host check of the ADC block bookkeeping (AdcBlockRing, lib/drivers/include/adc.hpp).
+
+Builds scripts/adc_scan_check.cpp with the host compiler: AdcBlockRing driven
+by a synthetic circular DMA whose half/full transfer interrupts run late by a
+random latency. Fails if a block is handed over twice, out of order or with
+the wrong samples, if take() does not return the newest block, if an
+overwritten block is counted wrong or reported intact, or if restart() does
+not go back to block 0.
+
+Usage:
+
+    python3 scripts/check_adc_scan.py [--cxx g++] [--rounds 200]
+"""
+from host_check import ROOT, argument_parser, build_and_run
+
+SOURCES = [ROOT / "scripts" / "adc_scan_check.cpp"]
+
+
+def main():
+    parser = argument_parser(__doc__)
+    parser.add_argument("--rounds", type=int, default=200)
+    args = parser.parse_args()
+
+    build_and_run("adc_scan_check", SOURCES, args.cxx, [args.rounds])
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Host check of the CAN load generator (lib/drivers/include/raceup_can_loadgen.h).
+
+Builds the firmware's raceup_can_loadgen.c with the host C compiler and links
+it with scripts/can_loadgen_sim.cpp, which stands in for the FDCAN wrapper
+calls it makes with a model of the bus, the Tx and Rx FIFOs and the Rx
+interrupt. The built-in scenarios check the report against the model, then
+the traffic profile is replayed and its report printed, to compare a target
+run against.
+
+Usage:
+
+    python3 scripts/check_can_loadgen.py [--profile profiles/can_full_load.yaml]
+                                         [--isr-us 4] [--stuffing] [--cc cc] [--cxx c++]
+"""
+import subprocess
+import sys
+import tempfile
+
+from host_check import DRIVERS, ROOT, argument_parser, build
+
+C_SOURCES = [DRIVERS / "raceup_can_loadgen.c"]
+SOURCES = [ROOT / "scripts" / "can_loadgen_sim.cpp"]
+
+# Reuse the profile parser (and its validation) of the code generator
+sys.path.insert(0, str(ROOT))
+from generate import load_profile  # noqa: E402
+
+# Host stand-ins for the HAL definitions raceup_fdcan.h and the generator use
+HAL_H = """#pragma once
+#include <stdint.h>
+#ifdef __cplusplus
+extern "C" {
+#endif
+typedef struct { uint32_t unused; } FDCAN_GlobalTypeDef;
+typedef struct { FDCAN_GlobalTypeDef *Instance; } FDCAN_HandleTypeDef;
+typedef struct {
+    uint32_t FilterList, FilterIndex, MessageLocation, MessageIndex;
+} FDCAN_HpMsgStatusTypeDef;
+#define FDCAN_RX_FIFO0 0x40U
+#define FDCAN_RX_FIFO1 0x41U
+#define FDCAN_ACCEPT_IN_RX_FIFO0 0x0U
+#define FDCAN_ACCEPT_IN_RX_FIFO1 0x1U
+#define FDCAN_REJECT 0x2U
+#define FDCAN_FILTER_RANGE 0x0U
+#define FDCAN_FILTER_DUAL 0x1U
+#define FDCAN_FILTER_MASK 0x2U
+#define FDCAN_FILTER_TO_RXFIFO0 0x1U
+#define FDCAN_FILTER_TO_RXFIFO1 0x2U
+#define FDCAN_FILTER_REJECT 0x3U
+#define FDCAN_FILTER_TO_RXFIFO0_HP 0x5U
+#define FDCAN_FILTER_TO_RXFIFO1_HP 0x6U
+#define HAL_MAX_DELAY 0xFFFFFFFFU
+typedef struct { volatile uint32_t CYCCNT; } DWT_Type;
+extern DWT_Type host_dwt;
+#define DWT (&host_dwt)
+extern uint32_t SystemCoreClock;
+#ifdef __cplusplus
+}
+#endif
+"""
+MAIN_H = "#pragma once\n"
+
+
+def profile_lines(profile):
+    lines = [f"profile {profile['name']} {profile['bitrate']} {profile['duration_ms']} "
+             f"{int(profile['loopback'])}"]
+    for s in profile["streams"]:
+        lines.append(f"stream {s['id']} {s['period_us']} {s['burst']} {s['offset_us']} "
+                     + " ".join(map(str, s["dlc"])))
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    parser = argument_parser(__doc__)
+    parser.add_argument("--profile", default=str(ROOT / "profiles" / "can_full_load.yaml"),
+                        help="traffic profile YAML file replayed after the scenarios")
+    parser.add_argument("--isr-us", type=float, default=4.0,
+                        help="Rx ISR service time per frame (us) of the replay")
+    parser.add_argument("--stuffing", action="store_true",
+                        help="worst-case bit stuffing on the wire in the replay")
+    parser.add_argument("--cc", default="cc", help="host C11 compiler")
+    args = parser.parse_args()
+
+    profile = load_profile({"load_test": {"profile": args.profile}})
+
+    with tempfile.TemporaryDirectory() as tmp:
+        binary = build(tmp, "can_loadgen_sim", SOURCES, args.cxx, c_sources=C_SOURCES,
+                       cc=args.cc, stubs={"stm32h5xx_hal.h": HAL_H, "main.h": MAIN_H})
+
+        status = subprocess.run([str(binary)]).returncode
+        replay = subprocess.run([str(binary), "replay", str(args.isr_us), str(int(args.stuffing))],
+                                input=profile_lines(profile), text=True).returncode
+        sys.exit(status or replay)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,32 @@
+#!/usr/bin/env python3
+"""Host check of the table-driven math (lib/drivers/include/cordic.hpp).
+
+Builds the *_table functions with the host compiler, together with
+scripts/cordic_math_check.cpp, and measures their worst error against libm in
+double precision and their throughput next to the float libm functions. Fails
+if an error exceeds its bound. The CORDIC versions are measured on target
+instead, by ru::driver::math::report_math_cycles().
+
+Usage:
+
+    python3 scripts/check_cordic_math.py [--cxx g++] [--count 100000]
+"""
+from host_check import DRIVERS, ROOT, argument_parser, build_and_run
+
+SOURCES = [
+    ROOT / "scripts" / "cordic_math_check.cpp",
+    DRIVERS / "cordic.cpp",
+]
+INCLUDES = [ROOT / "lib" / "drivers" / "include"]
+
+
+def main():
+    parser = argument_parser(__doc__)
+    parser.add_argument("--count", type=int, default=100000)
+    args = parser.parse_args()
+
+    build_and_run("cordic_math_check", SOURCES, args.cxx, [args.count], includes=INCLUDES)
+
+
+if __name__ == "__main__":
+    main()
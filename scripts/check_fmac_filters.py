@@ -0,0 +1,34 @@
+#!/usr/bin/env python3
+"""Host cross-check of the FMAC filter model (lib/drivers/include/filter.hpp).
+
+Builds FilterKernel, the software path of ru::driver::Filter, with the host
+compiler together with scripts/fmac_filter_check.cpp, and compares it with a
+plain transcription of the FMAC datapath on random signals, for the filters
+generated from config.yaml (run generate.py first) and for random ones. The
+FMAC itself and the cycles it saves are measured on target, by
+ru::driver::report_fmac_cycles().
+
+Usage:
+
+    python3 scripts/check_fmac_filters.py [--cxx g++] [--rounds 200]
+"""
+import host_check
+from host_check import DRIVERS, ROOT, argument_parser, build_and_run
+
+SOURCES = [
+    ROOT / "scripts" / "fmac_filter_check.cpp",
+    DRIVERS / "filter_kernel.cpp",
+]
+INCLUDES = [*host_check.INCLUDES, DRIVERS]
+
+
+def main():
+    parser = argument_parser(__doc__)
+    parser.add_argument("--rounds", type=int, default=200)
+    args = parser.parse_args()
+
+    build_and_run("fmac_filter_check", SOURCES, args.cxx, [args.rounds], includes=INCLUDES)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,33 @@
+#!/usr/bin/env python3
+"""Host check of the I3C controller protocol (lib/drivers/include/i3c.hpp).
+
+Builds I3cProtocol, the hardware-free half of ru::driver::I3c, with the host
+compiler together with scripts/i3c_protocol_sim.cpp, a simulated bus of I3C
+targets and a legacy I2C device. Checks the device table, the dynamic address
+assignment, private and legacy transfers against the targets' registers,
+common command codes, NACKs, errors, resubmission from callbacks and the
+in-band interrupts. The I3C peripheral itself is only exercised on target.
+
+Usage:
+
+    python3 scripts/check_i3c_protocol.py [--cxx g++] [--rounds 2000]
+"""
+from host_check import DRIVERS, ROOT, argument_parser, build_and_run
+
+SOURCES = [
+    ROOT / "scripts" / "i3c_protocol_sim.cpp",
+    DRIVERS / "i3c_protocol.cpp",
+]
+
+
+def main():
+    parser = argument_parser(__doc__)
+    parser.add_argument("--rounds", type=int, default=2000,
+                        help="rounds of random transfers")
+    args = parser.parse_args()
+
+    build_and_run("i3c_protocol_sim", SOURCES, args.cxx, [args.rounds])
+
+
+if __name__ == "__main__":
+    main()
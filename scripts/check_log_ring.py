@@ -0,0 +1,48 @@
+#!/usr/bin/env python3
+"""Host stress test of the deferred logging ring (lib/drivers/include/log_backend.hpp).
+
+Builds log_backend.cpp with the host compiler, against the few FreeRTOS
+definitions it needs, together with scripts/log_ring_stress.cpp: producer
+threads queue formatted, interned and raw text records while a drain thread
+empties the ring into a fake Serial port. Fails if a record comes out
+truncated, interleaved, twice or out of order, if a queued one is missing, or
+if a refused one is not counted as dropped. The caller cost is measured on
+target instead, by ru::driver::debug::report_log_cycles().
+
+Usage:
+
+    python3 scripts/check_log_ring.py [--cxx g++] [--records 20000]
+"""
+from host_check import DRIVERS, ROOT, argument_parser, build_and_run
+
+SOURCES = [
+    ROOT / "scripts" / "log_ring_stress.cpp",
+    DRIVERS / "log_backend.cpp",
+]
+
+# Host stand-ins for the kernel headers log_backend.cpp includes
+FREERTOS_H = """#pragma once
+#include <cstdint>
+#define configNUMBER_OF_CORES 1
+typedef uint32_t TickType_t;
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+"""
+TASK_H = """#pragma once
+#include "FreeRTOS.h"
+inline void vTaskDelay(TickType_t) {}
+"""
+
+
+
+def main():
+    parser = argument_parser(__doc__)
+    parser.add_argument("--records", type=int, default=20000,
+                        help="records queued by each producer")
+    args = parser.parse_args()
+
+    build_and_run("log_ring_stress", SOURCES, args.cxx, [args.records],
+                  stubs={"FreeRTOS.h": FREERTOS_H, "task.h": TASK_H}, flags=["-pthread"])
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,31 @@
+#!/usr/bin/env python3
+"""Host check of the serial packet codec (lib/drivers/include/serial_packet.hpp).
+
+Builds ru::driver::SerialPacket with the host compiler together with
+scripts/serial_packet_check.cpp, which loops it back through a fake Serial.
+Round-trips random packets and the COBS edge cases, checks that CRC
+mismatches, truncated frames and lost delimiters are counted and followed by
+a clean resync, and prints the encode and the decode throughput in MB/s.
+
+Usage:
+
+    python3 scripts/check_serial_packet.py [--cxx g++] [--rounds 200]
+"""
+from host_check import DRIVERS, ROOT, argument_parser, build_and_run
+
+SOURCES = [
+    ROOT / "scripts" / "serial_packet_check.cpp",
+    DRIVERS / "serial_packet.cpp",
+]
+
+
+def main():
+    parser = argument_parser(__doc__)
+    parser.add_argument("--rounds", type=int, default=200)
+    args = parser.parse_args()
+
+    build_and_run("serial_packet_check", SOURCES, args.cxx, [args.rounds])
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""Disassembly size check of StaticGpio (lib/drivers/include/static_gpio.hpp).
+
+Compiles scripts/static_gpio_probe.cpp with the exact flags the build uses for
+gpio.cpp (from compile_commands.json), counts the instructions of each probe
+function and fails if an access grew past its budget. The runtime Gpio methods
+of the same build are listed next to them for comparison (HAL calls excluded,
+they only add to the Gpio side).
+
+Usage, after a build:
+
+    python3 scripts/check_static_gpio.py [.build-stm32h563vit6x]
+"""
+import argparse
+import json
+import re
+import shlex
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+ROOT = Path(__file__).resolve().parent.parent
+PROBE = ROOT / "scripts" / "static_gpio_probe.cpp"
+
+# Thumb-2 instructions, return included. The port address is one literal
+# load, or movw + movt: one more than the access itself needs.
+BUDGETS = {
+    "probe_set_high": 5,
+    "probe_set_low": 5,
+    "probe_set_active_low": 5,
+    "probe_set_level": 8,
+    "probe_toggle": 9,
+    "probe_is_active": 7,
+}
+GPIO_METHODS = {
+    "_ZN2ru6driver4Gpio9set_levelEb": "Gpio::set_level",
+    "_ZN2ru6driver4Gpio6toggleEv": "Gpio::toggle",
+    "_ZNK2ru6driver4Gpio7is_highEv": "Gpio::is_high",
+}
+
+SYMBOL = re.compile(r"^[0-9a-f]+ <(?P<name>[^>]+)>:$")
+INSTRUCTION = re.compile(r"^\s+[0-9a-f]+:\s+(?P<mnemonic>[a-z][\w.]*)")
+
+
+def compile_command(build_dir):
+    with open(build_dir / "compile_commands.json") as f:
+        entries = json.load(f)
+    for entry in entries:
+        if entry["file"].endswith("instances/stm32h5xx/gpio.cpp"):
+            args = entry.get("arguments") or shlex.split(entry["command"])
+            return entry, args
+    raise SystemExit("gpio.cpp not found in compile_commands.json: build the firmware first")
+
+
+def instruction_counts(objdump, obj):
+    listing = subprocess.run([objdump, "-d", "--no-show-raw-insn", str(obj)],
+                             check=True, capture_output=True, text=True).stdout
+    counts = {}
+    name = None
+    for line in listing.splitlines():
+        symbol = SYMBOL.match(line)
+        if symbol:
+            name = symbol.group("name")
+            counts[name] = 0
+            continue
+        instruction = INSTRUCTION.match(line)
+        # Literal pool words are data, not instructions
+        if name and instruction and not instruction.group("mnemonic").startswith("."):
+            counts[name] += 1
+    return counts
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("build_dir", nargs="?", default=".build-stm32h563vit6x")
+    args = parser.parse_args()
+    build_dir = (ROOT / args.build_dir).resolve()
+
+    entry, command = compile_command(build_dir)
+    compiler = command[0]
+    objdump = re.sub(r"(g\+\+|c\+\+|gcc)(\.exe)?$", r"objdump\2", compiler)
+
+    # Same flags, other input and output
+    flags = []
+    skip = False
+    for arg in command[1:]:
+        if skip:
+            skip = False
+        elif arg == "-o":
+            skip = True
+        elif arg != "-c" and not arg.endswith("gpio.cpp"):
+            flags.append(arg)
+    gpio_obj = Path(entry["directory"]) / entry["output"] if "output" in entry else None
+
+    with tempfile.TemporaryDirectory() as tmp:
+        probe_obj = Path(tmp) / "static_gpio_probe.o"
+        subprocess.run([compiler, *flags, "-c", str(PROBE), "-o", str(probe_obj)],
+                       check=True, cwd=entry["directory"])
+        probe = instruction_counts(objdump, probe_obj)
+
+    failed = False
+    print(f"{'access':28} {'instr':>5} {'budget':>6}")
+    for name, budget in BUDGETS.items():
+        count = probe.get(name)
+        ok = count is not None and count <= budget
+        failed |= not ok
+        print(f"{name:28} {count if count is not None else '-':>5} {budget:>6}"
+              f"{'' if ok else '  <-- over budget'}")
+
+    if gpio_obj and gpio_obj.exists():
+        runtime = instruction_counts(objdump, gpio_obj)
+        print()
+        for symbol, label in GPIO_METHODS.items():
+            if symbol in runtime:
+                print(f"{label:28} {runtime[symbol]:>5}  (+ HAL call)")
+
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
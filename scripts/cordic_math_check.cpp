@@ -0,0 +1,177 @@
+// Host check of the table-driven math (lib/drivers/include/cordic.hpp): the
+// worst error of each *_table function against libm in double precision, next
+// to that of the float libm functions it replaces, and the throughput of both.
+// Fails if a table error exceeds its documented bound. Built and run by
+// scripts/check_cordic_math.py; report_math_cycles() does the same on target,
+// with the CORDIC.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "cordic.hpp"
+
+using namespace ru::driver;
+
+namespace {
+std::mt19937 rng(12345);
+
+std::vector<float> uniform(size_t count, float lo, float hi) {
+  std::uniform_real_distribution<float> dist(lo, hi);
+  std::vector<float> values(count);
+  for (auto& v : values) {
+    v = dist(rng);
+  }
+  return values;
+}
+
+// Random sign and mantissa, exponent uniform: spans many orders of magnitude
+std::vector<float> log_uniform(size_t count, float lo_exp, float hi_exp, bool signed_values) {
+  auto exponents = uniform(count, lo_exp, hi_exp);
+  std::vector<float> values(count);
+  for (size_t i = 0; i < count; ++i) {
+    values[i] = std::pow(10.0f, exponents[i]) * (signed_values && (rng() & 1) ? -1.0f : 1.0f);
+  }
+  return values;
+}
+
+template <typename F>
+double ns_per_element(size_t count, F f) {
+  const int repeats = 20;
+  const auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeats; ++r) {
+    f();
+  }
+  const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / repeats / count;
+}
+
+struct Result {
+  double table_error;
+  double libm_error;
+  double table_ns;
+  double libm_ns;
+};
+
+bool report(const char* name, const Result& r, double bound) {
+  const bool ok = r.table_error <= bound;
+  std::printf("%-10s table %.2e (bound %.0e) %6.2f ns, libm %.2e %6.2f ns%s\n", name,
+              r.table_error, bound, r.table_ns, r.libm_error, r.libm_ns, ok ? "" : "  FAILED");
+  return ok;
+}
+
+volatile float sink;
+} // namespace
+
+int main(int argc, char** argv) {
+  const size_t count = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 100000;
+  int failures = 0;
+
+  // sin / cos: absolute error, angles within a few turns
+  {
+    const auto angles = uniform(count, -4 * 3.14159265f, 4 * 3.14159265f);
+    std::vector<float> s(count), c(count), ls(count), lc(count);
+    Result r{};
+    r.table_ns = ns_per_element(count, [&] {
+      math::sincos_table(angles.data(), s.data(), c.data(), count);
+    });
+    r.libm_ns = ns_per_element(count, [&] {
+      for (size_t i = 0; i < count; ++i) {
+        ls[i] = std::sin(angles[i]);
+        lc[i] = std::cos(angles[i]);
+      }
+    });
+    for (size_t i = 0; i < count; ++i) {
+      const double a = angles[i];
+      r.table_error =
+          std::max({r.table_error, std::fabs(s[i] - std::sin(a)), std::fabs(c[i] - std::cos(a))});
+      r.libm_error =
+          std::max({r.libm_error, std::fabs(ls[i] - std::sin(a)), std::fabs(lc[i] - std::cos(a))});
+    }
+    failures += !report("sincos", r, 1e-5);
+  }
+
+  // atan2: absolute error in radians, vectors of any size and direction
+  {
+    const auto x = log_uniform(count, -6, 6, true);
+    const auto y = log_uniform(count, -6, 6, true);
+    std::vector<float> a(count), la(count);
+    Result r{};
+    r.table_ns = ns_per_element(count, [&] {
+      math::atan2_table(y.data(), x.data(), a.data(), count);
+    });
+    r.libm_ns = ns_per_element(count, [&] {
+      for (size_t i = 0; i < count; ++i) {
+        la[i] = std::atan2(y[i], x[i]);
+      }
+    });
+    for (size_t i = 0; i < count; ++i) {
+      const double ref = std::atan2(static_cast<double>(y[i]), static_cast<double>(x[i]));
+      // pi and -pi are the same angle
+      const auto error = [&](double v) {
+        const double d = std::fabs(v - ref);
+        return std::min(d, std::fabs(d - 2 * 3.14159265358979323846));
+      };
+      r.table_error = std::max(r.table_error, error(a[i]));
+      r.libm_error = std::max(r.libm_error, error(la[i]));
+    }
+    failures += !report("atan2", r, 5e-6);
+  }
+
+  // polar magnitude: relative error
+  {
+    const auto x = log_uniform(count, -30, 30, true);
+    const auto y = log_uniform(count, -30, 30, true);
+    std::vector<float> m(count), a(count), lm(count);
+    Result r{};
+    r.table_ns = ns_per_element(count, [&] {
+      math::polar_table(x.data(), y.data(), m.data(), a.data(), count);
+    });
+    r.libm_ns = ns_per_element(count, [&] {
+      for (size_t i = 0; i < count; ++i) {
+        lm[i] = std::hypot(x[i], y[i]);
+        sink = std::atan2(y[i], x[i]);
+      }
+    });
+    for (size_t i = 0; i < count; ++i) {
+      const double ref = std::hypot(static_cast<double>(x[i]), static_cast<double>(y[i]));
+      r.table_error = std::max(r.table_error, std::fabs(m[i] - ref) / ref);
+      r.libm_error = std::max(r.libm_error, std::fabs(lm[i] - ref) / ref);
+    }
+    failures += !report("polar", r, 2e-6);
+  }
+
+  // sqrt: relative error, over the whole float range, subnormals included
+  {
+    auto in = log_uniform(count, -44, 38, false);
+    std::vector<float> out(count), lout(count);
+    Result r{};
+    r.table_ns = ns_per_element(count, [&] { math::sqrt_table(in.data(), out.data(), count); });
+    r.libm_ns = ns_per_element(count, [&] {
+      for (size_t i = 0; i < count; ++i) {
+        lout[i] = std::sqrt(in[i]);
+      }
+    });
+    for (size_t i = 0; i < count; ++i) {
+      const double ref = std::sqrt(static_cast<double>(in[i]));
+      r.table_error = std::max(r.table_error, std::fabs(out[i] - ref) / ref);
+      r.libm_error = std::max(r.libm_error, std::fabs(lout[i] - ref) / ref);
+    }
+    failures += !report("sqrt", r, 1e-6);
+
+    const float special[] = {0.0f, -0.0f, -1.0f, INFINITY};
+    float result[4];
+    math::sqrt_table(special, result, 4);
+    if (result[0] != 0.0f || result[1] != 0.0f || !std::isnan(result[2]) ||
+        !std::isinf(result[3])) {
+      std::printf("sqrt: wrong special values\n");
+      ++failures;
+    }
+  }
+
+  std::printf("%zu elements per function, %d failures\n", count, failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,150 @@
+// Host cross-check of the FMAC filter model (lib/drivers/include/filter.hpp):
+// FilterKernel against a plain transcription of the FMAC datapath, fed the
+// same random signals in random chunks. Half of the chunks go through the
+// FMAC sequence of Filter::process instead (preload the history, run the
+// chunk, append it), so both paths carry the stream over. Runs the filters of
+// config.yaml, whose DC gain is checked too, and random ones that push the
+// accumulator into wrapping and saturation. Built and run by
+// scripts/check_fmac_filters.py.
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "filter.hpp"
+
+using namespace ru::driver;
+
+namespace {
+std::mt19937 rng(12345);
+
+int random_int(int lo, int hi) {
+  return std::uniform_int_distribution<int>(lo, hi)(rng);
+}
+
+std::vector<int16_t> random_signal(size_t count) {
+  // Full scale noise or a random walk
+  std::vector<int16_t> signal(count);
+  const bool walk = random_int(0, 1);
+  int value = random_int(-32768, 32767);
+  for (auto& sample : signal) {
+    value = walk ? std::min(32767, std::max(-32768, value + random_int(-512, 512)))
+                 : random_int(-32768, 32767);
+    sample = static_cast<int16_t>(value);
+  }
+  return signal;
+}
+
+// One FMAC run as the reference manual describes it: x starts with the p - 1
+// preloaded inputs, y with the q preloaded outputs
+void fmac_run(const FilterCoefficients& c, std::vector<int16_t> x, std::vector<int16_t> y,
+              const int16_t* in, int16_t* out, size_t count) {
+  x.insert(x.end(), in, in + count);
+  for (size_t n = 0; n < count; ++n) {
+    int64_t acc = 0;
+    for (int k = 0; k < c.p; ++k) {
+      acc += static_cast<int64_t>(std::floor(c.feedforward[k] * x[c.p - 1 + n - k] / 256.0));
+    }
+    for (int k = 0; k < c.q; ++k) {
+      acc += static_cast<int64_t>(std::floor(c.feedback[k] * y[c.q + n - 1 - k] / 256.0));
+    }
+    acc = ((acc % (1 << 26)) + (1 << 26)) % (1 << 26);  // 26 bits, two's complement
+    acc = acc >= (1 << 25) ? acc - (1 << 26) : acc;
+    const int64_t result = static_cast<int64_t>(std::floor(acc * std::pow(2.0, c.gain) / 128.0));
+    out[n] = static_cast<int16_t>(std::min<int64_t>(32767, std::max<int64_t>(-32768, result)));
+    y.push_back(out[n]);
+  }
+}
+
+// The stream through FilterKernel::process, and through the reference with
+// half of the chunks on the FMAC path of Filter::process
+bool compare(const char* name, const FilterCoefficients& c) {
+  const auto signal = random_signal(static_cast<size_t>(random_int(1, 3000)));
+  std::vector<int16_t> out(signal.size()), expected(signal.size());
+  FilterKernel kernel(c);
+  FilterKernel stream(c);
+  std::vector<int16_t> x(c.p - 1, 0), y(c.q, 0);
+  for (size_t done = 0; done < signal.size();) {
+    const size_t chunk = std::min(signal.size() - done, static_cast<size_t>(random_int(1, 200)));
+    kernel.process(signal.data() + done, out.data() + done, chunk);
+
+    if (random_int(0, 1)) {
+      stream.process(signal.data() + done, expected.data() + done, chunk);
+    } else {
+      std::vector<int16_t> inputs(c.p - 1), outputs(c.q);
+      stream.input_history(inputs.data());
+      stream.output_history(outputs.data());
+      fmac_run(c, inputs, outputs, signal.data() + done, expected.data() + done, chunk);
+      stream.append_history(signal.data() + done, expected.data() + done, chunk);
+    }
+    done += chunk;
+  }
+
+  // Both must match the whole stream in one run, from the start
+  std::vector<int16_t> whole(signal.size());
+  fmac_run(c, x, y, signal.data(), whole.data(), signal.size());
+  if (out != whole || expected != whole) {
+    std::printf("%s: mismatch (p %u, q %u, gain %u, %zu samples)\n", name, c.p, c.q, c.gain,
+                signal.size());
+    return false;
+  }
+  return true;
+}
+
+// Output of a constant input once settled, against the input
+bool check_dc_gain(const char* name, const FilterCoefficients& c) {
+  FilterKernel kernel(c);
+  std::vector<int16_t> in(4000, 8000), out(in.size());
+  kernel.process(in.data(), out.data(), in.size());
+  const double gain = out.back() / 8000.0;
+  std::printf("%s: p %u, q %u, gain shift %u, DC gain %.4f\n", name, c.p, c.q, c.gain, gain);
+  return std::fabs(gain - 1.0) < 0.01;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  const int rounds = argc > 1 ? std::atoi(argv[1]) : 200;
+  int failures = 0;
+
+  struct Named {
+    const char* name;
+    FilterId id;
+  };
+  const Named configured[] = {
+#undef X_filter
+#define X_filter(name) {#name, FilterId::name},
+#include "custom_board/driver_ids.hpp"
+#undef X_filter
+  };
+  for (const auto& filter : configured) {
+    const FilterCoefficients* c = filter_coefficients(filter.id);
+    if (!c || !check_dc_gain(filter.name, *c)) {
+      std::printf("%s: missing or wrong DC gain\n", filter.name);
+      ++failures;
+    }
+  }
+
+  std::vector<int16_t> coefficients(FilterKernel::max_feedforward + FilterKernel::max_feedback);
+  for (int round = 0; round < rounds; ++round) {
+    for (const auto& filter : configured) {
+      failures += !compare(filter.name, *filter_coefficients(filter.id));
+    }
+
+    // Random coefficients: large ones wrap the accumulator or saturate
+    const bool fir = random_int(0, 1);
+    const auto p = static_cast<uint8_t>(random_int(2, fir ? FilterKernel::max_feedforward : 9));
+    const auto q = static_cast<uint8_t>(fir ? 0 : random_int(1, FilterKernel::max_feedback));
+    const int scale = random_int(0, 1) ? 32767 : 2000;
+    for (auto& coefficient : coefficients) {
+      coefficient = static_cast<int16_t>(random_int(-scale, scale));
+    }
+    const FilterCoefficients random{coefficients.data(), coefficients.data() + p, p, q,
+                                    static_cast<uint8_t>(random_int(0, 7))};
+    failures += !compare(fir ? "random fir" : "random iir", random);
+  }
+
+  std::printf("%d rounds, %d mismatches\n", rounds, failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,55 @@
+"""Build and run support shared by the host checks (scripts/check_*.py).
+
+Each check builds driver sources with a host compiler, together with its own
+scripts/<name>_check.cpp or _sim.cpp, in a temporary directory, against stub
+headers standing in for the target ones if it needs any, and runs the result.
+The check scripts only list their sources, stubs and arguments.
+"""
+import argparse
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+ROOT = Path(__file__).resolve().parent.parent
+DRIVERS = ROOT / "lib" / "drivers" / "instances" / "stm32h5xx"
+INCLUDES = [ROOT / "lib" / "drivers" / "include", ROOT / "include"]
+COMMON_FLAGS = ["-O2", "-Wall", "-Wextra"]
+
+
+def argument_parser(doc):
+    """Parser for the options of a check: --cxx plus its own."""
+    parser = argparse.ArgumentParser(description=doc.splitlines()[0])
+    parser.add_argument("--cxx", default="c++", help="host C++20 compiler")
+    return parser
+
+
+def build(tmp, name, sources, cxx, includes=INCLUDES, stubs=None, flags=(), c_sources=(),
+          cc="cc"):
+    """Builds `name` in `tmp` and returns the path of the binary.
+
+    `stubs` maps header names to the text written to `tmp`, which comes first
+    on the include path. `c_sources` are compiled with `cc` as C11 and linked
+    in; `flags` are passed to both compilers.
+    """
+    tmp = Path(tmp)
+    for header, text in (stubs or {}).items():
+        (tmp / header).write_text(text)
+    include_flags = [f"-I{tmp}", *(f"-I{path}" for path in includes)]
+    objects = []
+    for source in c_sources:
+        obj = tmp / (Path(source).stem + ".o")
+        subprocess.run([cc, "-std=c11", *COMMON_FLAGS, *flags, *include_flags,
+                        "-c", str(source), "-o", str(obj)], check=True)
+        objects.append(str(obj))
+    binary = tmp / name
+    subprocess.run([cxx, "-std=c++20", *COMMON_FLAGS, *flags, *include_flags,
+                    *map(str, sources), *objects, "-o", str(binary)], check=True)
+    return binary
+
+
+def build_and_run(name, sources, cxx, args=(), **options):
+    """Builds `name` as build() does, runs it with `args` and exits with its status."""
+    with tempfile.TemporaryDirectory() as tmp:
+        binary = build(tmp, name, sources, cxx, **options)
+        sys.exit(subprocess.run([str(binary), *map(str, args)]).returncode)
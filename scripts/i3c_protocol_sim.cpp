@@ -0,0 +1,705 @@
+// Host check of the I3C controller protocol (lib/drivers/include/i3c.hpp):
+// the real I3cProtocol against a simulated bus of targets. The I3C targets
+// take part in the dynamic address assignment in the order of their 64-bit
+// payload, as the open-drain arbitration decides it, hold a register file,
+// end reads early when told to and raise in-band interrupts between frames;
+// a legacy I2C target sits at its static address. Every frame the protocol
+// asks for is decoded message by message, so the checks see what went on the
+// wire as well as what the transactions report.
+//
+// Each check prints one line and the program fails if any does. Built and
+// run by scripts/check_i3c_protocol.py.
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "i3c.hpp"
+
+using namespace ru::driver;
+
+namespace {
+const uint8_t bcr_ibi_capable = 0x02;
+const uint8_t bcr_ibi_payload = 0x04;
+const size_t hw_ibi_slots = 4;  // DEVR1-4 of the STM32 I3C
+
+struct Target {
+  uint64_t pid = 0;
+  uint8_t bcr = bcr_ibi_capable | bcr_ibi_payload;
+  uint8_t dcr = 0;
+  bool legacy = false;
+  uint8_t static_address = 0;
+  bool present = true;
+
+  uint8_t address = 0;  // dynamic address, 0 without
+  bool events = true;   // ENEC/DISEC interrupt bit
+  size_t read_limit = SIZE_MAX;
+  uint8_t pointer = 0;
+  uint8_t regs[256] = {};
+
+  bool ibi_pending = false;
+  uint8_t ibi_data = 0;
+  uint32_t ibis_sent = 0;  // acknowledged by the controller
+  uint32_t ibis_nacked = 0;
+
+  uint64_t payload() const { return pid << 16 | uint64_t{bcr} << 8 | dcr; }
+  bool answers(uint8_t a) const { return present && (legacy ? static_address : address) == a; }
+};
+
+class Bus : public I3cPort {
+public:
+  std::vector<Target> targets;
+  I3cProtocol* protocol = nullptr;
+  std::mt19937 rng{7};
+  double error_rate = 0;
+
+  size_t frames = 0;
+  std::vector<I3cTransaction*> completed;  // in completion order
+
+  void start_frame(const I3cMessage* messages, size_t count, const uint8_t* tx, size_t tx_len,
+                   uint8_t* rx, size_t rx_len) override {
+    pending = Pending::frame;
+    frame.assign(messages, messages + count);
+    frame_tx = tx;
+    frame_tx_len = tx_len;
+    frame_rx = rx;
+    frame_rx_len = rx_len;
+  }
+
+  void start_daa() override { pending = Pending::daa; }
+
+  bool set_ibi(uint8_t address, bool accept, bool payload) override {
+    auto slot = std::find_if(slots.begin(), slots.end(),
+                             [&](const IbiSlot& s) { return s.address == address; });
+    if (!accept) {
+      if (slot != slots.end()) {
+        slots.erase(slot);
+      }
+      return true;
+    }
+    if (slot != slots.end()) {
+      slot->payload = payload;
+      return true;
+    }
+    if (slots.size() == hw_ibi_slots) {
+      return false;
+    }
+    slots.push_back({address, payload});
+    return true;
+  }
+
+  // Runs the bus until the queue is empty; IBIs win the bus before each frame
+  void run() {
+    while (pending != Pending::none) {
+      deliver_ibis();
+      const Pending op = pending;
+      pending = Pending::none;
+      I3cTransaction* done = op == Pending::daa ? run_daa() : run_frame();
+      while (done) {
+        I3cTransaction* next = done->next;
+        completed.push_back(done);
+        if (done->callback) {
+          done->callback(*done, done->ctx);
+        }
+        done = next;
+      }
+    }
+    deliver_ibis();
+  }
+
+  Target* find(uint8_t address) {
+    for (Target& t : targets) {
+      if (t.answers(address)) {
+        return &t;
+      }
+    }
+    return nullptr;
+  }
+
+private:
+  enum class Pending { none, frame, daa };
+  struct IbiSlot {
+    uint8_t address;
+    bool payload;
+  };
+
+  Pending pending = Pending::none;
+  std::vector<I3cMessage> frame;
+  const uint8_t* frame_tx = nullptr;
+  size_t frame_tx_len = 0;
+  uint8_t* frame_rx = nullptr;
+  size_t frame_rx_len = 0;
+  std::vector<IbiSlot> slots;
+
+  bool chance(double p) { return p > 0 && std::uniform_real_distribution<>(0, 1)(rng) < p; }
+
+  // Lowest address first, as the arbitration on the address header goes
+  void deliver_ibis() {
+    std::vector<Target*> raising;
+    for (Target& t : targets) {
+      if (t.present && !t.legacy && t.address && t.events && t.ibi_pending &&
+          (t.bcr & bcr_ibi_capable)) {
+        raising.push_back(&t);
+      }
+    }
+    std::sort(raising.begin(), raising.end(),
+              [](const Target* a, const Target* b) { return a->address < b->address; });
+    for (Target* t : raising) {
+      t->ibi_pending = false;
+      auto slot = std::find_if(slots.begin(), slots.end(),
+                               [&](const IbiSlot& s) { return s.address == t->address; });
+      if (slot == slots.end()) {
+        ++t->ibis_nacked;
+        continue;
+      }
+      ++t->ibis_sent;
+      const uint8_t payload[2] = {t->ibi_data, static_cast<uint8_t>(~t->ibi_data)};
+      const bool with_payload = slot->payload && (t->bcr & bcr_ibi_payload);
+      protocol->ibi(t->address, payload, with_payload ? 2 : 0, frames);
+    }
+  }
+
+  I3cTransaction* run_daa() {
+    ++frames;
+    std::vector<Target*> waiting;
+    for (Target& t : targets) {
+      if (t.present && !t.legacy && !t.address) {
+        waiting.push_back(&t);
+      }
+    }
+    std::sort(waiting.begin(), waiting.end(),
+              [](const Target* a, const Target* b) { return a->payload() < b->payload(); });
+    for (Target* t : waiting) {
+      const uint8_t address = protocol->daa_payload(t->pid, t->bcr, t->dcr);
+      if (!address) {
+        break;
+      }
+      t->address = address;
+    }
+    // The H5 reports the final NACK as a completed frame; other controllers
+    // as a NACK
+    return protocol->frame_done(
+        chance(0.5) ? I3cFrameOutcome::done : I3cFrameOutcome::nack, 0);
+  }
+
+  I3cTransaction* run_frame() {
+    ++frames;
+    size_t tx_pos = 0;
+    size_t rx_count = 0;
+    uint8_t ccc = 0;
+    for (const I3cMessage& m : frame) {
+      if (chance(error_rate)) {
+        return protocol->frame_done(I3cFrameOutcome::error, rx_count);
+      }
+      if (m.type == I3cMessageType::ccc) {
+        ccc = m.ccc;
+        const bool any = std::any_of(targets.begin(), targets.end(), [](const Target& t) {
+          return t.present && !t.legacy;
+        });
+        if (m.address != 0x7E || !any) {
+          return protocol->frame_done(I3cFrameOutcome::nack, rx_count);
+        }
+        broadcast(ccc, frame_tx + tx_pos, m.len);
+        tx_pos += m.len;
+        continue;
+      }
+
+      Target* t = find(m.address);
+      const bool legacy = m.type == I3cMessageType::legacy_i2c;
+      if (!t || t->legacy != legacy) {
+        return protocol->frame_done(I3cFrameOutcome::nack, rx_count);
+      }
+      if (m.type == I3cMessageType::direct) {
+        if (m.read) {
+          rx_count = direct_read(*t, ccc, m.len);
+        } else {
+          direct_write(*t, ccc, frame_tx + tx_pos, m.len);
+          tx_pos += m.len;
+        }
+      } else if (m.read) {
+        // Only an I3C target can end a read before the controller does
+        const size_t len = legacy ? m.len : std::min<size_t>(m.len, t->read_limit);
+        for (size_t i = 0; i < len; ++i) {
+          frame_rx[i] = t->regs[t->pointer++];
+        }
+        rx_count = len;
+      } else {
+        t->pointer = frame_tx[tx_pos];
+        for (size_t i = 1; i < m.len; ++i) {
+          t->regs[t->pointer++] = frame_tx[tx_pos + i];
+        }
+        tx_pos += m.len;
+      }
+    }
+    if (tx_pos != frame_tx_len || rx_count > frame_rx_len) {
+      std::printf("  frame data mismatch: tx %zu of %zu, rx %zu of %zu\n", tx_pos, frame_tx_len,
+                  rx_count, frame_rx_len);
+      std::exit(EXIT_FAILURE);
+    }
+    return protocol->frame_done(I3cFrameOutcome::done, rx_count);
+  }
+
+  void broadcast(uint8_t ccc, const uint8_t* data, size_t len) {
+    for (Target& t : targets) {
+      if (!t.present || t.legacy) {
+        continue;
+      }
+      if (ccc == i3c_ccc::rstdaa) {
+        t.address = 0;
+      } else if (len && (ccc == i3c_ccc::enec || ccc == i3c_ccc::disec) &&
+                 (data[0] & i3c_ccc::event_interrupt)) {
+        t.events = ccc == i3c_ccc::enec;
+      }
+    }
+  }
+
+  void direct_write(Target& t, uint8_t ccc, const uint8_t* data, size_t len) {
+    if (len && (ccc == i3c_ccc::enec_direct || ccc == i3c_ccc::disec_direct) &&
+        (data[0] & i3c_ccc::event_interrupt)) {
+      t.events = ccc == i3c_ccc::enec_direct;
+    }
+  }
+
+  size_t direct_read(Target& t, uint8_t ccc, size_t len) {
+    uint8_t out[8] = {};
+    size_t n = 0;
+    if (ccc == i3c_ccc::getpid) {
+      for (; n < 6; ++n) {
+        out[n] = static_cast<uint8_t>(t.pid >> (40 - 8 * n));
+      }
+    } else if (ccc == i3c_ccc::getbcr) {
+      out[n++] = t.bcr;
+    } else if (ccc == i3c_ccc::getdcr) {
+      out[n++] = t.dcr;
+    } else if (ccc == i3c_ccc::getstatus) {
+      out[n++] = t.ibi_pending ? 1 : 0;
+      out[n++] = 0;
+    }
+    n = std::min(n, len);
+    std::memcpy(frame_rx, out, n);
+    return n;
+  }
+};
+
+bool report(const char* name, bool ok, const char* detail = "") {
+  std::printf("%-36s %s%s%s\n", name, ok ? "ok" : "FAIL", *detail ? "  " : "", detail);
+  return ok;
+}
+
+Target i3c_target(uint64_t pid, uint8_t dcr) {
+  Target t;
+  t.pid = pid;
+  t.dcr = dcr;
+  for (size_t i = 0; i < sizeof(t.regs); ++i) {
+    t.regs[i] = static_cast<uint8_t>(pid * 13 + i * 7);
+  }
+  return t;
+}
+
+// A bus of four listed I3C targets, one unlisted, one legacy I2C device;
+// the protocol with its table, before any assignment
+struct Fixture {
+  Bus bus;
+  I3cProtocol protocol{bus};
+  I3cDevice gyro, accel, baro, mag, eeprom;
+
+  Fixture() {
+    bus.protocol = &protocol;
+    bus.targets.push_back(i3c_target(0x0208A0001234, 0x40));  // gyro
+    bus.targets.push_back(i3c_target(0x0208A0001233, 0x41));  // accel, wins arbitration
+    bus.targets.push_back(i3c_target(0x04A1B0000001, 0x42));  // baro
+    bus.targets.push_back(i3c_target(0x0130C0000777, 0x43));  // mag
+    bus.targets.push_back(i3c_target(0x07FF00000042, 0x44));  // unlisted
+    Target eeprom_target;
+    eeprom_target.legacy = true;
+    eeprom_target.static_address = 0x50;
+    bus.targets.push_back(eeprom_target);
+
+    gyro = protocol.add_device(0x0208A0001234, 0x30);
+    accel = protocol.add_device(0x0208A0001233, 0);
+    baro = protocol.add_device(0x04A1B0000001, 0x09);
+    mag = protocol.add_device(0x0130C0000777, 0);
+    eeprom = protocol.add_i2c_device(0x50);
+  }
+
+  Target& target(I3cDevice device) { return bus.targets[device == eeprom ? 5 : device]; }
+
+  size_t assign() {
+    I3cTransaction daa{};
+    daa.device = I3cProtocol::broadcast;
+    daa.ccc = i3c_ccc::entdaa;
+    if (!protocol.submit(daa)) {
+      return SIZE_MAX;
+    }
+    bus.run();
+    return daa.status == I3cStatus::done ? daa.rx_count : SIZE_MAX;
+  }
+};
+
+I3cTransaction private_transfer(I3cDevice device, const uint8_t* tx, uint16_t tx_len,
+                                uint8_t* rx, uint16_t rx_len) {
+  I3cTransaction t{};
+  t.device = device;
+  t.ccc = I3cProtocol::no_ccc;
+  t.tx = tx;
+  t.tx_len = tx_len;
+  t.rx = rx;
+  t.rx_len = rx_len;
+  return t;
+}
+
+bool check_table() {
+  Fixture f;
+  bool ok = f.gyro == 0 && f.accel == 1 && f.baro == 2 && f.mag == 3 && f.eeprom == 4;
+  // Reserved, taken, duplicate
+  ok = ok && f.protocol.add_device(0x111111111111, 0x3E) == I3cProtocol::max_devices;
+  ok = ok && f.protocol.add_device(0x111111111111, 0x7E) == I3cProtocol::max_devices;
+  ok = ok && f.protocol.add_device(0x111111111111, 0x50) == I3cProtocol::max_devices;
+  ok = ok && f.protocol.add_device(0x111111111111, 0x30) == I3cProtocol::max_devices;
+  ok = ok && f.protocol.add_device(0x0208A0001234, 0) == I3cProtocol::max_devices;
+  ok = ok && f.protocol.add_i2c_device(0x09) == I3cProtocol::max_devices;
+  ok = ok && f.protocol.add_i2c_device(0x04) == I3cProtocol::max_devices;
+  // No address yet: private transfers are refused
+  uint8_t byte = 0;
+  I3cTransaction t = private_transfer(f.gyro, &byte, 1, nullptr, 0);
+  ok = ok && !f.protocol.submit(t);
+  // The I2C device is reachable at once
+  t = private_transfer(f.eeprom, &byte, 1, nullptr, 0);
+  ok = ok && f.protocol.submit(t);
+  f.bus.run();
+  ok = ok && t.status == I3cStatus::done;
+  // Table full
+  for (uint64_t pid = 1; f.protocol.device_count() < I3cProtocol::max_devices; ++pid) {
+    ok = ok && f.protocol.add_device(pid, 0) != I3cProtocol::max_devices;
+  }
+  ok = ok && f.protocol.add_device(0x222222222222, 0) == I3cProtocol::max_devices;
+  return report("device table", ok);
+}
+
+bool check_assignment() {
+  Fixture f;
+  const size_t assigned = f.assign();
+  bool ok = assigned == 5;
+  std::vector<uint8_t> used;
+  for (I3cDevice d = 0; d < 4; ++d) {
+    const I3cDeviceInfo& info = f.protocol.info(d);
+    const Target& t = f.target(d);
+    ok = ok && info.address && info.address == t.address && info.bcr == t.bcr &&
+         info.dcr == t.dcr && info.pid == t.pid;
+    used.push_back(t.address);
+  }
+  used.push_back(f.bus.targets[4].address);
+  used.push_back(0x50);
+  ok = ok && f.target(f.gyro).address == 0x30 && f.target(f.baro).address == 0x09;
+  std::sort(used.begin(), used.end());
+  ok = ok && std::adjacent_find(used.begin(), used.end()) == used.end() && used.front() >= 0x08;
+  ok = ok && f.protocol.stats().daa_targets == 5 && f.protocol.stats().unknown_targets == 1;
+
+  // A second assignment gives the same addresses
+  const uint8_t mag_address = f.target(f.mag).address;
+  ok = ok && f.assign() == 5 && f.target(f.mag).address == mag_address;
+  char detail[96];
+  std::snprintf(detail, sizeof(detail), "accel 0x%02X gyro 0x%02X baro 0x%02X mag 0x%02X",
+                f.target(f.accel).address, f.target(f.gyro).address, f.target(f.baro).address,
+                f.target(f.mag).address);
+  return report("dynamic address assignment", ok, detail);
+}
+
+// Random private transfers to every device, checked against a shadow of the
+// register files; reads may be ended early by the I3C targets
+bool check_transfers(size_t rounds) {
+  Fixture f;
+  bool ok = f.assign() == 5;
+  std::mt19937 rng(11);
+  uint8_t shadow[5][256];
+  for (I3cDevice d = 0; d < 5; ++d) {
+    std::memcpy(shadow[d], f.target(d).regs, 256);
+  }
+
+  struct Job {
+    I3cTransaction t;
+    uint8_t tx[33];
+    uint8_t rx[32];
+    uint8_t reg;
+    size_t expected_rx;
+  };
+  size_t early = 0;
+  for (size_t round = 0; round < rounds; ++round) {
+    std::vector<Job> jobs(1 + rng() % 6);
+    f.bus.completed.clear();
+    for (Job& job : jobs) {
+      const auto device = static_cast<I3cDevice>(rng() % 5);
+      Target& target = f.target(device);
+      target.read_limit = device != f.eeprom && rng() % 4 == 0 ? rng() % 8 : SIZE_MAX;
+      const uint16_t tx_len = static_cast<uint16_t>(rng() % 3 == 0 ? 0 : 1 + rng() % 32);
+      const uint16_t rx_len = static_cast<uint16_t>(tx_len && rng() % 2 ? 0 : 1 + rng() % 32);
+      job.reg = static_cast<uint8_t>(rng());
+      job.tx[0] = job.reg;
+      for (size_t i = 1; i < tx_len; ++i) {
+        job.tx[i] = static_cast<uint8_t>(rng());
+      }
+      job.t = private_transfer(device, job.tx, tx_len, job.rx, rx_len);
+    }
+    // All queued before the bus runs: the limits apply per target, so each
+    // job sees the register pointer its predecessors left
+    for (Job& job : jobs) {
+      ok = ok && f.protocol.submit(job.t);
+    }
+    uint8_t pointer[5];
+    for (I3cDevice d = 0; d < 5; ++d) {
+      pointer[d] = f.target(d).pointer;
+    }
+    std::vector<size_t> limits(5);
+    for (I3cDevice d = 0; d < 5; ++d) {
+      limits[d] = f.target(d).read_limit;
+    }
+    f.bus.run();
+
+    ok = ok && f.bus.completed.size() == jobs.size();
+    for (size_t i = 0; i < jobs.size() && ok; ++i) {
+      Job& job = jobs[i];
+      const I3cTransaction& t = job.t;
+      ok = ok && f.bus.completed[i] == &job.t && t.status == I3cStatus::done;
+      uint8_t& ptr = pointer[t.device];
+      if (t.tx_len) {
+        ptr = job.reg;
+        for (size_t k = 1; k < t.tx_len; ++k) {
+          shadow[t.device][ptr++] = job.tx[k];
+        }
+      }
+      const size_t expected = std::min<size_t>(t.rx_len, limits[t.device]);
+      ok = ok && t.rx_count == expected;
+      early += expected < t.rx_len;
+      for (size_t k = 0; k < t.rx_count && ok; ++k) {
+        ok = shadow[t.device][ptr++] == job.rx[k];
+      }
+    }
+  }
+  char detail[64];
+  std::snprintf(detail, sizeof(detail), "%zu rounds, %zu reads ended early", rounds, early);
+  return report("private and legacy transfers", ok, detail);
+}
+
+bool check_ccc() {
+  Fixture f;
+  bool ok = f.assign() == 5;
+  uint8_t pid[6] = {};
+  I3cTransaction t{};
+  t.device = f.baro;
+  t.ccc = i3c_ccc::getpid;
+  t.rx = pid;
+  t.rx_len = 6;
+  ok = ok && f.protocol.submit(t);
+  f.bus.run();
+  uint64_t read = 0;
+  for (uint8_t b : pid) {
+    read = read << 8 | b;
+  }
+  ok = ok && t.status == I3cStatus::done && t.rx_count == 6 && read == f.target(f.baro).pid;
+
+  const uint8_t events = i3c_ccc::event_interrupt;
+  t = {};
+  t.device = I3cProtocol::broadcast;
+  t.ccc = i3c_ccc::disec;
+  t.tx = &events;
+  t.tx_len = 1;
+  ok = ok && f.protocol.submit(t);
+  f.bus.run();
+  ok = ok && t.status == I3cStatus::done && !f.target(f.gyro).events && !f.target(f.mag).events;
+
+  t = {};
+  t.device = f.gyro;
+  t.ccc = i3c_ccc::enec_direct;
+  t.tx = &events;
+  t.tx_len = 1;
+  ok = ok && f.protocol.submit(t);
+  f.bus.run();
+  ok = ok && t.status == I3cStatus::done && f.target(f.gyro).events && !f.target(f.mag).events;
+
+  // Refused: a direct CCC to the I2C device, read and write at once,
+  // a broadcast code sent direct
+  uint8_t byte = 0;
+  t = {};
+  t.device = f.eeprom;
+  t.ccc = i3c_ccc::getstatus;
+  t.rx = &byte;
+  t.rx_len = 1;
+  ok = ok && !f.protocol.submit(t);
+  t.device = f.gyro;
+  t.tx = &byte;
+  t.tx_len = 1;
+  ok = ok && !f.protocol.submit(t);
+  t.ccc = i3c_ccc::enec;
+  t.rx_len = 0;
+  ok = ok && !f.protocol.submit(t);
+  return report("common command codes", ok);
+}
+
+struct Resubmit {
+  I3cProtocol* protocol;
+  size_t left;
+  size_t calls;
+};
+
+void resubmit(I3cTransaction& transaction, void* ctx) {
+  auto* r = static_cast<Resubmit*>(ctx);
+  ++r->calls;
+  if (r->left && r->left--) {
+    (void)r->protocol->submit(transaction);
+  }
+}
+
+bool check_errors() {
+  Fixture f;
+  bool ok = f.assign() == 5;
+  uint8_t buf[4] = {1, 2, 3, 4};
+
+  // A target gone: NACK, and the queue goes on
+  f.target(f.mag).present = false;
+  I3cTransaction a = private_transfer(f.mag, buf, 2, nullptr, 0);
+  I3cTransaction b = private_transfer(f.gyro, buf, 2, nullptr, 0);
+  ok = ok && f.protocol.submit(a) && f.protocol.submit(b);
+  f.bus.run();
+  ok = ok && a.status == I3cStatus::nack && b.status == I3cStatus::done;
+
+  // The next assignment leaves it without an address: a transaction queued
+  // behind the assignment ends NACKed without a frame
+  I3cTransaction daa{};
+  daa.device = I3cProtocol::broadcast;
+  daa.ccc = i3c_ccc::entdaa;
+  a = private_transfer(f.mag, buf, 2, nullptr, 0);
+  I3cTransaction c = private_transfer(f.gyro, buf, 1, nullptr, 0);
+  const size_t frames = f.bus.frames;
+  f.bus.completed.clear();
+  ok = ok && f.protocol.submit(b) && f.protocol.submit(daa) && f.protocol.submit(a) &&
+       f.protocol.submit(c);
+  f.bus.run();
+  ok = ok && daa.status == I3cStatus::done && daa.rx_count == 4 && a.status == I3cStatus::nack &&
+       c.status == I3cStatus::done && f.bus.frames == frames + 4 &&
+       f.bus.completed.size() == 4 && f.bus.completed[2] == &a;
+  // Refused from then on
+  ok = ok && !f.protocol.submit(a);
+
+  // Protocol errors fail the transaction at hand only
+  f.bus.error_rate = 0.2;
+  size_t failed = 0;
+  size_t done = 0;
+  for (size_t i = 0; i < 500; ++i) {
+    I3cTransaction t = private_transfer(f.accel, buf, 2, buf + 2, 2);
+    ok = ok && f.protocol.submit(t);
+    f.bus.run();
+    failed += t.status == I3cStatus::failed;
+    done += t.status == I3cStatus::done;
+  }
+  ok = ok && failed + done == 500 && failed > 50 && done > 300;
+  ok = ok && f.protocol.stats().errors == failed;
+  f.bus.error_rate = 0;
+
+  // Resubmitted from its callback, with another transaction queued
+  Resubmit r{&f.protocol, 20, 0};
+  c = private_transfer(f.gyro, buf, 1, buf + 1, 3);
+  c.callback = resubmit;
+  c.ctx = &r;
+  I3cTransaction d = private_transfer(f.baro, buf, 2, nullptr, 0);
+  f.bus.completed.clear();
+  ok = ok && f.protocol.submit(c) && f.protocol.submit(d);
+  f.bus.run();
+  ok = ok && r.calls == 21 && c.status == I3cStatus::done && f.bus.completed.size() == 22 &&
+       f.bus.completed[1] == &d;
+  return report("NACKs, errors and resubmission", ok);
+}
+
+bool check_ibis() {
+  Fixture f;
+  bool ok = f.assign() == 5;
+  // Acknowledged for gyro and baro only; the mag ones are NACKed. The
+  // controller tracks four addresses.
+  ok = ok && f.protocol.accept_ibi(f.gyro, true) && f.protocol.accept_ibi(f.baro, true);
+  ok = ok && !f.protocol.accept_ibi(f.eeprom, true);
+
+  std::mt19937 rng(5);
+  uint32_t gyro_taken = 0;
+  I3cIbi ibi{};
+  uint8_t buf[2] = {0x10, 0};
+  for (size_t i = 0; i < 2000; ++i) {
+    for (I3cDevice d : {f.gyro, f.baro, f.mag}) {
+      Target& t = f.target(d);
+      if (rng() % 3 == 0) {
+        t.ibi_pending = true;
+        t.ibi_data = static_cast<uint8_t>(rng());
+      }
+    }
+    I3cTransaction t = private_transfer(f.accel, buf, 1, buf + 1, 1);
+    ok = ok && f.protocol.submit(t);
+    f.bus.run();
+    if (rng() % 2 && f.protocol.take_ibi(f.gyro, ibi)) {
+      const Target& gyro = f.target(f.gyro);
+      ok = ok && ibi.count > gyro_taken && ibi.count == gyro.ibis_sent &&
+           ibi.payload_len == 2 && ibi.payload[0] == gyro.ibi_data &&
+           ibi.payload[1] == static_cast<uint8_t>(~gyro.ibi_data);
+      gyro_taken = ibi.count;
+      ok = ok && !f.protocol.take_ibi(f.gyro, ibi);
+    }
+  }
+  const Target& gyro = f.target(f.gyro);
+  const Target& baro = f.target(f.baro);
+  const Target& mag = f.target(f.mag);
+  ok = ok && gyro.ibis_sent > 500 && baro.ibis_sent > 500 && mag.ibis_sent == 0 &&
+       mag.ibis_nacked > 500 && gyro.ibis_nacked == 0;
+  ok = ok && f.protocol.stats().ibis == gyro.ibis_sent + baro.ibis_sent &&
+       f.protocol.stats().unknown_ibis == 0;
+
+  // Still acknowledged after a new assignment, at the new addresses
+  f.target(f.baro).present = false;
+  ok = ok && f.assign() == 4;
+  f.target(f.baro).present = true;
+  ok = ok && f.assign() == 5;
+  f.target(f.baro).ibi_pending = true;
+  f.target(f.gyro).ibi_pending = true;
+  I3cTransaction t = private_transfer(f.accel, buf, 1, nullptr, 0);
+  ok = ok && f.protocol.submit(t);
+  f.bus.run();
+  ok = ok && f.target(f.baro).ibis_nacked == 0 && f.target(f.gyro).ibis_nacked == 0;
+
+  // Stops acknowledging once disabled
+  ok = ok && f.protocol.accept_ibi(f.gyro, false);
+  f.target(f.gyro).ibi_pending = true;
+  ok = ok && f.protocol.submit(t);
+  f.bus.run();
+  ok = ok && f.target(f.gyro).ibis_nacked == 1;
+
+  char detail[96];
+  std::snprintf(detail, sizeof(detail), "gyro %u baro %u acknowledged, mag %u NACKed",
+                gyro.ibis_sent, baro.ibis_sent, mag.ibis_nacked);
+  return report("in-band interrupts", ok, detail);
+}
+
+bool check_ibi_slots() {
+  Fixture f;
+  // Four slots, the fifth accepted IBI address does not fit
+  bool ok = f.assign() == 5;
+  const I3cDevice extra = f.protocol.add_device(0x07FF00000042, 0);
+  ok = ok && f.assign() == 5 && f.protocol.stats().unknown_targets == 0;
+  ok = ok && f.protocol.accept_ibi(f.gyro, true) && f.protocol.accept_ibi(f.accel, true) &&
+       f.protocol.accept_ibi(f.baro, true) && f.protocol.accept_ibi(f.mag, true);
+  ok = ok && !f.protocol.accept_ibi(extra, true);
+  ok = ok && f.protocol.accept_ibi(f.mag, false) && f.protocol.accept_ibi(extra, true);
+  return report("controller IBI slots", ok);
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  const size_t rounds = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 2000;
+
+  bool ok = check_table();
+  ok = check_assignment() && ok;
+  ok = check_transfers(rounds) && ok;
+  ok = check_ccc() && ok;
+  ok = check_errors() && ok;
+  ok = check_ibis() && ok;
+  ok = check_ibi_slots() && ok;
+  std::printf("%s\n", ok ? "all checks ok" : "FAILED");
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
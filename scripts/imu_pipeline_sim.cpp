@@ -0,0 +1,323 @@
+// Host simulation of the IMU acquisition pipeline (lib/drivers/include/imu.hpp):
+// the real ImuCapture driven by a discrete-event model of the sensor, the
+// EXTI and DMA interrupt latencies, a shared SPI bus and a consumer task.
+// Every sample carries the index of the sensor reading it was read from, so
+// the consumer checks the content and order of each one, and the loss
+// counters are compared with the sensor's own count at the end.
+//
+// The nominal cases must lose nothing; the stress cases (a stalled consumer, a
+// bus too slow for the rate, late interrupts, bus errors) must lose samples
+// and account for every one of them. Built and run by
+// scripts/check_imu_pipeline.py.
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "imu.hpp"
+
+using namespace ru::driver;
+
+namespace {
+const double cpu_hz = 250e6;
+
+TimerInstant cycles(double us) {
+  return static_cast<TimerInstant>(us * cpu_hz / 1e6);
+}
+
+double micros(TimerInstant cycles) {
+  return static_cast<double>(cycles) * 1e6 / cpu_hz;
+}
+
+struct Scenario {
+  const char* name;
+  bool lossless;           // nominal: no loss allowed; stress: loss required
+  double rate_hz = 8000;
+  double drift_ppm = 150;  // sensor clock against the CPU one
+  size_t sample_bytes = 14;
+  double spi_hz = 12.5e6;
+  double seconds = 2;
+  // Interrupt entry latencies, uniform in [min, max], and rare long ones
+  double exti_min_us = 0.2, exti_max_us = 1.5;
+  double exti_stall_us = 20, exti_stall_rate = 1e-3;
+  double dma_min_us = 0.2, dma_max_us = 3;
+  // Another device on the bus: a transaction of other_us every other_period_us
+  double other_us = 25, other_period_us = 1000;
+  double bus_error_rate = 0;
+  // Consumer: scheduling delay after its wake-up, time to process a batch,
+  // and rare preemptions by higher priority tasks
+  size_t batch = 8;
+  double wake_min_us = 5, wake_max_us = 60;
+  double process_us = 40;
+  double stall_us = 3000, stall_rate = 2e-3;
+};
+
+enum class EventType { edge, exti, other, burst_done, consume, resume };
+
+struct Event {
+  TimerInstant time;
+  uint64_t order;
+  EventType type;
+  bool operator>(const Event& other) const {
+    return time != other.time ? time > other.time : order > other.order;
+  }
+};
+
+struct Result {
+  uint64_t edges = 0;
+  uint64_t consumed = 0;
+  uint64_t errors = 0;
+  double worst_ring_us = 0;      // edge to sample in the ring
+  double worst_consumer_us = 0;  // edge to sample handed to the consumer
+  size_t worst_fill = 0;
+};
+
+class Simulation {
+public:
+  explicit Simulation(const Scenario& s) : s(s), rng(2024) {}
+
+  Result run() {
+    period = s.rate_hz ? cycles(1e6 / s.rate_hz) : 1;
+    sensor_period = 1e6 / s.rate_hz * (1 + s.drift_ppm * 1e-6);
+    capture->reset(period, s.sample_bytes);
+    const auto last_edge = static_cast<uint64_t>(s.seconds * s.rate_hz);
+
+    schedule(edge_time(1), EventType::edge);
+    schedule(cycles(s.other_period_us / 3), EventType::other);
+    while (!events.empty()) {
+      const Event e = events.top();
+      events.pop();
+      now = e.time;
+      switch (e.type) {
+      case EventType::edge:
+        on_edge();
+        if (sensor_index < last_edge) {
+          schedule(edge_time(sensor_index + 1), EventType::edge);
+        }
+        break;
+      case EventType::exti:
+        on_exti();
+        break;
+      case EventType::other:
+        bus_request(cycles(s.other_us));
+        if (sensor_index < last_edge) {
+          schedule(now + cycles(s.other_period_us), EventType::other);
+        }
+        break;
+      case EventType::burst_done:
+        on_burst_done();
+        break;
+      case EventType::consume:
+        on_consume();
+        break;
+      case EventType::resume:
+        on_resume();
+        break;
+      }
+    }
+    // What the consumer has not taken yet
+    while (capture->available()) {
+      on_consume();
+    }
+    result.edges = sensor_index;
+    return result;
+  }
+
+  const ImuStats& stats() const { return capture->stats(); }
+
+private:
+  const Scenario& s;
+  std::mt19937_64 rng;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+  uint64_t order = 0;
+  TimerInstant now = 0;
+  TimerInstant period = 1;
+  double sensor_period = 1;  // us
+
+  // Large ring: on the heap
+  std::unique_ptr<ImuCapture> capture = std::make_unique<ImuCapture>();
+
+  uint64_t sensor_index = 0;  // last reading the sensor produced, from 1
+  bool exti_pending = false;
+  TimerInstant bus_free = 0;
+  uint8_t read_data[ImuSample::max_bytes] = {};
+  uint64_t read_reading = 0;
+  bool read_ok = true;
+  bool consumer_waiting = true;
+  int64_t last_sequence = -1;
+  TimerInstant last_timestamp = 0;
+  Result result;
+
+  double uniform(double lo, double hi) {
+    return std::uniform_real_distribution<double>(lo, hi)(rng);
+  }
+  bool chance(double p) { return p > 0 && uniform(0, 1) < p; }
+
+  void schedule(TimerInstant time, EventType type) { events.push({time, order++, type}); }
+
+  TimerInstant edge_time(uint64_t index) const {
+    return cycles(static_cast<double>(index) * sensor_period);
+  }
+
+  // The sensor holds its latest reading in its data registers
+  static uint8_t data_byte(uint64_t index, size_t i) {
+    return static_cast<uint8_t>(i < 4 ? index >> (8 * i) : index * 31 + i);
+  }
+
+  // Pending bit of the EXTI line: an edge while it is set is merged
+  void on_edge() {
+    ++sensor_index;
+    if (exti_pending) {
+      return;
+    }
+    exti_pending = true;
+    double latency = uniform(s.exti_min_us, s.exti_max_us);
+    if (chance(s.exti_stall_rate)) {
+      latency += s.exti_stall_us;
+    }
+    schedule(now + cycles(latency), EventType::exti);
+  }
+
+  // The data-ready callback: GpioEvent timestamp at the handler entry
+  void on_exti() {
+    exti_pending = false;
+    if (!capture->data_ready(now)) {
+      return;
+    }
+    // Submit, DMA set up: about a microsecond; then the command byte and the
+    // sample, after any transaction ahead on the bus
+    const TimerInstant start = bus_request(cycles(1 + (1 + s.sample_bytes) * 8e6 / s.spi_hz));
+    // The registers are read when the sample bytes are clocked out
+    read_reading = static_cast<uint64_t>(micros(start) / sensor_period);
+    for (size_t i = 0; i < s.sample_bytes; ++i) {
+      read_data[i] = data_byte(read_reading, i);
+    }
+    read_ok = !chance(s.bus_error_rate);
+    schedule(bus_free + cycles(uniform(s.dma_min_us, s.dma_max_us)), EventType::burst_done);
+  }
+
+  // FIFO bus: returns when the transaction starts
+  TimerInstant bus_request(TimerInstant duration) {
+    const TimerInstant start = std::max(now, bus_free);
+    bus_free = start + duration;
+    return start;
+  }
+
+  void on_burst_done() {
+    capture->burst_done(read_data, read_ok);
+    result.worst_fill = std::max(result.worst_fill, capture->available());
+    if (read_ok) {
+      result.worst_ring_us =
+          std::max(result.worst_ring_us, micros(now - edge_time(read_reading)));
+    }
+    if (consumer_waiting && capture->available() >= s.batch) {
+      consumer_waiting = false;
+      schedule(now + cycles(uniform(s.wake_min_us, s.wake_max_us)), EventType::consume);
+    }
+  }
+
+  void on_consume() {
+    ImuSample samples[32];
+    const size_t count = capture->pop(samples, 32);
+    for (size_t n = 0; n < count; ++n) {
+      check(samples[n]);
+    }
+    result.consumed += count;
+
+    double busy = s.process_us;
+    if (chance(s.stall_rate)) {
+      busy += s.stall_us;
+    }
+    schedule(now + cycles(busy), EventType::resume);
+  }
+
+  // Back in read_batch after processing the batch
+  void on_resume() {
+    if (capture->available() >= s.batch) {
+      on_consume();
+    } else {
+      consumer_waiting = true;
+    }
+  }
+
+  void check(const ImuSample& sample) {
+    // Sequence 0 is the reading of edge 1
+    const uint64_t reading = sample.sequence + 1;
+    bool ok = static_cast<int64_t>(sample.sequence) > last_sequence &&
+              sample.timestamp >= last_timestamp;
+    for (size_t i = 0; i < s.sample_bytes; ++i) {
+      ok = ok && sample.data[i] == data_byte(reading, i);
+    }
+    if (!ok && result.errors++ < 5) {
+      std::printf("  sample %llu: sequence %u after %lld, reading %u\n",
+                  static_cast<unsigned long long>(result.consumed),
+                  static_cast<unsigned>(sample.sequence), static_cast<long long>(last_sequence),
+                  static_cast<unsigned>(sample.data[0] | sample.data[1] << 8 |
+                                        sample.data[2] << 16 | sample.data[3] << 24));
+    }
+    last_sequence = sample.sequence;
+    last_timestamp = sample.timestamp;
+    result.worst_consumer_us =
+        std::max(result.worst_consumer_us, micros(now - edge_time(reading)));
+  }
+};
+
+bool run(const Scenario& scenario) {
+  Simulation sim(scenario);
+  const Result r = sim.run();
+  const ImuStats& st = sim.stats();
+
+  // Every edge is a sample or a missed one, and the content always matches
+  const uint64_t lost = r.edges - r.consumed;
+  bool ok = r.errors == 0 && st.samples == r.consumed && st.missed == lost;
+  if (scenario.lossless) {
+    ok = ok && lost == 0 && st.overruns == 0 && st.dropped == 0 && st.bus_errors == 0;
+  } else {
+    ok = ok && lost > 0;
+  }
+
+  std::printf("%-24s %7llu edges %7llu samples  missed %5u (overruns %5u dropped %5u bus %3u)"
+              "  ring %6.1f us  consumer %7.1f us  fill %3zu  %s\n",
+              scenario.name, static_cast<unsigned long long>(r.edges),
+              static_cast<unsigned long long>(r.consumed), st.missed, st.overruns, st.dropped,
+              st.bus_errors, r.worst_ring_us, r.worst_consumer_us, r.worst_fill,
+              ok ? "ok" : "FAIL");
+  return ok;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  const double seconds = argc > 1 ? std::atof(argv[1]) : 2;
+
+  std::vector<Scenario> scenarios;
+  scenarios.push_back({"8 kHz", true});
+  scenarios.push_back({"4 kHz", true});
+  scenarios.back().rate_hz = 4000;
+  scenarios.push_back({"8 kHz, 20 bytes, 4 MHz", true});
+  scenarios.back().sample_bytes = 20;
+  scenarios.back().spi_hz = 4e6;
+  scenarios.push_back({"8 kHz, busy bus", true});
+  scenarios.back().other_us = 80;
+  scenarios.back().other_period_us = 500;
+
+  scenarios.push_back({"consumer stalled 30 ms", false});
+  scenarios.back().stall_us = 30000;
+  scenarios.push_back({"bus too slow", false});
+  scenarios.back().spi_hz = 1e6;
+  scenarios.push_back({"late interrupts", false});
+  scenarios.back().exti_stall_us = 300;
+  scenarios.back().exti_stall_rate = 5e-3;
+  scenarios.push_back({"bus errors", false});
+  scenarios.back().bus_error_rate = 1e-3;
+
+  bool ok = true;
+  for (auto& scenario : scenarios) {
+    scenario.seconds = seconds;
+    ok = run(scenario) && ok;
+  }
+  std::printf("%s\n", ok ? "all scenarios ok" : "FAILED");
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+"""Host-side decoder of the interned log stream.
+
+RU_LOG_* (include/debug_log.hpp) keeps its format strings in the non-loaded
+.ru_log_fmt section of the firmware ELF and only sends
+
+    0x00 | COBS(LEB128 string offset | 4-byte little endian arguments) | 0x00
+
+Plain text (printf, log()) goes through unchanged, it never contains a zero byte.
+The interned strings read "<level>|<file>:<line>|<format>"; %s arguments are
+addresses, resolved against the loaded sections of the same ELF.
+
+Usage (capture file, or a serial port already set up with stty):
+
+    python3 scripts/log_decode.py .build-stm32h563vit6x/firmware.elf /dev/ttyACM0
+"""
+import argparse
+import re
+import struct
+import sys
+
+LOG_SECTION = ".ru_log_fmt"
+SHT_NOBITS = 8
+SHF_ALLOC = 0x2
+LEVELS = {"T": "TRACE", "D": "DEBUG", "I": "INFO", "W": "WARN", "E": "ERROR"}
+SPEC = re.compile(r"%([-+ #0]*)(\d*)(?:\.(\d+))?(hh|h|ll|l|z|j|t)?([diouxXcsfFeEgGp%])")
+
+
+class Elf:
+    """Sections of a little endian ELF (32 or 64-bit), enough to read strings."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[5] != 1:
+            raise ValueError(f"{path}: not a little endian ELF file")
+        is64 = self.data[4] == 2
+        if is64:
+            shoff, = struct.unpack_from("<Q", self.data, 0x28)
+            shentsize, shnum, shstrndx = struct.unpack_from("<HHH", self.data, 0x3A)
+            entry = "<IIQQQQ"
+        else:
+            shoff, = struct.unpack_from("<I", self.data, 0x20)
+            shentsize, shnum, shstrndx = struct.unpack_from("<HHH", self.data, 0x2E)
+            entry = "<IIIIII"
+
+        raw = [struct.unpack_from(entry, self.data, shoff + i * shentsize) for i in range(shnum)]
+        names_offset = raw[shstrndx][4]
+        self.sections = []
+        for name, kind, flags, addr, offset, size in raw:
+            end = self.data.index(b"\0", names_offset + name)
+            self.sections.append({
+                "name": self.data[names_offset + name:end].decode(),
+                "type": kind,
+                "flags": flags,
+                "addr": addr,
+                "offset": offset,
+                "size": size,
+            })
+
+    def section(self, name):
+        for sec in self.sections:
+            if sec["name"] == name:
+                return self.data[sec["offset"]:sec["offset"] + sec["size"]]
+        raise ValueError(f"no {name} section: is the firmware using RU_LOG_*?")
+
+    def string_at(self, addr):
+        """NUL-terminated string at a runtime address, or None outside the image."""
+        for sec in self.sections:
+            if (sec["flags"] & SHF_ALLOC and sec["type"] != SHT_NOBITS
+                    and sec["addr"] <= addr < sec["addr"] + sec["size"]):
+                start = sec["offset"] + addr - sec["addr"]
+                end = self.data.find(b"\0", start, sec["offset"] + sec["size"])
+                return self.data[start:end].decode(errors="replace") if end >= 0 else None
+        return None
+
+
+def cobs_decode(frame):
+    out = bytearray()
+    i = 0
+    while i < len(frame):
+        code = frame[i]
+        if code == 0 or i + code > len(frame):
+            return None
+        out += frame[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(frame):
+            out.append(0)
+    return bytes(out)
+
+
+def format_args(fmt, args, elf):
+    """printf on 32-bit argument words, the way the target passes them."""
+    words = iter(args)
+
+    def convert(match):
+        flags, width, prec, length, conv = match.groups()
+        if conv == "%":
+            return "%"
+        word = next(words, None)
+        if word is None:
+            return "<missing>"
+        spec = "%" + flags + width + ("." + prec if prec is not None else "")
+        if conv in "di":
+            bits = {"hh": 8, "h": 16}.get(length, 32)
+            value = word & ((1 << bits) - 1)
+            if value >> (bits - 1):
+                value -= 1 << bits
+            return (spec + "d") % value
+        if conv in "ouxX":
+            return (spec + conv) % word
+        if conv == "c":
+            return (spec + "c") % chr(word & 0xFF)
+        if conv in "fFeEgG":
+            return (spec + conv) % struct.unpack("<f", struct.pack("<I", word))[0]
+        if conv == "p":
+            return "0x%08x" % word
+        text = elf.string_at(word)
+        return (spec + "s") % (text if text is not None else "<0x%08x>" % word)
+
+    return SPEC.sub(convert, fmt)
+
+
+def decode_frame(payload, strings, elf):
+    index = 0
+    shift = 0
+    for pos, byte in enumerate(payload):
+        index |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            break
+    else:
+        return "<truncated log frame>"
+    raw = payload[pos + 1:]
+    if len(raw) % 4 or index >= len(strings):
+        return "<invalid log frame>"
+
+    end = strings.find(b"\0", index)
+    try:
+        if end < 0:
+            raise ValueError
+        level, location, fmt = strings[index:end].decode(errors="replace").split("|", 2)
+    except ValueError:
+        # Not the start of an interned string: another firmware, or corruption
+        return f"<bad index {index}>"
+    args = struct.unpack("<%dI" % (len(raw) // 4), raw)
+    return f"{LEVELS.get(level, level)} {location}: {format_args(fmt, args, elf)}"
+
+
+def decode(stream, elf, out):
+    strings = elf.section(LOG_SECTION)
+    in_frame = False
+    frame = bytearray()
+    while True:
+        chunk = stream.read(1)
+        if not chunk:
+            break
+        byte = chunk[0]
+        if not in_frame:
+            if byte == 0:
+                in_frame = True
+                frame.clear()
+            else:
+                out.write(chr(byte))
+        elif byte == 0:
+            # An empty frame is the opening delimiter of the next one after a
+            # lost closing delimiter: stay in frame
+            if frame:
+                payload = cobs_decode(frame)
+                out.write((decode_frame(payload, strings, elf) if payload else
+                           "<invalid log frame>") + "\n")
+                in_frame = False
+        else:
+            frame.append(byte)
+        out.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="firmware ELF the log stream comes from")
+    parser.add_argument("input", nargs="?", default="-",
+                        help="capture file or serial device (default: stdin)")
+    args = parser.parse_args()
+
+    elf = Elf(args.elf)
+    if args.input == "-":
+        decode(sys.stdin.buffer, elf, sys.stdout)
+    else:
+        with open(args.input, "rb", buffering=0) as stream:
+            decode(stream, elf, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""Flash cost of logging, read from the GNU ld map file of the firmware.
+
+Reports the interned format strings RU_LOG_* keeps in the non-loaded
+.ru_log_fmt section (in the ELF, not in flash), the string literals still in
+flash, and the printf machinery still linked (vfprintf and friends, pulled in
+by printf and log()). Given the map of another build, e.g. one from before a
+module moved to RU_LOG_*, prints both side by side with the difference.
+
+Usage, after a build (the link writes firmware.map next to firmware.elf):
+
+    python3 scripts/log_flash_size.py .build-stm32h563vit6x/firmware.map [baseline.map]
+"""
+import argparse
+import re
+
+# Input section, on one line or with the address and size wrapped to the next
+INPUT_ONE_LINE = re.compile(r"^ (\S+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$")
+INPUT_NAME = re.compile(r"^ (\S+)$")
+INPUT_WRAPPED = re.compile(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$")
+OUTPUT_SECTION = re.compile(r"^(\.\S+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)"
+                            r"(?:\s+load address 0x([0-9a-f]+))?")
+MEMORY = re.compile(r"^(\S+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)")
+
+# Objects of the C library formatted output (newlib, nano or not): vfprintf
+# and its variants, the float conversion and the printf family
+PRINTF = re.compile(r"[(/]lib_?c_a-(nano-)?(\w*printf\w*|dtoa|mprec)\.o\)?$")
+STRINGS = re.compile(r"^\.rodata.*\.str1\.\d+$")
+LOG_STRINGS = re.compile(r"^\.ru_log_fmt(\..*)?$")
+
+
+class MapFile:
+    def __init__(self, path):
+        self.flash = (0x08000000, 0x08000000 + 2 * 1024 * 1024)
+        self.inputs = []
+        self.outputs = []
+        with open(path) as f:
+            lines = f.read().splitlines()
+
+        in_memory = False
+        in_map = False
+        pending = None
+        for line in lines:
+            if line.startswith("Memory Configuration"):
+                in_memory = True
+                continue
+            if line.startswith("Linker script and memory map"):
+                in_memory = False
+                in_map = True
+                continue
+            if in_memory:
+                memory = MEMORY.match(line)
+                if memory and memory.group(1).upper() == "FLASH":
+                    origin = int(memory.group(2), 16)
+                    self.flash = (origin, origin + int(memory.group(3), 16))
+                continue
+            if not in_map:
+                continue
+
+            output = OUTPUT_SECTION.match(line)
+            if output:
+                name, addr, size, load = output.groups()
+                self.outputs.append((name, int(addr, 16), int(size, 16),
+                                     int(load, 16) if load else None))
+                continue
+            if pending:
+                wrapped = INPUT_WRAPPED.match(line)
+                if wrapped:
+                    self.inputs.append((pending, int(wrapped.group(1), 16),
+                                        int(wrapped.group(2), 16), wrapped.group(3)))
+                pending = None
+                continue
+            one_line = INPUT_ONE_LINE.match(line)
+            if one_line:
+                name, addr, size, obj = one_line.groups()
+                self.inputs.append((name, int(addr, 16), int(size, 16), obj))
+                continue
+            name = INPUT_NAME.match(line)
+            if name and not name.group(1).startswith("*"):
+                pending = name.group(1)
+
+    def in_flash(self, addr):
+        return self.flash[0] <= addr < self.flash[1]
+
+    def flash_used(self):
+        used = 0
+        for name, addr, size, load in self.outputs:
+            if self.in_flash(addr) or (load is not None and self.in_flash(load)):
+                used += size
+        return used
+
+    def matching(self, pattern, flash_only=True, by_object=False):
+        return [(obj if by_object else name, size) for name, addr, size, obj in self.inputs
+                if size and pattern.search(obj if by_object else name)
+                and (not flash_only or self.in_flash(addr))]
+
+    def printf_objects(self):
+        sizes = {}
+        for obj, size in self.matching(PRINTF, by_object=True):
+            obj = re.split(r"[(/]", obj.rstrip(")"))[-1]
+            sizes[obj] = sizes.get(obj, 0) + size
+        return sizes
+
+    def figures(self):
+        log_strings = self.matching(LOG_STRINGS, flash_only=False)
+        return {
+            "flash used": self.flash_used(),
+            "string literals in flash": sum(size for _, size in self.matching(STRINGS)),
+            "printf machinery": sum(self.printf_objects().values()),
+            "interned strings (ELF only)": sum(size for _, size in log_strings),
+            "interned call sites": len(log_strings),
+        }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("map", help="map file of the build to measure")
+    parser.add_argument("baseline", nargs="?", help="map file of another build to compare with")
+    args = parser.parse_args()
+
+    current = MapFile(args.map)
+    figures = current.figures()
+    if args.baseline:
+        baseline = MapFile(args.baseline).figures()
+        print(f"{'':28} {'this map':>10} {'baseline':>10} {'delta':>8}")
+        for key, value in figures.items():
+            print(f"{key:28} {value:>10} {baseline[key]:>10} {value - baseline[key]:>+8}")
+    else:
+        for key, value in figures.items():
+            print(f"{key:28} {value:>10}")
+
+    print()
+    for name, size in sorted(current.printf_objects().items(), key=lambda item: -item[1]):
+        print(f"{name:40} {size:>8}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,273 @@
+// Host stress test of the deferred logging ring (lib/drivers/include/log_backend.hpp):
+// the real log_backend.cpp, with producer threads standing in for tasks and
+// interrupts on every core and one thread draining to a fake Serial port.
+// Producers mix formatted records, interned records and raw text writes up to
+// the largest size, plus oversize writes that must be refused. The drain side
+// stalls now and then so the ring fills up.
+//
+// Every record the output holds must be one a producer queued, complete and
+// never interleaved with another; every queued record must come out once and
+// in order; and each refused record must show up in the drop counter. Built
+// and run by scripts/check_log_ring.py.
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "log_backend.hpp"
+#include "serial.hpp"
+
+using namespace ru::driver;
+
+// Drain sink: collects what the drain task sends
+namespace ru::driver {
+class SerialInstanceSpecific {
+public:
+  std::string output;
+};
+
+// The port of the last Serial built
+SerialInstanceSpecific* sink_port;
+
+Serial::Serial() : p_instance_specific(new SerialInstanceSpecific()) {
+  sink_port = p_instance_specific;
+}
+
+expected::expected<void, Error> Serial::init(const Config&) {
+  return {};
+}
+
+expected::expected<void, Error> Serial::stop() {
+  delete p_instance_specific;
+  p_instance_specific = nullptr;
+  return {};
+}
+
+expected::expected<size_t, Error> Serial::write(const uint8_t* data, size_t len) {
+  p_instance_specific->output.append(reinterpret_cast<const char*>(data), len);
+  return len;
+}
+} // namespace ru::driver
+
+namespace {
+const unsigned producer_count = 4;
+const uint32_t interned_base = 1000;
+
+enum Kind { kind_format, kind_interned, kind_text, kind_count };
+
+// Records a producer got queued, per kind, in queueing order
+struct Producer {
+  std::vector<uint32_t> queued[kind_count];
+  uint32_t refused = 0;
+};
+
+char filler(uint32_t seq, size_t i) {
+  return static_cast<char>('a' + (seq + i) % 26);
+}
+
+std::string text_record(unsigned producer, uint32_t seq, size_t size) {
+  std::string text = "w" + std::to_string(producer) + " " + std::to_string(seq) + " ";
+  for (size_t i = 0; text.size() < size - 1; ++i) {
+    text += filler(seq, i);
+  }
+  return text + "\n";
+}
+
+void produce(unsigned id, uint32_t records, Producer& out) {
+  std::mt19937 rng(id + 1);
+  for (uint32_t seq = 0; seq < records; ++seq) {
+    const int pick = std::uniform_int_distribution<int>(0, 99)(rng);
+    bool ok;
+    if (pick < 40) {
+      ok = debug::log("f%u %u\n", id, seq);
+      if (ok) {
+        out.queued[kind_format].push_back(seq);
+      }
+    } else if (pick < 70) {
+      const uint32_t args[] = {seq, ~seq, id};
+      ok = debug::log_interned(interned_base + id, args, 3);
+      if (ok) {
+        out.queued[kind_interned].push_back(seq);
+      }
+    } else if (pick < 98) {
+      std::uniform_int_distribution<size_t> size(16, debug::log_max_write_size);
+      const std::string text = text_record(id, seq, size(rng));
+      ok = debug::log_write(text.data(), text.size());
+      if (ok) {
+        out.queued[kind_text].push_back(seq);
+      }
+    } else {
+      // Too long for one claim: refused whole, never split
+      const std::string text = text_record(id, seq, debug::log_max_write_size + 1);
+      ok = debug::log_write(text.data(), text.size());
+      if (ok) {
+        // Not listed as queued: its output fails the check
+        std::printf("oversize write %u/%u accepted\n", id, seq);
+      }
+    }
+    out.refused += !ok;
+    // Bursts of records, as a task between two waits would log
+    if (seq % 4 == 3) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+}
+
+// Parses the drained stream: interned records are 0x00 | COBS | 0x00 frames,
+// text records are lines
+struct Parsed {
+  std::vector<uint32_t> records[producer_count][kind_count];
+  size_t errors = 0;
+};
+
+void error(Parsed& parsed, const char* what, const std::string& record) {
+  if (parsed.errors++ < 10) {
+    std::printf("bad %s: %.60s\n", what, record.c_str());
+  }
+}
+
+void parse_frame(const std::string& frame, Parsed& parsed) {
+  std::vector<uint8_t> payload;
+  for (size_t i = 0; i < frame.size();) {
+    const auto code = static_cast<uint8_t>(frame[i++]);
+    for (uint8_t k = 1; k < code && i < frame.size(); ++k) {
+      payload.push_back(static_cast<uint8_t>(frame[i++]));
+    }
+    if (code != 0xFF && i < frame.size()) {
+      payload.push_back(0);
+    }
+  }
+  uint32_t index = 0;
+  size_t pos = 0;
+  for (int shift = 0; pos < payload.size(); shift += 7) {
+    index |= static_cast<uint32_t>(payload[pos] & 0x7F) << shift;
+    if (!(payload[pos++] & 0x80)) {
+      break;
+    }
+  }
+  uint32_t args[3] = {};
+  if (payload.size() - pos != sizeof(args)) {
+    error(parsed, "frame", frame);
+    return;
+  }
+  for (size_t i = 0; i < sizeof(args); ++i) {
+    args[i / 4] |= static_cast<uint32_t>(payload[pos + i]) << (8 * (i % 4));
+  }
+  const uint32_t id = index - interned_base;
+  if (id >= producer_count || args[1] != ~args[0] || args[2] != id) {
+    error(parsed, "frame", frame);
+    return;
+  }
+  parsed.records[id][kind_interned].push_back(args[0]);
+}
+
+void parse_line(const std::string& line, Parsed& parsed) {
+  unsigned id = 0;
+  uint32_t seq = 0;
+  int used = 0;
+  if (std::sscanf(line.c_str(), "f%u %u%n", &id, &seq, &used) == 2 && id < producer_count &&
+      static_cast<size_t>(used) == line.size()) {
+    parsed.records[id][kind_format].push_back(seq);
+    return;
+  }
+  // The whole text, filler included, must be the one that producer wrote
+  if (std::sscanf(line.c_str(), "w%u %u", &id, &seq) == 2 && id < producer_count &&
+      line + "\n" == text_record(id, seq, line.size() + 1)) {
+    parsed.records[id][kind_text].push_back(seq);
+    return;
+  }
+  error(parsed, "line", line);
+}
+
+Parsed parse(const std::string& output) {
+  Parsed parsed;
+  for (size_t pos = 0; pos < output.size();) {
+    if (output[pos] == 0) {
+      const size_t end = output.find('\0', pos + 1);
+      if (end == std::string::npos) {
+        error(parsed, "frame", output.substr(pos));
+        break;
+      }
+      parse_frame(output.substr(pos + 1, end - pos - 1), parsed);
+      pos = end + 1;
+    } else {
+      const size_t end = output.find('\n', pos);
+      if (end == std::string::npos) {
+        error(parsed, "line", output.substr(pos));
+        break;
+      }
+      parse_line(output.substr(pos, end - pos), parsed);
+      pos = end + 1;
+    }
+  }
+  return parsed;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  const uint32_t records = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 20000;
+
+  Serial sink;
+  std::atomic<bool> done{false};
+  std::thread drainer([&] {
+    std::mt19937 rng(99);
+    for (;;) {
+      const bool last = done.load();
+      debug::log_drain(&sink);
+      if (last) {
+        break;
+      }
+      // Stalls long enough for the producers to fill the ring
+      if (std::uniform_int_distribution<int>(0, 63)(rng) == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+  });
+
+  Producer producers[producer_count];
+  std::vector<std::thread> threads;
+  for (unsigned id = 0; id < producer_count; ++id) {
+    threads.emplace_back(produce, id, records, std::ref(producers[id]));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  done = true;
+  drainer.join();
+
+  const Parsed parsed = parse(sink_port->output);
+
+  size_t failures = parsed.errors;
+  uint32_t queued = 0;
+  uint32_t refused = 0;
+  for (unsigned id = 0; id < producer_count; ++id) {
+    refused += producers[id].refused;
+    for (int kind = 0; kind < kind_count; ++kind) {
+      queued += static_cast<uint32_t>(producers[id].queued[kind].size());
+      if (parsed.records[id][kind] != producers[id].queued[kind]) {
+        std::printf("producer %u kind %d: %zu queued, %zu out or out of order\n", id, kind,
+                    producers[id].queued[kind].size(), parsed.records[id][kind].size());
+        ++failures;
+      }
+    }
+  }
+
+  const auto stats = debug::log_stats();
+  if (stats.records != queued || stats.dropped[0] != refused) {
+    std::printf("stats: %u records, %u dropped; expected %u and %u\n", stats.records,
+                stats.dropped[0], queued, refused);
+    ++failures;
+  }
+  if (!refused) {
+    std::printf("the ring never filled up\n");
+    ++failures;
+  }
+
+  std::printf("%u producers, %u records queued, %u refused, %zu failures\n", producer_count,
+              queued, refused, failures);
+  return failures ? 1 : 0;
+}
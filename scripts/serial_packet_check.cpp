@@ -0,0 +1,358 @@
+// Host check of the serial packet codec (lib/drivers/include/serial_packet.hpp):
+// the real SerialPacket over a loopback Serial that hands the received bytes
+// back in random chunks. Round-trips random packets, the COBS edge cases (no
+// zero at all, runs of 0x00, 0xFE and 0xFF, empty and largest payloads), then
+// checks that a CRC mismatch, a truncated frame, a lost delimiter and a frame
+// with no delimiter are counted, dropped and followed by a clean resync.
+// Finally measures the encode and the decode throughput, each on its own. Built and run by
+// scripts/check_serial_packet.py.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "serial_packet.hpp"
+
+using namespace ru::driver;
+
+namespace {
+std::mt19937 rng(12345);
+
+int random_int(int lo, int hi) {
+  return std::uniform_int_distribution<int>(lo, hi)(rng);
+}
+} // namespace
+
+// Loopback port: what is written lands in the wire, what is read comes off it
+namespace ru::driver {
+class SerialInstanceSpecific {
+public:
+  std::deque<uint8_t> wire;
+  // Largest chunk try_read() returns (random below it)
+  size_t max_chunk = 64;
+  // Capture the next writes instead of looping them back
+  std::vector<uint8_t>* capture = nullptr;
+};
+
+// The port of the last Serial built
+SerialInstanceSpecific* loopback_port;
+
+Serial::Serial() : p_instance_specific(new SerialInstanceSpecific()) {
+  loopback_port = p_instance_specific;
+}
+
+expected::expected<void, Error> Serial::init(const Config&) {
+  return {};
+}
+
+expected::expected<void, Error> Serial::stop() {
+  delete p_instance_specific;
+  p_instance_specific = nullptr;
+  return {};
+}
+
+expected::expected<void, Error> Serial::write_async(const uint8_t* data, size_t len,
+                                                    SerialTxCallback callback, void* ctx) {
+  auto* hw = p_instance_specific;
+  if (hw->capture) {
+    hw->capture->insert(hw->capture->end(), data, data + len);
+  } else {
+    hw->wire.insert(hw->wire.end(), data, data + len);
+  }
+  if (callback) {
+    callback(ctx);
+  }
+  return {};
+}
+
+expected::expected<void, Error> Serial::flush(uint32_t) {
+  return {};
+}
+
+expected::expected<std::optional<size_t>, Error> Serial::try_read(uint8_t* data, size_t len) {
+  auto* hw = p_instance_specific;
+  size_t count = std::min({len, hw->wire.size(), static_cast<size_t>(random_int(
+                                                     1, static_cast<int>(hw->max_chunk)))});
+  if (!count) {
+    return std::optional<size_t>{};
+  }
+  std::copy(hw->wire.begin(), hw->wire.begin() + count, data);
+  hw->wire.erase(hw->wire.begin(), hw->wire.begin() + count);
+  return count;
+}
+
+expected::expected<size_t, Error> Serial::read(uint8_t* data, size_t len, uint32_t) {
+  auto got = try_read(data, len);
+  if (!*got) {
+    return expected::unexpected(RU_ERROR(SerialError::timeout, "serial read timeout"));
+  }
+  return **got;
+}
+} // namespace ru::driver
+
+namespace {
+struct Received {
+  uint8_t type;
+  std::vector<uint8_t> payload;
+};
+
+std::vector<Received> received;
+
+void on_packet(uint8_t type, std::span<const uint8_t> payload, void*) {
+  received.push_back({type, std::vector<uint8_t>(payload.begin(), payload.end())});
+}
+
+// Handled types; 0x7F is left without a handler
+const uint8_t handled_types[] = {0x00, 0x01, 0xFE, 0xFF};
+const uint8_t unhandled_type = 0x7F;
+
+struct Loopback {
+  Serial serial;
+  SerialInstanceSpecific* hw = loopback_port;
+  SerialPacket packet{serial};
+
+  Loopback() {
+    for (uint8_t type : handled_types) {
+      (void)packet.on(type, on_packet);
+    }
+  }
+  ~Loopback() { (void)serial.stop(); }
+
+  SerialInstanceSpecific& port() { return *hw; }
+
+  // Polls until the wire is empty
+  void drain() {
+    for (int guard = 0; guard < 100000; ++guard) {
+      (void)packet.poll();
+      if (port().wire.empty()) {
+        (void)packet.poll();
+        return;
+      }
+    }
+  }
+
+  // Encoded bytes of one packet, as send() puts them on the wire
+  std::vector<uint8_t> encode(uint8_t type, const std::vector<uint8_t>& payload) {
+    std::vector<uint8_t> bytes;
+    port().capture = &bytes;
+    (void)packet.send(type, std::span<const uint8_t>(payload));
+    port().capture = nullptr;
+    return bytes;
+  }
+};
+
+std::vector<uint8_t> random_payload(size_t len) {
+  std::vector<uint8_t> payload(len);
+  // Plain random bytes, or runs of the COBS special values
+  const int kind = random_int(0, 3);
+  for (auto& byte : payload) {
+    switch (kind) {
+    case 0:
+      byte = static_cast<uint8_t>(random_int(0, 255));
+      break;
+    case 1:
+      byte = static_cast<uint8_t>(random_int(1, 255));
+      break;
+    default: {
+      static const uint8_t special[] = {0x00, 0x01, 0xFE, 0xFF};
+      byte = special[random_int(0, 3)];
+      break;
+    }
+    }
+  }
+  return payload;
+}
+
+int failures = 0;
+
+void expect(bool ok, const char* what) {
+  if (!ok) {
+    std::printf("FAIL: %s\n", what);
+    ++failures;
+  }
+}
+
+bool matches(const Received& got, uint8_t type, const std::vector<uint8_t>& payload) {
+  return got.type == type && got.payload == payload;
+}
+
+// Sends packets back to back and checks they all arrive, in order
+void check_round_trip(Loopback& link, const std::vector<std::vector<uint8_t>>& payloads,
+                      const char* what) {
+  std::vector<uint8_t> types;
+  received.clear();
+  for (const auto& payload : payloads) {
+    types.push_back(handled_types[random_int(0, 3)]);
+    expect(static_cast<bool>(link.packet.send(types.back(), std::span<const uint8_t>(payload))),
+           what);
+  }
+  link.drain();
+  bool ok = received.size() == payloads.size();
+  for (size_t i = 0; ok && i < payloads.size(); ++i) {
+    ok = matches(received[i], types[i], payloads[i]);
+  }
+  expect(ok, what);
+}
+
+void check_edge_cases(Loopback& link) {
+  const size_t max = SerialPacket::max_payload;
+  check_round_trip(link, {{}}, "empty payload");
+  check_round_trip(link, {std::vector<uint8_t>(max, 0xFF)}, "largest payload of 0xFF");
+  check_round_trip(link, {std::vector<uint8_t>(max, 0xFE)}, "largest payload of 0xFE");
+  check_round_trip(link, {std::vector<uint8_t>(max, 0x00)}, "largest payload of 0x00");
+  const std::vector<uint8_t> too_long(max + 1, 0x00);
+  expect(!link.packet.send(0x01, std::span<const uint8_t>(too_long)), "too long payload accepted");
+
+  // No zero in the payload: one run over the whole COBS block
+  std::vector<uint8_t> full(max);
+  for (size_t i = 0; i < max; ++i) {
+    full[i] = static_cast<uint8_t>(1 + i % 255);
+  }
+  check_round_trip(link, {full}, "full COBS block");
+
+  // Zeros at both ends and around runs of 0xFE/0xFF
+  check_round_trip(link, {{0x00}, {0x00, 0x00}, {0xFF, 0x00, 0xFF}, {0xFE, 0xFE, 0x00},
+                          {0x00, 0xFF, 0xFF, 0xFF, 0x00}},
+                   "zeros at the ends");
+
+  const auto& stats = link.packet.stats();
+  const uint32_t unhandled = stats.unhandled;
+  received.clear();
+  (void)link.packet.send(unhandled_type, std::span<const uint8_t>());
+  link.drain();
+  expect(received.empty() && stats.unhandled == unhandled + 1, "unhandled type counted");
+}
+
+// Puts raw bytes on the wire, then a good packet which must get through
+void check_dropped(Loopback& link, const std::vector<uint8_t>& bytes,
+                   uint32_t SerialPacket::Stats::*counter, const char* what) {
+  const auto before = link.packet.stats();
+  const std::vector<uint8_t> good = {0x12, 0x34, 0x00, 0x56};
+  received.clear();
+  link.port().wire.insert(link.port().wire.end(), bytes.begin(), bytes.end());
+  (void)link.packet.send(0x01, std::span<const uint8_t>(good));
+  link.drain();
+  const auto& after = link.packet.stats();
+  expect(after.*counter == before.*counter + 1, what);
+  expect(received.size() == 1 && matches(received[0], 0x01, good), what);
+}
+
+void check_corruption(Loopback& link) {
+  using Stats = SerialPacket::Stats;
+
+  // Type and payload without zeros: byte 2 is data, not a COBS code
+  const std::vector<uint8_t> payload = {0x11, 0x22, 0x33, 0x44, 0x55};
+  auto frame = link.encode(0x01, payload);
+  frame[2] ^= 0x01;
+  check_dropped(link, frame, &Stats::crc_errors, "crc mismatch");
+
+  // The code byte points past the end of the frame
+  frame = link.encode(0x01, payload);
+  frame.erase(frame.end() - 3, frame.end() - 1);
+  check_dropped(link, frame, &Stats::framing_errors, "truncated frame");
+
+  // Less than type and CRC
+  check_dropped(link, {0x02, 0x01, 0x00}, &Stats::framing_errors, "runt frame");
+
+  // Lost delimiter: two frames merge into one
+  frame = link.encode(0x01, payload);
+  frame.pop_back();
+  auto second = link.encode(0xFE, {0xAA, 0xBB});
+  frame.insert(frame.end(), second.begin(), second.end());
+  const auto before = link.packet.stats();
+  check_dropped(link, frame, &Stats::packets, "lost delimiter");
+  const auto& after = link.packet.stats();
+  expect(after.crc_errors + after.framing_errors == before.crc_errors + before.framing_errors + 1,
+         "lost delimiter");
+
+  // No delimiter within the largest encoded packet, until the one ending it
+  std::vector<uint8_t> endless(600, 0x55);
+  endless.push_back(0x00);
+  check_dropped(link, endless, &Stats::overflows, "endless frame");
+
+  // Random bit flips: whatever is dispatched must be a packet that was sent
+  received.clear();
+  std::vector<std::vector<uint8_t>> sent;
+  for (int i = 0; i < 2000; ++i) {
+    auto packet = random_payload(static_cast<size_t>(random_int(2, 60)));
+    packet[0] = static_cast<uint8_t>(i);
+    packet[1] = static_cast<uint8_t>(i >> 8);
+    auto bytes = link.encode(0x00, packet);
+    if (random_int(0, 3) == 0) {
+      bytes[static_cast<size_t>(random_int(0, static_cast<int>(bytes.size()) - 1))] ^=
+          static_cast<uint8_t>(1 << random_int(0, 7));
+    }
+    link.port().wire.insert(link.port().wire.end(), bytes.begin(), bytes.end());
+    sent.push_back(packet);
+  }
+  link.drain();
+  size_t bogus = 0;
+  for (const auto& got : received) {
+    const size_t seq = got.payload.size() >= 2 ? got.payload[0] | got.payload[1] << 8 : sent.size();
+    bogus += seq >= sent.size() || got.payload != sent[seq];
+  }
+  expect(!bogus, "corrupted packet dispatched");
+  expect(received.size() >= sent.size() / 2, "too many packets lost to bit flips");
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void benchmark(Loopback& link) {
+  const std::vector<uint8_t> payload = random_payload(SerialPacket::max_payload);
+  const int packets = 20000;
+  const double megabytes = packets * payload.size() / 1e6;
+
+  // Encode: send() into a buffer reserved beforehand
+  std::vector<uint8_t> bytes;
+  bytes.reserve(packets * (SerialPacket::max_payload + 16));
+  link.port().capture = &bytes;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < packets; ++i) {
+    (void)link.packet.send(0x01, std::span<const uint8_t>(payload));
+  }
+  const double encode_seconds = seconds_since(start);
+  link.port().capture = nullptr;
+
+  // Decode: the same bytes read back by poll() in chunks of up to 4 KiB, the
+  // copies out of the loopback port and into `received` included
+  link.port().max_chunk = 4096;
+  link.port().wire.assign(bytes.begin(), bytes.end());
+  received.clear();
+  received.reserve(packets);
+  start = std::chrono::steady_clock::now();
+  while (!link.port().wire.empty()) {
+    (void)link.packet.poll();
+  }
+  (void)link.packet.poll();
+  const double decode_seconds = seconds_since(start);
+
+  expect(received.size() == static_cast<size_t>(packets), "benchmark packets lost");
+  std::printf("encode: %.1f MB/s, decode: %.1f MB/s of payload (%d packets of %zu bytes)\n",
+              megabytes / encode_seconds, megabytes / decode_seconds, packets, payload.size());
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  const int rounds = argc > 1 ? std::atoi(argv[1]) : 200;
+
+  Loopback link;
+  check_edge_cases(link);
+  for (int round = 0; round < rounds; ++round) {
+    std::vector<std::vector<uint8_t>> payloads(static_cast<size_t>(random_int(1, 8)));
+    for (auto& payload : payloads) {
+      payload = random_payload(static_cast<size_t>(random_int(0, SerialPacket::max_payload)));
+    }
+    check_round_trip(link, payloads, "random packets");
+  }
+  check_corruption(link);
+  benchmark(link);
+
+  std::printf("%d rounds, %d failures\n", rounds, failures);
+  return failures ? 1 : 0;
+}
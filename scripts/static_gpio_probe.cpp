@@ -0,0 +1,17 @@
+// Probe for scripts/check_static_gpio.py: one function per access, compiled
+// with the firmware flags and measured in the disassembly.
+#include "static_gpio.hpp"
+
+using ProbePin = ru::driver::StaticGpio<'E', 3>;
+using ProbePinLow = ru::driver::StaticGpio<'E', 3, false>;
+
+extern "C" {
+
+void probe_set_high() { ProbePin::set_high(); }
+void probe_set_low() { ProbePin::set_low(); }
+void probe_set_active_low() { ProbePinLow::set_active(); }
+void probe_set_level(bool active) { ProbePin::set_level(active); }
+void probe_toggle() { ProbePin::toggle(); }
+bool probe_is_active() { return ProbePinLow::is_active(); }
+
+}